@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace bench {
+
+/**
+ * Keeps the optimizer from discarding a value that is only computed for timing.
+ */
+template<typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * Runs fn() `iterations` times after a short warm-up and returns the mean
+ * wall time of a single call in nanoseconds.
+ */
+template<typename Fn>
+inline double measureNs(Fn&& fn, uint32_t iterations) {
+    for (uint32_t i = 0; i < iterations / 10 + 1; i++) {
+        fn();
+    }
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+inline void printRow(const std::string& name, double value, const std::string& unit) {
+    std::cout << std::left << std::setw(36) << name
+              << std::right << std::setw(14) << std::fixed << std::setprecision(1) << value
+              << " " << unit << "\n";
+}
+
+} // namespace bench
@@ -0,0 +1,123 @@
+//
+// Measures FAsTMatch::evaluateConfigs on configurations of the first level,
+// in configs/s, for the sample counts of several epsilon values, with and
+// without photometric invariance, at the scalar level and at the best level
+// of this CPU. The early termination rows use the margins calculateLevel
+// passes on its first three levels; the template is cut from the image, so
+// a good config exists to bound the others as it would in a real search.
+//
+
+#include "BenchUtils.hpp"
+#include "FAsT-Match/MatchNet.h"
+#include "src/FastMatch.hpp"
+#include "src/GridConfigExpander.hpp"
+#include "src/MatchConfigBatch.hpp"
+#include "src/SampleKernels.hpp"
+#include "src/Utilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+// Smooth like the blurred maps the search runs on, so nearby configs score alike
+cv::Mat smoothImage(int width, int height, std::mt19937& gen) {
+    std::uniform_real_distribution<float> phase(0.f, 6.28f), noise(-0.05f, 0.05f);
+    float p1 = phase(gen), p2 = phase(gen), p3 = phase(gen);
+    cv::Mat image(height, width, CV_32F);
+    for (int y = 0; y < height; y++) {
+        auto* row = image.ptr<float>(y);
+        for (int x = 0; x < width; x++) {
+            row[x] = 0.5f + 0.2f * std::sin(0.11f * x + p1) * std::cos(0.07f * y + p2) +
+                     0.2f * std::sin(0.05f * (x + y) + p3) + noise(gen);
+        }
+    }
+    return image;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int imageSide = argc > 1 ? std::atoi(argv[1]) : 400;
+    int templSide = argc > 2 ? std::atoi(argv[2]) : 100;
+    size_t maxConfigs = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 20000;
+    const float delta = 0.25f, minScale = 0.5f, maxScale = 2.0f;
+    std::mt19937 gen(42);
+
+    cv::Mat image = smoothImage(imageSide, imageSide, gen);
+    cv::Mat templ = image(cv::Rect((imageSide - templSide) / 2, (imageSide - templSide) / 2, templSide, templSide))
+            .clone();
+
+    // Net of the first level, as FAsTMatch::apply builds it
+    int r1 = static_cast<int>(0.5 * (templSide - 1)), r2 = static_cast<int>(0.5 * (imageSide - 1));
+    float maxTrans = r2 - r1 * minScale;
+    GridConfigExpander grid;
+    ConfigExpanderBase& expander = grid;
+    expander.setNet(fast_match::MatchNet(templSide, templSide, delta, -maxTrans, maxTrans, -maxTrans, maxTrans,
+                                         static_cast<float>(-M_PI), static_cast<float>(M_PI), minScale, maxScale));
+
+    fast_match::MatchConfigBatch configs;
+    expander.createListOfConfigs(templ.size(), image.size(), configs);
+    Utilities::configsToAffine(configs, image.size(), templ.size());
+    // An even spread over the grid, so the configs around the true placement are among them
+    if (configs.size() > maxConfigs) {
+        std::vector<uint8_t> keep(configs.size(), 0);
+        for (size_t i = 0; i < maxConfigs; i++) {
+            keep[i * configs.size() / maxConfigs] = 1;
+        }
+        configs.compact(keep);
+    }
+    std::cout << imageSide << "x" << imageSide << " image, " << templSide << "x" << templSide << " template, "
+              << configs.size() << " configs\n";
+
+    const simd::Level best = simd::detectLevel();
+    const simd::Level levels[] = {simd::Level::Scalar, best};
+    for (float epsilon : {0.05f, 0.1f, 0.15f, 0.25f}) {
+        int points = static_cast<int>(std::round(10 / (epsilon * epsilon)));
+        cv::Mat xs(1, points, CV_32SC1), ys(1, points, CV_32SC1);
+        std::uniform_int_distribution<int> coord(1, templSide);
+        for (int i = 0; i < points; i++) {
+            xs.at<int>(0, i) = coord(gen);
+            ys.at<int>(0, i) = coord(gen);
+        }
+
+        for (bool photometric : {false, true}) {
+            for (auto level : levels) {
+                simd::setLevel(level);
+                double ns = bench::measureNs([&] {
+                    auto distances = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys,
+                                                                            photometric);
+                    bench::doNotOptimize(distances.data());
+                }, 3);
+                std::string name = "eps " + std::to_string(epsilon).substr(0, 4) + ", " + std::to_string(points) +
+                                   " pts" + (photometric ? ", photometric" : "") + ", " + simd::levelName(level);
+                bench::printRow(name, configs.size() * 1e9 / ns, "configs/s");
+                if (level == best) break;
+            }
+        }
+
+        simd::setLevel(best);
+        auto full = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, false);
+        float levelDelta = delta;
+        for (int level = 1; level <= 3; level++, levelDelta /= 1.511f) {
+            double margin = Utilities::getThresholdPerDelta(levelDelta);
+            std::vector<double> distances;
+            double ns = bench::measureNs([&] {
+                distances = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, false, margin);
+                bench::doNotOptimize(distances.data());
+            }, 3);
+            size_t abandoned = 0;
+            for (size_t i = 0; i < full.size(); i++) {
+                abandoned += distances[i] != full[i];
+            }
+            std::string name = "eps " + std::to_string(epsilon).substr(0, 4) + ", " + std::to_string(points) +
+                               " pts, bound of level " + std::to_string(level);
+            bench::printRow(name, configs.size() * 1e9 / ns, "configs/s");
+            bench::printRow("  abandoned", 100.0 * abandoned / full.size(), "%");
+        }
+    }
+    simd::setLevel(best);
+    return 0;
+}
@@ -0,0 +1,155 @@
+//
+// Measures the per particle cost of evaluating map samples: the
+// double-precision loops ImageSample used to run versus the dispatched
+// kernels, for both the correlation and the gather from the map. The
+// correlation is measured on float samples and on raw bytes.
+//
+
+#include "BenchUtils.hpp"
+#include "src/AlignedBuffer.hpp"
+#include "src/SampleKernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+// 10% of a 640x480 template, as sampled by ParticleFastMatch::setTemplate
+constexpr size_t kSamplePoints = 640 * 480 / 10;
+constexpr size_t kParticles = 512;
+
+double legacyDot(const std::vector<float>& a, const std::vector<float>& b) {
+    double top = 0.0;
+    for (size_t i = 0; i < a.size(); i++) {
+        top += a[i] * b[i];
+    }
+    return top;
+}
+
+// Gather as done by the ImageSample constructor: double affine, clamp, push_back
+std::vector<float> legacyGather(const std::vector<uint8_t>& map, int rows, int cols,
+                                const std::vector<int32_t>& xs, const std::vector<int32_t>& ys, const double m[6]) {
+    std::vector<float> sample;
+    double sum = 0.0;
+    for (size_t i = 0; i < xs.size(); i++) {
+        int x = std::clamp(static_cast<int>(m[0] * xs[i] + m[1] * ys[i] + m[2]), 0, cols - 1);
+        int y = std::clamp(static_cast<int>(m[3] * xs[i] + m[4] * ys[i] + m[5]), 0, rows - 1);
+        float val = map[static_cast<size_t>(y) * cols + x];
+        sum += val;
+        sample.push_back(val);
+    }
+    auto average = static_cast<float>(sum / static_cast<double>(xs.size()));
+    for (float& val : sample) {
+        val -= average;
+    }
+    return sample;
+}
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> dist(-128.f, 127.f);
+
+    std::vector<float> templLegacy(kSamplePoints);
+    AlignedVector<float> templ(paddedLength<float>(kSamplePoints), 0.f);
+    for (size_t i = 0; i < kSamplePoints; i++) {
+        templ[i] = templLegacy[i] = dist(gen);
+    }
+    std::vector<std::vector<float>> mapsLegacy(kParticles, std::vector<float>(kSamplePoints));
+    std::vector<AlignedVector<float>> maps(kParticles, AlignedVector<float>(templ.size(), 0.f));
+    for (size_t p = 0; p < kParticles; p++) {
+        for (size_t i = 0; i < kSamplePoints; i++) {
+            maps[p][i] = mapsLegacy[p][i] = dist(gen);
+        }
+    }
+
+    std::cout << "calcSimilarity, " << kSamplePoints << " samples, " << kParticles << " particles\n";
+    double legacy = bench::measureNs([&] {
+        for (const auto& m : mapsLegacy) {
+            bench::doNotOptimize(legacyDot(templLegacy, m));
+        }
+    }, 20) / kParticles;
+    bench::printRow("legacy double loop", legacy, "ns/particle");
+
+    const simd::Level levels[] = {simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2, simd::Level::AVX512};
+    for (auto level : levels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double ns = bench::measureNs([&] {
+            for (const auto& m : maps) {
+                bench::doNotOptimize(simd::dotProduct(templ.data(), m.data(), templ.size()));
+            }
+        }, 20) / kParticles;
+        bench::printRow(std::string("kernel ") + simd::levelName(level), ns, "ns/particle");
+    }
+
+    // Same correlation on raw bytes, as ImageSampleBatch runs it
+    std::uniform_int_distribution<int> byteDist(0, 255);
+    AlignedVector<uint8_t> templBytes(paddedLength<uint8_t>(kSamplePoints), 0);
+    std::vector<AlignedVector<uint8_t>> mapBytes(kParticles, AlignedVector<uint8_t>(templBytes.size(), 0));
+    for (size_t i = 0; i < kSamplePoints; i++) {
+        templBytes[i] = static_cast<uint8_t>(byteDist(gen));
+        for (auto& m : mapBytes) {
+            m[i] = static_cast<uint8_t>(byteDist(gen));
+        }
+    }
+    for (auto level : levels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double ns = bench::measureNs([&] {
+            for (const auto& m : mapBytes) {
+                bench::doNotOptimize(simd::dotProductU8(templBytes.data(), m.data(), templBytes.size()));
+            }
+        }, 20) / kParticles;
+        std::string vnni = level >= simd::Level::AVX2 && simd::hasVnni() ? " vnni" : "";
+        bench::printRow(std::string("integer kernel ") + simd::levelName(level) + vnni, ns, "ns/particle");
+    }
+
+    // Rotated gathers from a 4000x4000 map, one placement per particle
+    const int rows = 4000, cols = 4000;
+    std::vector<uint8_t> map(static_cast<size_t>(rows) * cols);
+    for (auto& px : map) {
+        px = static_cast<uint8_t>(gen());
+    }
+    std::uniform_int_distribution<int> xDist(0, 639), yDist(0, 479);
+    std::vector<int32_t> xs(kSamplePoints), ys(kSamplePoints);
+    for (size_t i = 0; i < kSamplePoints; i++) {
+        xs[i] = xDist(gen);
+        ys[i] = yDist(gen);
+    }
+    std::vector<std::array<double, 6>> placements(kParticles);
+    std::uniform_real_distribution<double> angleDist(-M_PI, M_PI), posDist(800.0, 3200.0);
+    for (auto& m : placements) {
+        double a = angleDist(gen), s = 0.9;
+        m = {s * std::cos(a), s * std::sin(a), posDist(gen), -s * std::sin(a), s * std::cos(a), posDist(gen)};
+    }
+
+    std::cout << "\nmap gather, " << kSamplePoints << " samples, " << kParticles << " particles\n";
+    double legacyGatherNs = bench::measureNs([&] {
+        for (const auto& m : placements) {
+            bench::doNotOptimize(legacyGather(map, rows, cols, xs, ys, m.data()).data());
+        }
+    }, 5) / kParticles;
+    bench::printRow("legacy double gather", legacyGatherNs, "ns/particle");
+
+    simd::ImageView8u view{map.data(), rows, cols, static_cast<size_t>(cols)};
+    AlignedVector<uint8_t> arena(kParticles * paddedLength<uint8_t>(kSamplePoints), 0);
+    for (auto level : levels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double ns = bench::measureNs([&] {
+            for (size_t p = 0; p < kParticles; p++) {
+                float m[6];
+                std::copy(placements[p].begin(), placements[p].end(), m);
+                simd::SampleStats stats;
+                simd::gatherAffine(view, xs.data(), ys.data(), kSamplePoints, simd::FixedAffine::fromFloat(m),
+                                   arena.data() + p * paddedLength<uint8_t>(kSamplePoints), stats);
+                bench::doNotOptimize(stats.sum);
+            }
+        }, 5) / kParticles;
+        bench::printRow(std::string("batched gather ") + simd::levelName(level), ns, "ns/particle");
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+//
+// Measures the bin bookkeeping of the KLD-sampling loop for growing particle
+// counts: string keys with a linear search and the per-bin pow/sqrt bound,
+// as filterParticles used to do, versus the flat hash set and bound table.
+//
+
+#include "BenchUtils.hpp"
+#include "src/KldSampling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+constexpr int kBinSize = 5;
+constexpr float kKldError = 0.5f;
+constexpr float kZValue = 2.33f;
+
+struct Position {
+    int x, y;
+};
+
+int legacyLoop(const std::vector<Position>& cloud) {
+    std::vector<std::string> bins;
+    int support = 0, samplingCount = 0;
+    for (const auto& p : cloud) {
+        std::string bin = std::to_string(p.x - (p.x % kBinSize)) + "x" + std::to_string(p.y - (p.y % kBinSize));
+        if (std::find(bins.begin(), bins.end(), bin) == bins.end()) {
+            bins.push_back(bin);
+            support++;
+            if (support >= 2) {
+                int k = support - 1;
+                k = static_cast<int>(ceil(k / (2 * kKldError) * pow(1 - 2 / (9.0 * k) + sqrt(2 / (9.0 * k)) * kZValue, 3)));
+                samplingCount = std::max(samplingCount, k);
+            }
+        }
+    }
+    return samplingCount;
+}
+
+int hashedLoop(const std::vector<Position>& cloud, KldBinSet& bins, KldBoundTable& bound) {
+    bins.clear();
+    int support = 0, samplingCount = 0;
+    for (const auto& p : cloud) {
+        if (bins.insert(KldBinSet::key(p.x / kBinSize, p.y / kBinSize))) {
+            support++;
+            if (support >= 2) {
+                samplingCount = std::max(samplingCount, bound(static_cast<size_t>(support)));
+            }
+        }
+    }
+    return samplingCount;
+}
+} // namespace
+
+int main() {
+    std::mt19937 gen(42);
+    KldBinSet bins;
+    KldBoundTable bound(kKldError, kZValue);
+
+    const int counts[] = {200, 500, 1000, 2000, 5000, 10000, 20000};
+    for (int count : counts) {
+        // Particle cloud after propagation, wide enough that most particles open a new bin
+        std::normal_distribution<double> dist(0.0, 2.0 * kBinSize * std::sqrt(static_cast<double>(count)));
+        std::vector<Position> cloud(static_cast<size_t>(count));
+        for (auto& p : cloud) {
+            p = {2000 + static_cast<int>(dist(gen)), 2000 + static_cast<int>(dist(gen))};
+        }
+        uint32_t iterations = count <= 2000 ? 20 : 2;
+
+        std::cout << "\n" << count << " particles\n";
+        double legacy = bench::measureNs([&] { bench::doNotOptimize(legacyLoop(cloud)); }, iterations);
+        bench::printRow("string bins + linear search", legacy / 1000.0, "us/frame");
+        double hashed = bench::measureNs([&] { bench::doNotOptimize(hashedLoop(cloud, bins, bound)); }, iterations * 50);
+        bench::printRow("hash set + bound table", hashed / 1000.0, "us/frame");
+        bench::printRow("speedup", legacy / hashed, "x");
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+//
+// Measures the first FAsT-Match level: generating the configuration grid,
+// dropping the configurations outside the image and scoring the rest, in
+// configs/s, and the peak resident memory it takes. The bounds check runs
+// at the scalar level and at the best one of this CPU, with the compaction
+// and on its own, and once more as the former cv::Mat product of the corners. The streamed grid of
+// calculateLevel runs first, then the grid stored as a batch, then the former
+// layout with a cv::Mat per configuration; each peak printed covers only the
+// runs before it.
+//
+
+#include "BenchUtils.hpp"
+#include "FAsT-Match/MatchNet.h"
+#include "src/ConfigBounds.hpp"
+#include "src/ConfigGrid.hpp"
+#include "src/FastMatch.hpp"
+#include "src/GeometryUtils.hpp"
+#include "src/GridConfigExpander.hpp"
+#include "src/MatchConfigBatch.hpp"
+#include "src/SampleKernels.hpp"
+#include "src/Utilities.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+double peakRssMb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    // Kilobytes on Linux
+    return usage.ru_maxrss / 1024.0;
+}
+
+cv::Mat randomImage(int width, int height, std::mt19937& gen) {
+    std::uniform_real_distribution<float> value(0.f, 1.f);
+    cv::Mat image(height, width, CV_32F);
+    for (int y = 0; y < height; y++) {
+        auto* row = image.ptr<float>(y);
+        for (int x = 0; x < width; x++) {
+            row[x] = value(gen);
+        }
+    }
+    return image;
+}
+
+// Utilities::configsToAffine before the analytic check, without its parallel loop
+size_t formerBoundsCheck(const fast_match::MatchConfigBatch& configs, const cv::Size& imageSize,
+                         const cv::Size& templSize) {
+    cv::Point2d topLeft(-geometry::kBoundaryPadding, -geometry::kBoundaryPadding);
+    cv::Point2d bottomRight(imageSize.width + geometry::kBoundaryPadding,
+                            imageSize.height + geometry::kBoundaryPadding);
+    int r1x = static_cast<int>(0.5 * (templSize.width - 1)), r1y = static_cast<int>(0.5 * (templSize.height - 1)),
+            r2x = static_cast<int>(0.5 * (imageSize.width - 1)), r2y = static_cast<int>(0.5 * (imageSize.height - 1));
+    cv::Mat corners = (cv::Mat_<float>(3, 4) << 1 - (r1x + 1), templSize.width - (r1x + 1),
+            templSize.width - (r1x + 1), 1 - (r1x + 1),
+            1 - (r1y + 1), 1 - (r1y + 1), templSize.height - (r1y + 1), templSize.height - (r1y + 1),
+            1.0, 1.0, 1.0, 1.0);
+    cv::Mat transl = (cv::Mat_<float>(4, 2) << r2x + 1, r2y + 1, r2x + 1, r2y + 1, r2x + 1, r2y + 1,
+            r2x + 1, r2y + 1);
+    size_t inside = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        cv::Mat affine = configs.get(i).getAffineMatrix();
+        cv::Mat affineCorners = (affine * corners).t();
+        affineCorners = affineCorners + transl;
+        bool in = true;
+        for (int k = 0; k < 4; k++) {
+            in = in && isWithinBounds(affineCorners.at<cv::Point2f>(k, 0), topLeft, bottomRight);
+        }
+        inside += in;
+    }
+    return inside;
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int imageSide = argc > 1 ? std::atoi(argv[1]) : 400;
+    int templSide = argc > 2 ? std::atoi(argv[2]) : 100;
+    const float epsilon = 0.15f, delta = 0.25f, minScale = 0.5f, maxScale = 2.0f;
+    std::mt19937 gen(42);
+
+    cv::Mat image = randomImage(imageSide, imageSide, gen);
+    cv::Mat templ = randomImage(templSide, templSide, gen);
+
+    // Net of the first level, as FAsTMatch::apply builds it
+    int r1 = static_cast<int>(0.5 * (templSide - 1)), r2 = static_cast<int>(0.5 * (imageSide - 1));
+    float maxTrans = r2 - r1 * minScale;
+    GridConfigExpander grid;
+    ConfigExpanderBase& expander = grid;
+    expander.setNet(fast_match::MatchNet(templSide, templSide, delta, -maxTrans, maxTrans, -maxTrans, maxTrans,
+                                         static_cast<float>(-M_PI), static_cast<float>(M_PI), minScale, maxScale));
+
+    int points = static_cast<int>(std::round(10 / (epsilon * epsilon)));
+    cv::Mat xs(1, points, CV_32SC1), ys(1, points, CV_32SC1);
+    std::uniform_int_distribution<int> coord(1, templSide);
+    for (int i = 0; i < points; i++) {
+        xs.at<int>(0, i) = coord(gen);
+        ys.at<int>(0, i) = coord(gen);
+    }
+
+    fast_match::ConfigGrid configGrid = expander.createConfigGrid(templ.size(), image.size());
+    size_t gridSize = configGrid.size();
+    std::cout << "level 1, " << imageSide << "x" << imageSide << " image, " << templSide << "x" << templSide
+              << " template, " << gridSize << " configs, " << points << " points\n";
+
+    // Streamed: decoded, bounds checked and scored inside the tasks
+    std::vector<size_t> indices;
+    std::vector<double> streamed;
+    double margin = Utilities::getThresholdPerDelta(delta);
+    double streamNs = bench::measureNs([&] {
+        fast_match::FAsTMatch::evaluateGrid(image, templ, configGrid, xs, ys, false, margin, indices, streamed);
+    }, 1);
+    bench::printRow("streamed, bounded", gridSize * 1e9 / streamNs, "configs/s");
+    bench::printRow("configs kept", static_cast<double>(indices.size()), "");
+    bench::printRow("peak RSS, streamed", peakRssMb(), "MB");
+
+    fast_match::MatchConfigBatch configs;
+
+    double generateNs = bench::measureNs([&] {
+        expander.createListOfConfigs(templ.size(), image.size(), configs);
+    }, 3);
+    const simd::Level best = simd::detectLevel();
+    double boundsNs = 0;
+    for (auto level : {simd::Level::Scalar, best}) {
+        simd::setLevel(level);
+        boundsNs = bench::measureNs([&] {
+            expander.createListOfConfigs(templ.size(), image.size(), configs);
+            Utilities::configsToAffine(configs, image.size(), templ.size());
+        }, 3) - generateNs;
+        bench::printRow(std::string("bounds checked and compacted, ") + simd::levelName(level),
+                        gridSize * 1e9 / boundsNs, "configs/s");
+    }
+    size_t inside = configs.size();
+    std::vector<double> distances;
+    double evaluateNs = bench::measureNs([&] {
+        distances = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, false);
+        bench::doNotOptimize(distances.data());
+    }, 1);
+
+    bench::printRow("generated", gridSize * 1e9 / generateNs, "configs/s");
+    bench::printRow("evaluated", inside * 1e9 / evaluateNs, "configs/s");
+    bench::printRow("bytes per config", sizeof(float) * 10, "B");
+    bench::printRow("peak RSS, batch", peakRssMb(), "MB");
+
+    // Former layout: a config object and a 2x3 cv::Mat per configuration
+    std::vector<fast_match::MatchConfig> asValues = configs.toConfigs();
+
+    // The check alone, on the whole grid, then as the former cv::Mat product of the corners
+    fast_match::MatchConfigBatch whole;
+    expander.createListOfConfigs(templ.size(), image.size(), whole);
+    const ConfigBounds bounds(image.size(), templ.size());
+    const simd::AffineColumns columns{whole.a11.data(), whole.a12.data(), whole.translateX.data(),
+                                      whole.a21.data(), whole.a22.data(), whole.translateY.data(), whole.size()};
+    std::vector<uint8_t> flags(whole.size());
+    for (auto level : {simd::Level::Scalar, best}) {
+        simd::setLevel(level);
+        double flagsNs = bench::measureNs([&] {
+            bench::doNotOptimize(bounds.contains(columns, flags.data()));
+        }, 3);
+        bench::printRow(std::string("bounds flags, one thread, ") + simd::levelName(level),
+                        gridSize * 1e9 / flagsNs, "configs/s");
+    }
+    size_t formerInside = 0;
+    double formerNs = bench::measureNs([&] {
+        formerInside = formerBoundsCheck(whole, image.size(), templ.size());
+    }, 1);
+    bench::printRow("bounds checked with cv::Mat corners", gridSize * 1e9 / formerNs, "configs/s");
+    if (formerInside != inside) {
+        std::cout << "  cv::Mat corners keep " << formerInside << " configs, the batch " << inside << "\n";
+    }
+    whole = fast_match::MatchConfigBatch();
+    std::vector<cv::Mat> asMatrices;
+    asMatrices.reserve(asValues.size());
+    double matricesNs = bench::measureNs([&] {
+        asMatrices.clear();
+        for (const auto& config : asValues) {
+            asMatrices.push_back(config.getAffineMatrix());
+        }
+    }, 1);
+    bench::printRow("cv::Mat per config", asValues.size() * 1e9 / matricesNs, "configs/s");
+    bench::printRow("peak RSS, with cv::Mat per config", peakRssMb(), "MB");
+    return 0;
+}
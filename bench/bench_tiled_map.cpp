@@ -0,0 +1,94 @@
+//
+// Measures rotated gather throughput from a large map stored row-major
+// versus in Morton ordered 64x64 tiles. Each particle samples the template
+// points under a random rotation at a random position, as filterParticles
+// does when particles spread over the map.
+//
+
+#include "BenchUtils.hpp"
+#include "src/TiledImage.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace {
+// 10% of a 640x480 template, sorted by row like ParticleFastMatch::setTemplate does
+constexpr size_t kSamplePoints = 640 * 480 / 10;
+constexpr size_t kParticles = 256;
+} // namespace
+
+int main(int argc, char* argv[]) {
+    // Large enough that neither layout fits in the last level cache or the TLB reach
+    int side = argc > 1 ? std::atoi(argv[1]) : 16384;
+    std::mt19937 gen(42);
+
+    cv::Mat map(side, side, CV_8UC1);
+    for (int y = 0; y < side; y++) {
+        auto* row = map.ptr<uint8_t>(y);
+        for (int x = 0; x < side; x++) {
+            row[x] = static_cast<uint8_t>(gen());
+        }
+    }
+    TiledImage tiled(map);
+
+    std::uniform_int_distribution<int> xDist(0, 639), yDist(0, 479);
+    std::vector<std::array<int32_t, 2>> points(kSamplePoints);
+    for (auto& p : points) {
+        p = {xDist(gen), yDist(gen)};
+    }
+    std::sort(points.begin(), points.end(), [](const auto& a, const auto& b) {
+        return a[1] == b[1] ? a[0] < b[0] : a[1] < b[1];
+    });
+    std::vector<int32_t> xs(kSamplePoints), ys(kSamplePoints);
+    for (size_t i = 0; i < kSamplePoints; i++) {
+        xs[i] = points[i][0];
+        ys[i] = points[i][1];
+    }
+
+    std::vector<simd::FixedAffine> placements;
+    std::uniform_real_distribution<double> angleDist(-M_PI, M_PI), posDist(800.0, side - 800.0);
+    for (size_t p = 0; p < kParticles; p++) {
+        double a = angleDist(gen), s = 0.9;
+        const float m[6] = {
+                static_cast<float>(s * std::cos(a)), static_cast<float>(s * std::sin(a)), static_cast<float>(posDist(gen)),
+                static_cast<float>(-s * std::sin(a)), static_cast<float>(s * std::cos(a)), static_cast<float>(posDist(gen))
+        };
+        placements.push_back(simd::FixedAffine::fromFloat(m));
+    }
+
+    std::cout << "rotated gather, " << side << "x" << side << " map, " << kSamplePoints << " samples, "
+              << kParticles << " particles\n";
+    simd::ImageView8u rowMajor{map.data, map.rows, map.cols, map.step};
+    simd::TiledView8u tiles = tiled.view();
+    std::vector<uint8_t> out(kSamplePoints);
+    const simd::Level levels[] = {simd::Level::Scalar, simd::Level::AVX2};
+    for (auto level : levels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double rowNs = bench::measureNs([&] {
+            for (const auto& affine : placements) {
+                simd::SampleStats stats;
+                simd::gatherAffine(rowMajor, xs.data(), ys.data(), kSamplePoints, affine, out.data(), stats);
+                bench::doNotOptimize(stats.sum);
+            }
+        }, 5) / kParticles;
+        double tiledNs = bench::measureNs([&] {
+            for (const auto& affine : placements) {
+                simd::SampleStats stats;
+                simd::gatherAffine(tiles, xs.data(), ys.data(), kSamplePoints, affine, out.data(), stats);
+                bench::doNotOptimize(stats.sum);
+            }
+        }, 5) / kParticles;
+        std::string name = simd::levelName(level);
+        bench::printRow("row-major " + name, rowNs, "ns/particle");
+        bench::printRow("tiled " + name, tiledNs, "ns/particle");
+        bench::printRow("points/us row-major " + name, kSamplePoints * 1000.0 / rowNs, "");
+        bench::printRow("points/us tiled " + name, kSamplePoints * 1000.0 / tiledNs, "");
+        bench::printRow("speedup " + name, rowNs / tiledNs, "x");
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+//
+// GeoTIFF map loaded through a persistent cache of its preprocessed form.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "GeotiffMap.hpp"
+#include "MapCacheFile.hpp"
+
+/**
+ * Map whose `image` is the gray map blurred with the 9x9 Gaussian of
+ * FAsTMatch::setImage, taken from a MapCacheFile. The first run decodes the
+ * GeoTIFF, preprocesses it and writes the cache; later runs only map it.
+ * Levels 1..kPyramidLevels are the pyrDown reductions of level 0. The gray
+ * map before the blur is cached as well, for the affine search, which
+ * samples the unblurred map.
+ */
+class CachedGeotiffMap : public GeotiffMap {
+public:
+    static constexpr int kPyramidLevels = 4;
+
+    /**
+     * Opens the map from `cacheFile`, building the cache first when it is
+     * missing or stale. If the cache cannot be written, or `cacheFile` is
+     * empty, the preprocessed levels are kept in memory for this run only.
+     */
+    bool open(const std::string& mapFile, const std::string& cacheFile);
+
+    /**
+     * Level 0 is `image`, level i is reduced i times. Empty outside of
+     * [0, kPyramidLevels].
+     */
+    cv::Mat level(int index) const;
+
+    /**
+     * The gray map before the blur, as FAsTMatch::setImage keeps it in
+     * original_image.
+     */
+    cv::Mat gray() const;
+
+    /**
+     * Whether the levels come from a cache file that was valid on open.
+     */
+    bool isWarmStart() const { return warmStart; }
+
+    bool isPersistent() const { return cache.isOpen(); }
+
+private:
+    void useGeoreference(const MapCacheFile::Georeference& georeference);
+
+    MapCacheFile cache;
+    // Cache levels: 0..kPyramidLevels, then the unblurred gray
+    static constexpr int kGrayIndex = kPyramidLevels + 1;
+
+    cv::Mat cached(int index) const;
+
+    // Levels of a cache that could not be written
+    std::vector<cv::Mat> ownedLevels;
+    bool warmStart = false;
+};
+
+typedef std::shared_ptr<CachedGeotiffMap> CachedMapPtr;
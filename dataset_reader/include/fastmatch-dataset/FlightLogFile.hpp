@@ -0,0 +1,141 @@
+//
+// Binary flight log: fixed-size metadata records and pre-decoded gray frames.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "MapCacheFile.hpp"
+#include "MetadataEntry.hpp"
+
+/**
+ * metadata.csv of a dataset converted once (see flight-log-convert) into
+ * fixed-size records, optionally followed by a frame store holding every
+ * camera image already decoded to gray at one resolution. The file is
+ * mapped read-only, so a record is read without parsing and a frame is a
+ * cv::Mat over the mapping: nothing is decoded or copied during replay.
+ *
+ * Layout: header, frames (each kFrameAlignment aligned), records, file
+ * names. The header keeps the size and modification time of the CSV it
+ * was converted from, so a stale log can be told apart.
+ */
+class FlightLogFile {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kFrameAlignment = 64;
+    static constexpr size_t kAlignment = 4096;
+
+    // One row of metadata.csv, in host byte order
+    struct Record {
+        double latitude;
+        double longitude;
+        double altitude;
+        double imu[4];
+        double pose[3];
+        double orientation[4];
+        double svo[3];
+        int32_t mapX;
+        int32_t mapY;
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        uint32_t reserved;
+    };
+
+    static std::string defaultPath(const std::string& datasetDir) { return datasetDir + "/metadata.pflog"; }
+
+    FlightLogFile() = default;
+
+    ~FlightLogFile();
+
+    FlightLogFile(const FlightLogFile&) = delete;
+
+    FlightLogFile& operator=(const FlightLogFile&) = delete;
+
+    /**
+     * Maps the log. With a non-zero `source`, logs converted from another
+     * version of the CSV are rejected.
+     */
+    bool open(const std::string& path, const MapCacheFile::SourceStamp& source = MapCacheFile::SourceStamp());
+
+    void close();
+
+    bool isOpen() const { return mapping != nullptr; }
+
+    size_t recordCount() const { return count; }
+
+    const Record& record(size_t index) const { return records[index]; }
+
+    std::string_view fileName(size_t index) const;
+
+    bool hasFrames() const { return !frameSize.empty(); }
+
+    cv::Size getFrameSize() const { return frameSize; }
+
+    /**
+     * Read-only CV_8UC1 view of a frame, valid while the log is open.
+     */
+    cv::Mat frame(size_t index) const;
+
+    /**
+     * Fills the metadata of `entry` from record `index`. imageGray is the
+     * stored frame, if the log has frames.
+     */
+    void fillEntry(size_t index, MetadataEntry& entry) const;
+
+private:
+    void *mapping = nullptr;
+    size_t mappedBytes = 0;
+    const Record* records = nullptr;
+    size_t count = 0;
+    std::string_view names;
+    const uint8_t* frames = nullptr;
+    size_t frameStride = 0;
+    cv::Size frameSize;
+};
+
+/**
+ * Streams a FlightLogFile to disk: frames are written as they are
+ * appended, records and names are kept in memory until finish(). The log
+ * is written under a temporary name and renamed by finish().
+ */
+class FlightLogWriter {
+public:
+    FlightLogWriter() = default;
+
+    ~FlightLogWriter();
+
+    FlightLogWriter(const FlightLogWriter&) = delete;
+
+    FlightLogWriter& operator=(const FlightLogWriter&) = delete;
+
+    /**
+     * An empty `frameSize` writes a log without frames.
+     */
+    bool open(const std::string& path, const cv::Size& frameSize, const MapCacheFile::SourceStamp& source);
+
+    /**
+     * Appends the metadata of `entry` and, when the log has frames, `gray`
+     * (CV_8UC1 of the log's frame size).
+     */
+    bool append(const MetadataEntry& entry, const cv::Mat& gray = cv::Mat());
+
+    bool finish();
+
+private:
+    std::string path;
+    std::string temporary;
+    std::ofstream out;
+    cv::Size frameSize;
+    size_t frameStride = 0;
+    MapCacheFile::SourceStamp source;
+    std::vector<FlightLogFile::Record> records;
+    std::string names;
+};
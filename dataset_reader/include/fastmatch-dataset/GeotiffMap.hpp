@@ -6,6 +6,7 @@
 
 #include "Map.hpp"
 
+class GDALDataset;
 
 class GeotiffMap : public Map {
 protected:
@@ -13,6 +14,11 @@ protected:
     int zoneNumber = 0;
     bool northp = true;
 
+    /**
+     * Reads the UTM zone and the geotransform of an opened dataset.
+     */
+    bool readGeoreference(GDALDataset *dataset);
+
 public:
     void open(const std::string& filename);
 
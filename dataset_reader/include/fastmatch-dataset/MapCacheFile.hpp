@@ -0,0 +1,91 @@
+//
+// Binary cache of a preprocessed map, mapped read-only into memory.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+/**
+ * File next to the map holding what every run would otherwise recompute:
+ * the gray, blurred map (imageGray), its pyrDown levels and the
+ * georeference. Levels are page aligned in the file and mapped with
+ * MAP_SHARED, so a warm start only maps the file and concurrent runs on the
+ * same map share the page cache.
+ *
+ * The cache belongs to one version of the map file: open() rejects it when
+ * the size or the modification time of the source differs, or when it was
+ * written by another format version.
+ */
+class MapCacheFile {
+public:
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kMaxLevels = 8;
+    static constexpr size_t kAlignment = 4096;
+
+    struct Georeference {
+        double geoTransform[6] = {};
+        int32_t zoneNumber = 0;
+        int32_t northp = 1;
+    };
+
+    struct SourceStamp {
+        uint64_t size = 0;
+        int64_t modified = 0;
+
+        /**
+         * Stamp of an existing file, zero for a missing one.
+         */
+        static SourceStamp of(const std::string& path);
+
+        bool operator==(const SourceStamp& other) const {
+            return size == other.size && modified == other.modified;
+        }
+    };
+
+    MapCacheFile() = default;
+
+    ~MapCacheFile();
+
+    MapCacheFile(const MapCacheFile&) = delete;
+
+    MapCacheFile& operator=(const MapCacheFile&) = delete;
+
+    /**
+     * Maps the cache if it exists and matches `source` and this version.
+     */
+    bool open(const std::string& path, const SourceStamp& source);
+
+    void close();
+
+    /**
+     * Writes CV_8UC1 levels and the georeference. The file is written under a
+     * temporary name and renamed, so readers never see a partial cache.
+     */
+    static bool write(const std::string& path, const SourceStamp& source, const Georeference& georeference,
+                      const std::vector<cv::Mat>& levels);
+
+    static std::string defaultPath(const std::string& mapFile) { return mapFile + ".pfcache"; }
+
+    bool isOpen() const { return mapping != nullptr; }
+
+    size_t levelCount() const { return levels.size(); }
+
+    /**
+     * Read-only view of a level, valid while the cache is open.
+     */
+    const cv::Mat& level(size_t index) const { return levels[index]; }
+
+    const Georeference& georeference() const { return geo; }
+
+private:
+    void *mapping = nullptr;
+    size_t mappedBytes = 0;
+    std::vector<cv::Mat> levels;
+    Georeference geo;
+};
@@ -0,0 +1,65 @@
+//
+// Residency bookkeeping for a map that is paged in on demand.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/types.hpp>
+
+/**
+ * Splits a map into a grid of fixed size pages and remembers which of them
+ * are resident and when each was last needed. It only does the bookkeeping:
+ * the owner loads the pages reported by request() and drops the ones
+ * reported by evict().
+ */
+class MapPageTable {
+public:
+    MapPageTable() = default;
+
+    MapPageTable(const cv::Size& mapSize, const cv::Size& pageSize);
+
+    const cv::Size& pageSize() const { return pageSize_; }
+
+    int pagesX() const { return pagesX_; }
+
+    int pagesY() const { return pagesY_; }
+
+    size_t pageCount() const { return lastUse_.size(); }
+
+    size_t residentCount() const { return resident_; }
+
+    bool isResident(size_t page) const { return lastUse_[page] != 0; }
+
+    /**
+     * Pixels covered by the page, clipped to the map.
+     */
+    cv::Rect pageRect(size_t page) const;
+
+    /**
+     * Marks every page overlapping `region` as used. Pages that were not
+     * resident are appended to `missing` and count as resident from now on.
+     */
+    void request(const cv::Rect& region, std::vector<size_t>& missing);
+
+    /**
+     * Drops least recently used pages that do not overlap `keep` until at
+     * most `maxResident` pages remain, appending them to `evicted`. Fewer
+     * pages are dropped if `keep` alone needs more than `maxResident`.
+     */
+    void evict(size_t maxResident, const cv::Rect& keep, std::vector<size_t>& evicted);
+
+private:
+    cv::Rect pageSpan(const cv::Rect& region) const;
+
+    cv::Size mapSize_;
+    cv::Size pageSize_;
+    int pagesX_ = 0, pagesY_ = 0;
+    // Clock value of the last request that touched the page, 0 if not resident
+    std::vector<uint64_t> lastUse_;
+    uint64_t clock_ = 0;
+    size_t resident_ = 0;
+};
@@ -0,0 +1,83 @@
+//
+// metadata.csv mapped into memory with an index of its rows.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Read-only view of a dataset's metadata.csv. The file is mapped, the start
+ * of every row is indexed once on open and the header is resolved to the
+ * column of each field MetadataEntryReader fills, so a row is read by
+ * splitting it in place and parsing the numbers with std::from_chars,
+ * without copying a single field.
+ */
+class MetadataCsvFile {
+public:
+    enum Column {
+        Filename, Latitude, Longitude, RelativeAltitude,
+        ImuX, ImuY, ImuZ, ImuW,
+        PoseX, PoseY, PoseZ,
+        OrientationX, OrientationY, OrientationZ, OrientationW,
+        MapX, MapY,
+        SvoX, SvoY, SvoZ,
+        ColumnCount
+    };
+
+    // Fields of one row in Column order, empty for columns the file lacks
+    typedef std::array<std::string_view, ColumnCount> Row;
+
+    MetadataCsvFile() { columnIndex.fill(-1); }
+
+    ~MetadataCsvFile();
+
+    MetadataCsvFile(const MetadataCsvFile&) = delete;
+
+    MetadataCsvFile& operator=(const MetadataCsvFile&) = delete;
+
+    bool open(const std::string& path);
+
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+
+    /**
+     * Data rows, the header not counted.
+     */
+    size_t rowCount() const { return rowStarts.empty() ? 0 : rowStarts.size() - 1; }
+
+    bool hasColumn(Column column) const { return columnIndex[column] >= 0; }
+
+    /**
+     * Splits data row `row`. Surrounding quotes and whitespace are stripped;
+     * the views point into the mapping and stay valid while the file is open.
+     */
+    void readRow(size_t row, Row& fields) const;
+
+    /**
+     * The number a field starts with, 0 when it does not start with one
+     * (the behaviour of atof).
+     */
+    static double toDouble(std::string_view field);
+
+    static int toInt(std::string_view field);
+
+    static const char* columnName(Column column);
+
+private:
+    std::string_view line(size_t row) const;
+
+    const char* data = nullptr;
+    size_t size = 0;
+    // Offset of every data row followed by the end of the last one
+    std::vector<size_t> rowStarts;
+    std::array<int, ColumnCount> columnIndex{};
+    // Column read from each position of a row, -1 for fields nothing reads.
+    // Fields past the last one read are not split.
+    std::vector<int> columnAt;
+};
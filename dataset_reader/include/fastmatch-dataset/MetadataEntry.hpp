@@ -28,13 +28,31 @@ public:
 
     cv::Mat map;
     cv::Mat imageBuffer;
-
+    // Gray version of imageBuffer, converted once when the frame is decoded
+    cv::Mat imageGray;
+
+    /**
+     * Decodes the camera image into imageBuffer and imageGray. Does nothing
+     * when imageGray is already set.
+     */
+    void loadImages();
+
+    /**
+     * imageGray, or the image read from disk as grayscale when the frame
+     * was not decoded.
+     */
     cv::Mat getImage() const;
 
     cv::Mat getImageSharpened(bool smooth = false) const;
 
     cv::Mat getImageColored() const;
 
+    /**
+     * The decoded image without a copy: imageGray once loadImages ran,
+     * imageBuffer otherwise. Matching only needs the gray image.
+     */
+    const cv::Mat& getMatchImage() const;
+
     std::shared_ptr<Map> mapper;
 };
 
@@ -9,45 +9,103 @@
 #include <boost/tokenizer.hpp>
 #include <fstream>
 #include "MetadataEntry.hpp"
+#include "MetadataCsvFile.hpp"
+#include "FlightLogFile.hpp"
 #include "GeotiffMap.hpp"
+#include "PagedGeotiffMap.hpp"
+#include "CachedGeotiffMap.hpp"
 
 
 class MetadataEntryReader {
 private:
-    static std::vector<std::string> parseString(const std::string& line);
+    MetadataCsvFile csv;
 
-    static std::map<std::string, std::string> parseLine(
-            const std::vector<std::string>& header,
-            const std::string& line
-    );
+    // Used instead of csv when the dataset has an up to date metadata.pflog
+    FlightLogFile log;
 
-    std::ifstream in;
+    std::string datasetPath;
 
-    std::vector<std::string> header;
+    void fillMetadata(MetadataEntry& entry, const MetadataCsvFile::Row& values);
 
-    std::string datasetPath;
+    void fillMetadata(MetadataEntry& entry, size_t record);
 
-    void fillMetadata(MetadataEntry& entry, std::map<std::string, std::string>& values);
+    void finishEntry(MetadataEntry& entry);
 
     GeoMapPtr map = nullptr;
 
     uint32_t skipRate = 1;
 
+    // Data row read next
     uint64_t lineCounter = 0;
 
+    bool decodeImages = true;
+
+    bool useFlightLog = true;
+
 public:
     uint32_t getSkipRate() const;
 
     void setSkipRate(uint32_t skipRate);
 
+    /**
+     * Reads metadata.pflog (see FlightLogFile) when it was converted from
+     * the dataset's current metadata.csv, or there is no CSV, and
+     * metadata.csv otherwise.
+     */
     bool openDirectory(const std::string &datasetDir);
 
+    /**
+     * When disabled, openDirectory always reads metadata.csv.
+     */
+    void setUseFlightLog(bool use);
+
+    /**
+     * Whether the open dataset is read from a flight log.
+     */
+    bool usesFlightLog() const;
+
+    /**
+     * Reads the next row whose index is a multiple of the skip rate.
+     */
     bool readNextEntry(MetadataEntry& metadataEntry);
 
+    /**
+     * Data rows of the open dataset, skip rate not applied.
+     */
+    size_t rowCount() const;
+
+    /**
+     * Continues reading at data row `row` (rounded up to the skip rate).
+     * Returns false past the last row.
+     */
+    bool seek(size_t row);
+
     void setMap(const std::string& mapFile);
 
+    /**
+     * Uses a map opened elsewhere, e.g. one shared by several readers.
+     */
+    void setMap(const GeoMapPtr& map);
+
+    /**
+     * Opens the map as a PagedGeotiffMap that keeps at most
+     * `maxResidentBytes` of the map in memory.
+     */
+    void setPagedMap(const std::string& mapFile, size_t maxResidentBytes);
+
+    /**
+     * Opens the map through a CachedGeotiffMap backed by `cacheFile`.
+     */
+    void setCachedMap(const std::string& mapFile, const std::string& cacheFile);
+
     const MapPtr getMap() const;
 
+    /**
+     * When disabled, readNextEntry only parses the metadata and leaves
+     * decoding the images to the caller (see PrefetchingEntryReader).
+     */
+    void setDecodeImages(bool decode);
+
 };
 
 
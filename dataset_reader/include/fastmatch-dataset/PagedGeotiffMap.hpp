@@ -0,0 +1,99 @@
+//
+// GeoTIFF map that is read from disk page by page when a region is needed.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "GeotiffMap.hpp"
+#include "MapPageTable.hpp"
+
+struct MapPagingStats {
+    size_t residentBytes = 0;
+    size_t peakResidentBytes = 0;
+    uint64_t pageIns = 0;
+    uint64_t evictions = 0;
+    double pageInMs = 0.0;
+    double maxPageInMs = 0.0;
+};
+
+/**
+ * Loading a large orthophoto with cv::imread keeps the whole raster in memory
+ * although the particle cloud only ever covers a small part of it. Here the
+ * GDAL dataset stays open and `image` is a gray CV_8UC1 view of an anonymous
+ * mapping that only reserves address space. ensureRegion() reads the pages
+ * under a region with GDAL block reads, everything else reads as zero.
+ *
+ * The pixels are already preprocessed the way FAsTMatch::setImage prepares
+ * imageGray: converted to gray and blurred with a 9x9 Gaussian. Every page is
+ * read with an apron of kBlurApron pixels, so the result equals blurring the
+ * whole map at once.
+ *
+ * A page spans a whole number of OS pages in every row (rows are padded to
+ * the page width), so evicted pages are returned to the OS with madvise.
+ */
+class PagedGeotiffMap : public GeotiffMap {
+public:
+    static constexpr int kPageWidth = 4096;
+    static constexpr int kPageHeight = 256;
+    static constexpr size_t kPageBytes = static_cast<size_t>(kPageWidth) * kPageHeight;
+    // Radius of the 9x9 blur kernel
+    static constexpr int kBlurApron = 4;
+    // Upper bound of the GDAL block cache, the pages themselves are the cache
+    static constexpr int64_t kGdalCacheBytes = 64ll << 20;
+
+    PagedGeotiffMap() = default;
+
+    ~PagedGeotiffMap();
+
+    PagedGeotiffMap(const PagedGeotiffMap&) = delete;
+
+    PagedGeotiffMap& operator=(const PagedGeotiffMap&) = delete;
+
+    /**
+     * Opens the map without reading any pixels. At most `maxResidentBytes`
+     * are kept in memory, unless a single requested region needs more.
+     */
+    bool open(const std::string& filename, size_t maxResidentBytes);
+
+    /**
+     * Pages in everything under `region` and evicts least recently used
+     * pages outside of it when the limit is exceeded.
+     */
+    void ensureRegion(const cv::Rect& region);
+
+    /**
+     * Pages in `region` shifted by the expected motion while keeping
+     * `region` itself resident.
+     */
+    void prefetch(const cv::Rect& region, const cv::Point2f& motion);
+
+    const MapPagingStats& stats() const { return pagingStats; }
+
+    size_t getMaxResidentBytes() const { return maxResidentPages * kPageBytes; }
+
+private:
+    void ensure(const cv::Rect& region, const cv::Rect& keep);
+
+    void loadPage(size_t page);
+
+    void releasePage(size_t page);
+
+    void close();
+
+    GDALDataset *dataset = nullptr;
+    uint8_t *pixels = nullptr;
+    size_t mappedBytes = 0;
+    size_t maxResidentPages = 0;
+    MapPageTable pages;
+    MapPagingStats pagingStats;
+    // Reused between page-ins
+    std::vector<size_t> missingPages, evictedPages;
+    cv::Mat rawPage, grayPage, blurredPage;
+};
+
+typedef std::shared_ptr<PagedGeotiffMap> PagedMapPtr;
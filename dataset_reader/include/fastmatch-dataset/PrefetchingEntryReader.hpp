@@ -0,0 +1,85 @@
+//
+// Reader stage decoding the next frames while the current one is filtered.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "MetadataEntryReader.hpp"
+
+struct FramePrefetchStats {
+    uint64_t frames = 0;
+    uint64_t decoded = 0;
+    // Frames the caller had to wait for because they were still decoding
+    uint64_t stalls = 0;
+    double waitMs = 0.0;
+    double decodeMs = 0.0;
+    double maxDecodeMs = 0.0;
+    // Sum over all requests of the frames already decoded at that moment
+    uint64_t readyFramesSum = 0;
+
+    double meanDecodeMs() const { return decoded > 0 ? decodeMs / decoded : 0.0; }
+
+    double meanQueueDepth() const { return frames > 0 ? static_cast<double>(readyFramesSum) / frames : 0.0; }
+};
+
+/**
+ * Wraps a MetadataEntryReader so that the camera images of the next `depth`
+ * frames are decoded on `workers` threads while the caller works on the
+ * current one. Each image is decoded once, in color, and converted to gray
+ * once (MetadataEntry::loadImages). The metadata itself is still parsed on
+ * the calling thread, in order. With a depth of 0 frames are read
+ * synchronously, exactly like the wrapped reader. While it exists the
+ * wrapped reader does not decode images itself.
+ */
+class PrefetchingEntryReader {
+public:
+    explicit PrefetchingEntryReader(MetadataEntryReader &reader, size_t depth = 4, size_t workers = 2);
+
+    ~PrefetchingEntryReader();
+
+    PrefetchingEntryReader(const PrefetchingEntryReader&) = delete;
+
+    PrefetchingEntryReader& operator=(const PrefetchingEntryReader&) = delete;
+
+    bool readNextEntry(MetadataEntry &metadataEntry);
+
+    size_t getDepth() const { return depth; }
+
+    FramePrefetchStats stats() const;
+
+private:
+    struct Frame {
+        MetadataEntry entry;
+        bool decoded = false;
+    };
+
+    /**
+     * Parses frames until `depth` of them are queued and hands them to the workers.
+     */
+    void refill();
+
+    void work();
+
+    MetadataEntryReader &reader;
+    size_t depth;
+    bool exhausted = false;
+    // Frames in reading order, front is returned next
+    std::deque<std::shared_ptr<Frame>> queued;
+    // Frames no worker has picked up yet
+    std::deque<std::shared_ptr<Frame>> pending;
+    std::vector<std::thread> threads;
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::condition_variable frameDecoded;
+    bool stopping = false;
+    FramePrefetchStats stats_;
+};
@@ -0,0 +1,82 @@
+//
+// GeoTIFF map loaded through a persistent cache of its preprocessed form.
+//
+
+#include <algorithm>
+#include <iostream>
+#include <opencv2/imgproc.hpp>
+
+#include "fastmatch-dataset/CachedGeotiffMap.hpp"
+
+bool CachedGeotiffMap::open(const std::string &mapFile, const std::string &cacheFile) {
+    valid = false;
+    ownedLevels.clear();
+    auto source = MapCacheFile::SourceStamp::of(mapFile);
+    warmStart = !cacheFile.empty() && cache.open(cacheFile, source) && cache.levelCount() == kGrayIndex + 1;
+    if(!warmStart) {
+        cache.close();
+        GeotiffMap::open(mapFile);
+        if(!valid) {
+            return false;
+        }
+        // Same preprocessing as FAsTMatch::setImage
+        cv::Mat gray;
+        if(image.type() == CV_8UC3) {
+            cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = image;
+        }
+        image.release();
+        cv::Mat blurred;
+        GaussianBlur( gray, blurred, cv::Size( 9, 9 ), 0, 0 );
+        std::vector<cv::Mat> levels = {blurred};
+        for(int i = 1; i <= kPyramidLevels; i++) {
+            cv::Mat reduced;
+            cv::pyrDown(levels.back(), reduced);
+            levels.push_back(reduced);
+        }
+        levels.push_back(gray);
+        MapCacheFile::Georeference georeference;
+        std::copy(adfGeoTransform, adfGeoTransform + 6, georeference.geoTransform);
+        georeference.zoneNumber = zoneNumber;
+        georeference.northp = northp ? 1 : 0;
+        if(cacheFile.empty()) {
+            ownedLevels = std::move(levels);
+        } else if(!MapCacheFile::write(cacheFile, source, georeference, levels) || !cache.open(cacheFile, source)) {
+            std::cerr << "Could not write map cache " << cacheFile << ", keeping it in memory\n";
+            ownedLevels = std::move(levels);
+        }
+    }
+    if(cache.isOpen()) {
+        useGeoreference(cache.georeference());
+    }
+    image = level(0);
+    geoRegion[0] = pixelCoordinates(cv::Point(0, 0));
+    geoRegion[1] = pixelCoordinates(cv::Point(image.cols, image.rows));
+    valid = true;
+    return true;
+}
+
+cv::Mat CachedGeotiffMap::level(int index) const {
+    if(index < 0 || index > kPyramidLevels) {
+        return {};
+    }
+    return cached(index);
+}
+
+cv::Mat CachedGeotiffMap::gray() const {
+    return cached(kGrayIndex);
+}
+
+cv::Mat CachedGeotiffMap::cached(int index) const {
+    if(cache.isOpen()) {
+        return cache.level(static_cast<size_t>(index));
+    }
+    return static_cast<size_t>(index) < ownedLevels.size() ? ownedLevels[index] : cv::Mat();
+}
+
+void CachedGeotiffMap::useGeoreference(const MapCacheFile::Georeference &georeference) {
+    std::copy(georeference.geoTransform, georeference.geoTransform + 6, adfGeoTransform);
+    zoneNumber = georeference.zoneNumber;
+    northp = georeference.northp != 0;
+}
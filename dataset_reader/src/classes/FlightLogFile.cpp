@@ -0,0 +1,244 @@
+//
+// Binary flight log: fixed-size metadata records and pre-decoded gray frames.
+//
+
+#include "fastmatch-dataset/FlightLogFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+    const char kMagic[8] = {'P', 'F', 'F', 'L', 'I', 'G', 'H', 'T'};
+
+    // On-disk layout, in host byte order
+    struct LogHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t recordCount;
+        uint64_t recordsOffset;
+        uint64_t namesOffset;
+        uint64_t namesBytes;
+        uint64_t framesOffset;
+        uint32_t frameWidth;
+        uint32_t frameHeight;
+        uint64_t frameStride;
+        uint64_t fileSize;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+    };
+
+    static_assert(std::is_trivially_copyable<LogHeader>::value, "log header is written as raw bytes");
+    static_assert(std::is_trivially_copyable<FlightLogFile::Record>::value, "records are written as raw bytes");
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+FlightLogFile::~FlightLogFile() {
+    close();
+}
+
+void FlightLogFile::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappedBytes);
+        mapping = nullptr;
+        mappedBytes = 0;
+    }
+    records = nullptr;
+    count = 0;
+    names = std::string_view();
+    frames = nullptr;
+    frameStride = 0;
+    frameSize = cv::Size();
+}
+
+bool FlightLogFile::open(const std::string &path, const MapCacheFile::SourceStamp &source) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info{};
+    LogHeader header{};
+    bool ok = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(header) &&
+              pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+              std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+              header.version == kVersion && header.recordSize == sizeof(Record) &&
+              header.fileSize == static_cast<uint64_t>(info.st_size) &&
+              header.recordsOffset % alignof(Record) == 0 &&
+              header.recordsOffset + header.recordCount * sizeof(Record) <= header.fileSize &&
+              header.namesOffset + header.namesBytes <= header.fileSize &&
+              header.framesOffset + header.frameStride * (header.frameWidth > 0 ? header.recordCount : 0) <=
+              header.fileSize &&
+              header.frameStride >= static_cast<uint64_t>(header.frameWidth) * header.frameHeight;
+    if (ok && source.size != 0) {
+        ok = header.sourceSize == source.size && header.sourceModified == source.modified;
+    }
+    if (ok) {
+        void *mapped = mmap(nullptr, header.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            mapping = mapped;
+            mappedBytes = header.fileSize;
+        } else {
+            ok = false;
+        }
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+    auto *base = static_cast<const uint8_t *>(mapping);
+    records = reinterpret_cast<const Record *>(base + header.recordsOffset);
+    count = header.recordCount;
+    names = std::string_view(reinterpret_cast<const char *>(base + header.namesOffset), header.namesBytes);
+    if (header.frameWidth > 0 && header.frameHeight > 0) {
+        frames = base + header.framesOffset;
+        frameStride = header.frameStride;
+        frameSize = cv::Size(static_cast<int>(header.frameWidth), static_cast<int>(header.frameHeight));
+    }
+    return true;
+}
+
+std::string_view FlightLogFile::fileName(size_t index) const {
+    const Record &r = records[index];
+    if (r.nameOffset + r.nameLength > names.size()) {
+        return {};
+    }
+    return names.substr(r.nameOffset, r.nameLength);
+}
+
+cv::Mat FlightLogFile::frame(size_t index) const {
+    if (frames == nullptr) {
+        return {};
+    }
+    // The mapping is read-only, the const_cast only satisfies the cv::Mat constructor
+    return cv::Mat(frameSize, CV_8UC1, const_cast<uint8_t *>(frames + frameStride * index));
+}
+
+void FlightLogFile::fillEntry(size_t index, MetadataEntry &entry) const {
+    const Record &r = records[index];
+    entry.imageFileName = std::string(fileName(index));
+    entry.latitude = r.latitude;
+    entry.longitude = r.longitude;
+    entry.altitude = r.altitude;
+    entry.imuOrientation = Quaternion(r.imu[0], r.imu[1], r.imu[2], r.imu[3]);
+    entry.groundTruthPose = Vector3d(r.pose[0], r.pose[1], r.pose[2]);
+    entry.groundTruthOrientation = Quaternion(r.orientation[0], r.orientation[1], r.orientation[2], r.orientation[3]);
+    entry.mapLocation = cv::Point(r.mapX, r.mapY);
+    entry.svoPose = Vector3d(r.svo[0], r.svo[1], r.svo[2]);
+    entry.imageGray = frame(index);
+}
+
+FlightLogWriter::~FlightLogWriter() {
+    if (!temporary.empty()) {
+        out.close();
+        std::remove(temporary.c_str());
+    }
+}
+
+bool FlightLogWriter::open(const std::string &path, const cv::Size &frameSize, const MapCacheFile::SourceStamp &source) {
+    this->path = path;
+    this->frameSize = frameSize.empty() ? cv::Size() : frameSize;
+    this->source = source;
+    frameStride = alignUp(static_cast<uint64_t>(this->frameSize.area()), FlightLogFile::kFrameAlignment);
+    records.clear();
+    names.clear();
+    temporary = path + ".tmp." + std::to_string(getpid());
+    out.open(temporary, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        temporary.clear();
+        return false;
+    }
+    // Frames follow the header, which finish() fills in
+    out.seekp(static_cast<std::streamoff>(FlightLogFile::kAlignment));
+    return true;
+}
+
+bool FlightLogWriter::append(const MetadataEntry &entry, const cv::Mat &gray) {
+    if (!out) {
+        return false;
+    }
+    FlightLogFile::Record r{};
+    r.latitude = entry.latitude;
+    r.longitude = entry.longitude;
+    r.altitude = entry.altitude;
+    r.imu[0] = entry.imuOrientation.getX();
+    r.imu[1] = entry.imuOrientation.getY();
+    r.imu[2] = entry.imuOrientation.getZ();
+    r.imu[3] = entry.imuOrientation.getW();
+    r.pose[0] = entry.groundTruthPose.getX();
+    r.pose[1] = entry.groundTruthPose.getY();
+    r.pose[2] = entry.groundTruthPose.getZ();
+    r.orientation[0] = entry.groundTruthOrientation.getX();
+    r.orientation[1] = entry.groundTruthOrientation.getY();
+    r.orientation[2] = entry.groundTruthOrientation.getZ();
+    r.orientation[3] = entry.groundTruthOrientation.getW();
+    r.svo[0] = entry.svoPose.getX();
+    r.svo[1] = entry.svoPose.getY();
+    r.svo[2] = entry.svoPose.getZ();
+    r.mapX = entry.mapLocation.x;
+    r.mapY = entry.mapLocation.y;
+    r.nameOffset = names.size();
+    r.nameLength = static_cast<uint32_t>(entry.imageFileName.size());
+    names += entry.imageFileName;
+    records.push_back(r);
+
+    if (frameSize.empty()) {
+        return true;
+    }
+    if (gray.type() != CV_8UC1 || gray.size() != frameSize) {
+        out.setstate(std::ios::failbit);
+        return false;
+    }
+    uint64_t frameStart = FlightLogFile::kAlignment + frameStride * (records.size() - 1);
+    out.seekp(static_cast<std::streamoff>(frameStart));
+    for (int y = 0; y < gray.rows; y++) {
+        out.write(reinterpret_cast<const char *>(gray.ptr(y)), gray.cols);
+    }
+    return static_cast<bool>(out);
+}
+
+bool FlightLogWriter::finish() {
+    if (temporary.empty() || !out) {
+        return false;
+    }
+    LogHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = FlightLogFile::kVersion;
+    header.recordSize = sizeof(FlightLogFile::Record);
+    header.recordCount = records.size();
+    header.framesOffset = FlightLogFile::kAlignment;
+    if (!frameSize.empty()) {
+        header.frameWidth = static_cast<uint32_t>(frameSize.width);
+        header.frameHeight = static_cast<uint32_t>(frameSize.height);
+        header.frameStride = frameStride;
+    }
+    header.recordsOffset = alignUp(header.framesOffset + header.frameStride * records.size(), FlightLogFile::kAlignment);
+    header.namesOffset = header.recordsOffset + records.size() * sizeof(FlightLogFile::Record);
+    header.namesBytes = names.size();
+    header.fileSize = header.namesOffset + header.namesBytes;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+
+    out.seekp(static_cast<std::streamoff>(header.recordsOffset));
+    out.write(reinterpret_cast<const char *>(records.data()),
+              static_cast<std::streamsize>(records.size() * sizeof(FlightLogFile::Record)));
+    out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        temporary.clear();
+        return false;
+    }
+    temporary.clear();
+    return true;
+}
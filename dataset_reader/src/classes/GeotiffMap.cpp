@@ -17,23 +17,33 @@ void GeotiffMap::open(const std::string &filename) {
     GDALAllRegister();
     poDataset = (GDALDataset *) GDALOpen( filename.c_str(), GA_ReadOnly );
     if(poDataset != nullptr) {
-        const char* projectionString = poDataset->GetProjectionRef();
-        auto srs = OGRSpatialReference(projectionString);
-        auto zone = std::string(srs.GetAttrValue("projcs"));
-        static const std::regex zoneRegex(R"(.*UTM\szone\s(\d+)(\w))");
-        std::match_results<std::string::const_iterator> res;
-        if(std::regex_match(zone, res, zoneRegex)) {
-            zoneNumber = std::atoi(std::string(res[1]).c_str());
-            northp = (res[2] == "N");
-            if(poDataset->GetGeoTransform(adfGeoTransform) == CE_None) {
-                image = cv::imread(filename);
-                geoRegion[0] = pixelCoordinates(cv::Point(0, 0));
-                geoRegion[1] = pixelCoordinates(cv::Point(image.cols, image.rows));
-                valid = true;
-            }
+        if(readGeoreference(poDataset)) {
+            image = cv::imread(filename);
+            geoRegion[0] = pixelCoordinates(cv::Point(0, 0));
+            geoRegion[1] = pixelCoordinates(cv::Point(image.cols, image.rows));
+            valid = true;
         }
+        GDALClose(poDataset);
     }
 }
+
+bool GeotiffMap::readGeoreference(GDALDataset *dataset) {
+    const char* projectionString = dataset->GetProjectionRef();
+    auto srs = OGRSpatialReference(projectionString);
+    const char* projcs = srs.GetAttrValue("projcs");
+    if(projcs == nullptr) {
+        return false;
+    }
+    auto zone = std::string(projcs);
+    static const std::regex zoneRegex(R"(.*UTM\szone\s(\d+)(\w))");
+    std::match_results<std::string::const_iterator> res;
+    if(!std::regex_match(zone, res, zoneRegex)) {
+        return false;
+    }
+    zoneNumber = std::atoi(std::string(res[1]).c_str());
+    northp = (res[2] == "N");
+    return dataset->GetGeoTransform(adfGeoTransform) == CE_None;
+}
 /*
 cv::Point2i GeotiffMap::toPixels(double latitude, double longitude) const {
     return Map::toPixels(latitude, longitude);
@@ -0,0 +1,170 @@
+//
+// Binary cache of a preprocessed map, mapped read-only into memory.
+//
+
+#include "fastmatch-dataset/MapCacheFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace {
+    const char kMagic[8] = {'P', 'F', 'M', 'C', 'A', 'C', 'H', 'E'};
+
+    // On-disk layout, in host byte order
+    struct CacheLevel {
+        uint32_t rows;
+        uint32_t cols;
+        uint64_t step;
+        uint64_t offset;
+    };
+
+    struct CacheHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t levelCount;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t fileSize;
+        MapCacheFile::Georeference georeference;
+        CacheLevel levels[MapCacheFile::kMaxLevels];
+    };
+
+    static_assert(std::is_trivially_copyable<CacheHeader>::value, "cache header is written as raw bytes");
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + MapCacheFile::kAlignment - 1) / MapCacheFile::kAlignment * MapCacheFile::kAlignment;
+    }
+}
+
+MapCacheFile::SourceStamp MapCacheFile::SourceStamp::of(const std::string &path) {
+    SourceStamp stamp;
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error) {
+        return stamp;
+    }
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return stamp;
+    }
+    stamp.size = size;
+    stamp.modified = static_cast<int64_t>(modified.time_since_epoch().count());
+    return stamp;
+}
+
+MapCacheFile::~MapCacheFile() {
+    close();
+}
+
+void MapCacheFile::close() {
+    levels.clear();
+    if (mapping != nullptr) {
+        munmap(mapping, mappedBytes);
+        mapping = nullptr;
+        mappedBytes = 0;
+    }
+    geo = Georeference();
+}
+
+bool MapCacheFile::open(const std::string &path, const SourceStamp &source) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info{};
+    CacheHeader header{};
+    bool ok = fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(header) &&
+              pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+              std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+              header.version == kVersion &&
+              header.levelCount > 0 && header.levelCount <= kMaxLevels &&
+              header.fileSize == static_cast<uint64_t>(info.st_size) &&
+              header.sourceSize == source.size && header.sourceModified == source.modified;
+    for (uint32_t i = 0; ok && i < header.levelCount; i++) {
+        const CacheLevel &level = header.levels[i];
+        ok = level.step >= level.cols && level.offset % kAlignment == 0 &&
+             level.offset + level.step * level.rows <= header.fileSize;
+    }
+    if (ok) {
+        void *mapped = mmap(nullptr, header.fileSize, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapped != MAP_FAILED) {
+            mapping = mapped;
+            mappedBytes = header.fileSize;
+        } else {
+            ok = false;
+        }
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+    auto *base = static_cast<uint8_t *>(mapping);
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        const CacheLevel &level = header.levels[i];
+        levels.emplace_back(static_cast<int>(level.rows), static_cast<int>(level.cols), CV_8UC1,
+                            base + level.offset, static_cast<size_t>(level.step));
+    }
+    geo = header.georeference;
+    return true;
+}
+
+bool MapCacheFile::write(const std::string &path, const SourceStamp &source, const Georeference &georeference,
+                         const std::vector<cv::Mat> &levels) {
+    if (levels.empty() || levels.size() > kMaxLevels) {
+        return false;
+    }
+    CacheHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.georeference = georeference;
+    uint64_t offset = alignUp(sizeof(header));
+    for (size_t i = 0; i < levels.size(); i++) {
+        if (levels[i].type() != CV_8UC1) {
+            return false;
+        }
+        header.levels[i] = {static_cast<uint32_t>(levels[i].rows), static_cast<uint32_t>(levels[i].cols),
+                            static_cast<uint64_t>(levels[i].cols), offset};
+        offset = alignUp(offset + static_cast<uint64_t>(levels[i].cols) * levels[i].rows);
+    }
+    header.fileSize = offset;
+
+    std::string temporary = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (size_t i = 0; i < levels.size(); i++) {
+            out.seekp(static_cast<std::streamoff>(header.levels[i].offset));
+            for (int y = 0; y < levels[i].rows; y++) {
+                out.write(reinterpret_cast<const char *>(levels[i].ptr(y)), levels[i].cols);
+            }
+        }
+        // Pad the last level to the aligned file size
+        if (static_cast<uint64_t>(out.tellp()) < header.fileSize) {
+            out.seekp(static_cast<std::streamoff>(header.fileSize - 1));
+            out.put('\0');
+        }
+        if (!out) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+//
+// Residency bookkeeping for a map that is paged in on demand.
+//
+
+#include "fastmatch-dataset/MapPageTable.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+MapPageTable::MapPageTable(const cv::Size& mapSize, const cv::Size& pageSize)
+        : mapSize_(mapSize), pageSize_(pageSize) {
+    if (pageSize.width <= 0 || pageSize.height <= 0) {
+        throw std::invalid_argument("MapPageTable: page size must be positive");
+    }
+    pagesX_ = (mapSize.width + pageSize.width - 1) / pageSize.width;
+    pagesY_ = (mapSize.height + pageSize.height - 1) / pageSize.height;
+    lastUse_.assign(static_cast<size_t>(pagesX_) * pagesY_, 0);
+}
+
+cv::Rect MapPageTable::pageRect(size_t page) const {
+    int px = static_cast<int>(page % pagesX_);
+    int py = static_cast<int>(page / pagesX_);
+    cv::Rect rect(px * pageSize_.width, py * pageSize_.height, pageSize_.width, pageSize_.height);
+    return rect & cv::Rect(cv::Point(0, 0), mapSize_);
+}
+
+cv::Rect MapPageTable::pageSpan(const cv::Rect& region) const {
+    cv::Rect clipped = region & cv::Rect(cv::Point(0, 0), mapSize_);
+    if (clipped.empty()) {
+        return {};
+    }
+    int x0 = clipped.x / pageSize_.width;
+    int y0 = clipped.y / pageSize_.height;
+    int x1 = (clipped.x + clipped.width - 1) / pageSize_.width;
+    int y1 = (clipped.y + clipped.height - 1) / pageSize_.height;
+    return {x0, y0, x1 - x0 + 1, y1 - y0 + 1};
+}
+
+void MapPageTable::request(const cv::Rect& region, std::vector<size_t>& missing) {
+    cv::Rect span = pageSpan(region);
+    if (span.empty()) {
+        return;
+    }
+    ++clock_;
+    for (int py = span.y; py < span.y + span.height; py++) {
+        for (int px = span.x; px < span.x + span.width; px++) {
+            size_t page = static_cast<size_t>(py) * pagesX_ + px;
+            if (lastUse_[page] == 0) {
+                missing.push_back(page);
+                ++resident_;
+            }
+            lastUse_[page] = clock_;
+        }
+    }
+}
+
+void MapPageTable::evict(size_t maxResident, const cv::Rect& keep, std::vector<size_t>& evicted) {
+    if (resident_ <= maxResident) {
+        return;
+    }
+    cv::Rect keepSpan = pageSpan(keep);
+    std::vector<size_t> candidates;
+    for (size_t page = 0; page < lastUse_.size(); page++) {
+        cv::Point pos(static_cast<int>(page % pagesX_), static_cast<int>(page / pagesX_));
+        if (lastUse_[page] != 0 && !keepSpan.contains(pos)) {
+            candidates.push_back(page);
+        }
+    }
+    size_t count = std::min(resident_ - maxResident, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                      [this](size_t a, size_t b) { return lastUse_[a] < lastUse_[b]; });
+    for (size_t i = 0; i < count; i++) {
+        lastUse_[candidates[i]] = 0;
+        evicted.push_back(candidates[i]);
+    }
+    resident_ -= count;
+}
@@ -0,0 +1,155 @@
+//
+// metadata.csv mapped into memory with an index of its rows.
+//
+
+#include "fastmatch-dataset/MetadataCsvFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace {
+const char *const kColumnNames[MetadataCsvFile::ColumnCount] = {
+        "Filename", "Latitude", "Longitude", "RelativeAltitude",
+        "ImuX", "ImuY", "ImuZ", "ImuW",
+        "PoseX", "PoseY", "PoseZ",
+        "OrientationX", "OrientationY", "OrientationZ", "OrientationW",
+        "MapX", "MapY",
+        "SvoX", "SvoY", "SvoZ"
+};
+
+std::string_view trim(std::string_view field) {
+    while (!field.empty() && (field.front() == ' ' || field.front() == '\t' || field.front() == '"')) {
+        field.remove_prefix(1);
+    }
+    while (!field.empty() && (field.back() == ' ' || field.back() == '\t' || field.back() == '"' ||
+                              field.back() == '\r')) {
+        field.remove_suffix(1);
+    }
+    return field;
+}
+
+// from_chars rejects the leading '+' atof accepts
+std::string_view skipPlus(std::string_view field) {
+    if (!field.empty() && field.front() == '+') {
+        field.remove_prefix(1);
+    }
+    return field;
+}
+} // namespace
+
+MetadataCsvFile::~MetadataCsvFile() {
+    close();
+}
+
+void MetadataCsvFile::close() {
+    if (data != nullptr) {
+        munmap(const_cast<char *>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+    rowStarts.clear();
+    columnIndex.fill(-1);
+    columnAt.clear();
+}
+
+bool MetadataCsvFile::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info{};
+    bool ok = fstat(fd, &info) == 0 && info.st_size > 0;
+    if (ok) {
+        void *mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = static_cast<const char *>(mapped);
+            size = static_cast<size_t>(info.st_size);
+            // Rows are read front to back
+            madvise(mapped, size, MADV_SEQUENTIAL);
+        } else {
+            ok = false;
+        }
+    }
+    ::close(fd);
+    if (!ok) {
+        return false;
+    }
+
+    const char *end = data + size;
+    const char *headerEnd = static_cast<const char *>(std::memchr(data, '\n', size));
+    headerEnd = headerEnd ? headerEnd : end;
+    std::string_view header(data, static_cast<size_t>(headerEnd - data));
+    for (int index = 0;; index++) {
+        size_t comma = header.find(',');
+        auto name = trim(header.substr(0, comma));
+        for (int column = 0; column < ColumnCount; column++) {
+            if (columnIndex[column] < 0 && name == kColumnNames[column]) {
+                columnIndex[column] = index;
+                columnAt.resize(std::max(columnAt.size(), static_cast<size_t>(index) + 1), -1);
+                columnAt[index] = column;
+            }
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        header.remove_prefix(comma + 1);
+    }
+
+    for (const char *row = headerEnd + (headerEnd < end ? 1 : 0); row < end;) {
+        const char *next = static_cast<const char *>(std::memchr(row, '\n', static_cast<size_t>(end - row)));
+        next = next ? next + 1 : end;
+        // Blank lines, like the one a trailing newline would leave, are not rows
+        if (!trim(std::string_view(row, static_cast<size_t>(next - row - (next[-1] == '\n' ? 1 : 0)))).empty()) {
+            rowStarts.push_back(static_cast<size_t>(row - data));
+        }
+        row = next;
+    }
+    rowStarts.push_back(size);
+    return true;
+}
+
+std::string_view MetadataCsvFile::line(size_t row) const {
+    size_t start = rowStarts[row];
+    const char *lineStart = data + start;
+    const char *lineEnd = static_cast<const char *>(std::memchr(lineStart, '\n', size - start));
+    return {lineStart, static_cast<size_t>((lineEnd ? lineEnd : data + size) - lineStart)};
+}
+
+void MetadataCsvFile::readRow(size_t row, Row &fields) const {
+    fields.fill(std::string_view());
+    std::string_view rest = line(row);
+    for (size_t index = 0; index < columnAt.size(); index++) {
+        size_t comma = rest.find(',');
+        if (columnAt[index] >= 0) {
+            fields[columnAt[index]] = trim(rest.substr(0, comma));
+        }
+        if (comma == std::string_view::npos) {
+            break;
+        }
+        rest.remove_prefix(comma + 1);
+    }
+}
+
+double MetadataCsvFile::toDouble(std::string_view field) {
+    field = skipPlus(field);
+    double value = 0.0;
+    auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == std::errc() ? value : 0.0;
+}
+
+int MetadataCsvFile::toInt(std::string_view field) {
+    field = skipPlus(field);
+    int value = 0;
+    auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+    return result.ec == std::errc() ? value : 0;
+}
+
+const char *MetadataCsvFile::columnName(Column column) {
+    return kColumnNames[column];
+}
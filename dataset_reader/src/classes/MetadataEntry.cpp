@@ -6,17 +6,43 @@
 #include <opencv2/opencv.hpp>
 #include "fastmatch-dataset/MetadataEntry.hpp"
 
+void MetadataEntry::loadImages() {
+    if(!imageGray.empty()) {
+        // Already decoded, e.g. a frame of a FlightLogFile
+        return;
+    }
+    imageBuffer = cv::imread(imageFullPath);
+    if(imageBuffer.empty()) {
+        imageGray.release();
+        return;
+    }
+    cv::cvtColor(imageBuffer, imageGray, cv::COLOR_BGR2GRAY);
+}
+
 cv::Mat MetadataEntry::getImage() const {
+    if(!imageGray.empty()) {
+        return imageGray;
+    }
     return cv::imread(imageFullPath, cv::IMREAD_GRAYSCALE);
 }
 
 cv::Mat MetadataEntry::getImageColored() const {
+    if(imageBuffer.empty() && !imageGray.empty()) {
+        cv::Mat colored;
+        cv::cvtColor(imageGray, colored, cv::COLOR_GRAY2BGR);
+        return colored;
+    }
     return imageBuffer.clone();
 }
 
+const cv::Mat &MetadataEntry::getMatchImage() const {
+    return imageGray.empty() ? imageBuffer : imageGray;
+}
+
 cv::Mat MetadataEntry::getImageSharpened(bool smooth) const {
-    cv::Mat im = getImage();
-    cv::equalizeHist(im, im);
+    // imageGray may be a read-only mapped frame, equalize into a new image
+    cv::Mat im;
+    cv::equalizeHist(getImage(), im);
     if(smooth) {
         cv::medianBlur(im, im, 5);
     }
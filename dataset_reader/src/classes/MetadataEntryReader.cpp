@@ -2,99 +2,111 @@
 // Created by rokas on 17.11.30.
 //
 
-#include <boost/algorithm/string/split.hpp>
-#include <boost/algorithm/string/classification.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include "fastmatch-dataset/MetadataEntryReader.hpp"
 
-std::vector<std::string> MetadataEntryReader::parseString(const std::string &line) {
-    std::vector<std::string> parts;
-    boost::split(parts,line,boost::is_any_of(","));
-    return parts;
-}
-
-std::map<std::string, std::string>
-MetadataEntryReader::parseLine(const std::vector<std::string> &header, const std::string &line) {
-    std::vector<std::string> values = parseString(line);
-    std::map<std::string, std::string> valueMap;
-    int i = 0;
-    for(const auto& value : values) {
-        valueMap.insert(std::pair<std::string, std::string>(
-                header[i], value
-        ));
-        i++;
-    }
-    return valueMap;
-}
-
 bool MetadataEntryReader::openDirectory(const std::string &datasetDir) {
     datasetPath = datasetDir;
-    in = std::ifstream(datasetDir + "/metadata.csv");
-    if(in.is_open()) {
-        std::string line;
-        std::getline(in, line);
-        header = parseString(line);
+    lineCounter = 0;
+    log.close();
+    csv.close();
+    std::string csvPath = datasetDir + "/metadata.csv";
+    if(useFlightLog && log.open(FlightLogFile::defaultPath(datasetDir), MapCacheFile::SourceStamp::of(csvPath))) {
         return true;
-    } else {
-        return false;
     }
+    return csv.open(csvPath);
+}
+
+void MetadataEntryReader::setUseFlightLog(bool use) {
+    useFlightLog = use;
+}
+
+bool MetadataEntryReader::usesFlightLog() const {
+    return log.isOpen();
 }
 
 bool MetadataEntryReader::readNextEntry(MetadataEntry &metadataEntry) {
     // Reset the metadata
     metadataEntry = MetadataEntry();
-    std::string line;
-    while(std::getline(in, line)) {
-        if(lineCounter % skipRate == 0) {
-            std::map<std::string, std::string> values = parseLine(header, line);
-            fillMetadata(metadataEntry, values);
-            lineCounter++;
-            return true;
-        }
-        lineCounter++;
+    // The row index jumps straight to the next row kept by the skip rate
+    uint64_t row = (lineCounter + skipRate - 1) / skipRate * skipRate;
+    if(row >= rowCount()) {
+        lineCounter = rowCount();
+        return false;
+    }
+    if(log.isOpen()) {
+        fillMetadata(metadataEntry, row);
+    } else {
+        MetadataCsvFile::Row values;
+        csv.readRow(row, values);
+        fillMetadata(metadataEntry, values);
     }
-    return false;
+    lineCounter = row + 1;
+    return true;
 }
 
-void MetadataEntryReader::fillMetadata(MetadataEntry &entry, std::map<std::string, std::string> &values) {
-    entry.imageFileName = values["Filename"];
-    entry.imageFileName.erase(
-            remove( entry.imageFileName.begin(), entry.imageFileName.end(), '\"' ),
-            entry.imageFileName.end()
-    );
+size_t MetadataEntryReader::rowCount() const {
+    return log.isOpen() ? log.recordCount() : csv.rowCount();
+}
+
+bool MetadataEntryReader::seek(size_t row) {
+    lineCounter = row;
+    return row < rowCount();
+}
+
+void MetadataEntryReader::fillMetadata(MetadataEntry &entry, const MetadataCsvFile::Row &values) {
+    auto number = [&values](MetadataCsvFile::Column column) {
+        return MetadataCsvFile::toDouble(values[column]);
+    };
+    entry.imageFileName = std::string(values[MetadataCsvFile::Filename]);
     entry.imageFullPath = datasetPath + "/" + entry.imageFileName;
-    entry.latitude = std::atof(values["Latitude"].c_str());
-    entry.longitude = std::atof(values["Longitude"].c_str());
-    entry.altitude = std::atof(values["RelativeAltitude"].c_str());
+    entry.latitude = number(MetadataCsvFile::Latitude);
+    entry.longitude = number(MetadataCsvFile::Longitude);
+    entry.altitude = number(MetadataCsvFile::RelativeAltitude);
     entry.imuOrientation = Quaternion(
-            std::atof(values["ImuX"].c_str()),
-            std::atof(values["ImuY"].c_str()),
-            std::atof(values["ImuZ"].c_str()),
-            std::atof(values["ImuW"].c_str())
+            number(MetadataCsvFile::ImuX),
+            number(MetadataCsvFile::ImuY),
+            number(MetadataCsvFile::ImuZ),
+            number(MetadataCsvFile::ImuW)
     );
     entry.groundTruthPose = Vector3d(
-            std::atof(values["PoseX"].c_str()),
-            std::atof(values["PoseY"].c_str()),
-            std::atof(values["PoseZ"].c_str())
+            number(MetadataCsvFile::PoseX),
+            number(MetadataCsvFile::PoseY),
+            number(MetadataCsvFile::PoseZ)
     );
     entry.groundTruthOrientation = Quaternion(
-            std::atof(values["OrientationX"].c_str()),
-            std::atof(values["OrientationY"].c_str()),
-            std::atof(values["OrientationZ"].c_str()),
-            std::atof(values["OrientationW"].c_str())
+            number(MetadataCsvFile::OrientationX),
+            number(MetadataCsvFile::OrientationY),
+            number(MetadataCsvFile::OrientationZ),
+            number(MetadataCsvFile::OrientationW)
     );
     entry.mapLocation = cv::Point(
-            std::atoi(values["MapX"].c_str()),
-            std::atoi(values["MapY"].c_str())
+            MetadataCsvFile::toInt(values[MetadataCsvFile::MapX]),
+            MetadataCsvFile::toInt(values[MetadataCsvFile::MapY])
     );
     entry.svoPose = Vector3d(
-            std::atof(values["SvoX"].c_str()),
-            std::atof(values["SvoY"].c_str()),
-            std::atof(values["SvoZ"].c_str())
+            number(MetadataCsvFile::SvoX),
+            number(MetadataCsvFile::SvoY),
+            number(MetadataCsvFile::SvoZ)
     );
-    entry.imageBuffer = cv::imread(entry.imageFullPath);
-    entry.map = map->getImage();
-    entry.mapper = map;
+    finishEntry(entry);
+}
+
+void MetadataEntryReader::fillMetadata(MetadataEntry &entry, size_t record) {
+    // Frames stored in the log become imageGray without decoding or copying
+    log.fillEntry(record, entry);
+    entry.imageFullPath = datasetPath + "/" + entry.imageFileName;
+    finishEntry(entry);
+}
+
+void MetadataEntryReader::finishEntry(MetadataEntry &entry) {
+    if(decodeImages) {
+        entry.loadImages();
+    }
+    if(map) {
+        entry.map = map->getImage();
+        entry.mapper = map;
+    }
 }
 
 void MetadataEntryReader::setMap(const std::string &mapFile) {
@@ -102,10 +114,30 @@ void MetadataEntryReader::setMap(const std::string &mapFile) {
     map->open(mapFile);
 }
 
+void MetadataEntryReader::setMap(const GeoMapPtr &map) {
+    this->map = map;
+}
+
+void MetadataEntryReader::setPagedMap(const std::string &mapFile, size_t maxResidentBytes) {
+    auto paged = std::make_shared<PagedGeotiffMap>();
+    paged->open(mapFile, maxResidentBytes);
+    map = paged;
+}
+
+void MetadataEntryReader::setCachedMap(const std::string &mapFile, const std::string &cacheFile) {
+    auto cached = std::make_shared<CachedGeotiffMap>();
+    cached->open(mapFile, cacheFile);
+    map = cached;
+}
+
 const MapPtr MetadataEntryReader::getMap() const {
     return map;
 }
 
+void MetadataEntryReader::setDecodeImages(bool decode) {
+    decodeImages = decode;
+}
+
 uint32_t MetadataEntryReader::getSkipRate() const {
     return skipRate;
 }
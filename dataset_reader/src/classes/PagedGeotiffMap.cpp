@@ -0,0 +1,133 @@
+//
+// GeoTIFF map that is read from disk page by page when a region is needed.
+//
+
+#include <gdal/gdal.h>
+#include <gdal/gdal_priv.h>
+#include <sys/mman.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <opencv2/imgproc.hpp>
+
+#include "fastmatch-dataset/PagedGeotiffMap.hpp"
+
+PagedGeotiffMap::~PagedGeotiffMap() {
+    close();
+}
+
+void PagedGeotiffMap::close() {
+    image.release();
+    if(pixels != nullptr) {
+        munmap(pixels, mappedBytes);
+        pixels = nullptr;
+        mappedBytes = 0;
+    }
+    if(dataset != nullptr) {
+        GDALClose(dataset);
+        dataset = nullptr;
+    }
+    pages = MapPageTable();
+    pagingStats = MapPagingStats();
+    valid = false;
+}
+
+bool PagedGeotiffMap::open(const std::string &filename, size_t maxResidentBytes) {
+    close();
+    GDALAllRegister();
+    dataset = (GDALDataset *) GDALOpen( filename.c_str(), GA_ReadOnly );
+    if(dataset == nullptr || dataset->GetRasterCount() < 1 || !readGeoreference(dataset)) {
+        close();
+        return false;
+    }
+    GDALSetCacheMax64(std::min<GIntBig>(GDALGetCacheMax64(), kGdalCacheBytes));
+
+    cv::Size size(dataset->GetRasterXSize(), dataset->GetRasterYSize());
+    size_t step = (static_cast<size_t>(size.width) + kPageWidth - 1) / kPageWidth * kPageWidth;
+    mappedBytes = step * size.height;
+    // Only address space is reserved, memory is committed when a page is written
+    void *mapping = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(mapping == MAP_FAILED) {
+        mappedBytes = 0;
+        close();
+        return false;
+    }
+    pixels = static_cast<uint8_t *>(mapping);
+    image = cv::Mat(size, CV_8UC1, pixels, step);
+    pages = MapPageTable(size, cv::Size(kPageWidth, kPageHeight));
+    maxResidentPages = std::max<size_t>(1, maxResidentBytes / kPageBytes);
+    geoRegion[0] = pixelCoordinates(cv::Point(0, 0));
+    geoRegion[1] = pixelCoordinates(cv::Point(size.width, size.height));
+    valid = true;
+    return true;
+}
+
+void PagedGeotiffMap::ensureRegion(const cv::Rect &region) {
+    ensure(region, region);
+}
+
+void PagedGeotiffMap::prefetch(const cv::Rect &region, const cv::Point2f &motion) {
+    cv::Rect ahead = region + cv::Point(cvRound(motion.x), cvRound(motion.y));
+    ensure(ahead, region | ahead);
+}
+
+void PagedGeotiffMap::ensure(const cv::Rect &region, const cv::Rect &keep) {
+    if(!valid) {
+        return;
+    }
+    missingPages.clear();
+    pages.request(region, missingPages);
+    // Make room first, so the peak stays within the limit when possible
+    evictedPages.clear();
+    pages.evict(maxResidentPages, keep, evictedPages);
+    for(size_t page : evictedPages) {
+        releasePage(page);
+    }
+    pagingStats.evictions += evictedPages.size();
+    for(size_t page : missingPages) {
+        auto start = std::chrono::steady_clock::now();
+        loadPage(page);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        pagingStats.pageInMs += ms;
+        pagingStats.maxPageInMs = std::max(pagingStats.maxPageInMs, ms);
+    }
+    pagingStats.pageIns += missingPages.size();
+    pagingStats.residentBytes = pages.residentCount() * kPageBytes;
+    pagingStats.peakResidentBytes = std::max(pagingStats.peakResidentBytes, pagingStats.residentBytes);
+}
+
+void PagedGeotiffMap::loadPage(size_t page) {
+    cv::Rect rect = pages.pageRect(page);
+    cv::Rect source(rect.x - kBlurApron, rect.y - kBlurApron,
+                    rect.width + 2 * kBlurApron, rect.height + 2 * kBlurApron);
+    source &= cv::Rect(0, 0, image.cols, image.rows);
+
+    // Same channel order as cv::imread, single band maps are read as gray directly
+    int bandMap[3] = {3, 2, 1};
+    int bands = dataset->GetRasterCount() >= 3 ? 3 : 1;
+    rawPage.create(source.size(), bands == 3 ? CV_8UC3 : CV_8UC1);
+    CPLErr err = dataset->RasterIO(GF_Read, source.x, source.y, source.width, source.height,
+                                   rawPage.data, source.width, source.height, GDT_Byte,
+                                   bands, bands == 3 ? bandMap : bandMap + 2,
+                                   bands, static_cast<GSpacing>(rawPage.step), 1);
+    if(err != CE_None) {
+        throw std::runtime_error("PagedGeotiffMap: failed to read map page " + std::to_string(page));
+    }
+    if(bands == 3) {
+        cv::cvtColor(rawPage, grayPage, cv::COLOR_BGR2GRAY);
+    } else {
+        grayPage = rawPage;
+    }
+    GaussianBlur( grayPage, blurredPage, cv::Size( 9, 9 ), 0, 0 );
+    blurredPage(cv::Rect(rect.tl() - source.tl(), rect.size())).copyTo(image(rect));
+}
+
+void PagedGeotiffMap::releasePage(size_t page) {
+    cv::Rect rect = pages.pageRect(page);
+    // Rows are padded to the page width, so the whole span belongs to this page
+    for(int y = rect.y; y < rect.y + rect.height; y++) {
+        madvise(image.ptr(y) + rect.x, kPageWidth, MADV_DONTNEED);
+    }
+}
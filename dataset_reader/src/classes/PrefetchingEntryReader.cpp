@@ -0,0 +1,121 @@
+//
+// Reader stage decoding the next frames while the current one is filtered.
+//
+
+#include <algorithm>
+#include <chrono>
+
+#include "fastmatch-dataset/PrefetchingEntryReader.hpp"
+
+PrefetchingEntryReader::PrefetchingEntryReader(MetadataEntryReader &reader, size_t depth, size_t workers)
+        : reader(reader), depth(depth) {
+    if(depth == 0) {
+        return;
+    }
+    reader.setDecodeImages(false);
+    for(size_t i = 0; i < std::max<size_t>(workers, 1); i++) {
+        threads.emplace_back(&PrefetchingEntryReader::work, this);
+    }
+}
+
+PrefetchingEntryReader::~PrefetchingEntryReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    if(depth > 0) {
+        reader.setDecodeImages(true);
+    }
+}
+
+void PrefetchingEntryReader::refill() {
+    while(!exhausted && queued.size() < depth) {
+        auto frame = std::make_shared<Frame>();
+        if(!reader.readNextEntry(frame->entry)) {
+            exhausted = true;
+            break;
+        }
+        queued.push_back(frame);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.push_back(frame);
+        }
+        workAvailable.notify_one();
+    }
+}
+
+bool PrefetchingEntryReader::readNextEntry(MetadataEntry &metadataEntry) {
+    if(depth == 0) {
+        auto start = std::chrono::steady_clock::now();
+        if(!reader.readNextEntry(metadataEntry)) {
+            return false;
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(mutex);
+        stats_.frames++;
+        stats_.decoded++;
+        stats_.stalls++;
+        stats_.waitMs += ms;
+        stats_.decodeMs += ms;
+        stats_.maxDecodeMs = std::max(stats_.maxDecodeMs, ms);
+        return true;
+    }
+    refill();
+    if(queued.empty()) {
+        return false;
+    }
+    auto frame = queued.front();
+    queued.pop_front();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        stats_.frames++;
+        stats_.readyFramesSum += std::count_if(queued.begin(), queued.end(), [](const std::shared_ptr<Frame> &f) {
+            return f->decoded;
+        }) + (frame->decoded ? 1 : 0);
+        if(!frame->decoded) {
+            stats_.stalls++;
+            auto start = std::chrono::steady_clock::now();
+            frameDecoded.wait(lock, [&] { return frame->decoded; });
+            stats_.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    metadataEntry = std::move(frame->entry);
+    // Keeps the workers busy while the caller processes this frame
+    refill();
+    return true;
+}
+
+void PrefetchingEntryReader::work() {
+    for(;;) {
+        std::shared_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return stopping || !pending.empty(); });
+            if(stopping) {
+                return;
+            }
+            frame = pending.front();
+            pending.pop_front();
+        }
+        auto start = std::chrono::steady_clock::now();
+        frame->entry.loadImages();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            frame->decoded = true;
+            stats_.decoded++;
+            stats_.decodeMs += ms;
+            stats_.maxDecodeMs = std::max(stats_.maxDecodeMs, ms);
+        }
+        frameDecoded.notify_all();
+    }
+}
+
+FramePrefetchStats PrefetchingEntryReader::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats_;
+}
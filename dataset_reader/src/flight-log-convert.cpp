@@ -0,0 +1,106 @@
+#include <boost/program_options.hpp>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include <opencv2/imgproc.hpp>
+
+#include "fastmatch-dataset/FlightLogFile.hpp"
+#include "fastmatch-dataset/MetadataEntryReader.hpp"
+#include "fastmatch-dataset/PrefetchingEntryReader.hpp"
+
+namespace po = boost::program_options;
+
+int main(int ac, char *av[]) {
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("dataset,d", po::value<std::string>(), "Dataset directory containing metadata.csv")
+            ("output,o", po::value<std::string>(), "Flight log to write, <dataset>/metadata.pflog by default")
+            ("frame-width,w", po::value<int>()->default_value(0), "Width of the stored gray frames, the height keeps "
+                                                                  "the aspect ratio; 0 keeps the original size")
+            ("no-frames", po::bool_switch()->default_value(false), "Store the metadata only, images stay on disk")
+            ("help,h", "produce help message");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, (const char *const *) av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if(!vm.count("dataset")) {
+        std::cerr << "Please set dataset\n";
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    std::string dataset = vm["dataset"].as<std::string>();
+    std::string output = vm.count("output") ? vm["output"].as<std::string>() : FlightLogFile::defaultPath(dataset);
+    int frameWidth = vm["frame-width"].as<int>();
+    bool frames = !vm["no-frames"].as<bool>();
+
+    MetadataEntryReader reader;
+    // Always convert from the CSV, never from an existing log
+    reader.setUseFlightLog(false);
+    if(!reader.openDirectory(dataset)) {
+        std::cerr << "Cannot read " << dataset << "/metadata.csv\n";
+        return 1;
+    }
+    reader.setDecodeImages(false);
+    PrefetchingEntryReader prefetcher(reader, frames ? 8 : 0);
+
+    FlightLogWriter writer;
+    bool opened = false;
+    cv::Size frameSize;
+    size_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    MetadataEntry entry;
+    while(prefetcher.readNextEntry(entry)) {
+        cv::Mat gray;
+        if(frames) {
+            if(entry.imageGray.empty()) {
+                std::cerr << "Cannot decode " << entry.imageFullPath << "\n";
+                return 1;
+            }
+            if(frameSize.empty()) {
+                // Every frame is stored at the size derived from the first one
+                frameSize = entry.imageGray.size();
+                if(frameWidth > 0) {
+                    frameSize = cv::Size(frameWidth, std::max(1, frameSize.height * frameWidth / frameSize.width));
+                }
+            }
+            gray = entry.imageGray;
+            if(gray.size() != frameSize) {
+                cv::resize(entry.imageGray, gray, frameSize, 0, 0, cv::INTER_AREA);
+            }
+        }
+        if(!opened) {
+            if(!writer.open(output, frameSize, MapCacheFile::SourceStamp::of(dataset + "/metadata.csv"))) {
+                std::cerr << "Cannot write " << output << "\n";
+                return 1;
+            }
+            opened = true;
+        }
+        if(!writer.append(entry, gray)) {
+            std::cerr << "Cannot write " << output << "\n";
+            return 1;
+        }
+        count++;
+    }
+    if(!opened) {
+        writer.open(output, cv::Size(), MapCacheFile::SourceStamp::of(dataset + "/metadata.csv"));
+    }
+    if(!writer.finish()) {
+        std::cerr << "Cannot write " << output << "\n";
+        return 1;
+    }
+    std::cout << count << " frames";
+    if(!frameSize.empty()) {
+        std::cout << " at " << frameSize.width << "x" << frameSize.height;
+    }
+    std::cout << " written to " << output << " in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+    return 0;
+}
@@ -14,12 +14,6 @@ using namespace std;
 using namespace cv;
 
 namespace fast_match {
-    /**
-     * Default constructor
-     */
-    MatchConfig::MatchConfig(){
-    }
-    
     /**
      * Constructor
      */
@@ -27,13 +21,6 @@ namespace fast_match {
         init( trans_x, trans_y, rotate_2, scale_x, scale_y, rotate_1 );
     }
     
-    /**
-     * Copy constructor
-     */
-    MatchConfig::MatchConfig( const MatchConfig& object ) : id(object.getId()) {
-        init( object.translateX, object.translateY, object.rotate2, object.scaleX, object.scaleY, object.rotate1 );
-    }
-    
     /**
      * Initialize our configuration parameters
      */
@@ -44,7 +31,7 @@ namespace fast_match {
         this->scaleX        = scale_x;
         this->scaleY        = scale_y;
         this->rotate1       = rotate_1;
-        this->affine        = asAffineMatrix();
+        computeAffine( trans_x, trans_y, rotate_2, scale_x, scale_y, rotate_1, this->affine );
     }
 
     vector<MatchConfig> MatchConfig::fromMatrix(Mat& configs) {
@@ -59,36 +46,41 @@ namespace fast_match {
     /**
      * Create an affine transformation matrix from the configurations
      */
-    Mat MatchConfig::asMatrix() {
+    Mat MatchConfig::asMatrix() const {
         return (Mat_<float>(1, 6) << translateX, translateY, rotate2, scaleX, scaleY, rotate1 );
     }
     
     /**
      * Returns the affine matrix representation of the configuration
      */
-    Mat MatchConfig::getAffineMatrix() {
-        return this->affine;
+    Mat MatchConfig::getAffineMatrix() const {
+        return Mat( 2, 3, CV_32F, const_cast<float *>( this->affine ) ).clone();
     }
     
     /**
      * Create an affine transformation matrix from the configurations
      */
-    Mat MatchConfig::asAffineMatrix() {
+    Mat MatchConfig::asAffineMatrix() const {
+        float a[6];
+        computeAffine( translateX, translateY, rotate2, scaleX, scaleY, rotate1, a );
+        return Mat( 2, 3, CV_32F, a ).clone();
+    }
+
+    void MatchConfig::computeAffine( float trans_x, float trans_y, float rotate_2, float scale_x, float scale_y,
+                                     float rotate_1, float out[6] ) {
         /* [TODO] Should use lookup table or something in the future */
-        float   cos_r1 = cosf( rotate1 ),
-                sin_r1 = sinf( rotate1 ),
-                cos_r2 = cosf( rotate2 ),
-                sin_r2 = sinf( rotate2 );
+        float   cos_r1 = cosf( rotate_1 ),
+                sin_r1 = sinf( rotate_1 ),
+                cos_r2 = cosf( rotate_2 ),
+                sin_r2 = sinf( rotate_2 );
         
         /* Create affine matrix based on the configuration */
-        float   a11 =  scaleX * cos_r1 * cos_r2 - scaleY * sin_r1 * sin_r2,
-                a12 = -scaleX * cos_r1 * sin_r2 - scaleY * cos_r2 * sin_r1,
-                a21 =  scaleX * cos_r2 * sin_r1 + scaleY * cos_r1 * sin_r2,
-                a22 =  scaleY * cos_r1 * cos_r2 - scaleX * sin_r1 * sin_r2;
-        
-        return (Mat_<float>(2, 3) <<
-                a11, a12, translateX,
-                a21, a22, translateY );
+        out[0] =  scale_x * cos_r1 * cos_r2 - scale_y * sin_r1 * sin_r2;
+        out[1] = -scale_x * cos_r1 * sin_r2 - scale_y * cos_r2 * sin_r1;
+        out[2] =  trans_x;
+        out[3] =  scale_x * cos_r2 * sin_r1 + scale_y * cos_r1 * sin_r2;
+        out[4] =  scale_y * cos_r1 * cos_r2 - scale_x * sin_r1 * sin_r2;
+        out[5] =  trans_y;
     }
 
 
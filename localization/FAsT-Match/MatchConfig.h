@@ -10,27 +10,44 @@
 #define __FAsT_Match__MatchConfig__
 
 #include <iostream>
+#include <type_traits>
 #include <opencv2/opencv.hpp>
 
 namespace fast_match {
     /**
-     * Config class that describes the parameters used in creating affine transformations
+     * Config class that describes the parameters used in creating affine transformations.
+     * The affine matrix is kept inline, so a config is a plain value that is
+     * copied with memcpy and never touches the heap.
      */
     class MatchConfig {
     public:
-        MatchConfig();
-        MatchConfig( const MatchConfig& object );
+        MatchConfig() = default;
         MatchConfig( float trans_x, float trans_y, float rotate_2, float scale_x, float scale_y, float rotate_1 );
         void init( float trans_x, float trans_y, float rotate_2, float scale_x, float scale_y, float rotate_1 );
         
         static std::vector<MatchConfig> fromMatrix( cv::Mat& configs);
-        cv::Mat asMatrix();
-        cv::Mat asAffineMatrix();
-        cv::Mat getAffineMatrix();
+        cv::Mat asMatrix() const;
+        cv::Mat asAffineMatrix() const;
+        cv::Mat getAffineMatrix() const;
+
+        /**
+         * The affine matrix as 6 floats, row-major [a11 a12 tx a21 a22 ty]
+         */
+        const float* getAffine() const { return affine; }
+
+        /**
+         * Affine matrix of the given parameters, row-major into `out`
+         */
+        static void computeAffine( float trans_x, float trans_y, float rotate_2, float scale_x, float scale_y,
+                                   float rotate_1, float out[6] );
         
         friend std::ostream &operator <<( std::ostream& os, const MatchConfig & conf );
         float getTranslateX() const;
         float getTranslateY() const;
+        float getRotate2() const { return rotate2; }
+        float getScaleX() const { return scaleX; }
+        float getScaleY() const { return scaleY; }
+        float getRotate1() const { return rotate1; }
         float getProbability() const;
         void setProbability(float probability);
 
@@ -50,8 +67,10 @@ namespace fast_match {
         void setId(int id);
 
     protected:
-        cv::Mat affine;
+        float affine[6];
     };
+
+    static_assert( std::is_trivially_copyable<MatchConfig>::value, "MatchConfig is copied as plain memory" );
 }
 
 
@@ -1,8 +1,13 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
+#include <src/Resampler.hpp>
+
 struct ParticleFilterConfig {
     double radius = 500.0;
     float epsilon = 0.1f;
@@ -11,6 +16,22 @@ struct ParticleFilterConfig {
     float kld_error = 0.5f;
     int binSize = 5;
     bool use_gaussian = true;
+    ResamplingMethod resampling = ResamplingMethod::Systematic;
+    // Fraction of template pixels sampled for the correlation
+    float sampleDensity = 0.1f;
+    // Sample particles from a tiled copy of the map
+    bool tiledMap = false;
+    // Memory bound for rotated sampling patterns, in megabytes
+    size_t patternCacheMB = 64;
+    // Pyramid level on which all particles are scored before the best
+    // coarseSurvivors are re-scored at full resolution, 0 disables it
+    int coarseLevel = 0;
+    int coarseSurvivors = 32;
+    // Recent correlations averaged into a particle's probability
+    int probabilityWindow = 4;
+    // Seed of every random stream of the filter, a run with the same seed
+    // and settings is reproducible. Unset draws one from std::random_device
+    std::optional<uint64_t> seed;
 
     void validate() const {
         if (radius <= 0.0)
@@ -25,5 +46,13 @@ struct ParticleFilterConfig {
             throw std::invalid_argument("kld_error must be positive, got " + std::to_string(kld_error));
         if (binSize <= 0)
             throw std::invalid_argument("binSize must be positive, got " + std::to_string(binSize));
+        if (sampleDensity <= 0.0f || sampleDensity > 1.0f)
+            throw std::invalid_argument("sampleDensity must be in (0, 1], got " + std::to_string(sampleDensity));
+        if (coarseLevel < 0 || coarseLevel > 4)
+            throw std::invalid_argument("coarseLevel must be in [0, 4], got " + std::to_string(coarseLevel));
+        if (coarseSurvivors <= 0)
+            throw std::invalid_argument("coarseSurvivors must be positive, got " + std::to_string(coarseSurvivors));
+        if (probabilityWindow < 1 || probabilityWindow > 16)
+            throw std::invalid_argument("probabilityWindow must be in [1, 16], got " + std::to_string(probabilityWindow));
     }
 };
@@ -1,6 +1,15 @@
 #include "ParticleFilterCore.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+
+namespace {
+    constexpr float kPropagationNoise = 4.0f;
+    // Covers the noise added when the odometry is lost
+    constexpr float kPagingMargin = 64.0f;
+}
 
 void ParticleFilterCore::initialize(const MetadataEntry &metadata, const ParticleFilterConfig &config) {
     pfm = std::make_shared<ParticleFastMatch>(
@@ -12,11 +21,32 @@ void ParticleFilterCore::initialize(const MetadataEntry &metadata, const Particl
             config.quantile, // quantile_
             config.kld_error, // kld_error_
             config.binSize, // bin_size_
-            config.use_gaussian // use_gaussian
+            config.use_gaussian, // use_gaussian
+            config.seed ? *config.seed : entropySeed() // seed
     );
-    cv::Mat templ = metadata.getImageColored();
+    pfm->setResampling(config.resampling);
+    pfm->getPatternCache().setMemoryLimit(config.patternCacheMB << 20);
+    pfm->setSampleDensity(config.sampleDensity);
+    pfm->setTiledMap(config.tiledMap);
+    pfm->setCoarseToFine(config.coarseLevel, static_cast<size_t>(config.coarseSurvivors));
+    pfm->setProbabilityWindow(static_cast<uint32_t>(config.probabilityWindow));
+    const cv::Mat &templ = metadata.getMatchImage();
     pfm->setTemplate(templ);
-    pfm->setImage(metadata.map);
+    templateSize = templ.size();
+    pagedMap = std::dynamic_pointer_cast<PagedGeotiffMap>(metadata.mapper);
+    if (pagedMap) {
+        if (config.tiledMap) {
+            throw std::invalid_argument("A paged map cannot be sampled through a tiled copy");
+        }
+        if (config.coarseLevel > 0) {
+            throw std::invalid_argument("Coarse-to-fine evaluation needs the whole map in memory");
+        }
+        pfm->setPreparedImage(metadata.map);
+    } else if (auto cachedMap = std::dynamic_pointer_cast<CachedGeotiffMap>(metadata.mapper)) {
+        pfm->setPreparedImage(metadata.map, cachedMap->level(config.coarseLevel), cachedMap->gray());
+    } else {
+        pfm->setImage(metadata.map);
+    }
 }
 
 void ParticleFilterCore::setDirection(double direction) {
@@ -28,6 +58,7 @@ void ParticleFilterCore::setTemplate(const cv::Mat &templ) {
 }
 
 void ParticleFilterCore::setImage(const cv::Mat &image) {
+    pagedMap.reset();
     pfm->setImage(image);
 }
 
@@ -36,13 +67,50 @@ void ParticleFilterCore::setScale(float minScale, float maxScale, uint32_t searc
 }
 
 std::vector<cv::Point> ParticleFilterCore::filterParticles(const cv::Point2f &movement, cv::Mat &bestTransform) {
-    return pfm->filterParticles(movement, bestTransform);
+    if (!pagedMap) {
+        return pfm->filterParticles(movement, bestTransform);
+    }
+    pagedMap->ensureRegion(particleRegion(movement));
+    auto corners = pfm->filterParticles(movement, bestTransform);
+    // The next frame most likely moves the same way
+    pagedMap->prefetch(particleRegion(cv::Point2f()), movement);
+    return corners;
 }
 
 std::vector<cv::Point> ParticleFilterCore::filterParticlesAffine(const cv::Point2f &movement, cv::Mat &bestTransform) {
+    if (pagedMap) {
+        throw std::runtime_error("Affine particle matching needs the whole map in memory");
+    }
     return pfm->filterParticlesAffine(movement, bestTransform);
 }
 
+cv::Rect ParticleFilterCore::particleRegion(const cv::Point2f &movement) const {
+    const Particles &particles = pfm->getParticles();
+    if (particles.empty()) {
+        return {};
+    }
+    int minX = particles.front().x, maxX = minX;
+    int minY = particles.front().y, maxY = minY;
+    float maxScale = 0.0f;
+    for (const auto &particle : particles) {
+        minX = std::min(minX, particle.x);
+        maxX = std::max(maxX, particle.x);
+        minY = std::min(minY, particle.y);
+        maxY = std::max(maxY, particle.y);
+        maxScale = std::max(maxScale, particle.getScale());
+    }
+    // Particle::propagate adds noise of up to four times the movement
+    cv::Point2f spread(kPropagationNoise * std::abs(movement.x) + kPagingMargin,
+                       kPropagationNoise * std::abs(movement.y) + kPagingMargin);
+    // Any rotation of the template stays within half of its diagonal
+    float reach = 0.5f * static_cast<float>(std::hypot(templateSize.width, templateSize.height)) * maxScale;
+    cv::Point tl(static_cast<int>(std::floor(minX + std::min(movement.x, 0.0f) - spread.x - reach)),
+                 static_cast<int>(std::floor(minY + std::min(movement.y, 0.0f) - spread.y - reach)));
+    cv::Point br(static_cast<int>(std::ceil(maxX + std::max(movement.x, 0.0f) + spread.x + reach)) + 1,
+                 static_cast<int>(std::ceil(maxY + std::max(movement.y, 0.0f) + spread.y + reach)) + 1);
+    return {tl, br};
+}
+
 cv::Mat ParticleFilterCore::getBestParticleView(const cv::Mat &map) const {
     return pfm->getBestParticleView(map);
 }
@@ -58,6 +126,44 @@ void ParticleFilterCore::setConversionMethod(ParticleFastMatch::ConversionMode m
 void ParticleFilterCore::describe() const {
     std::cout << "Using conversion mode: " << pfm->conversionModeString() << "\n";
     std::cout << "Conversion bound: " << pfm->getLowBound() << "\n";
+    std::cout << "Resampling method: " << resamplingMethodName(pfm->getParticles().getResampling()) << "\n";
+    std::cout << "Map layout: " << (pfm->isTiledMap() ? "tiled" : "row-major") << "\n";
+    auto memory = pfm->mapMemoryUsage();
+    std::cout << "Map memory: " << (memory.gray + memory.tiled + memory.coarse) / (1024 * 1024) << " MiB ("
+              << memory.gray / (1024 * 1024) << " gray, " << memory.tiled / (1024 * 1024) << " tiled, "
+              << memory.coarse / (1024 * 1024) << " coarse), " << memory.avoided / (1024 * 1024)
+              << " MiB of full float and padded copies not built\n";
+    if (pfm->getCoarseLevel() > 0) {
+        std::cout << "Coarse-to-fine: level " << pfm->getCoarseLevel() << ", " << pfm->getCoarseSurvivors()
+                  << " survivors\n";
+    }
+    if (pagedMap) {
+        std::cout << "Map paging: " << pagedMap->getMaxResidentBytes() / (1024 * 1024) << " MiB resident limit\n";
+    }
+}
+
+void ParticleFilterCore::printStatistics() const {
+    const SamplingPatternCache &cache = pfm->getPatternCache();
+    std::cout << "Sampling pattern cache: " << cache.hits() << " hits, " << cache.misses() << " misses, "
+              << cache.evictions() << " evictions, " << cache.size() << " patterns in "
+              << cache.memoryUsage() / 1024 << " KiB\n";
+    const auto &stages = pfm->getStageTimings();
+    if (stages.frames > 0) {
+        double frames = static_cast<double>(stages.frames);
+        std::cout << "Filter stages per frame (" << stages.particles / stages.frames << " particles mean): draw "
+                  << stages.drawMs / frames << " ms, propagate " << stages.propagateMs / frames << " ms, KLD merge "
+                  << stages.kldMergeMs / frames << " ms, evaluate " << stages.evaluateMs / frames << " ms, normalize "
+                  << stages.normalizeMs / frames << " ms; predict serial fraction "
+                  << 100.0 * stages.predictSerialFraction() << " %\n";
+    }
+    if (pagedMap) {
+        const MapPagingStats &paging = pagedMap->stats();
+        std::cout << "Map paging: " << paging.pageIns << " page-ins, " << paging.evictions << " evictions, "
+                  << paging.residentBytes / (1024 * 1024) << " MiB resident, "
+                  << paging.peakResidentBytes / (1024 * 1024) << " MiB peak, page-in "
+                  << (paging.pageIns ? paging.pageInMs / paging.pageIns : 0.0) << " ms average, "
+                  << paging.maxPageInMs << " ms max\n";
+    }
 }
 
 const Particles &ParticleFilterCore::getParticles() const {
@@ -4,6 +4,8 @@
 #include <vector>
 
 #include <fastmatch-dataset/MetadataEntry.hpp>
+#include <fastmatch-dataset/CachedGeotiffMap.hpp>
+#include <fastmatch-dataset/PagedGeotiffMap.hpp>
 #include <src/ParticleFastMatch.hpp>
 
 #include "ParticleFilterConfig.hpp"
@@ -32,10 +34,22 @@ public:
 
     void describe() const;
 
+    void printStatistics() const;
+
     const Particles &getParticles() const;
 
     std::shared_ptr<ParticleFastMatch> getFilter() const;
 
 private:
+    /**
+     * Region a frame moving the particles by `movement` samples from: the
+     * bounding box of the particles before and after the move, grown by the
+     * reach of the rotated and scaled template.
+     */
+    cv::Rect particleRegion(const cv::Point2f &movement) const;
+
     std::shared_ptr<ParticleFastMatch> pfm;
+    // Set when the map is paged in on demand
+    PagedMapPtr pagedMap;
+    cv::Size templateSize;
 };
@@ -0,0 +1,81 @@
+#include <boost/program_options.hpp>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include "io/BatchManifest.hpp"
+#include "io/ResultWriter.hpp"
+#include "runtime/BatchRunner.hpp"
+
+namespace po = boost::program_options;
+
+int main(int ac, char *av[]) {
+    po::options_description desc("Allowed options");
+    desc.add_options()
+            ("manifest,j", po::value<std::string>(), "CSV file listing the dataset, map and filter options of each job")
+            ("threads,t", po::value<int>()->default_value(0), "Worker threads shared by all jobs, 0 uses every core")
+            ("summary,o", po::value<std::string>(), "Write the results table to this file instead of stdout")
+            ("skip-rate,s", po::value<uint32_t>()->default_value(10), "Default skip rate of jobs that do not set it")
+            ("seed", po::value<uint64_t>(), "Default seed of jobs that do not set it, unset draws one per job")
+            ("map-cache", po::bool_switch()->default_value(false), "Keep the preprocessed maps in <map>.pfcache "
+                                                                   "between runs")
+            ("help,h", "produce help message");
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, (const char *const *) av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help")) {
+        std::cout << desc << "\n";
+        return 0;
+    }
+
+    if(!vm.count("manifest")) {
+        std::cerr << "Please set manifest\n";
+        std::cout << desc << "\n";
+        return 1;
+    }
+
+    BatchJob defaults;
+    defaults.skipRate = vm["skip-rate"].as<uint32_t>();
+    if(vm.count("seed")) {
+        defaults.config.seed = vm["seed"].as<uint64_t>();
+    }
+    std::vector<BatchJob> jobs;
+    try {
+        jobs = BatchManifest::readFile(vm["manifest"].as<std::string>(), defaults);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    BatchRunner runner(vm["threads"].as<int>(), vm["map-cache"].as<bool>());
+    auto start = std::chrono::steady_clock::now();
+    runner.loadMaps(jobs);
+    std::cout << jobs.size() << " jobs on " << runner.mapCount() << " maps, maps loaded in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+
+    start = std::chrono::steady_clock::now();
+    auto results = runner.run(jobs);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream summaryFile;
+    if(vm.count("summary")) {
+        summaryFile.open(vm["summary"].as<std::string>());
+    }
+    std::ostream &summary = summaryFile.is_open() ? summaryFile : std::cout;
+    ResultWriter::appendJobHeader(summary);
+    summary << "\n";
+    size_t frames = 0;
+    int failed = 0;
+    for(const auto& result : results) {
+        ResultWriter::appendJobRow(summary, result);
+        summary << "\n";
+        frames += result.frames;
+        failed += result.error.empty() ? 0 : 1;
+    }
+    std::cout << frames << " frames in " << seconds << " s, " << (seconds > 0.0 ? frames / seconds : 0.0)
+              << " frames/s across all jobs, " << failed << " failed\n";
+    return failed > 0 ? 2 : 0;
+}
@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include <fastmatch-dataset/MetadataEntryReader.hpp>
+#include <fastmatch-dataset/PrefetchingEntryReader.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/opencv_modules.hpp>
 #include <chrono>
@@ -14,56 +15,14 @@
 #include "runtime/WorkspaceRuntime.hpp"
 #endif
 #include "runtime/IRuntime.hpp"
-#include "runtime/RuntimeBase.hpp"
+#include "runtime/HeadlessRuntime.hpp"
 #include "io/ResultWriter.hpp"
+#include "src/Random.hpp"
 
 namespace fs = std::filesystem;
 namespace po = boost::program_options;
 
 namespace {
-class HeadlessRuntime : public RuntimeBase {
-public:
-    bool preview(const MetadataEntry &metadata, const cv::Mat & /*image*/, std::stringstream &stringOutput) override {
-        if(writeImageToDisk_ && !warnedWriteImages_) {
-            warnedWriteImages_ = true;
-            std::cerr << "Headless mode ignores --write-images because GUI preview rendering is disabled.\n";
-        }
-        cv::Point2i prediction = core_->getFilter()->getPredictedLocation();
-        cv::Point2i relativeLocation = prediction - startLocation_;
-        double distance = std::sqrt(std::pow(metadata.mapLocation.x - prediction.x, 2) +
-                                    std::pow(metadata.mapLocation.y - prediction.y, 2));
-        double svoDistance = std::sqrt(std::pow(metadata.mapLocation.x - svoCurPosition_.x, 2) +
-                                       std::pow(metadata.mapLocation.y - svoCurPosition_.y, 2));
-        ResultWriter::appendRow(
-                stringOutput,
-                core_->getFilter()->particleCount(),
-                relativeLocation,
-                distance,
-                svoDistance
-        );
-        return true;
-    }
-
-    bool isDisplayImage() const override {
-        return false;
-    }
-
-    void setDisplayImage(bool /*displayImage*/) override {}
-
-    void setWriteImageToDisk(bool writeImageToDisk) override {
-        writeImageToDisk_ = writeImageToDisk;
-    }
-
-    void setOutputDirectory(const std::string &outputDirectory) override {
-        outputDirectory_ = outputDirectory;
-    }
-
-private:
-    bool writeImageToDisk_ = false;
-    bool warnedWriteImages_ = false;
-    std::string outputDirectory_;
-};
-
 int runDataset(IRuntime &pf,
                MetadataEntryReader &reader,
                const po::variables_map &vm,
@@ -93,6 +52,9 @@ int runDataset(IRuntime &pf,
             pf.setOutputDirectory(dir.string());
         }
         if(reader.openDirectory(datasetPath.string())) {
+            if(reader.usesFlightLog()) {
+                std::cout << "Reading frames from " << FlightLogFile::defaultPath(datasetPath.string()) << "\n";
+            }
             std::ofstream hists;
             if(writeHistograms) {
                 hists.open((dir / "histograms.csv").string());
@@ -102,7 +64,8 @@ int runDataset(IRuntime &pf,
             output << "\n";
             MetadataEntry entry;
             int iteration = 0;
-            while (reader.readNextEntry(entry)) {
+            PrefetchingEntryReader frames(reader, vm["prefetch"].as<size_t>());
+            while (frames.readNextEntry(entry)) {
                 output << iteration++ << ",\"" << entry.imageFileName << "\",";
                 if(!pfInitialized) {
                     pf.initialize(entry, config);
@@ -141,6 +104,14 @@ int runDataset(IRuntime &pf,
                 output.str("");
                 output.clear();
             }
+            if(pfInitialized) {
+                pf.printStatistics();
+            }
+            auto prefetch = frames.stats();
+            std::cout << "Frame decode: " << prefetch.meanDecodeMs() << " ms mean, " << prefetch.maxDecodeMs
+                      << " ms max; " << prefetch.stalls << " of " << prefetch.frames << " frames waited "
+                      << prefetch.waitMs << " ms in total, " << prefetch.meanQueueDepth()
+                      << " frames decoded ahead on average (prefetch depth " << frames.getDepth() << ")\n";
         } else {
             std::cerr << "Failed to open metadata file in the dataset\n";
         }
@@ -175,6 +146,24 @@ int main(int ac, char *av[]) {
             ("kld-error", po::value<float>()->default_value(0.5f), "Particle filter KLD error")
             ("bin-size", po::value<int>()->default_value(5), "Particle filter bin size")
             ("no-gaussian", po::bool_switch()->default_value(false), "Use uniform instead of gaussian sampling")
+            ("resampler", po::value<std::string>()->default_value("systematic"), "Resampling method: systematic, "
+                                                                                  "stratified, residual, multinomial or alias")
+            ("sample-density", po::value<float>()->default_value(0.1f), "Fraction of template pixels sampled for correlation")
+            ("tiled-map", po::bool_switch()->default_value(false), "Sample particles from a tiled copy of the map")
+            ("pattern-cache-mb", po::value<size_t>()->default_value(64), "Memory bound of the sampling pattern cache in MB")
+            ("coarse-level", po::value<int>()->default_value(0), "Pyramid level scoring all particles before the best "
+                                                                 "are re-scored at full resolution, 0 disables it")
+            ("coarse-survivors", po::value<int>()->default_value(32), "Particles re-scored at full resolution")
+            ("probability-window", po::value<int>()->default_value(4), "Recent correlations averaged into a "
+                                                                       "particle's probability, at most 16")
+            ("seed", po::value<uint64_t>(), "Seed of all random numbers of the filter, runs with the same seed "
+                                            "and settings give the same results")
+            ("map-cache", po::bool_switch()->default_value(false), "Reuse the preprocessed map from <map-image>.pfcache, "
+                                                                   "writing it on the first run")
+            ("paged-map", po::bool_switch()->default_value(false), "Read the map from disk only around the particles")
+            ("map-resident-mb", po::value<size_t>()->default_value(1024), "Memory bound of a paged map in MB")
+            ("prefetch", po::value<size_t>()->default_value(4), "Frames decoded ahead on worker threads, "
+                                                               "0 decodes each frame when it is read")
             ("help,h", "produce help message");
 
     po::variables_map vm;
@@ -201,6 +190,21 @@ int main(int ac, char *av[]) {
     config.kld_error = vm["kld-error"].as<float>();
     config.binSize = vm["bin-size"].as<int>();
     config.use_gaussian = !vm["no-gaussian"].as<bool>();
+    config.sampleDensity = vm["sample-density"].as<float>();
+    config.patternCacheMB = vm["pattern-cache-mb"].as<size_t>();
+    config.tiledMap = vm["tiled-map"].as<bool>();
+    config.coarseLevel = vm["coarse-level"].as<int>();
+    config.coarseSurvivors = vm["coarse-survivors"].as<int>();
+    config.probabilityWindow = vm["probability-window"].as<int>();
+    // Always known, so that any run can be repeated
+    config.seed = vm.count("seed") ? vm["seed"].as<uint64_t>() : entropySeed();
+    std::cout << "Seed: " << *config.seed << "\n";
+    try {
+        config.resampling = resamplingMethodFromString(vm["resampler"].as<std::string>());
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
 
     bool displayPreview = vm.count("preview") > 0;
     bool noGui = vm.count("no-gui") > 0;
@@ -220,10 +224,25 @@ int main(int ac, char *av[]) {
     if(vm.count("map-image")) {
         auto mapImage = vm["map-image"].as<std::string>();
         mapName = fs::path(mapImage).stem().string();
-        if(fs::exists(mapImage)) {
-            reader.setMap(mapImage);
-        } else {
+        if(!fs::exists(mapImage)) {
             std::cerr << "Map configuration files were not found\n";
+        } else if(vm["paged-map"].as<bool>() && vm["map-cache"].as<bool>()) {
+            std::cerr << "--paged-map and --map-cache cannot be combined\n";
+            return 1;
+        } else if(vm["paged-map"].as<bool>()) {
+            reader.setPagedMap(mapImage, vm["map-resident-mb"].as<size_t>() << 20);
+        } else if(vm["map-cache"].as<bool>()) {
+            auto cacheFile = MapCacheFile::defaultPath(mapImage);
+            auto start = std::chrono::steady_clock::now();
+            reader.setCachedMap(mapImage, cacheFile);
+            auto cachedMap = std::dynamic_pointer_cast<CachedGeotiffMap>(reader.getMap());
+            if(cachedMap->isValid()) {
+                std::cout << "Map cache " << cacheFile << ": " << (cachedMap->isWarmStart() ? "warm" : "cold")
+                          << " start in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+                          << " s\n";
+            }
+        } else {
+            reader.setMap(mapImage);
         }
         if(!reader.getMap()->isValid()) {
             std::cerr << "Map configuration is corrupted!\n";
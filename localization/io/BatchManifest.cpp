@@ -0,0 +1,194 @@
+#include "BatchManifest.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <stdexcept>
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
+
+namespace fs = std::filesystem;
+
+namespace {
+const char *const kColumns[] = {
+        "name", "dataset", "map", "particle-radius", "epsilon", "particle-count", "quantile", "kld-error",
+        "bin-size", "no-gaussian", "resampler", "sample-density", "tiled-map", "pattern-cache-mb",
+        "coarse-level", "coarse-survivors", "probability-window", "seed", "skip-rate", "correlation-bound", "conversion-method"
+};
+
+std::vector<std::string> splitLine(const std::string &line) {
+    std::vector<std::string> cells;
+    boost::split(cells, line, boost::is_any_of(","));
+    for(auto &cell : cells) {
+        boost::trim(cell);
+        cell.erase(std::remove(cell.begin(), cell.end(), '"'), cell.end());
+    }
+    return cells;
+}
+
+bool parseFlag(const std::string &value) {
+    if(value == "1" || value == "true" || value == "yes") {
+        return true;
+    }
+    if(value == "0" || value == "false" || value == "no") {
+        return false;
+    }
+    throw std::invalid_argument("expected a boolean, got " + value);
+}
+
+template<typename T, typename Parse>
+T parseNumber(const std::string &value, Parse parse) {
+    size_t used = 0;
+    T result = static_cast<T>(parse(value, &used));
+    if(used != value.size()) {
+        throw std::invalid_argument("expected a number, got " + value);
+    }
+    return result;
+}
+
+float parseFloat(const std::string &value) {
+    return parseNumber<float>(value, [](const std::string &s, size_t *used) { return std::stof(s, used); });
+}
+
+int parseInt(const std::string &value) {
+    return parseNumber<int>(value, [](const std::string &s, size_t *used) { return std::stoi(s, used); });
+}
+
+uint64_t parseSeed(const std::string &value) {
+    if(value.empty() || value[0] == '-') {
+        throw std::invalid_argument("expected a non-negative integer, got " + value);
+    }
+    return parseNumber<uint64_t>(value, [](const std::string &s, size_t *used) { return std::stoull(s, used); });
+}
+
+std::string resolve(const std::string &path, const std::string &baseDirectory) {
+    if(path.empty() || baseDirectory.empty() || fs::path(path).is_absolute()) {
+        return path;
+    }
+    return (fs::path(baseDirectory) / path).string();
+}
+} // namespace
+
+void BatchManifest::apply(BatchJob &job, const std::string &column, const std::string &value) {
+    if(column == "name") {
+        job.name = value;
+    } else if(column == "dataset") {
+        job.dataset = value;
+    } else if(column == "map") {
+        job.map = value;
+    } else if(column == "particle-radius") {
+        job.config.radius = parseFloat(value);
+    } else if(column == "epsilon") {
+        job.config.epsilon = parseFloat(value);
+    } else if(column == "particle-count") {
+        job.config.particleCount = parseInt(value);
+    } else if(column == "quantile") {
+        job.config.quantile = parseFloat(value);
+    } else if(column == "kld-error") {
+        job.config.kld_error = parseFloat(value);
+    } else if(column == "bin-size") {
+        job.config.binSize = parseInt(value);
+    } else if(column == "no-gaussian") {
+        job.config.use_gaussian = !parseFlag(value);
+    } else if(column == "resampler") {
+        job.config.resampling = resamplingMethodFromString(value);
+    } else if(column == "sample-density") {
+        job.config.sampleDensity = parseFloat(value);
+    } else if(column == "tiled-map") {
+        job.config.tiledMap = parseFlag(value);
+    } else if(column == "pattern-cache-mb") {
+        job.config.patternCacheMB = static_cast<size_t>(parseInt(value));
+    } else if(column == "coarse-level") {
+        job.config.coarseLevel = parseInt(value);
+    } else if(column == "coarse-survivors") {
+        job.config.coarseSurvivors = parseInt(value);
+    } else if(column == "probability-window") {
+        job.config.probabilityWindow = parseInt(value);
+    } else if(column == "seed") {
+        job.config.seed = parseSeed(value);
+    } else if(column == "skip-rate") {
+        int skipRate = parseInt(value);
+        if(skipRate <= 0) {
+            throw std::invalid_argument("skip-rate must be positive, got " + value);
+        }
+        job.skipRate = static_cast<uint32_t>(skipRate);
+    } else if(column == "correlation-bound") {
+        job.correlationBound = parseFloat(value);
+    } else if(column == "conversion-method") {
+        if(value != "glf" && value != "softmax" && value != "hprelu") {
+            throw std::invalid_argument("unknown conversion method: " + value);
+        }
+        job.conversionMethod = value;
+    } else {
+        throw std::invalid_argument("unknown manifest column: " + column);
+    }
+}
+
+std::vector<BatchJob> BatchManifest::read(std::istream &in, const BatchJob &defaults, const std::string &baseDirectory) {
+    std::vector<std::string> header;
+    std::vector<BatchJob> jobs;
+    std::string line;
+    size_t lineNumber = 0;
+    while(std::getline(in, line)) {
+        lineNumber++;
+        boost::trim(line);
+        if(line.empty() || line[0] == '#') {
+            continue;
+        }
+        auto where = "manifest line " + std::to_string(lineNumber) + ": ";
+        auto cells = splitLine(line);
+        if(header.empty()) {
+            for(const auto &column : cells) {
+                if(std::find(std::begin(kColumns), std::end(kColumns), column) == std::end(kColumns)) {
+                    throw std::invalid_argument(where + "unknown manifest column: " + column);
+                }
+            }
+            header = cells;
+            if(std::find(header.begin(), header.end(), "dataset") == header.end() ||
+               std::find(header.begin(), header.end(), "map") == header.end()) {
+                throw std::invalid_argument(where + "header must name the dataset and map columns");
+            }
+            continue;
+        }
+        if(cells.size() > header.size()) {
+            throw std::invalid_argument(where + "more cells than header columns");
+        }
+        BatchJob job = defaults;
+        for(size_t i = 0; i < cells.size(); i++) {
+            if(cells[i].empty()) {
+                continue;
+            }
+            try {
+                apply(job, header[i], cells[i]);
+            } catch(const std::exception &e) {
+                throw std::invalid_argument(where + header[i] + ": " + e.what());
+            }
+        }
+        if(job.dataset.empty() || job.map.empty()) {
+            throw std::invalid_argument(where + "dataset and map are required");
+        }
+        job.dataset = resolve(job.dataset, baseDirectory);
+        job.map = resolve(job.map, baseDirectory);
+        if(job.name.empty()) {
+            job.name = fs::path(job.dataset).filename().string() + "@" + fs::path(job.map).stem().string();
+        }
+        try {
+            job.config.validate();
+        } catch(const std::invalid_argument &e) {
+            throw std::invalid_argument(where + e.what());
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+std::vector<BatchJob> BatchManifest::readFile(const std::string &manifestFile, const BatchJob &defaults) {
+    std::ifstream in(manifestFile);
+    if(!in.is_open()) {
+        throw std::invalid_argument("cannot open manifest " + manifestFile);
+    }
+    return read(in, defaults, fs::path(manifestFile).parent_path().string());
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "core/ParticleFilterConfig.hpp"
+
+/**
+ * One flight replayed by the batch runner: a dataset directory, the map it
+ * is localized on and the filter settings of dataset-match.
+ */
+struct BatchJob {
+    std::string name;
+    std::string dataset;
+    std::string map;
+    ParticleFilterConfig config;
+    uint32_t skipRate = 10;
+    float correlationBound = 0.2f;
+    std::string conversionMethod = "glf";
+};
+
+/**
+ * Outcome of a BatchJob. Errors are in map pixels against the ground truth
+ * location of each frame; `error` is empty when the job ran to the end.
+ */
+struct BatchJobResult {
+    std::string name;
+    size_t frames = 0;
+    double seconds = 0.0;
+    double meanError = 0.0;
+    double maxError = 0.0;
+    double finalError = 0.0;
+    double meanSvoError = 0.0;
+    std::string error;
+};
+
+/**
+ * Reads a batch manifest: a CSV file whose header names the columns and
+ * whose every other line is a job. `dataset` and `map` columns are
+ * required; the remaining columns are named after the dataset-match options
+ * they override (`particle-count`, `resampler`, `coarse-level`, ...), and an
+ * empty cell keeps the default. Blank lines and lines starting with `#` are
+ * skipped. Relative paths are resolved against `baseDirectory`.
+ */
+class BatchManifest {
+public:
+    /**
+     * Throws std::invalid_argument naming the line of an unknown column, a
+     * missing path or a value that does not parse or validate.
+     */
+    static std::vector<BatchJob> read(std::istream &in, const BatchJob &defaults = BatchJob(),
+                                      const std::string &baseDirectory = "");
+
+    static std::vector<BatchJob> readFile(const std::string &manifestFile, const BatchJob &defaults = BatchJob());
+
+    /**
+     * Sets the field of `job` that column `column` overrides.
+     */
+    static void apply(BatchJob &job, const std::string &column, const std::string &value);
+};
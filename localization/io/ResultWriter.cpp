@@ -1,4 +1,5 @@
 #include "ResultWriter.hpp"
+#include "BatchManifest.hpp"
 
 #include <iomanip>
 #include <ostream>
@@ -24,3 +25,29 @@ void ResultWriter::appendRow(std::ostream &out,
     out.flags(flags);
     out.precision(precision);
 }
+
+void ResultWriter::appendJobHeader(std::ostream &out) {
+    out << "\"Job\",";
+    out << "\"Frames [count]\",";
+    out << "\"Time [s]\",";
+    out << "\"Throughput [frames/s]\",";
+    out << "\"MeanLocationError [map px]\",";
+    out << "\"MaxLocationError [map px]\",";
+    out << "\"FinalLocationError [map px]\",";
+    out << "\"MeanSVODistance [map px]\",";
+    out << "\"Status\"";
+}
+
+void ResultWriter::appendJobRow(std::ostream &out, const BatchJobResult &result) {
+    out << "\"" << result.name << "\"," << result.frames << ",";
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << result.seconds << ",";
+    out << (result.seconds > 0.0 ? result.frames / result.seconds : 0.0) << ",";
+    out << result.meanError << "," << result.maxError << "," << result.finalError << ",";
+    out << result.meanSvoError << ",";
+    out.flags(flags);
+    out.precision(precision);
+    out << "\"" << (result.error.empty() ? "ok" : result.error) << "\"";
+}
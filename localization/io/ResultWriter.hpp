@@ -5,6 +5,8 @@
 
 #include <opencv2/core/types.hpp>
 
+struct BatchJobResult;
+
 class ResultWriter {
 public:
     static void appendHeader(std::ostream &out);
@@ -13,4 +15,10 @@ public:
                           const cv::Point &relativeLocation,
                           double distance,
                           double svoDistance);
+
+    /**
+     * One row per job of a batch run, see BatchRunner.
+     */
+    static void appendJobHeader(std::ostream &out);
+    static void appendJobRow(std::ostream &out, const BatchJobResult &result);
 };
@@ -0,0 +1,127 @@
+#include "BatchRunner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fastmatch-dataset/MetadataEntryReader.hpp>
+#include <fastmatch-dataset/PrefetchingEntryReader.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/task_arena.h>
+
+#include "HeadlessRuntime.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr size_t kPrefetchDepth = 2;
+}
+
+BatchRunner::BatchRunner(int threads, bool persistMapCache)
+        : threads(threads), persistMapCache(persistMapCache) {
+    if (threads < 0) {
+        throw std::invalid_argument("threads must not be negative, got " + std::to_string(threads));
+    }
+}
+
+std::string BatchRunner::mapKey(const std::string &mapFile) {
+    std::error_code ec;
+    auto canonical = fs::weakly_canonical(mapFile, ec);
+    return ec ? mapFile : canonical.string();
+}
+
+bool BatchRunner::loadMaps(const std::vector<BatchJob> &jobs) {
+    bool valid = true;
+    for (const auto &job : jobs) {
+        auto key = mapKey(job.map);
+        auto found = maps.find(key);
+        if (found == maps.end()) {
+            auto map = std::make_shared<CachedGeotiffMap>();
+            // GDAL datasets are not opened concurrently, so maps are loaded before any job starts
+            map->open(job.map, persistMapCache ? MapCacheFile::defaultPath(job.map) : std::string());
+            if (!map->isValid()) {
+                std::cerr << "Map " << job.map << " could not be opened\n";
+            }
+            found = maps.emplace(key, map).first;
+        }
+        valid &= found->second->isValid();
+    }
+    return valid;
+}
+
+std::vector<BatchJobResult> BatchRunner::run(const std::vector<BatchJob> &jobs) {
+    loadMaps(jobs);
+    std::vector<BatchJobResult> results(jobs.size());
+    tbb::task_arena arena(threads > 0 ? threads : static_cast<int>(tbb::task_arena::automatic));
+    arena.execute([&] {
+        // One task per job: jobs run for minutes, so chunking them would only unbalance the arena
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, jobs.size(), 1), [&](const tbb::blocked_range<size_t> &range) {
+            for (size_t i = range.begin(); i != range.end(); i++) {
+                // While a job waits for its own parallel loops it must not pick up
+                // another job, which would stall the first until the second finishes
+                tbb::this_task_arena::isolate([&] {
+                    const auto &map = maps.at(mapKey(jobs[i].map));
+                    results[i] = runJob(jobs[i], map);
+                });
+            }
+        }, tbb::simple_partitioner());
+    });
+    return results;
+}
+
+BatchJobResult BatchRunner::runJob(const BatchJob &job, const GeoMapPtr &map) {
+    BatchJobResult result;
+    result.name = job.name;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        if (!map || !map->isValid()) {
+            throw std::runtime_error("map is not valid");
+        }
+        MetadataEntryReader reader;
+        reader.setMap(map);
+        reader.setSkipRate(job.skipRate);
+        if (!reader.openDirectory(job.dataset)) {
+            throw std::runtime_error("cannot open " + job.dataset + "/metadata.csv");
+        }
+        // One decode thread per job: the arena's threads are busy filtering
+        PrefetchingEntryReader frames(reader, kPrefetchDepth, 1);
+        HeadlessRuntime runtime;
+        std::stringstream output;
+        MetadataEntry entry;
+        double errorSum = 0.0;
+        double svoErrorSum = 0.0;
+        while (frames.readNextEntry(entry)) {
+            if (result.frames == 0) {
+                runtime.initialize(entry, job.config);
+                if (job.conversionMethod == "glf") {
+                    runtime.setConversionMethod(ParticleFastMatch::GLF);
+                } else if (job.conversionMethod == "softmax") {
+                    runtime.setConversionMethod(ParticleFastMatch::Softmax);
+                }
+                runtime.setCorrelationLowBound(job.correlationBound);
+            } else {
+                runtime.update(entry);
+            }
+            runtime.preview(entry, cv::Mat(), output);
+            output.str("");
+            result.frames++;
+            errorSum += runtime.getLocationError();
+            svoErrorSum += runtime.getSvoError();
+            result.maxError = std::max(result.maxError, runtime.getLocationError());
+            result.finalError = runtime.getLocationError();
+        }
+        if (result.frames > 0) {
+            result.meanError = errorSum / result.frames;
+            result.meanSvoError = svoErrorSum / result.frames;
+        }
+    } catch (const std::exception &e) {
+        result.error = e.what();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
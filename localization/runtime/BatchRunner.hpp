@@ -0,0 +1,51 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <fastmatch-dataset/CachedGeotiffMap.hpp>
+
+#include "io/BatchManifest.hpp"
+
+/**
+ * Replays many flights in one process. Every distinct map is opened and
+ * preprocessed once and shared read-only by the jobs localized on it; each
+ * job runs its own HeadlessRuntime as one task of a shared TBB arena, so
+ * the filters' own parallel loops fill the cores the other jobs leave idle.
+ */
+class BatchRunner {
+public:
+    /**
+     * `threads` bounds the arena, 0 uses every core. With `persistMapCache`
+     * the preprocessed maps are kept in `<map>.pfcache` like --map-cache of
+     * dataset-match, otherwise they live in memory for this run only.
+     */
+    explicit BatchRunner(int threads = 0, bool persistMapCache = false);
+
+    /**
+     * Opens the maps of `jobs` that are not open yet. Returns false if any of
+     * them is invalid; the jobs using it then fail when run.
+     */
+    bool loadMaps(const std::vector<BatchJob> &jobs);
+
+    /**
+     * Runs all jobs, loading their maps first. Results are in the order of
+     * `jobs`; a job that throws reports the error and does not stop the rest.
+     */
+    std::vector<BatchJobResult> run(const std::vector<BatchJob> &jobs);
+
+    /**
+     * Replays one job on the calling thread.
+     */
+    static BatchJobResult runJob(const BatchJob &job, const GeoMapPtr &map);
+
+    size_t mapCount() const { return maps.size(); }
+
+private:
+    static std::string mapKey(const std::string &mapFile);
+
+    int threads;
+    bool persistMapCache;
+    std::map<std::string, CachedMapPtr> maps;
+};
@@ -0,0 +1,41 @@
+#include "HeadlessRuntime.hpp"
+
+#include <cmath>
+#include <iostream>
+
+#include "io/ResultWriter.hpp"
+
+bool HeadlessRuntime::preview(const MetadataEntry &metadata, const cv::Mat & /*image*/, std::stringstream &stringOutput) {
+    if(writeImageToDisk_ && !warnedWriteImages_) {
+        warnedWriteImages_ = true;
+        std::cerr << "Headless mode ignores --write-images because GUI preview rendering is disabled.\n";
+    }
+    cv::Point2i prediction = core_->getFilter()->getPredictedLocation();
+    cv::Point2i relativeLocation = prediction - startLocation_;
+    locationError_ = std::sqrt(std::pow(metadata.mapLocation.x - prediction.x, 2) +
+                               std::pow(metadata.mapLocation.y - prediction.y, 2));
+    svoError_ = std::sqrt(std::pow(metadata.mapLocation.x - svoCurPosition_.x, 2) +
+                          std::pow(metadata.mapLocation.y - svoCurPosition_.y, 2));
+    ResultWriter::appendRow(
+            stringOutput,
+            core_->getFilter()->particleCount(),
+            relativeLocation,
+            locationError_,
+            svoError_
+    );
+    return true;
+}
+
+bool HeadlessRuntime::isDisplayImage() const {
+    return false;
+}
+
+void HeadlessRuntime::setDisplayImage(bool /*displayImage*/) {}
+
+void HeadlessRuntime::setWriteImageToDisk(bool writeImageToDisk) {
+    writeImageToDisk_ = writeImageToDisk;
+}
+
+void HeadlessRuntime::setOutputDirectory(const std::string &outputDirectory) {
+    outputDirectory_ = outputDirectory;
+}
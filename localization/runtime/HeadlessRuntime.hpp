@@ -0,0 +1,30 @@
+#pragma once
+
+#include "RuntimeBase.hpp"
+
+class HeadlessRuntime : public RuntimeBase {
+public:
+    bool preview(const MetadataEntry &metadata, const cv::Mat &image, std::stringstream &stringOutput) override;
+
+    bool isDisplayImage() const override;
+
+    void setDisplayImage(bool displayImage) override;
+
+    void setWriteImageToDisk(bool writeImageToDisk) override;
+
+    void setOutputDirectory(const std::string &outputDirectory) override;
+
+    /**
+     * Location and odometry errors of the frame last passed to preview, in map pixels.
+     */
+    double getLocationError() const { return locationError_; }
+
+    double getSvoError() const { return svoError_; }
+
+private:
+    bool writeImageToDisk_ = false;
+    bool warnedWriteImages_ = false;
+    std::string outputDirectory_;
+    double locationError_ = 0.0;
+    double svoError_ = 0.0;
+};
@@ -29,5 +29,6 @@ public:
     virtual void setConversionMethod(ParticleFastMatch::ConversionMode method) = 0;
 
     virtual void describe() const = 0;
+    virtual void printStatistics() const = 0;
     virtual const Particles &getParticles() const = 0;
 };
@@ -15,7 +15,7 @@ void RuntimeBase::initialize(const MetadataEntry &metadata, const ParticleFilter
     );
     core_->initialize(metadata, config);
     core_->setDirection(direction_);
-    cv::Mat templ = metadata.getImageColored();
+    const cv::Mat &templ = metadata.getMatchImage();
     currentScale_ = scaleModel_.updateScale(
             1.0f,
             static_cast<float>(metadata.altitude),
@@ -32,7 +32,7 @@ void RuntimeBase::update(const MetadataEntry &metadata) {
     auto svoResult = motionModel_.getMovementFromSvo(metadata, svoCoordinates_, direction_, svoCurPosition_);
     svoCurPosition_ = svoResult.updatedPosition;
     cv::Point movement = svoResult.movement;
-    cv::Mat templ = metadata.getImageColored();
+    const cv::Mat &templ = metadata.getMatchImage();
     currentScale_ = scaleModel_.updateScale(
             1.0f,
             static_cast<float>(metadata.altitude),
@@ -76,6 +76,10 @@ void RuntimeBase::describe() const {
     core_->describe();
 }
 
+void RuntimeBase::printStatistics() const {
+    core_->printStatistics();
+}
+
 const Particles &RuntimeBase::getParticles() const {
     return core_->getParticles();
 }
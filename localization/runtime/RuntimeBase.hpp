@@ -31,6 +31,8 @@ public:
 
     void describe() const override;
 
+    void printStatistics() const override;
+
     const Particles &getParticles() const override;
 
 protected:
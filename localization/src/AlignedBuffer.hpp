@@ -0,0 +1,59 @@
+//
+// Cache-line aligned storage for sample buffers consumed by the SIMD kernels.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+template<typename T, std::size_t Alignment = 64>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        // std::aligned_alloc requires the size to be a multiple of the alignment
+        std::size_t bytes = ((n * sizeof(T) + Alignment - 1) / Alignment) * Alignment;
+        void* ptr = std::aligned_alloc(Alignment, bytes);
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, std::size_t) noexcept {
+        std::free(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+template<typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+/**
+ * Rounds a sample count up to a whole number of 64 byte vectors, so kernels
+ * can run without a scalar tail. Padding lanes must be filled with zeros.
+ */
+template<typename T>
+constexpr std::size_t paddedLength(std::size_t n) {
+    constexpr std::size_t lanes = 64 / sizeof(T);
+    return ((n + lanes - 1) / lanes) * lanes;
+}
@@ -0,0 +1,87 @@
+//
+// Boundary check of the affine search configurations.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <opencv2/core/types.hpp>
+
+#include "ConfigKernels.hpp"
+#include "GeometryUtils.hpp"
+
+/**
+ * Boundary check of Utilities::configsToAffine and FAsTMatch::evaluateGrid:
+ * the corners of the template, centered on the template, transformed and
+ * moved to the image center, have to lie within the image padded by
+ * geometry::kBoundaryPadding.
+ *
+ * The corners are never transformed one by one; the extremes of each
+ * coordinate follow from the signs of the coefficients (see
+ * simd::cornersInside), which batches test eight configurations at a time.
+ */
+struct ConfigBounds {
+    simd::CornerBox box;
+
+    ConfigBounds(const cv::Size& imageSize, const cv::Size& templSize) : box() {
+        int r1x = static_cast<int>(0.5 * (templSize.width - 1)),
+                r1y = static_cast<int>(0.5 * (templSize.height - 1)),
+                r2x = static_cast<int>(0.5 * (imageSize.width - 1)),
+                r2y = static_cast<int>(0.5 * (imageSize.height - 1));
+        box.left = static_cast<float>(1 - (r1x + 1));
+        box.right = static_cast<float>(templSize.width - (r1x + 1));
+        box.top = static_cast<float>(1 - (r1y + 1));
+        box.bottom = static_cast<float>(templSize.height - (r1y + 1));
+        box.centerX = static_cast<float>(r2x + 1);
+        box.centerY = static_cast<float>(r2y + 1);
+        box.minX = static_cast<float>(-geometry::kBoundaryPadding);
+        box.minY = static_cast<float>(-geometry::kBoundaryPadding);
+        box.maxX = static_cast<float>(imageSize.width + geometry::kBoundaryPadding);
+        box.maxY = static_cast<float>(imageSize.height + geometry::kBoundaryPadding);
+    }
+
+    bool contains(float a11, float a12, float tx, float a21, float a22, float ty) const {
+        float low, high;
+        axisExtent(a11, a12, tx, box.centerX, low, high);
+        if (!(low > box.minX && high < box.maxX)) {
+            return false;
+        }
+        axisExtent(a21, a22, ty, box.centerY, low, high);
+        return low > box.minY && high < box.maxY;
+    }
+
+    /**
+     * Smallest and largest image coordinates the corners reach under the
+     * row-major 2x3 affine `m`, as contains() computes them.
+     */
+    void extent(const float m[6], cv::Point2f& low, cv::Point2f& high) const {
+        axisExtent(m[0], m[1], m[2], box.centerX, low.x, high.x);
+        axisExtent(m[3], m[4], m[5], box.centerY, low.y, high.y);
+    }
+
+    /**
+     * contains() for a row-major 2x3 affine matrix.
+     */
+    bool contains(const float m[6]) const {
+        return contains(m[0], m[1], m[2], m[3], m[4], m[5]);
+    }
+
+    /**
+     * contains() for every matrix of `affines` into inside[0, n), vectorized;
+     * returns the number inside.
+     */
+    size_t contains(const simd::AffineColumns& affines, uint8_t* inside) const {
+        return simd::cornersInside(affines, box, inside);
+    }
+
+private:
+    // Rounded as simd::cornersInside, so single configs and batches agree
+    void axisExtent(float a, float b, float t, float center, float& low, float& high) const {
+        float aLeft = a * box.left, aRight = a * box.right, bTop = b * box.top, bBottom = b * box.bottom;
+        low = ((std::min(aLeft, aRight) + std::min(bTop, bBottom)) + t) + center;
+        high = ((std::max(aLeft, aRight) + std::max(bTop, bBottom)) + t) + center;
+    }
+};
@@ -0,0 +1,78 @@
+//
+// Scores affine configurations of a template with the config kernels.
+//
+
+#include "ConfigEvaluator.hpp"
+
+#include <algorithm>
+
+ConfigEvaluator::ConfigEvaluator(const cv::Mat& templ, const cv::Mat& xs, const cv::Mat& ys,
+                                 const cv::Size& imageSize, bool photometricInvariance)
+        : templCenter_(static_cast<int>(0.5 * (templ.cols - 1)), static_cast<int>(0.5 * (templ.rows - 1))),
+          imageCenter_(static_cast<int>(0.5 * (imageSize.width - 1)), static_cast<int>(0.5 * (imageSize.height - 1))),
+          imageSize_(imageSize), photometricInvariance_(photometricInvariance) {
+    const int* xsPtr = xs.ptr<int>(0);
+    const int* ysPtr = ys.ptr<int>(0);
+    auto n = static_cast<size_t>(xs.cols);
+    xs_.resize(n);
+    ys_.resize(n);
+    values_.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        /* Template values at the sampled points, and the points recentered */
+        values_[i] = templ.at<float>(ysPtr[i] - 1, xsPtr[i] - 1);
+        xs_[i] = static_cast<float>(xsPtr[i] - (templCenter_.x + 1));
+        ys_[i] = static_cast<float>(ysPtr[i] - (templCenter_.y + 1));
+        valuesSum_ += values_[i];
+        valuesSquaredSum_ += static_cast<double>(values_[i]) * values_[i];
+    }
+}
+
+double ConfigEvaluator::evaluate(const simd::FloatImageView& image, const cv::Point& origin, const float m[6],
+                                 float* scratch, double bound) const {
+    if (values_.empty()) {
+        return 0.0;
+    }
+    // The image size is added before the truncation and taken back after it,
+    // so the truncation rounds down, as on the former padded image
+    simd::SampleAffine affine{};
+    affine.a11 = m[0];
+    affine.a12 = m[1];
+    affine.cx = static_cast<float>((imageCenter_.x + 1) + static_cast<double>(m[2]) + 0.5 + imageSize_.width);
+    affine.a21 = m[3];
+    affine.a22 = m[4];
+    affine.cy = static_cast<float>((imageCenter_.y + 1) + static_cast<double>(m[5]) + 0.5 + imageSize_.height);
+    affine.ox = -1 - imageSize_.width - origin.x;
+    affine.oy = -1 - imageSize_.height - origin.y;
+    // Samples left or right of the image do not count in the plain distance
+    affine.columnBegin = -origin.x;
+    affine.columnEnd = imageSize_.width - origin.x;
+
+    const size_t n = values_.size();
+    simd::PhotometricScale scale{};
+    if (photometricInvariance_) {
+        simd::ConfigSamples all{xs_.data(), ys_.data(), values_.data(), n};
+        scale = simd::gatherPhotometric(image, all, affine, valuesSum_, valuesSquaredSum_, scratch);
+    }
+
+    /* The chunks are summed in the same order whether or not the bound stops
+     * the loop, so the distances of the configs that finish do not depend on it */
+    double score = 0.0;
+    for (size_t begin = 0; begin < n; begin += kChunk) {
+        size_t length = std::min(kChunk, n - begin);
+        if (photometricInvariance_) {
+            score += simd::scaledSad(values_.data() + begin, scratch + begin, scale, length);
+        } else {
+            simd::ConfigSamples chunk{xs_.data() + begin, ys_.data() + begin, values_.data() + begin, length};
+            score += simd::affineSad(image, chunk, affine);
+        }
+        // Compared as the returned distance, so rounding cannot stop a config that finishes within the bound
+        if (score / static_cast<double>(n) > bound) {
+            break;
+        }
+    }
+    return score / static_cast<double>(n);
+}
+
+simd::FloatImageView ConfigEvaluator::view(const cv::Mat& image) {
+    return {image.ptr<float>(0), image.rows, image.cols, image.step / sizeof(float)};
+}
@@ -0,0 +1,184 @@
+//
+// Scores affine configurations of a template with the config kernels.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "ConfigKernels.hpp"
+
+/**
+ * Template samples of one evaluateConfigs call, prepared once for every
+ * configuration: the sampled points relative to the template center, the
+ * template values there and their sums. Each configuration then costs one
+ * simd::affineSad / affineSadPhotometric call.
+ */
+class ConfigEvaluator {
+public:
+    /**
+     * Configurations per block of evaluate(); each task reuses one scratch
+     * buffer for all of its blocks.
+     */
+    static constexpr size_t kGrain = 16;
+
+    /**
+     * Samples scored between two checks of the bound.
+     */
+    static constexpr size_t kChunk = 64;
+
+    /**
+     * Every kProbeStride-th configuration is scored ahead of the others when
+     * a margin is given.
+     */
+    static constexpr int kProbeStride = 32;
+
+    /**
+     * `xs` and `ys` are 1xN CV_32SC1 one-based template coordinates, as
+     * FAsTMatch samples them; `templ` is the CV_32F template.
+     */
+    ConfigEvaluator(const cv::Mat& templ, const cv::Mat& xs, const cv::Mat& ys, const cv::Size& imageSize,
+                    bool photometricInvariance);
+
+    size_t points() const { return values_.size(); }
+
+    /**
+     * Mean distance of the configuration with the row-major 2x3 affine `m`.
+     * `image` holds the image pixels from `origin` on. `scratch` needs
+     * points() floats and is only used in the photometric mode.
+     *
+     * The samples are scored in chunks of kChunk; once the distance of the
+     * chunks so far exceeds `bound` the rest is skipped and that partial
+     * distance, a lower bound of the full one, is returned.
+     */
+    double evaluate(const simd::FloatImageView& image, const cv::Point& origin, const float m[6], float* scratch,
+                    double bound = std::numeric_limits<double>::infinity()) const;
+
+    /**
+     * Distances of `count` configurations in parallel over blocked ranges.
+     * `affineAt(i, m)` writes the matrix of configuration i into m[6].
+     *
+     * With a finite `margin` the evaluation is a branch and bound: the
+     * smallest distance found so far is shared by all tasks, and a
+     * configuration is abandoned once it is certain to end farther than
+     * `margin` from it. Every configuration within `margin` of the final
+     * minimum gets its full distance, identical to the one without a
+     * margin; the others get a lower bound that is still beyond the margin.
+     */
+    template<typename AffineAt>
+    std::vector<double> evaluate(const simd::FloatImageView& image, const cv::Point& origin, int count,
+                                 AffineAt affineAt,
+                                 double margin = std::numeric_limits<double>::infinity()) const {
+        std::vector<double> distances(static_cast<size_t>(count), 0.0);
+        scan(image, origin, static_cast<size_t>(count), kGrain, [&](size_t i, float m[6]) {
+            affineAt(static_cast<int>(i), m);
+            return true;
+        }, margin, [&](size_t i, double distance, bool) {
+            distances[i] = distance;
+        });
+        return distances;
+    }
+
+    /**
+     * The branch and bound of evaluate() over configurations that are not
+     * stored anywhere. `affineAt(i, m)` writes the matrix of configuration i
+     * and returns false to leave it out. `store(i, distance, finished)` gets
+     * every configuration scored, `finished` is false for the abandoned ones.
+     * The configurations are handed out in blocks of `block`; the calls for
+     * one block come from one task, in ascending order.
+     */
+    template<typename AffineAt, typename Store>
+    void scan(const simd::FloatImageView& image, const cv::Point& origin, size_t count, size_t block,
+              AffineAt affineAt, double margin, Store store) const {
+        std::atomic<double> best(std::numeric_limits<double>::infinity());
+        // Distance of configuration i, NaN if it is left out
+        auto score = [&](size_t i, float* scratch, bool& finished) {
+            float m[6];
+            if (!affineAt(i, m)) {
+                return std::numeric_limits<double>::quiet_NaN();
+            }
+            double current = best.load(std::memory_order_relaxed);
+            double bound = boundFor(current, margin);
+            double distance = evaluate(image, origin, m, scratch, bound);
+            finished = distance <= bound;
+            // An abandoned distance exceeds its bound, which is above `current`, so it never lands here
+            while (distance < current && !best.compare_exchange_weak(current, distance, std::memory_order_relaxed)) {
+            }
+            return distance;
+        };
+
+        /* A bound is only as good as the best distance behind it, so a spread */
+        /* of probes across the range is scored first to find a low one early */
+        size_t stride = std::isinf(margin) ? 1 : kProbeStride;
+        std::vector<double> probes;
+        std::vector<uint8_t> probesFinished;
+        if (stride > 1) {
+            probes.resize((count + stride - 1) / stride);
+            probesFinished.resize(probes.size());
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, probes.size(), kGrain),
+                              [&](const tbb::blocked_range<size_t>& r) {
+                std::vector<float> scratch(photometricInvariance_ ? points() : 0);
+                for (size_t k = r.begin(); k != r.end(); k++) {
+                    bool finished = false;
+                    probes[k] = score(k * stride, scratch.data(), finished);
+                    probesFinished[k] = finished;
+                }
+            });
+        }
+
+        size_t blocks = (count + block - 1) / block;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, blocks), [&](const tbb::blocked_range<size_t>& r) {
+            std::vector<float> scratch(photometricInvariance_ ? points() : 0);
+            for (size_t i = r.begin() * block, end = std::min(r.end() * block, count); i < end; i++) {
+                bool finished = false;
+                double distance;
+                if (stride > 1 && i % stride == 0) {
+                    distance = probes[i / stride];
+                    finished = probesFinished[i / stride] != 0;
+                } else {
+                    distance = score(i, scratch.data(), finished);
+                }
+                if (!std::isnan(distance)) {
+                    store(i, distance, finished);
+                }
+            }
+        });
+    }
+
+    /**
+     * View of a CV_32FC1 image.
+     */
+    static simd::FloatImageView view(const cv::Mat& image);
+
+private:
+    /**
+     * Bound for a configuration while `best` is the smallest distance so
+     * far. The relative slack covers callers that add the margin to the
+     * minimum in float, as FAsTMatch::getGoodConfigsByDistance does.
+     */
+    static double boundFor(double best, double margin) {
+        return (best + margin) * (1.0 + 1e-6);
+    }
+
+    std::vector<float> xs_;
+    std::vector<float> ys_;
+    std::vector<float> values_;
+    double valuesSum_ = 0.0;
+    double valuesSquaredSum_ = 0.0;
+    cv::Point templCenter_;
+    cv::Point imageCenter_;
+    cv::Size imageSize_;
+    bool photometricInvariance_;
+};
@@ -6,6 +6,8 @@
 
 #include <FAsT-Match/MatchNet.h>
 #include "../FAsT-Match/MatchConfig.h"
+#include "MatchConfigBatch.hpp"
+#include "ConfigGrid.hpp"
 
 
 class ConfigExpanderBase {
@@ -16,10 +18,23 @@ public:
     ConfigExpanderBase();
     fast_match::MatchNet getNet() const;
     void setNet(fast_match::MatchNet net);
-    virtual std::vector<fast_match::MatchConfig> createListOfConfigs(cv::Size templ_size, cv::Size image_size) = 0;
-    virtual std::vector<fast_match::MatchConfig> randomExpandConfigs(std::vector<fast_match::MatchConfig> &configs,
-                                                                     int level, int no_of_points,
-                                                                     float delta_factor) = 0;
+    /**
+     * The configurations of the net as a grid decoded on demand, for callers
+     * that stream through them instead of storing them.
+     */
+    virtual fast_match::ConfigGrid createConfigGrid(cv::Size templ_size, cv::Size image_size) = 0;
+
+    /**
+     * Fills `configs` with the configurations of the net, reusing its capacity.
+     */
+    virtual void createListOfConfigs(cv::Size templ_size, cv::Size image_size,
+                                     fast_match::MatchConfigBatch &configs) = 0;
+
+    /**
+     * Fills `expanded` with `no_of_points` random neighbours of each of `configs`.
+     */
+    virtual void randomExpandConfigs(const fast_match::MatchConfigBatch &configs, int level, int no_of_points,
+                                     float delta_factor, fast_match::MatchConfigBatch &expanded) = 0;
 
 };
 
@@ -0,0 +1,89 @@
+//
+// Configurations of a MatchNet grid, decoded from their index.
+//
+
+#include "ConfigGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace fast_match {
+
+ConfigGrid::ConfigGrid(MatchNet net) {
+    translationsX = net.getXTranslationSteps();
+    translationsY = net.getYTranslationSteps();
+    std::vector<float> rotations = net.getRotationSteps(),
+            scales = net.getScaleSteps();
+
+    size_t nr_steps = rotations.size(),
+            nr2_steps = nr_steps,
+            ns_steps = scales.size();
+
+    /* Refine the number of steps for the 2nd rotation parameter */
+    if (std::fabs((net.boundsRotate.second - net.boundsRotate.first) - (2 * M_PI)) < 0.1) {
+        nr2_steps = static_cast<size_t>(std::count_if(rotations.begin(), rotations.end(), [&](float r) {
+            return r < (-M_PI / 2 + net.stepsRotate / 2);
+        }));
+    }
+
+    shapes.resize(nr_steps * nr2_steps * ns_steps * ns_steps);
+    size_t index = 0;
+    for (size_t r1 = 0; r1 < nr_steps; r1++)
+        for (size_t r2 = 0; r2 < nr2_steps; r2++)
+            for (size_t sx = 0; sx < ns_steps; sx++)
+                for (size_t sy = 0; sy < ns_steps; sy++)
+                    shapes.set(index++, 0.f, 0.f, rotations[r2], scales[sx], scales[sy], rotations[r1]);
+}
+
+MatchConfig ConfigGrid::get(size_t index) const {
+    size_t shape = index % shapes.size(), translation = index / shapes.size();
+    return MatchConfig(translationsX[translation / translationsY.size()],
+                       translationsY[translation % translationsY.size()],
+                       shapes.rotate2[shape], shapes.scaleX[shape], shapes.scaleY[shape], shapes.rotate1[shape]);
+}
+
+void ConfigGrid::affine(size_t index, float out[6]) const {
+    size_t shape = index % shapes.size(), translation = index / shapes.size();
+    out[0] = shapes.a11[shape];
+    out[1] = shapes.a12[shape];
+    out[2] = translationsX[translation / translationsY.size()];
+    out[3] = shapes.a21[shape];
+    out[4] = shapes.a22[shape];
+    out[5] = translationsY[translation % translationsY.size()];
+}
+
+void ConfigGrid::pushTo(size_t index, MatchConfigBatch& batch) const {
+    size_t shape = index % shapes.size(), translation = index / shapes.size();
+    batch.pushFrom(shapes, shape);
+    batch.translateX.back() = translationsX[translation / translationsY.size()];
+    batch.translateY.back() = translationsY[translation % translationsY.size()];
+}
+
+void ConfigGrid::fill(MatchConfigBatch& configs) const {
+    configs.resize(size());
+    if (configs.empty()) {
+        return;
+    }
+    /* Every translation repeats the block of shapes */
+    size_t block = shapes.size();
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, size() / block), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t translation = r.begin(); translation != r.end(); translation++) {
+            size_t begin = translation * block;
+            std::fill_n(configs.translateX.begin() + begin, block, translationsX[translation / translationsY.size()]);
+            std::fill_n(configs.translateY.begin() + begin, block, translationsY[translation % translationsY.size()]);
+            std::copy(shapes.rotate2.begin(), shapes.rotate2.end(), configs.rotate2.begin() + begin);
+            std::copy(shapes.scaleX.begin(), shapes.scaleX.end(), configs.scaleX.begin() + begin);
+            std::copy(shapes.scaleY.begin(), shapes.scaleY.end(), configs.scaleY.begin() + begin);
+            std::copy(shapes.rotate1.begin(), shapes.rotate1.end(), configs.rotate1.begin() + begin);
+            std::copy(shapes.a11.begin(), shapes.a11.end(), configs.a11.begin() + begin);
+            std::copy(shapes.a12.begin(), shapes.a12.end(), configs.a12.begin() + begin);
+            std::copy(shapes.a21.begin(), shapes.a21.end(), configs.a21.begin() + begin);
+            std::copy(shapes.a22.begin(), shapes.a22.end(), configs.a22.begin() + begin);
+        }
+    });
+}
+
+}
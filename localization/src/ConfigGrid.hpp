@@ -0,0 +1,67 @@
+//
+// Configurations of a MatchNet grid, decoded from their index.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <FAsT-Match/MatchConfig.h>
+#include <FAsT-Match/MatchNet.h>
+
+#include "MatchConfigBatch.hpp"
+
+namespace fast_match {
+
+/**
+ * The configurations of a net without storing them: a config is decoded
+ * from its grid index on demand, in the order GridConfigExpander has always
+ * listed them (translation x, translation y, rotation 1, rotation 2,
+ * scale x, scale y, the last one varying fastest). The grid keeps the steps
+ * and one entry per combination of rotations and scales, whose affine
+ * linear part is computed once; the translation only adds the last column.
+ * Decoded configs are bit for bit the ones MatchConfigBatch::set builds.
+ */
+class ConfigGrid {
+public:
+    ConfigGrid() = default;
+
+    /**
+     * The grid of `net`. Over a full turn, the second rotation only covers
+     * the steps below -pi/2 + half a step, as FAsT-Match does.
+     */
+    explicit ConfigGrid(MatchNet net);
+
+    size_t size() const { return translationsX.size() * translationsY.size() * shapes.size(); }
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * Config `index` as a standalone value.
+     */
+    MatchConfig get(size_t index) const;
+
+    /**
+     * Affine matrix of config `index`, row-major as MatchConfig::getAffine.
+     */
+    void affine(size_t index, float out[6]) const;
+
+    /**
+     * Appends config `index` to `batch`.
+     */
+    void pushTo(size_t index, MatchConfigBatch& batch) const;
+
+    /**
+     * Writes the entire grid to `configs`, reusing its capacity.
+     */
+    void fill(MatchConfigBatch& configs) const;
+
+private:
+    std::vector<float> translationsX;
+    std::vector<float> translationsY;
+    // Rotations and scales with a zero translation, indexed r1, r2, sx, sy
+    MatchConfigBatch shapes;
+};
+
+}
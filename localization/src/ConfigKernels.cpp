@@ -0,0 +1,339 @@
+//
+// Vectorized kernels scoring affine configurations of the FAsT-Match search.
+//
+
+#include "ConfigKernels.hpp"
+#include "SampleKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CONFIG_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+    namespace {
+        // Float partial sums are moved to double after this many samples
+        constexpr std::size_t kFlushBlock = 256;
+
+        inline float sampleAt(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine,
+                              std::size_t i, int32_t& column) {
+            float x = samples.xs[i], y = samples.ys[i];
+            column = static_cast<int32_t>(affine.a11 * x + affine.a12 * y + affine.cx) + affine.ox;
+            int32_t row = static_cast<int32_t>(affine.a21 * x + affine.a22 * y + affine.cy) + affine.oy;
+            if (static_cast<unsigned>(column) >= static_cast<unsigned>(image.cols) ||
+                static_cast<unsigned>(row) >= static_cast<unsigned>(image.rows)) {
+                return 0.f;
+            }
+            return image.data[static_cast<std::size_t>(row) * image.step + static_cast<std::size_t>(column)];
+        }
+
+        double affineSadScalar(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine,
+                               std::size_t begin) {
+            double total = 0.0;
+            for (std::size_t block = begin; block < samples.n; block += kFlushBlock) {
+                std::size_t end = std::min(block + kFlushBlock, samples.n);
+                float acc = 0.f;
+                for (std::size_t i = block; i < end; i++) {
+                    int32_t column;
+                    float value = sampleAt(image, samples, affine, i, column);
+                    if (column >= affine.columnBegin && column < affine.columnEnd) {
+                        acc += std::fabs(samples.values[i] - value);
+                    }
+                }
+                total += acc;
+            }
+            return total;
+        }
+
+        void gatherScalar(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine,
+                          std::size_t begin, float* out, double& sum, double& squaredSum) {
+            for (std::size_t block = begin; block < samples.n; block += kFlushBlock) {
+                std::size_t end = std::min(block + kFlushBlock, samples.n);
+                float s = 0.f, sq = 0.f;
+                for (std::size_t i = block; i < end; i++) {
+                    int32_t column;
+                    float value = sampleAt(image, samples, affine, i, column);
+                    out[i] = value;
+                    s += value;
+                    sq += value * value;
+                }
+                sum += s;
+                squaredSum += sq;
+            }
+        }
+
+        double scaledSadScalar(const float* values, const float* gathered, float factor, float offset,
+                               std::size_t begin, std::size_t n) {
+            double total = 0.0;
+            for (std::size_t block = begin; block < n; block += kFlushBlock) {
+                std::size_t end = std::min(block + kFlushBlock, n);
+                float acc = 0.f;
+                for (std::size_t i = block; i < end; i++) {
+                    acc += std::fabs(values[i] - factor * gathered[i] + offset);
+                }
+                total += acc;
+            }
+            return total;
+        }
+
+        // One axis of cornersInside: extremes of a * [u0, u1] + b * [v0, v1] + t + c
+        inline bool axisInside(float a, float b, float t, float u0, float u1, float v0, float v1, float c,
+                               float lo, float hi) {
+            float au0 = a * u0, au1 = a * u1, bv0 = b * v0, bv1 = b * v1;
+            float low = ((std::min(au0, au1) + std::min(bv0, bv1)) + t) + c;
+            float high = ((std::max(au0, au1) + std::max(bv0, bv1)) + t) + c;
+            return low > lo && high < hi;
+        }
+
+        std::size_t cornersInsideScalar(const AffineColumns& m, const CornerBox& box, std::size_t begin,
+                                        uint8_t* inside) {
+            std::size_t count = 0;
+            for (std::size_t i = begin; i < m.n; i++) {
+                bool in = axisInside(m.a11[i], m.a12[i], m.tx[i], box.left, box.right, box.top, box.bottom,
+                                     box.centerX, box.minX, box.maxX) &&
+                          axisInside(m.a21[i], m.a22[i], m.ty[i], box.left, box.right, box.top, box.bottom,
+                                     box.centerY, box.minY, box.maxY);
+                inside[i] = in;
+                count += in;
+            }
+            return count;
+        }
+
+#ifdef CONFIG_KERNELS_X86
+        // Plain avx2 without fma, so the products are rounded as in the scalar path
+        __attribute__((target("avx2")))
+        float horizontalSum(__m256 v) {
+            alignas(32) float lanes[8];
+            _mm256_store_ps(lanes, v);
+            return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+        }
+
+        /**
+         * Gathers 8 samples starting at i; `gate` gets the lanes whose column
+         * lies in [columnBegin, columnEnd)
+         */
+        struct GatherAVX2 {
+            __m256 a11, a12, cx, a21, a22, cy;
+            __m256i ox, oy, cols, rows, step, minusOne, columnBegin, columnEnd;
+            const float* data;
+
+            __attribute__((target("avx2")))
+            GatherAVX2(const FloatImageView& image, const SampleAffine& affine)
+                    : a11(_mm256_set1_ps(affine.a11)), a12(_mm256_set1_ps(affine.a12)), cx(_mm256_set1_ps(affine.cx)),
+                      a21(_mm256_set1_ps(affine.a21)), a22(_mm256_set1_ps(affine.a22)), cy(_mm256_set1_ps(affine.cy)),
+                      ox(_mm256_set1_epi32(affine.ox)), oy(_mm256_set1_epi32(affine.oy)),
+                      cols(_mm256_set1_epi32(image.cols)), rows(_mm256_set1_epi32(image.rows)),
+                      step(_mm256_set1_epi32(static_cast<int32_t>(image.step))), minusOne(_mm256_set1_epi32(-1)),
+                      columnBegin(_mm256_set1_epi32(affine.columnBegin - 1)),
+                      columnEnd(_mm256_set1_epi32(affine.columnEnd)), data(image.data) {}
+
+            __attribute__((target("avx2")))
+            __m256 operator()(const ConfigSamples& samples, std::size_t i, __m256& gate) const {
+                __m256 x = _mm256_loadu_ps(samples.xs + i), y = _mm256_loadu_ps(samples.ys + i);
+                __m256i column = _mm256_add_epi32(_mm256_cvttps_epi32(
+                        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a11, x), _mm256_mul_ps(a12, y)), cx)), ox);
+                __m256i row = _mm256_add_epi32(_mm256_cvttps_epi32(
+                        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a21, x), _mm256_mul_ps(a22, y)), cy)), oy);
+                __m256i inside = _mm256_and_si256(
+                        _mm256_and_si256(_mm256_cmpgt_epi32(column, minusOne), _mm256_cmpgt_epi32(cols, column)),
+                        _mm256_and_si256(_mm256_cmpgt_epi32(row, minusOne), _mm256_cmpgt_epi32(rows, row)));
+                gate = _mm256_castsi256_ps(_mm256_and_si256(_mm256_cmpgt_epi32(column, columnBegin),
+                                                            _mm256_cmpgt_epi32(columnEnd, column)));
+                __m256i index = _mm256_add_epi32(_mm256_mullo_epi32(row, step), column);
+                return _mm256_mask_i32gather_ps(_mm256_setzero_ps(), data, index, _mm256_castsi256_ps(inside), 4);
+            }
+        };
+
+        __attribute__((target("avx2")))
+        double affineSadAVX2(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine,
+                             std::size_t& done) {
+            const GatherAVX2 gather(image, affine);
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+            double total = 0.0;
+            std::size_t i = 0;
+            while (i + 16 <= samples.n) {
+                // Two independent chains of 8 samples
+                __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+                std::size_t end = std::min(i + kFlushBlock, samples.n);
+                for (; i + 16 <= end; i += 16) {
+                    __m256 gate0, gate1;
+                    __m256 v0 = gather(samples, i, gate0), v1 = gather(samples, i + 8, gate1);
+                    __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(samples.values + i), v0);
+                    __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(samples.values + i + 8), v1);
+                    acc0 = _mm256_add_ps(acc0, _mm256_and_ps(_mm256_and_ps(d0, absMask), gate0));
+                    acc1 = _mm256_add_ps(acc1, _mm256_and_ps(_mm256_and_ps(d1, absMask), gate1));
+                }
+                total += horizontalSum(_mm256_add_ps(acc0, acc1));
+            }
+            done = i;
+            return total;
+        }
+
+        __attribute__((target("avx2")))
+        void gatherAVX2(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine,
+                        float* out, double& sum, double& squaredSum, std::size_t& done) {
+            const GatherAVX2 gather(image, affine);
+            std::size_t i = 0;
+            while (i + 16 <= samples.n) {
+                __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+                __m256 q0 = _mm256_setzero_ps(), q1 = _mm256_setzero_ps();
+                std::size_t end = std::min(i + kFlushBlock, samples.n);
+                for (; i + 16 <= end; i += 16) {
+                    __m256 gate0, gate1;
+                    __m256 v0 = gather(samples, i, gate0), v1 = gather(samples, i + 8, gate1);
+                    _mm256_storeu_ps(out + i, v0);
+                    _mm256_storeu_ps(out + i + 8, v1);
+                    s0 = _mm256_add_ps(s0, v0);
+                    s1 = _mm256_add_ps(s1, v1);
+                    q0 = _mm256_add_ps(q0, _mm256_mul_ps(v0, v0));
+                    q1 = _mm256_add_ps(q1, _mm256_mul_ps(v1, v1));
+                }
+                sum += horizontalSum(_mm256_add_ps(s0, s1));
+                squaredSum += horizontalSum(_mm256_add_ps(q0, q1));
+            }
+            done = i;
+        }
+
+        __attribute__((target("avx2")))
+        double scaledSadAVX2(const float* values, const float* gathered, float factor, float offset, std::size_t n,
+                             std::size_t& done) {
+            const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+            const __m256 f = _mm256_set1_ps(factor), o = _mm256_set1_ps(offset);
+            double total = 0.0;
+            std::size_t i = 0;
+            while (i + 16 <= n) {
+                __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+                std::size_t end = std::min(i + kFlushBlock, n);
+                for (; i + 16 <= end; i += 16) {
+                    __m256 d0 = _mm256_add_ps(_mm256_sub_ps(_mm256_loadu_ps(values + i),
+                                                            _mm256_mul_ps(f, _mm256_loadu_ps(gathered + i))), o);
+                    __m256 d1 = _mm256_add_ps(_mm256_sub_ps(_mm256_loadu_ps(values + i + 8),
+                                                            _mm256_mul_ps(f, _mm256_loadu_ps(gathered + i + 8))), o);
+                    acc0 = _mm256_add_ps(acc0, _mm256_and_ps(d0, absMask));
+                    acc1 = _mm256_add_ps(acc1, _mm256_and_ps(d1, absMask));
+                }
+                total += horizontalSum(_mm256_add_ps(acc0, acc1));
+            }
+            done = i;
+            return total;
+        }
+
+        // Lanes of one axis of cornersInside, as axisInside computes them
+        __attribute__((target("avx2")))
+        __m256 axisInsideAVX2(__m256 a, __m256 b, __m256 t, __m256 u0, __m256 u1, __m256 v0, __m256 v1, __m256 c,
+                              __m256 lo, __m256 hi) {
+            __m256 au0 = _mm256_mul_ps(a, u0), au1 = _mm256_mul_ps(a, u1);
+            __m256 bv0 = _mm256_mul_ps(b, v0), bv1 = _mm256_mul_ps(b, v1);
+            __m256 low = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_min_ps(au0, au1),
+                                                                   _mm256_min_ps(bv0, bv1)), t), c);
+            __m256 high = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_max_ps(au0, au1),
+                                                                    _mm256_max_ps(bv0, bv1)), t), c);
+            return _mm256_and_ps(_mm256_cmp_ps(low, lo, _CMP_GT_OQ), _mm256_cmp_ps(high, hi, _CMP_LT_OQ));
+        }
+
+        __attribute__((target("avx2")))
+        std::size_t cornersInsideAVX2(const AffineColumns& m, const CornerBox& box, uint8_t* inside,
+                                      std::size_t& done) {
+            const __m256 left = _mm256_set1_ps(box.left), right = _mm256_set1_ps(box.right);
+            const __m256 top = _mm256_set1_ps(box.top), bottom = _mm256_set1_ps(box.bottom);
+            const __m256 centerX = _mm256_set1_ps(box.centerX), centerY = _mm256_set1_ps(box.centerY);
+            const __m256 minX = _mm256_set1_ps(box.minX), maxX = _mm256_set1_ps(box.maxX);
+            const __m256 minY = _mm256_set1_ps(box.minY), maxY = _mm256_set1_ps(box.maxY);
+            std::size_t count = 0, i = 0;
+            for (; i + 8 <= m.n; i += 8) {
+                __m256 x = axisInsideAVX2(_mm256_loadu_ps(m.a11 + i), _mm256_loadu_ps(m.a12 + i),
+                                          _mm256_loadu_ps(m.tx + i), left, right, top, bottom, centerX, minX, maxX);
+                __m256 y = axisInsideAVX2(_mm256_loadu_ps(m.a21 + i), _mm256_loadu_ps(m.a22 + i),
+                                          _mm256_loadu_ps(m.ty + i), left, right, top, bottom, centerY, minY, maxY);
+                __m256i mask = _mm256_castps_si256(_mm256_and_ps(x, y));
+                // Narrow the 8 lanes of 0 / -1 to 8 bytes of 0 / 1
+                __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1));
+                __m128i bytes = _mm_and_si128(_mm_packs_epi16(words, words), _mm_set1_epi8(1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(inside + i), bytes);
+                count += static_cast<std::size_t>(__builtin_popcount(
+                        static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(mask)))));
+            }
+            done = i;
+            return count;
+        }
+#endif
+
+        bool useAVX2() {
+#ifdef CONFIG_KERNELS_X86
+            return activeLevel() >= Level::AVX2;
+#else
+            return false;
+#endif
+        }
+
+        bool useAVX2(const FloatImageView& image) {
+            // 32 bit gather offsets limit the vector path to images below 2^31 floats
+            return useAVX2() && static_cast<double>(image.rows) * static_cast<double>(image.step) < 2147483647.0;
+        }
+    }
+
+    double affineSad(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine) {
+        double total = 0.0;
+        std::size_t done = 0;
+#ifdef CONFIG_KERNELS_X86
+        if (useAVX2(image)) {
+            total = affineSadAVX2(image, samples, affine, done);
+        }
+#endif
+        return total + affineSadScalar(image, samples, affine, done);
+    }
+
+    PhotometricScale gatherPhotometric(const FloatImageView& image, const ConfigSamples& samples,
+                                       const SampleAffine& affine, double valuesSum, double valuesSquaredSum,
+                                       float* scratch) {
+        const std::size_t n = samples.n;
+        double sum = 0.0, squaredSum = 0.0;
+        std::size_t done = 0;
+#ifdef CONFIG_KERNELS_X86
+        if (useAVX2(image)) {
+            gatherAVX2(image, samples, affine, scratch, sum, squaredSum, done);
+        }
+#endif
+        gatherScalar(image, samples, affine, done, scratch, sum, squaredSum);
+
+        const double epsilon = 1e-7;
+        double meanX = valuesSum / n,
+                meanY = sum / n,
+                sigmaX = std::sqrt(std::max((valuesSquaredSum - (valuesSum * valuesSum) / n) / n, 0.0)) + epsilon,
+                sigmaY = std::sqrt(std::max((squaredSum - (sum * sum) / n) / n, 0.0)) + epsilon;
+        double sigmaDiv = sigmaX / sigmaY;
+        return {static_cast<float>(sigmaDiv), static_cast<float>(-meanX + sigmaDiv * meanY)};
+    }
+
+    double scaledSad(const float* values, const float* gathered, const PhotometricScale& scale, std::size_t n) {
+        double total = 0.0;
+        std::size_t done = 0;
+#ifdef CONFIG_KERNELS_X86
+        if (useAVX2()) {
+            total = scaledSadAVX2(values, gathered, scale.factor, scale.offset, n, done);
+        }
+#endif
+        return total + scaledSadScalar(values, gathered, scale.factor, scale.offset, done, n);
+    }
+
+    double affineSadPhotometric(const FloatImageView& image, const ConfigSamples& samples,
+                                const SampleAffine& affine, double valuesSum, double valuesSquaredSum,
+                                float* scratch) {
+        PhotometricScale scale = gatherPhotometric(image, samples, affine, valuesSum, valuesSquaredSum, scratch);
+        return scaledSad(samples.values, scratch, scale, samples.n);
+    }
+
+    std::size_t cornersInside(const AffineColumns& affines, const CornerBox& box, uint8_t* inside) {
+        std::size_t count = 0, done = 0;
+#ifdef CONFIG_KERNELS_X86
+        if (useAVX2()) {
+            count = cornersInsideAVX2(affines, box, inside, done);
+        }
+#endif
+        return count + cornersInsideScalar(affines, box, done, inside);
+    }
+}
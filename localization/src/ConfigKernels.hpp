@@ -0,0 +1,130 @@
+//
+// Vectorized kernels scoring affine configurations of the FAsT-Match search.
+// Dispatch follows simd::activeLevel() (see SampleKernels.hpp).
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simd {
+
+    /**
+     * Single channel float image. Reads outside [0, cols) x [0, rows)
+     * return 0. `step` counts floats.
+     */
+    struct FloatImageView {
+        const float* data;
+        int rows;
+        int cols;
+        std::size_t step;
+    };
+
+    /**
+     * Template samples shared by every configuration of one evaluation:
+     * coordinates relative to the template center and the template values
+     * there.
+     */
+    struct ConfigSamples {
+        const float* xs;
+        const float* ys;
+        const float* values;
+        std::size_t n;
+    };
+
+    /**
+     * Placement of the samples in the image:
+     *   column = trunc(a11 * x + a12 * y + cx) + ox
+     *   row    = trunc(a21 * x + a22 * y + cy) + oy
+     * computed in float without fused multiply-add, so every level lands on
+     * the same pixels. Callers keep the truncated values positive by adding
+     * a bias to cx, cy and taking it back in ox, oy, which makes trunc a
+     * floor. affineSad leaves out samples whose column falls outside
+     * [columnBegin, columnEnd).
+     */
+    struct SampleAffine {
+        float a11, a12, cx;
+        float a21, a22, cy;
+        int32_t ox, oy;
+        int32_t columnBegin, columnEnd;
+    };
+
+    /**
+     * Sum of |values[i] - image(column i, row i)| over the samples whose
+     * column lies in [columnBegin, columnEnd).
+     */
+    double affineSad(const FloatImageView& image, const ConfigSamples& samples, const SampleAffine& affine);
+
+    /**
+     * Gain and bias mapping the gathered image values onto the mean and
+     * deviation of the template values: value ~ factor * image - offset.
+     */
+    struct PhotometricScale {
+        float factor;
+        float offset;
+    };
+
+    /**
+     * Photometric invariant counterpart of affineSad: the image values are
+     * scaled and shifted to the mean and deviation of the template values
+     * before the absolute differences are summed. One pass gathers the image
+     * values into `scratch` (samples.n floats, reused between calls) and sums
+     * them, a second one over `scratch` sums the differences.
+     * `valuesSum` and `valuesSquaredSum` are the sums of samples.values.
+     */
+    double affineSadPhotometric(const FloatImageView& image, const ConfigSamples& samples,
+                                const SampleAffine& affine, double valuesSum, double valuesSquaredSum,
+                                float* scratch);
+
+    /**
+     * First pass of affineSadPhotometric: gathers the image values of all
+     * samples into `scratch` and returns the scale that maps them onto the
+     * template values.
+     */
+    PhotometricScale gatherPhotometric(const FloatImageView& image, const ConfigSamples& samples,
+                                       const SampleAffine& affine, double valuesSum, double valuesSquaredSum,
+                                       float* scratch);
+
+    /**
+     * Second pass of affineSadPhotometric over n samples:
+     * sum of |values[i] - factor * gathered[i] + offset|. Partial sums over a
+     * prefix never exceed the full one, so callers may stop early.
+     */
+    double scaledSad(const float* values, const float* gathered, const PhotometricScale& scale, std::size_t n);
+
+    /**
+     * Affine matrices [a11 a12 tx; a21 a22 ty] of n configurations, one
+     * array per coefficient, as MatchConfigBatch stores them.
+     */
+    struct AffineColumns {
+        const float* a11;
+        const float* a12;
+        const float* tx;
+        const float* a21;
+        const float* a22;
+        const float* ty;
+        std::size_t n;
+    };
+
+    /**
+     * Template rectangle [left, right] x [top, bottom] around the template
+     * center, moved by the affine and then by (centerX, centerY), has to lie
+     * strictly within (minX, maxX) x (minY, maxY).
+     */
+    struct CornerBox {
+        float left, right, top, bottom;
+        float centerX, centerY;
+        float minX, minY, maxX, maxY;
+    };
+
+    /**
+     * Sets inside[i] to 1 if all four corners of the box fall within the
+     * bounds under affine i, to 0 otherwise, and returns the number inside.
+     * Each corner coordinate is a sum of two products, so its extremes over
+     * the corners are the sums of the per-coefficient extremes; rounding is
+     * monotonic, so the test agrees with transforming every corner in float:
+     *   minX = (min(a11 * left, a11 * right) + min(a12 * top, a12 * bottom) + tx) + centerX
+     */
+    std::size_t cornersInside(const AffineColumns& affines, const CornerBox& box, uint8_t* inside);
+}
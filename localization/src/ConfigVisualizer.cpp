@@ -4,12 +4,12 @@
 
 #include "ConfigVisualizer.hpp"
 
-void ConfigVisualizer::visualiseConfigs(cv::Mat image, const std::vector<fast_match::MatchConfig>& configs) {
+void ConfigVisualizer::visualiseConfigs(cv::Mat image, const fast_match::MatchConfigBatch& configs) {
     std::vector<cv::Point2i> drawnPoints;
-    for(const auto& config : configs) {
+    for(size_t i = 0; i < configs.size(); i++) {
         cv::Point2i curPoint(cv::Point(
-                (int) config.getTranslateX() + (image.cols / 2),
-                (int) config.getTranslateY() + (image.rows / 2)
+                (int) configs.translateX[i] + (image.cols / 2),
+                (int) configs.translateY[i] + (image.rows / 2)
         ));
         if(std::find(drawnPoints.begin(), drawnPoints.end(), curPoint) == drawnPoints.end()) {
             cv::drawMarker(
@@ -6,12 +6,13 @@
 
 
 #include <FAsT-Match/MatchConfig.h>
+#include <src/MatchConfigBatch.hpp>
 #include <src/Particles.hpp>
 
 class ConfigVisualizer {
 public:
     ConfigVisualizer();
-    void visualiseConfigs(cv::Mat image, const std::vector<fast_match::MatchConfig>& configs);
+    void visualiseConfigs(cv::Mat image, const fast_match::MatchConfigBatch& configs);
     void visualiseParticles(cv::Mat image, const Particles& particles, const cv::Point2i& offset);
 
 };
@@ -7,6 +7,8 @@
 //
 
 #include "FastMatch.hpp"
+#include "ConfigBounds.hpp"
+#include "ConfigEvaluator.hpp"
 #include "GridConfigExpander.hpp"
 #include "Utilities.hpp"
 #include <iomanip>
@@ -71,11 +73,11 @@ namespace fast_match {
 
 
     /**
-     * From given list of configurations, convert them into affine matrices.
-     * But filter out all the rectangles that are out of the given boundaries.
+     * From given list of configurations, filter out all the rectangles
+     * that are out of the given boundaries. Returns the number left.
      **/
-    vector<Mat> FAsTMatch::configsToAffine(vector<MatchConfig> &configs, vector<bool> &insiders) {
-        return Utilities::configsToAffine(configs, insiders, image.size(), templ.size());
+    size_t FAsTMatch::configsToAffine(MatchConfigBatch &configs) {
+        return Utilities::configsToAffine(configs, image.size(), templ.size());
     }
 
 
@@ -83,108 +85,67 @@ namespace fast_match {
      * Evaluate the score of the given configurations
      */
     vector<double> FAsTMatch::evaluateConfigs(Mat &image, Mat &templ, vector<Mat> &affine_matrices,
-                                              Mat &xs, Mat &ys, bool photometric_invariance) {
-
-        int r1x = static_cast<int>(0.5 * (templ.cols - 1)),
-                r1y = static_cast<int>(0.5 * (templ.rows - 1)),
-                r2x = static_cast<int>(0.5 * (image.cols - 1)),
-                r2y = static_cast<int>(0.5 * (image.rows - 1));
-
+                                              Mat &xs, Mat &ys, bool photometric_invariance, double margin) {
+        ConfigEvaluator evaluator(templ, xs, ys, image.size(), photometric_invariance);
         int no_of_configs = static_cast<int>(affine_matrices.size());
-        int no_of_points = xs.cols;
-
-        /* Use a padded image, to avoid boundary checking */
-        Mat padded(image.rows * 3, image.cols, image.type(), Scalar(0.0));
-        image.copyTo(Mat(padded, Rect(0, image.rows, image.cols, image.rows)));
-
-        /* Create a lookup array for our template values based on the given random x and y points */
-        int *xs_ptr = xs.ptr<int>(0),
-                *ys_ptr = ys.ptr<int>(0);
-
-        vector<float> vals_i1(no_of_points);
-        for (int i = 0; i < no_of_points; i++)
-            vals_i1[i] = templ.at<float>(ys_ptr[i] - 1, xs_ptr[i] - 1);
-
-
-        /* Recenter our indices */
-        Mat xs_centered = xs.clone() - (r1x + 1),
-                ys_centered = ys.clone() - (r1y + 1);
-
-        int *xs_ptr_cent = xs_centered.ptr<int>(0),
-                *ys_ptr_cent = ys_centered.ptr<int>(0);
-
-        vector<double> distances(no_of_configs, 0.0);
-
-        /* Calculate the score for each configurations on each of our randomly sampled points */
-        tbb::parallel_for(0, no_of_configs, 1, [&](int i) {
-
-            float a11 = affine_matrices[i].at<float>(0, 0),
-                    a12 = affine_matrices[i].at<float>(0, 1),
-                    a13 = affine_matrices[i].at<float>(0, 2),
-                    a21 = affine_matrices[i].at<float>(1, 0),
-                    a22 = affine_matrices[i].at<float>(1, 1),
-                    a23 = affine_matrices[i].at<float>(1, 2);
-
-            double tmp_1 = (r2x + 1) + a13 + 0.5;
-            double tmp_2 = (r2y + 1) + a23 + 0.5 + 1 * image.rows;
-            double score = 0.0;
-
-            if (!photometric_invariance) {
-                for (int j = 0; j < no_of_points; j++) {
-                    int target_x = int(a11 * xs_ptr_cent[j] + a12 * ys_ptr_cent[j] + tmp_1),
-                            target_y = int(a21 * xs_ptr_cent[j] + a22 * ys_ptr_cent[j] + tmp_2);
-
-                    //score += abs(vals_i1[j] - padded.at<float>(target_y - 1, target_x - 1) );
-                    if (target_x - 1 >= 0 && target_x - 1 < padded.size().width)
-                        score += abs(vals_i1[j] - padded.at<float>(target_y - 1, target_x - 1));
-
-                }
-            } else {
-                vector<double> xs_target(no_of_points),
-                        ys_target(no_of_points);
-
-                double sum_x = 0.0,
-                        sum_y = 0.0,
-                        sum_x_squared = 0.0,
-                        sum_y_squared = 0.0;
-
-                for (int j = 0; j < no_of_points; j++) {
-                    int target_x = int(a11 * xs_ptr_cent[j] + a12 * ys_ptr_cent[j] + tmp_1),
-                            target_y = int(a21 * xs_ptr_cent[j] + a22 * ys_ptr_cent[j] + tmp_2);
-
-                    float xi = vals_i1[j],
-                            yi = padded.at<float>(target_y - 1, target_x - 1);
-
-                    xs_target[j] = xi;
-                    ys_target[j] = yi;
-
-                    sum_x += xi;
-                    sum_y += yi;
-
-                    sum_x_squared += (xi * xi);
-                    sum_y_squared += (yi * yi);
-                }
-
-                double epsilon = 1e-7;
-                double mean_x = sum_x / no_of_points,
-                        mean_y = sum_y / no_of_points,
-                        sigma_x = sqrt((sum_x_squared - (sum_x * sum_x) / no_of_points) / no_of_points) + epsilon,
-                        sigma_y = sqrt((sum_y_squared - (sum_y * sum_y) / no_of_points) / no_of_points) + epsilon;
+        return evaluator.evaluate(ConfigEvaluator::view(image), Point(0, 0), no_of_configs, [&](int i, float a[6]) {
+            for (int k = 0; k < 6; k++)
+                a[k] = affine_matrices[i].at<float>(k / 3, k % 3);
+        }, margin);
+    }
 
-                double sigma_div = sigma_x / sigma_y;
-                double temp = -mean_x + sigma_div * mean_y;
+    vector<double> FAsTMatch::evaluateConfigs(Mat &image, Mat &templ, const MatchConfigBatch &configs,
+                                              Mat &xs, Mat &ys, bool photometric_invariance, double margin) {
+        ConfigEvaluator evaluator(templ, xs, ys, image.size(), photometric_invariance);
+        int no_of_configs = static_cast<int>(configs.size());
+        return evaluator.evaluate(ConfigEvaluator::view(image), Point(0, 0), no_of_configs, [&](int i, float a[6]) {
+            configs.affine(static_cast<size_t>(i), a);
+        }, margin);
+    }
 
 
-                for (int j = 0; j < no_of_points; j++)
-                    score += fabs(xs_target[j] - sigma_div * ys_target[j] + temp);
+    size_t FAsTMatch::evaluateGrid(Mat &image, Mat &templ, const ConfigGrid &grid, Mat &xs, Mat &ys,
+                                   bool photometric_invariance, double margin,
+                                   vector<size_t> &indices, vector<double> &distances) {
+        ConfigEvaluator evaluator(templ, xs, ys, image.size(), photometric_invariance);
+        const ConfigBounds bounds(image.size(), templ.size());
+
+        /* Every block of the grid collects its own finished configs, already in order */
+        const size_t block = 1024;
+        struct Found {
+            vector<size_t> indices;
+            vector<double> distances;
+            size_t inside = 0;
+        };
+        vector<Found> found((grid.size() + block - 1) / block);
+        evaluator.scan(ConfigEvaluator::view(image), Point(0, 0), grid.size(), block, [&](size_t i, float a[6]) {
+            grid.affine(i, a);
+            return bounds.contains(a);
+        }, margin, [&](size_t i, double distance, bool finished) {
+            Found &part = found[i / block];
+            part.inside++;
+            if (finished) {
+                part.indices.push_back(i);
+                part.distances.push_back(distance);
             }
-
-            distances[i] = score / no_of_points;
-            //configs[i].setProbability((float) distances[i]);
         });
 
-
-        return distances;
+        size_t inside = 0, total = 0;
+        for (const auto &part : found) {
+            inside += part.inside;
+            total += part.indices.size();
+        }
+        indices.clear();
+        distances.clear();
+        indices.reserve(total);
+        distances.reserve(total);
+        for (auto &part : found) {
+            indices.insert(indices.end(), part.indices.begin(), part.indices.end());
+            distances.insert(distances.end(), part.distances.begin(), part.distances.end());
+            vector<size_t>().swap(part.indices);
+            vector<double>().swap(part.distances);
+        }
+        return inside;
     }
 
 
@@ -192,43 +153,36 @@ namespace fast_match {
      * Given the previously calcuated distances for each configurations,
      * filter out all distances that fall within a certain threshold
      */
-    vector<MatchConfig>
-    FAsTMatch::getGoodConfigsByDistance(vector<MatchConfig> &configs, float best_dist, float new_delta,
-                                        vector<double> &distances, float &thresh, bool &too_high_percentage) {
+    void FAsTMatch::getGoodConfigsByDistance(const ConfigGrid &grid, const vector<size_t> &indices, size_t inside,
+                                             float best_dist, float new_delta, vector<double> &distances,
+                                             float &thresh, bool &too_high_percentage,
+                                             MatchConfigBatch &good_configs) {
         thresh = best_dist + Utilities::getThresholdPerDelta(new_delta);
 
         /* Only those configs that have distances below the given threshold are */
         /* categorized as good configurations */
-        vector<MatchConfig> good_configs;
-        for (int i = 0; i < distances.size(); i++) {
-            if (distances[i] <= thresh)
-                good_configs.push_back(configs[i]);
-        }
-
-        int no_of_configs = static_cast<int>(good_configs.size());
+        size_t no_of_configs = count_if(distances.begin(), distances.end(), [&](double d) { return d <= thresh; });
 
         /* Well if there's still too many configurations */
         /* keep shrinking the threshold */
         while (no_of_configs > 27000) {
             thresh *= 0.99;
-            good_configs.clear();
-
-            for (int i = 0; i < distances.size(); i++) {
-                if (distances[i] <= thresh)
-                    good_configs.push_back(configs[i]);
-            }
-
-            no_of_configs = static_cast<int>(good_configs.size());
+            no_of_configs = count_if(distances.begin(), distances.end(), [&](double d) { return d <= thresh; });
         }
 
         assert(no_of_configs > 0);
 
-        float percentage = 1.0 * no_of_configs / configs.size();
+        good_configs.clear();
+        good_configs.reserve(no_of_configs);
+        for (size_t i = 0; i < distances.size(); i++) {
+            if (distances[i] <= thresh)
+                grid.pushTo(indices[i], good_configs);
+        }
+
+        float percentage = 1.0 * no_of_configs / inside;
 
         /* If it's above 97.8% it's too high percentage */
         too_high_percentage = percentage > 0.022;
-
-        return good_configs;
     }
 
 
@@ -244,27 +198,18 @@ namespace fast_match {
         rng.fill(ys, RNG::UNIFORM, 1, templ.rows);
 
 
-        /* First create configurations based on our net */
-        configs = configExpander->createListOfConfigs(templ.size(), image.size());
+        /* First create configurations based on our net, as a grid decoded where they are scored */
+        ConfigGrid grid = configExpander->createConfigGrid(templ.size(), image.size());
 
-        int configs_count = static_cast<int>(configs.size());
+        size_t configs_count = grid.size();
 
-        /* Convert the configurations into affine matrices */
-        vector<Mat> affines = configsToAffine(configs, insiders);
-
-        /* Filter out configurations that fall outside of the boundaries */
-        /* the internal logic of configsToAffine has more information */
-        vector<MatchConfig> temp_configs;
-        for (size_t i = 0; i < insiders.size(); i++)
-            if (insiders[i])
-                temp_configs.push_back(configs[i]);
-        configs = temp_configs;
-
-        /* For the configs, calculate the scores / distances */
-        distances = evaluateConfigs(image, templ, affines, xs, ys, photometricInvariance);
-        if(visualize) {
-            visualizer.visualiseConfigs(original_image.clone(), configs);
-        }
+        /* For the configs inside the boundaries, calculate the scores / distances. Only the */
+        /* configs within the threshold of getGoodConfigsByDistance need their exact distance, */
+        /* the others are abandoned as soon as their partial distance rules them out */
+        double margin = earlyTermination ? Utilities::getThresholdPerDelta(new_delta)
+                                         : std::numeric_limits<double>::infinity();
+        size_t inside = evaluateGrid(image, templ, grid, xs, ys, photometricInvariance, margin,
+                                     candidate_indices, distances);
 
         /* Find the minimum distance */
         auto min_itr = min_element(distances.begin(), distances.end());
@@ -272,11 +217,7 @@ namespace fast_match {
         double best_distance = distances[min_index];
         best_distances[level] = best_distance;
 
-        auto max_itr = max_element(distances.begin(), distances.end());
-        int max_index = static_cast<int>(max_itr - distances.begin());
-        double worst_distance = distances[max_index];
-
-        best_config = configs[min_index];
+        best_config = grid.get(candidate_indices[min_index]);
         best_trans = best_config.getAffineMatrix();
 
 
@@ -287,7 +228,7 @@ namespace fast_match {
         if (level > 3) {
             float mean_value =
                     (float) (std::accumulate(best_distances.begin() + level - 3, best_distances.begin() + level - 1, 0) *
-                             1.0 / distances.size());
+                             1.0 / inside);
 
             if (best_distance > mean_value * 0.97)
                 return false;
@@ -298,8 +239,11 @@ namespace fast_match {
         bool too_high_percentage;
 
         /* Get the good configurations that falls between certain thresholds */
-        vector<MatchConfig> good_configs = getGoodConfigsByDistance(configs, (float) best_distance, new_delta, distances,
-                                                                    thresh, too_high_percentage);
+        getGoodConfigsByDistance(grid, candidate_indices, inside, (float) best_distance, new_delta, distances, thresh,
+                                 too_high_percentage, good_configs);
+        if(visualize) {
+            visualizer.visualiseConfigs(original_image.clone(), good_configs);
+        }
 
         if ((too_high_percentage && (best_distance > 0.05) && ((level == 1) && (configs_count < 7.5e6))) ||
             ((best_distance > 0.1) && ((level == 1) && (configs_count < 5e6)))) {
@@ -308,16 +252,10 @@ namespace fast_match {
             new_delta = new_delta * factor;
             level = 0;
             configExpander->setNet(configExpander->getNet() * factor);
-            configs = configExpander->createListOfConfigs(templ.size(), image.size());
         } else {
             new_delta = new_delta / delta_fact;
 
-            vector<MatchConfig> expanded_configs =
-                    configExpander->randomExpandConfigs(good_configs, level, 80, delta_fact);
-
-            configs.clear();
-            configs.insert(configs.end(), good_configs.begin(), good_configs.end());
-            configs.insert(configs.end(), expanded_configs.begin(), expanded_configs.end());
+            configExpander->randomExpandConfigs(good_configs, level, 80, delta_fact, expanded_configs);
         }
 
         return true;
@@ -357,7 +295,9 @@ namespace fast_match {
             cv::cvtColor(templ_, templGray, cv::COLOR_BGR2GRAY);
             FAsTMatch::templ = Utilities::preprocessImage(templGray);
         } else {
-            FAsTMatch::templ = Utilities::preprocessImage(templ);
+            // Blurred in place below, so the caller's gray frame is copied
+            templGray = templ_.clone();
+            FAsTMatch::templ = Utilities::preprocessImage(templGray);
         }
         templAvg = static_cast<float>(cv::sum(FAsTMatch::templ).val[0] / (templ.cols * templ.rows));
         templGrayAvg = static_cast<float>(cv::sum(FAsTMatch::templGray).val[0] / (templ.cols * templ.cols));
@@ -11,11 +11,14 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
 #include <iterator>
+#include <limits>
 #include <boost/shared_ptr.hpp>
 
 #include "../FAsT-Match/MatchNet.h"
 #include "../FAsT-Match/MatchConfig.h"
 #include "ConfigExpanderBase.hpp"
+#include "MatchConfigBatch.hpp"
+#include "ConfigGrid.hpp"
 #include "ConfigVisualizer.hpp"
 
 namespace fast_match {
@@ -36,6 +39,8 @@ namespace fast_match {
         bool calculateLevel();
         int no_of_points = 0;
         int level = 0;
+        // Abandon configs in calculateLevel once they cannot pass the good config threshold
+        bool earlyTermination = true;
         cv::Mat original_image;
         cv::Mat imageGray, templGray;
         float imageGrayAvg = 0.0;
@@ -54,8 +59,32 @@ namespace fast_match {
 
         virtual void setTemplate(const cv::Mat &templ);
 
+        /**
+         * Mean distance of the template under each affine matrix. Configs farther than
+         * `margin` from the smallest distance may get a lower bound of their distance
+         * instead (see ConfigEvaluator::evaluate); a margin of 0 keeps the minimum exact
+         */
         static std::vector<double> evaluateConfigs( cv::Mat& image, cv::Mat& templ, std::vector<cv::Mat>& affine_matrices,
-                                        cv::Mat& xs, cv::Mat& ys, bool photometric_invariance );
+                                        cv::Mat& xs, cv::Mat& ys, bool photometric_invariance,
+                                        double margin = std::numeric_limits<double>::infinity() );
+
+        /**
+         * evaluateConfigs reading the affine matrices straight from the columns of a batch
+         */
+        static std::vector<double> evaluateConfigs( cv::Mat& image, cv::Mat& templ, const MatchConfigBatch& configs,
+                                        cv::Mat& xs, cv::Mat& ys, bool photometric_invariance,
+                                        double margin = std::numeric_limits<double>::infinity() );
+
+        /**
+         * evaluateConfigs streaming through a grid: the configs are decoded from their
+         * index inside the scoring tasks and never stored. Fills `indices` (ascending)
+         * and `distances` with the configs inside the image that finished, which covers
+         * every config within `margin` of the smallest distance, and returns how many
+         * configs lie inside the image
+         */
+        static size_t evaluateGrid( cv::Mat& image, cv::Mat& templ, const ConfigGrid& grid,
+                                    cv::Mat& xs, cv::Mat& ys, bool photometric_invariance, double margin,
+                                    std::vector<size_t>& indices, std::vector<double>& distances );
 
     protected:
 
@@ -74,10 +103,16 @@ namespace fast_match {
 
 
 
-        std::vector<cv::Mat> configsToAffine( std::vector<MatchConfig>& configs, std::vector<bool>& insiders );
+        size_t configsToAffine( MatchConfigBatch& configs );
 
-        std::vector<MatchConfig> getGoodConfigsByDistance( std::vector<MatchConfig>& configs, float best_dist, float new_delta,
-                                                      std::vector<double>& distances, float& thresh, bool& too_high_percentage );
+        /**
+         * Copies the configs of `grid` listed in `indices` whose distance is within the
+         * threshold of `best_dist` to `good_configs`. `inside` is the number of configs
+         * scored, for the share of good ones
+         */
+        void getGoodConfigsByDistance( const ConfigGrid& grid, const std::vector<size_t>& indices, size_t inside,
+                                       float best_dist, float new_delta, std::vector<double>& distances,
+                                       float& thresh, bool& too_high_percentage, MatchConfigBatch& good_configs );
 
         float delta_fact = 1.511f;
         float new_delta;
@@ -86,9 +121,12 @@ namespace fast_match {
         MatchConfig best_config;
         cv::Mat best_trans;
         std::vector<double> best_distances;
+        // Grid indices and distances of the configs of a level that were scored to the end
+        std::vector<size_t> candidate_indices;
         std::vector<double> distances;
-        std::vector<bool> insiders;
-        std::vector<MatchConfig> configs;
+        // Configs carried to the next level, reusing their capacity between levels
+        MatchConfigBatch good_configs;
+        MatchConfigBatch expanded_configs;
 
     };
 }
@@ -0,0 +1,22 @@
+//
+// Float copy of the part of the map the affine search reads.
+//
+
+#include "FloatMapRegion.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+FloatMapRegion::FloatMapRegion(const cv::Mat& map, const cv::Rect& region)
+        : rect_(region & cv::Rect(0, 0, map.cols, map.rows)) {
+    if (rect_.empty()) {
+        rect_ = cv::Rect();
+        return;
+    }
+    cv::Mat part = map(rect_);
+    if (part.channels() != 1) {
+        cv::Mat gray;
+        cv::cvtColor(part, gray, cv::COLOR_BGR2GRAY);
+        part = gray;
+    }
+    part.convertTo(pixels_, CV_32FC1, 1.0 / 255.0);
+}
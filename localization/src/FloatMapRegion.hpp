@@ -0,0 +1,58 @@
+//
+// Float copy of the part of the map the affine search reads.
+//
+
+#pragma once
+
+#include <cstddef>
+
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+#include "ConfigKernels.hpp"
+
+/**
+ * Pixels of a map region converted the way Utilities::preprocessImage
+ * converts the whole map: gray, CV_32F, scaled to [0, 1]. Reads outside of
+ * the region return 0, like the zero rows around the padded float map the
+ * affine search used to keep for the entire map.
+ */
+class FloatMapRegion {
+public:
+    FloatMapRegion() = default;
+
+    /**
+     * Converts `region` of a CV_8UC3 (BGR) or CV_8UC1 map, clipped to the map.
+     */
+    FloatMapRegion(const cv::Mat& map, const cv::Rect& region);
+
+    const cv::Rect& rect() const { return rect_; }
+
+    bool covers(const cv::Rect& region) const {
+        return region.empty() || (region & rect_) == region;
+    }
+
+    size_t bytes() const { return pixels_.total() * pixels_.elemSize(); }
+
+    float at(int x, int y) const {
+        // One unsigned compare per axis rejects both sides of the region
+        auto rx = static_cast<unsigned>(x - rect_.x), ry = static_cast<unsigned>(y - rect_.y);
+        if (rx >= static_cast<unsigned>(rect_.width) || ry >= static_cast<unsigned>(rect_.height)) {
+            return 0.f;
+        }
+        return pixels_.ptr<float>(static_cast<int>(ry))[rx];
+    }
+
+    /**
+     * The pixels for the config kernels; pixel (x, y) of the map is
+     * (x - rect().x, y - rect().y) of the view.
+     */
+    simd::FloatImageView view() const {
+        return {pixels_.empty() ? nullptr : pixels_.ptr<float>(0), pixels_.rows, pixels_.cols,
+                pixels_.step / sizeof(float)};
+    }
+
+private:
+    cv::Rect rect_;
+    cv::Mat pixels_;
+};
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cmath>
 #include <opencv2/core/types.hpp>
 
 /**
@@ -21,3 +22,21 @@ namespace geometry {
     constexpr double kBoundaryPadding = 10.0;
     constexpr double kRadToDeg = 57.2957795130823;  // 180 / M_PI
 }
+
+namespace geometry {
+    /**
+     * Same matrix as cv::getRotationMatrix2D, written to a plain row-major
+     * array so hot loops don't allocate a cv::Mat per call.
+     */
+    inline void rotationMatrix2D(const cv::Point2d& center, double angleDeg, double scale, double m[6]) {
+        double angle = angleDeg * M_PI / 180.0;
+        double alpha = std::cos(angle) * scale,
+                beta = std::sin(angle) * scale;
+        m[0] = alpha;
+        m[1] = beta;
+        m[2] = (1 - alpha) * center.x - beta * center.y;
+        m[3] = -beta;
+        m[4] = alpha;
+        m[5] = beta * center.x + (1 - alpha) * center.y;
+    }
+}
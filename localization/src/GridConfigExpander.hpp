@@ -16,11 +16,13 @@ public:
 
 protected:
     cv::RNG rng;
-    virtual std::vector<fast_match::MatchConfig> createListOfConfigs(cv::Size templ_size, cv::Size image_size) override;
+    virtual fast_match::ConfigGrid createConfigGrid(cv::Size templ_size, cv::Size image_size) override;
 
-    virtual std::vector<fast_match::MatchConfig>
-    randomExpandConfigs(std::vector<fast_match::MatchConfig> &configs, int level, int no_of_points,
-                        float delta_factor) override;
+    virtual void createListOfConfigs(cv::Size templ_size, cv::Size image_size,
+                                     fast_match::MatchConfigBatch &configs) override;
+
+    virtual void randomExpandConfigs(const fast_match::MatchConfigBatch &configs, int level, int no_of_points,
+                                     float delta_factor, fast_match::MatchConfigBatch &expanded) override;
 
 };
 
@@ -4,6 +4,7 @@
 
 #include <algorithm>
 #include "ImageSample.hpp"
+#include "SampleKernels.hpp"
 
 namespace {
     inline cv::Point clampToImage(const cv::Point& pt, const cv::Mat& image) {
@@ -14,12 +15,16 @@ namespace {
     }
 }
 
-ImageSample::ImageSample(const cv::Mat& image, const std::vector<cv::Point>& samplePoints, float average) {
-    for (const auto& p : samplePoints) {
-        auto cp = clampToImage(p, image);
-        double val = static_cast<float>(image.at<uint8_t>(cp)) - average;
+ImageSample::ImageSample(const cv::Mat& image, const std::vector<cv::Point>& samplePoints, float average)
+        : sample(paddedLength<float>(samplePoints.size()), 0.f),
+          pixels(paddedLength<uint8_t>(samplePoints.size()), 0), average(average), length(samplePoints.size()) {
+    for (size_t i = 0; i < length; i++) {
+        auto cp = clampToImage(samplePoints[i], image);
+        pixels[i] = image.at<uint8_t>(cp);
+        double val = static_cast<float>(pixels[i]) - average;
+        sum += val;
         squared_sum += val * val;
-        sample.push_back(val);
+        sample[i] = val;
     }
     standard_deviation = std::sqrt(squared_sum);
 };
@@ -30,7 +35,8 @@ ImageSample::ImageSample(
         const cv::Mat& rotation,
         const cv::Point& offset,
         float average
-) {
+) : sample(paddedLength<float>(samplePoints.size()), 0.f),
+    pixels(paddedLength<uint8_t>(samplePoints.size()), 0), average(average), length(samplePoints.size()) {
     double m11 = rotation.at<double>(0, 0),
             m12 = rotation.at<double>(0, 1),
             m13 = rotation.at<double>(0, 2),
@@ -38,53 +44,58 @@ ImageSample::ImageSample(
             m22 = rotation.at<double>(1, 1),
             m23 = rotation.at<double>(1, 2);
     cv::Point centerOffset(320, 240);
-    for (const auto& ps : samplePoints) {
+    for (size_t i = 0; i < length; i++) {
         // Centerfix
-        cv::Point p = (ps + offset) - centerOffset;
+        cv::Point p = (samplePoints[i] + offset) - centerOffset;
 
         // Transform points
         cv::Point pTran = clampToImage(cv::Point(
                 m11 * p.x + m12 * p.y + m13,
                 m21 * p.x + m22 * p.y + m23
         ), image);
-        double val = static_cast<float>(image.at<uint8_t>(pTran)) - average;
+        pixels[i] = image.at<uint8_t>(pTran);
+        double val = static_cast<float>(pixels[i]) - average;
+        sum += val;
         squared_sum += val * val;
-        sample.push_back(val);
+        sample[i] = val;
     }
     standard_deviation = std::sqrt(squared_sum);
 }
 
 double ImageSample::calcSimilarity(const ImageSample& other) const {
-    double top = 0.0;
-    auto sampleLen = sample.size();
-    for (int i = 0; i < sampleLen; i++) {
-        top += sample[i] * other.sample[i];
-    }
+    // Padding lanes are zero, so running over the padded length does not change the result
+    auto sampleLen = std::min(sample.size(), other.sample.size());
+    double top = simd::dotProduct(sample.data(), other.sample.data(), sampleLen);
     double res = top / (standard_deviation * other.standard_deviation);
-    if (res > 1.0 || res < -1.0) {
-        std::cout << "Problem " << std::endl;
-    }
-    return res;
+    // Float accumulation may overshoot the [-1; 1] range by a rounding error
+    return std::clamp(res, -1.0, 1.0);
 }
 
-ImageSample::ImageSample(const cv::Mat &image, const std::vector<cv::Point> &samplePoints) {
+ImageSample::ImageSample(const cv::Mat &image, const std::vector<cv::Point> &samplePoints)
+        : sample(paddedLength<float>(samplePoints.size()), 0.f),
+          pixels(paddedLength<uint8_t>(samplePoints.size()), 0), length(samplePoints.size()) {
     double sum_ = 0.0;
-    for (const auto& p : samplePoints) {
-        auto cp = clampToImage(p, image);
-        float val = static_cast<float>(image.at<uint8_t>(cp));
+    for (size_t i = 0; i < length; i++) {
+        auto cp = clampToImage(samplePoints[i], image);
+        pixels[i] = image.at<uint8_t>(cp);
+        float val = static_cast<float>(pixels[i]);
         sum_ += val;
-        sample.push_back(val);
+        sample[i] = val;
     }
-    auto average = static_cast<float>(sum_ / static_cast<double>(samplePoints.size()));
-    for(float& val : sample) {
+    average = static_cast<float>(sum_ / static_cast<double>(samplePoints.size()));
+    for (size_t i = 0; i < length; i++) {
+        float& val = sample[i];
         val -= average;
+        sum += val;
         squared_sum += val * val;
     }
     standard_deviation = std::sqrt(squared_sum);
 }
 
 ImageSample::ImageSample(const cv::Mat &image, const std::vector<cv::Point> &samplePoints, const cv::Mat &rotation,
-                         const cv::Point &offset) {
+                         const cv::Point &offset)
+        : sample(paddedLength<float>(samplePoints.size()), 0.f),
+          pixels(paddedLength<uint8_t>(samplePoints.size()), 0), length(samplePoints.size()) {
     double m11 = rotation.at<double>(0, 0),
             m12 = rotation.at<double>(0, 1),
             m13 = rotation.at<double>(0, 2),
@@ -93,22 +104,25 @@ ImageSample::ImageSample(const cv::Mat &image, const std::vector<cv::Point> &sam
             m23 = rotation.at<double>(1, 2);
     cv::Point centerOffset(320, 240);
     double sum_ = 0.0;
-    for (const auto& ps : samplePoints) {
+    for (size_t i = 0; i < length; i++) {
         // Centerfix
-        cv::Point p = (ps + offset) - centerOffset;
+        cv::Point p = (samplePoints[i] + offset) - centerOffset;
 
         // Transform points
         cv::Point pTran = clampToImage(cv::Point(
                 m11 * p.x + m12 * p.y + m13,
                 m21 * p.x + m22 * p.y + m23
         ), image);
-        double val = static_cast<float>(image.at<uint8_t>(pTran));
+        pixels[i] = image.at<uint8_t>(pTran);
+        double val = static_cast<float>(pixels[i]);
         sum_ += val;
-        sample.push_back(val);
+        sample[i] = val;
     }
-    auto average = static_cast<float>(sum_ / static_cast<double>(samplePoints.size()));
-    for(float& val : sample) {
+    average = static_cast<float>(sum_ / static_cast<double>(samplePoints.size()));
+    for (size_t i = 0; i < length; i++) {
+        float& val = sample[i];
         val -= average;
+        sum += val;
         squared_sum += val * val;
     }
     standard_deviation = std::sqrt(squared_sum);
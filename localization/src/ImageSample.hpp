@@ -5,11 +5,19 @@
 #pragma once
 
 #include "Utilities.hpp"
+#include "AlignedBuffer.hpp"
 #include <opencv2/opencv.hpp>
 
 class ImageSample {
 public:
-    std::vector<float> sample;
+    // Zero padded to a whole number of SIMD vectors, see paddedLength()
+    AlignedVector<float> sample;
+    // Raw pixel values, zero padded to paddedLength<uint8_t>(), for the integer correlation
+    AlignedVector<uint8_t> pixels;
+    // Value subtracted from the pixels to form `sample`
+    float average = 0.f;
+    size_t length = 0;
+    double sum = 0.0;
     double squared_sum = 0.0;
     double standard_deviation = 0.0;
 
@@ -0,0 +1,143 @@
+//
+// Samples the map for a whole set of particles in one pass.
+//
+
+#include "ImageSampleBatch.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/parallel_for.h>
+
+Affine2f Affine2f::fromSampling(const cv::Mat& rotation, const cv::Point& offset, const cv::Point& center) {
+    const double m[6] = {
+            rotation.at<double>(0, 0), rotation.at<double>(0, 1), rotation.at<double>(0, 2),
+            rotation.at<double>(1, 0), rotation.at<double>(1, 1), rotation.at<double>(1, 2)
+    };
+    return fromSampling(m, offset, center);
+}
+
+Affine2f Affine2f::fromSampling(const double rotation[6], const cv::Point& offset, const cv::Point& center) {
+    double m11 = rotation[0],
+            m12 = rotation[1],
+            m13 = rotation[2],
+            m21 = rotation[3],
+            m22 = rotation[4],
+            m23 = rotation[5];
+    // ImageSample transforms (p + offset - center), fold everything but p into the translation
+    double dx = offset.x - center.x,
+            dy = offset.y - center.y;
+    return Affine2f{{
+            static_cast<float>(m11), static_cast<float>(m12), static_cast<float>(m11 * dx + m12 * dy + m13),
+            static_cast<float>(m21), static_cast<float>(m22), static_cast<float>(m21 * dx + m22 * dy + m23)
+    }};
+}
+
+void ImageSampleBatch::prepare(size_t sampleLength, size_t count) {
+    length = sampleLength;
+    if (stride != paddedLength<uint8_t>(length)) {
+        // Padding lanes of every row must read as zeros for the dot product
+        stride = paddedLength<uint8_t>(length);
+        arena.clear();
+    }
+    // The arena only grows, so a steady particle count reuses the same memory every frame
+    if (arena.size() < count * stride) {
+        arena.resize(count * stride, 0);
+    }
+    means.resize(count);
+    norms.resize(count);
+}
+
+void ImageSampleBatch::finish(size_t index, const simd::SampleStats& stats) {
+    double mean = static_cast<double>(stats.sum) / static_cast<double>(length);
+    means[index] = mean;
+    norms[index] = std::sqrt(std::max(0.0, static_cast<double>(stats.squaredSum) - length * mean * mean));
+}
+
+void ImageSampleBatch::setPoints(const std::vector<cv::Point>& samplePoints) {
+    xs.resize(length);
+    ys.resize(length);
+    for (size_t i = 0; i < length; i++) {
+        xs[i] = samplePoints[i].x;
+        ys[i] = samplePoints[i].y;
+    }
+}
+
+void ImageSampleBatch::gather(const cv::Mat& map, const std::vector<cv::Point>& samplePoints,
+                              const std::vector<Affine2f>& transforms) {
+    CV_Assert(map.type() == CV_8UC1);
+    size_t count = transforms.size();
+    prepare(samplePoints.size(), count);
+    setPoints(samplePoints);
+
+    simd::ImageView8u view{map.data, map.rows, map.cols, map.step};
+    tbb::parallel_for(size_t(0), count, [&](size_t i) {
+        simd::SampleStats stats;
+        simd::gatherAffine(view, xs.data(), ys.data(), length,
+                           simd::FixedAffine::fromFloat(transforms[i].m), arena.data() + i * stride, stats);
+        finish(i, stats);
+    });
+}
+
+void ImageSampleBatch::gather(const cv::Mat& map, const SamplingPattern& pattern,
+                              const std::vector<cv::Point>& positions) {
+    CV_Assert(map.type() == CV_8UC1);
+    CV_Assert(pattern.step == map.step && pattern.linear.size() == pattern.size());
+    size_t count = positions.size();
+    prepare(pattern.size(), count);
+
+    simd::ImageView8u view{map.data, map.rows, map.cols, map.step};
+    tbb::parallel_for(size_t(0), count, [&](size_t i) {
+        simd::SampleStats stats;
+        const cv::Point& p = positions[i];
+        uint8_t* out = arena.data() + i * stride;
+        if (pattern.fits(p.x, p.y, map.cols, map.rows)) {
+            auto origin = static_cast<std::ptrdiff_t>(p.y) * static_cast<std::ptrdiff_t>(map.step) + p.x;
+            simd::gatherOffsets(view, origin, pattern.linear.data(), length, out, stats);
+        } else {
+            simd::gatherTranslated(view, p.x, p.y, pattern.dx.data(), pattern.dy.data(), length, out, stats);
+        }
+        finish(i, stats);
+    });
+}
+
+void ImageSampleBatch::gather(const TiledImage& map, const std::vector<cv::Point>& samplePoints,
+                              const std::vector<Affine2f>& transforms) {
+    size_t count = transforms.size();
+    prepare(samplePoints.size(), count);
+    setPoints(samplePoints);
+
+    simd::TiledView8u view = map.view();
+    tbb::parallel_for(size_t(0), count, [&](size_t i) {
+        simd::SampleStats stats;
+        simd::gatherAffine(view, xs.data(), ys.data(), length,
+                           simd::FixedAffine::fromFloat(transforms[i].m), arena.data() + i * stride, stats);
+        finish(i, stats);
+    });
+}
+
+void ImageSampleBatch::gather(const TiledImage& map, const SamplingPattern& pattern,
+                              const std::vector<cv::Point>& positions) {
+    size_t count = positions.size();
+    prepare(pattern.size(), count);
+
+    simd::TiledView8u view = map.view();
+    tbb::parallel_for(size_t(0), count, [&](size_t i) {
+        simd::SampleStats stats;
+        const cv::Point& p = positions[i];
+        // Tiles have no linear offsets, every point goes through the tile table
+        simd::gatherTranslated(view, p.x, p.y, pattern.dx.data(), pattern.dy.data(), length,
+                               arena.data() + i * stride, stats);
+        finish(i, stats);
+    });
+}
+
+double ImageSampleBatch::similarity(const ImageSample& templ, size_t index) const {
+    // The template sample is t = u - a for raw pixels u, so
+    // sum(t * (m - mean)) = sum(u * m) - a * sum(m) - mean * sum(t)
+    auto cross = static_cast<double>(simd::dotProductU8(templ.pixels.data(), sample(index),
+                                                        std::min(templ.pixels.size(), stride)));
+    double top = cross - templ.average * means[index] * static_cast<double>(length) - means[index] * templ.sum;
+    double res = top / (templ.standard_deviation * norms[index]);
+    return std::clamp(res, -1.0, 1.0);
+}
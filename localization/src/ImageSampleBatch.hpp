@@ -0,0 +1,85 @@
+//
+// Samples the map for a whole set of particles in one pass.
+//
+
+#pragma once
+
+#include <vector>
+#include <opencv2/core/mat.hpp>
+#include <opencv2/core/types.hpp>
+
+#include "AlignedBuffer.hpp"
+#include "SampleKernels.hpp"
+#include "ImageSample.hpp"
+#include "SamplingPatternCache.hpp"
+#include "TiledImage.hpp"
+
+/**
+ * Affine transformation applied directly to template sampling points,
+ * stored row-major as [m11 m12 m13 m21 m22 m23].
+ */
+struct Affine2f {
+    float m[6];
+
+    /**
+     * Folds the per-particle offset and the template center fix used by
+     * ImageSample into a single transformation of the raw sampling points.
+     */
+    static Affine2f fromSampling(const cv::Mat& rotation, const cv::Point& offset, const cv::Point& center);
+
+    static Affine2f fromSampling(const double rotation[6], const cv::Point& offset, const cv::Point& center);
+};
+
+class ImageSampleBatch {
+public:
+    /**
+     * Samples map at samplePoints under each of the given transformations.
+     * Samples of all transformations end up in one contiguous arena; the mean
+     * and the norm of each sample are reduced while gathering.
+     */
+    void gather(const cv::Mat& map, const std::vector<cv::Point>& samplePoints,
+                const std::vector<Affine2f>& transforms);
+
+    /**
+     * Samples map at a pre-rotated pattern placed at each of the given positions.
+     * Positions whose pattern lies fully inside the map are read straight through
+     * the linear offsets, the rest are clamped to the border.
+     */
+    void gather(const cv::Mat& map, const SamplingPattern& pattern, const std::vector<cv::Point>& positions);
+
+    /**
+     * Same as the cv::Mat versions for a map stored in tiles.
+     */
+    void gather(const TiledImage& map, const std::vector<cv::Point>& samplePoints,
+                const std::vector<Affine2f>& transforms);
+
+    void gather(const TiledImage& map, const SamplingPattern& pattern, const std::vector<cv::Point>& positions);
+
+    /**
+     * Normalized cross-correlation between a template sample and the
+     * index-th map sample. The cross product of the raw pixels is summed
+     * exactly in integers; both means are applied algebraically afterwards.
+     */
+    double similarity(const ImageSample& templ, size_t index) const;
+
+    size_t size() const { return means.size(); }
+
+    const uint8_t* sample(size_t index) const { return arena.data() + index * stride; }
+
+private:
+    void setPoints(const std::vector<cv::Point>& samplePoints);
+
+    void prepare(size_t sampleLength, size_t count);
+
+    void finish(size_t index, const simd::SampleStats& stats);
+
+    // Raw pixel values, one zero padded row of `stride` bytes per transformation
+    AlignedVector<uint8_t> arena;
+    size_t stride = 0;
+    size_t length = 0;
+    std::vector<double> means;
+    std::vector<double> norms;
+
+    // Sampling points split into separate coordinate arrays for the vector kernel
+    std::vector<int32_t> xs, ys;
+};
@@ -0,0 +1,104 @@
+//
+// Bookkeeping for KLD-sampling: the set of occupied spatial bins and the
+// sample count bound as a function of the number of occupied bins.
+//
+
+#include "KldSampling.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// splitmix64 finalizer, spreads neighbouring bins over the table
+inline uint64_t mix(uint64_t key) {
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+size_t nextPowerOfTwo(size_t n) {
+    size_t p = 16;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+}
+
+KldBinSet::KldBinSet(size_t expectedBins) {
+    // Keep the load factor at or below 1/2
+    size_t slots = nextPowerOfTwo(expectedBins * 2);
+    keys.assign(slots, 0);
+    generations.assign(slots, 0);
+    mask = slots - 1;
+}
+
+bool KldBinSet::insert(uint64_t key) {
+    size_t slot = mix(key) & mask;
+    while (generations[slot] == generation) {
+        if (keys[slot] == key) {
+            return false;
+        }
+        slot = (slot + 1) & mask;
+    }
+    keys[slot] = key;
+    generations[slot] = generation;
+    count++;
+    if (count * 2 > keys.size()) {
+        grow();
+    }
+    return true;
+}
+
+void KldBinSet::clear() {
+    count = 0;
+    if (++generation == 0) {
+        // Generation counter wrapped, stale slots could look occupied again
+        std::fill(generations.begin(), generations.end(), 0);
+        generation = 1;
+    }
+}
+
+void KldBinSet::grow() {
+    std::vector<uint64_t> oldKeys;
+    std::vector<uint32_t> oldGenerations;
+    oldKeys.swap(keys);
+    oldGenerations.swap(generations);
+
+    keys.assign(oldKeys.size() * 2, 0);
+    generations.assign(oldKeys.size() * 2, 0);
+    mask = keys.size() - 1;
+    for (size_t i = 0; i < oldKeys.size(); i++) {
+        if (oldGenerations[i] != generation) {
+            continue;
+        }
+        size_t slot = mix(oldKeys[i]) & mask;
+        while (generations[slot] == generation) {
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = oldKeys[i];
+        generations[slot] = generation;
+    }
+}
+
+KldBoundTable::KldBoundTable(float kldError, float zvalue, size_t initialSupport)
+        : kldError(kldError), zvalue(zvalue) {
+    extend(initialSupport);
+}
+
+void KldBoundTable::extend(size_t support) {
+    size_t first = bounds.size();
+    bounds.resize(std::max(support + 1, bounds.size() * 2));
+    for (size_t i = first; i < bounds.size(); i++) {
+        if (i < 2) {
+            // A single bin does not constrain the sample count
+            bounds[i] = 0;
+            continue;
+        }
+        int k = static_cast<int>(i) - 1;
+        bounds[i] = static_cast<int>(ceil(k / (2 * kldError) * pow(1 - 2 / (9.0 * k) + sqrt(2 / (9.0 * k)) * zvalue, 3)));
+    }
+}
@@ -0,0 +1,74 @@
+//
+// Bookkeeping for KLD-sampling: the set of occupied spatial bins and the
+// sample count bound as a function of the number of occupied bins.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Open-addressing hash set of packed bin keys. Clearing is O(1): every slot
+ * carries the generation it was written in and slots of older generations
+ * count as empty. Storage is only reallocated when a frame occupies more bins
+ * than any frame before it.
+ */
+class KldBinSet {
+public:
+    explicit KldBinSet(size_t expectedBins = 256);
+
+    /**
+     * Packs signed bin indices into a single key.
+     */
+    static uint64_t key(int32_t binX, int32_t binY) {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(binX)) << 32) | static_cast<uint32_t>(binY);
+    }
+
+    /**
+     * Inserts the key; returns true if the bin was not occupied yet.
+     */
+    bool insert(uint64_t key);
+
+    void clear();
+
+    size_t size() const { return count; }
+
+    size_t capacity() const { return keys.size(); }
+
+private:
+    void grow();
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> generations;
+    uint32_t generation = 1;
+    size_t count = 0;
+    size_t mask = 0;
+};
+
+/**
+ * Number of particles KLD-sampling asks for once `support` bins are occupied
+ * (Fox, 2003). Values are cached by support count so the sampling loop does a
+ * table lookup instead of evaluating pow/sqrt per new bin.
+ */
+class KldBoundTable {
+public:
+    KldBoundTable() = default;
+
+    KldBoundTable(float kldError, float zvalue, size_t initialSupport = 1024);
+
+    int operator()(size_t support) {
+        if (support >= bounds.size()) {
+            extend(support);
+        }
+        return bounds[support];
+    }
+
+private:
+    void extend(size_t support);
+
+    float kldError = 0.5f;
+    float zvalue = 0.f;
+    std::vector<int> bounds;
+};
@@ -0,0 +1,162 @@
+//
+// Affine search configurations stored column by column.
+//
+
+#include "MatchConfigBatch.hpp"
+
+namespace fast_match {
+
+namespace {
+template<typename Fn>
+void forEachColumn(MatchConfigBatch& batch, Fn&& fn) {
+    fn(batch.translateX);
+    fn(batch.translateY);
+    fn(batch.rotate2);
+    fn(batch.scaleX);
+    fn(batch.scaleY);
+    fn(batch.rotate1);
+    fn(batch.a11);
+    fn(batch.a12);
+    fn(batch.a21);
+    fn(batch.a22);
+}
+} // namespace
+
+void MatchConfigBatch::clear() {
+    forEachColumn(*this, [](std::vector<float>& column) { column.clear(); });
+}
+
+void MatchConfigBatch::reserve(size_t count) {
+    forEachColumn(*this, [count](std::vector<float>& column) { column.reserve(count); });
+}
+
+void MatchConfigBatch::resize(size_t count) {
+    forEachColumn(*this, [count](std::vector<float>& column) { column.resize(count); });
+}
+
+void MatchConfigBatch::set(size_t index, float trans_x, float trans_y, float rotate_2, float scale_x,
+                           float scale_y, float rotate_1) {
+    float m[6];
+    MatchConfig::computeAffine(trans_x, trans_y, rotate_2, scale_x, scale_y, rotate_1, m);
+    translateX[index] = trans_x;
+    translateY[index] = trans_y;
+    rotate2[index] = rotate_2;
+    scaleX[index] = scale_x;
+    scaleY[index] = scale_y;
+    rotate1[index] = rotate_1;
+    a11[index] = m[0];
+    a12[index] = m[1];
+    a21[index] = m[3];
+    a22[index] = m[4];
+}
+
+void MatchConfigBatch::push(const MatchConfig& config) {
+    const float* m = config.getAffine();
+    translateX.push_back(config.getTranslateX());
+    translateY.push_back(config.getTranslateY());
+    rotate2.push_back(config.getRotate2());
+    scaleX.push_back(config.getScaleX());
+    scaleY.push_back(config.getScaleY());
+    rotate1.push_back(config.getRotate1());
+    a11.push_back(m[0]);
+    a12.push_back(m[1]);
+    a21.push_back(m[3]);
+    a22.push_back(m[4]);
+}
+
+void MatchConfigBatch::pushFrom(const MatchConfigBatch& other, size_t index) {
+    translateX.push_back(other.translateX[index]);
+    translateY.push_back(other.translateY[index]);
+    rotate2.push_back(other.rotate2[index]);
+    scaleX.push_back(other.scaleX[index]);
+    scaleY.push_back(other.scaleY[index]);
+    rotate1.push_back(other.rotate1[index]);
+    a11.push_back(other.a11[index]);
+    a12.push_back(other.a12[index]);
+    a21.push_back(other.a21[index]);
+    a22.push_back(other.a22[index]);
+}
+
+void MatchConfigBatch::append(const MatchConfigBatch& other) {
+    auto append = [](std::vector<float>& to, const std::vector<float>& from) {
+        to.insert(to.end(), from.begin(), from.end());
+    };
+    append(translateX, other.translateX);
+    append(translateY, other.translateY);
+    append(rotate2, other.rotate2);
+    append(scaleX, other.scaleX);
+    append(scaleY, other.scaleY);
+    append(rotate1, other.rotate1);
+    append(a11, other.a11);
+    append(a12, other.a12);
+    append(a21, other.a21);
+    append(a22, other.a22);
+}
+
+MatchConfig MatchConfigBatch::get(size_t index) const {
+    return MatchConfig(translateX[index], translateY[index], rotate2[index], scaleX[index], scaleY[index],
+                       rotate1[index]);
+}
+
+void MatchConfigBatch::affine(size_t index, float out[6]) const {
+    out[0] = a11[index];
+    out[1] = a12[index];
+    out[2] = translateX[index];
+    out[3] = a21[index];
+    out[4] = a22[index];
+    out[5] = translateY[index];
+}
+
+size_t MatchConfigBatch::compact(const std::vector<uint8_t>& keep) {
+    // The configs up to the first dropped one stay where they are
+    size_t first = 0;
+    while (first < keep.size() && keep[first]) {
+        first++;
+    }
+    size_t kept = first;
+    /* One column at a time, each one streamed once; every entry is copied
+     * and the write position only advances past the kept ones, so there is
+     * no branch to mispredict on a mask that keeps about half */
+    forEachColumn(*this, [&keep, first, &kept](std::vector<float>& column) {
+        size_t to = first;
+        for (size_t i = first; i < keep.size(); i++) {
+            column[to] = column[i];
+            to += keep[i] != 0;
+        }
+        kept = to;
+    });
+    resize(kept);
+    return kept;
+}
+
+void MatchConfigBatch::swap(MatchConfigBatch& other) {
+    translateX.swap(other.translateX);
+    translateY.swap(other.translateY);
+    rotate2.swap(other.rotate2);
+    scaleX.swap(other.scaleX);
+    scaleY.swap(other.scaleY);
+    rotate1.swap(other.rotate1);
+    a11.swap(other.a11);
+    a12.swap(other.a12);
+    a21.swap(other.a21);
+    a22.swap(other.a22);
+}
+
+MatchConfigBatch MatchConfigBatch::fromConfigs(const std::vector<MatchConfig>& configs) {
+    MatchConfigBatch batch;
+    batch.reserve(configs.size());
+    for (const auto& config : configs) {
+        batch.push(config);
+    }
+    return batch;
+}
+
+std::vector<MatchConfig> MatchConfigBatch::toConfigs() const {
+    std::vector<MatchConfig> configs(size());
+    for (size_t i = 0; i < size(); i++) {
+        configs[i] = get(i);
+    }
+    return configs;
+}
+
+}
@@ -0,0 +1,91 @@
+//
+// Affine search configurations stored column by column.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <FAsT-Match/MatchConfig.h>
+
+namespace fast_match {
+
+/**
+ * Configurations of one FAsT-Match level stored column by column: the six
+ * parameters and the linear part of the affine matrix each have their own
+ * array, the translation column doubles as the last column of the matrix.
+ * Generating the grid, the bounds check and the evaluation stream through
+ * these arrays, 40 bytes per configuration with no allocation per entry.
+ * Particle ids and probabilities are not kept; get() returns configs
+ * without them.
+ */
+struct MatchConfigBatch {
+    std::vector<float> translateX;
+    std::vector<float> translateY;
+    std::vector<float> rotate2;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> rotate1;
+    // Linear part of the affine matrix [a11 a12 tx; a21 a22 ty]
+    std::vector<float> a11;
+    std::vector<float> a12;
+    std::vector<float> a21;
+    std::vector<float> a22;
+
+    size_t size() const { return translateX.size(); }
+
+    bool empty() const { return translateX.empty(); }
+
+    /**
+     * Empties every column, keeping the capacity.
+     */
+    void clear();
+
+    void reserve(size_t count);
+
+    void resize(size_t count);
+
+    /**
+     * Sets config `index` and its affine matrix, as MatchConfig::init does.
+     */
+    void set(size_t index, float trans_x, float trans_y, float rotate_2, float scale_x, float scale_y,
+             float rotate_1);
+
+    void push(const MatchConfig& config);
+
+    /**
+     * Appends a copy of config `index` of `other`.
+     */
+    void pushFrom(const MatchConfigBatch& other, size_t index);
+
+    /**
+     * Appends every config of `other`.
+     */
+    void append(const MatchConfigBatch& other);
+
+    /**
+     * Config `index` as a standalone value.
+     */
+    MatchConfig get(size_t index) const;
+
+    /**
+     * Affine matrix of config `index`, row-major as MatchConfig::getAffine.
+     */
+    void affine(size_t index, float out[6]) const;
+
+    /**
+     * Keeps the configs whose flag in `keep` is non-zero, in their order.
+     * Returns the number kept.
+     */
+    size_t compact(const std::vector<uint8_t>& keep);
+
+    void swap(MatchConfigBatch& other);
+
+    static MatchConfigBatch fromConfigs(const std::vector<MatchConfig>& configs);
+
+    std::vector<MatchConfig> toConfigs() const;
+};
+
+}
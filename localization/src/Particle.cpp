@@ -7,6 +7,11 @@
 #include "Particle.hpp"
 #include "GeometryUtils.hpp"
 
+#include <algorithm>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<Particle>::value, "resampling copies particles as raw memory");
+
 // Default image center used for coordinate transformations
 static constexpr int kDefaultHalfWidth = 320;
 static constexpr int kDefaultHalfHeight = 240;
@@ -18,61 +23,62 @@ float Particle::getProbability() const {
     return probability;
 }
 
-void Particle::setProbability(float probability) {
-    accumulatedProbability += probability;
-    oldProbabilities.push_back(probability);
-    if (oldProbabilities.size() >= 5) {
-        accumulatedProbability -= oldProbabilities[0];
-        oldProbabilities.erase(oldProbabilities.begin());
+float ProbabilityHistory::push(float probability) {
+    sum += probability;
+    if (count >= window) {
+        sum -= values[head];
     } else {
-        iteration++;
+        count++;
     }
-    Particle::probability = accumulatedProbability / iteration;
+    values[head] = probability;
+    head = head + 1 == window ? 0 : head + 1;
+    return sum / count;
+}
+
+void ProbabilityHistory::restart(uint32_t window, float current) {
+    this->window = std::min(std::max(window, 1u), kCapacity);
+    if (count == 0) {
+        head = 0;
+        return;
+    }
+    values[0] = current;
+    sum = current;
+    count = 1;
+    head = this->window > 1 ? 1 : 0;
+}
+
+void Particle::setProbability(float probability) {
+    Particle::probability = history.push(probability);
+}
+
+uint32_t Particle::getProbabilityWindow() const {
+    return history.window;
+}
+
+void Particle::setProbabilityWindow(uint32_t window) {
+    history.restart(window, probability);
 }
 
 Particle::Particle(int x, int y, const std::shared_ptr<ParticleConfig>& config)
-    : config(config), x(x), y(y), probability(1.0) {
-    updateConfigs();
+    : Particle(x, y, config.get()) {
 }
 
-const std::vector<fast_match::MatchConfig> &Particle::getConfigs(int id) {
-    for (auto &cfg : configs) {
-        cfg.setId(id);
+Particle::Particle(int x, int y, const ParticleConfig* config)
+    : config(config), probability(1.0), x(x), y(y) {
+    if (config) {
+        setProbabilityWindow(config->probabilityWindow);
     }
-    return configs;
 }
 
 void Particle::propagate(const cv::Point2f &movement) {
-
-    cv::Point2f m = movement;
-    float alpha = 4.0f;
-    float min_movement = 10.0f;
-    float min_noise_level = 5.0f;
-    // This is the case when the odometry is lost
-    if (movement.x == 0.f && movement.y == 0.f) {
-        m.x = static_cast<float>(Utilities::gausian_noise(1) * min_movement * alpha);
-        m.y = static_cast<float>(Utilities::gausian_noise(1) * min_movement * alpha);
-    } else {
-        // Do not trust in noise level measurements
-        if (movement.x < min_noise_level) {
-            m.x += Utilities::gausian_noise(alpha) * min_noise_level;
-        } else {
-            m.x += Utilities::gausian_noise(alpha) * m.x;
-        }
-        if (movement.y < min_noise_level) {
-            m.y += Utilities::gausian_noise(alpha) * min_noise_level;
-        } else {
-            m.y += Utilities::gausian_noise(alpha) * m.y;
-        }
-    }
+    cv::Point2f m = noisyMovement(movement, [] { return static_cast<float>(Utilities::gausian_noise(1)); });
     x += m.x;
     y += m.y;
-    updateConfigs();
 }
 
-void Particle::updateConfigs() {
-    configs.clear();
-    auto scale_steps = static_cast<int>(s_initial->size());
+std::vector<fast_match::MatchConfig> Particle::getConfigs(int id) const {
+    std::vector<fast_match::MatchConfig> configs;
+    auto scale_steps = static_cast<int>(config->scales.size());
     auto rotation_steps = static_cast<int>(config->r_initial.size());
 
     std::vector<float> r2_rotations = {
@@ -87,6 +93,7 @@ void Particle::updateConfigs() {
         rotation += config->direction;
     }
 
+    configs.reserve(static_cast<size_t>(scale_steps * scale_steps * rotation_steps) * nr2_steps);
     for (size_t sx = 0; sx < static_cast<size_t>(scale_steps); sx++) {
         for (size_t sy = 0; sy < static_cast<size_t>(scale_steps); sy++) {
             for (int r1 = 0; r1 < rotation_steps; r1++) {
@@ -95,30 +102,38 @@ void Particle::updateConfigs() {
                             x - config->mapCenter.x,
                             y - config->mapCenter.y,
                             r2_rotations[r2],
-                            s_initial->at(sx),
-                            s_initial->at(sy),
+                            config->scales[sx],
+                            config->scales[sy],
                             rotations[r1]
                     );
+                    configs.back().setId(id);
                 }
             }
         }
     }
+    return configs;
 }
 
 double Particle::evaluate(cv::Mat &image, cv::Mat &templ, cv::Mat &xs, cv::Mat &ys) {
-    std::vector<cv::Mat> affines = getAffines(image.size(), templ.size());
-    /* For the configs, calculate the scores / distances */
-    std::vector<double> distances = fast_match::FAsTMatch::evaluateConfigs(image, templ, affines, xs, ys, true);
+    std::vector<fast_match::MatchConfig> configs = getConfigs(0);
+    std::vector<cv::Mat> affines = getAffines(configs, image.size(), templ.size());
+    /* For the configs, calculate the scores / distances; only the smallest one has to be exact */
+    std::vector<double> distances = fast_match::FAsTMatch::evaluateConfigs(image, templ, affines, xs, ys, true, 0.0);
     /* Find the minimum distance */
     auto min_itr = min_element(distances.begin(), distances.end());
     int min_index = static_cast<int>(min_itr - distances.begin());
     double best_distance = distances[min_index];
-    bestTransform = configs[min_index].getAffineMatrix();
+    cv::Mat best = configs[min_index].getAffineMatrix();
+    for (int i = 0; i < 6; i++) {
+        bestTransform[i] = best.at<float>(i / 3, i % 3);
+    }
+    hasBestTransform = true;
     setProbability(static_cast<float>(best_distance));
     return best_distance;
 }
 
-std::vector<cv::Mat> Particle::getAffines(const cv::Size &imageSize, const cv::Size &templSize) {
+std::vector<cv::Mat> Particle::getAffines(std::vector<fast_match::MatchConfig> &configs,
+                                          const cv::Size &imageSize, const cv::Size &templSize) const {
     std::vector<bool> insiders;
     std::vector<cv::Mat> affines = Utilities::configsToAffine(configs, insiders, imageSize, templSize);
 
@@ -132,8 +147,11 @@ std::vector<cv::Mat> Particle::getAffines(const cv::Size &imageSize, const cv::S
     return affines;
 }
 
-const cv::Mat &Particle::getBestTransform() const {
-    return bestTransform;
+cv::Mat Particle::getBestTransform() const {
+    if (!hasBestTransform) {
+        return cv::Mat();
+    }
+    return cv::Mat(2, 3, CV_32F, const_cast<float *>(bestTransform)).clone();
 }
 
 void Particle::setMinimalProbability(float probability) {
@@ -172,12 +190,13 @@ void Particle::setWeight(float weight) {
     Particle::weight = weight;
 }
 
-std::string Particle::serialize(int binSize) {
-    return std::to_string(x - (x % binSize)) + "x" + std::to_string(y - (y % binSize));
+std::string Particle::serialize(int binSize) const {
+    cv::Point2i b = bin(binSize);
+    return std::to_string(b.x) + "x" + std::to_string(b.y);
 }
 
-void Particle::setS_initial(const std::shared_ptr<std::vector<float>> &s_initial) {
-    Particle::s_initial = s_initial;
+cv::Point2i Particle::bin(int binSize) const {
+    return {x / binSize, y / binSize};
 }
 
 cv::Point2i Particle::getLocationInMapCoords() const {
@@ -201,12 +220,20 @@ cv::Mat Particle::staticTransformation() const {
     return T;
 }
 
+double Particle::mapRotationDegrees() const {
+    return getDirectionDegrees() - kDirectionOffsetDeg;
+}
+
 cv::Mat Particle::mapTransformation() const {
-    return cv::getRotationMatrix2D(toPoint(), getDirectionDegrees() - kDirectionOffsetDeg, getScale());
+    return cv::getRotationMatrix2D(toPoint(), mapRotationDegrees(), getScale());
+}
+
+void Particle::mapTransformation(double m[6]) const {
+    geometry::rotationMatrix2D(toPoint(), mapRotationDegrees(), getScale(), m);
 }
 
 float Particle::getScale() const {
-    return (*s_initial)[2];
+    return config->scales[2];
 }
 
 float Particle::getCorrelation() const {
@@ -275,8 +302,6 @@ std::vector<cv::Point> Particle::getCorners() const {
     };
 }
 
-Particle::Particle(const Particle &a) = default;
-
 void Particle::setConfig(const std::shared_ptr<ParticleConfig>& cfg) {
-    config = cfg;
+    config = cfg.get();
 }
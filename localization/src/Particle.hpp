@@ -7,24 +7,59 @@
 #include <FAsT-Match/MatchConfig.h>
 #include "ParticleConfig.hpp"
 
+/**
+ * Last `window` probabilities of a particle with their running sum, stored
+ * inline so it can live in a particle or in a column of Particles.
+ */
+struct ProbabilityHistory {
+    // Capacity, the upper bound of ParticleConfig::probabilityWindow
+    static constexpr uint32_t kCapacity = 16;
+
+    // Ring buffer, oldest entry at head once full
+    float values[kCapacity] = {};
+    float sum = 0.f;
+    uint32_t window = ParticleConfig::kDefaultProbabilityWindow;
+    uint32_t head = 0;
+    uint32_t count = 0;
+
+    /**
+     * Adds `probability` and returns the mean of the window.
+     */
+    float push(float probability);
+
+    /**
+     * Sets the window, clamped to [1, kCapacity], and keeps `current` as the
+     * only entry of a non-empty history.
+     */
+    void restart(uint32_t window, float current);
+};
+
+/**
+ * Trivially copyable: the configuration is shared through a plain pointer
+ * and the probability history lives inline, so copying a particle during
+ * resampling is a memcpy. Particles stores the same state column by
+ * column (see ParticleColumns).
+ */
 class Particle {
+    friend struct ParticleColumns;
+
 private:
-    std::shared_ptr<std::vector<float>> s_initial = std::make_shared<std::vector<float>>();
-    std::shared_ptr<ParticleConfig> config;
+    // Owned by the Particles container (or the caller) and outlives the particle
+    const ParticleConfig* config = nullptr;
 
 public:
     double getDirection() const;
-    std::vector<bool> insiders;
+
+    static constexpr uint32_t kMaxProbabilityWindow = ProbabilityHistory::kCapacity;
 
 protected:
-    std::vector<fast_match::MatchConfig> configs;
     float probability;
     float samplingFactor;
-    float accumulatedProbability = 0.f;
-    std::vector<float> oldProbabilities = {};
-    uint32_t iteration = 0;
+    ProbabilityHistory history;
     float weight;
-    cv::Mat bestTransform;
+    // Row-major 2x3 affine of the best config found by evaluate()
+    float bestTransform[6] = {};
+    bool hasBestTransform = false;
     float correlation = -1.0f;
 public:
     float getCorrelation() const;
@@ -32,34 +67,77 @@ public:
     void setCorrelation(float correlation);
 
 protected:
-    std::vector<cv::Mat> getAffines(const cv::Size& imageSize, const cv::Size& templSize);
+    std::vector<cv::Mat> getAffines(std::vector<fast_match::MatchConfig>& configs,
+                                    const cv::Size& imageSize, const cv::Size& templSize) const;
 
 public:
     int x, y;
 
-    const cv::Mat &getBestTransform() const;
-    void setS_initial(const std::shared_ptr<std::vector<float>> &s_initial);
+    /**
+     * 2x3 CV_32F affine of the best config found by evaluate(), empty before.
+     */
+    cv::Mat getBestTransform() const;
     void setConfig(const std::shared_ptr<ParticleConfig>& config);
     double evaluate(cv::Mat& image, cv::Mat& templ, cv::Mat& xs, cv::Mat& ys);
     bool operator<(const Particle& str) const;
     bool operator>(const Particle& str) const;
-    std::string serialize(int binSize);
+    std::string serialize(int binSize) const;
+    /**
+     * Spatial bin of the particle for KLD-sampling.
+     */
+    cv::Point2i bin(int binSize) const;
     float getWeight() const;
     void setWeight(float weight);
     float getSamplingFactor() const;
     void setSamplingFactor(float samplingFactor);
     float getProbability() const;
+    /**
+     * Sets the probability to the mean of the last probabilityWindow values.
+     */
     void setProbability(float probability);
+    uint32_t getProbabilityWindow() const;
+    /**
+     * Restarts the history from the current probability with a window of
+     * `window` values, clamped to [1, kMaxProbabilityWindow].
+     */
+    void setProbabilityWindow(uint32_t window);
     void setMinimalProbability(float probability);
     void setMaximalProbability(float probability);
     Particle(int x, int y, const std::shared_ptr<ParticleConfig>& config);
-    Particle(const Particle& a);
+    Particle(int x, int y, const ParticleConfig* config);
+    Particle(const Particle& a) = default;
     Particle(Particle&& a) noexcept = default;
     Particle& operator=(const Particle& a) = default;
     Particle& operator=(Particle&& a) noexcept = default;
-    const std::vector<fast_match::MatchConfig> & getConfigs(int id);
+    /**
+     * Builds the affine search configurations around the current position.
+     * Configs are not stored in the particle, so only the affine matching
+     * path pays for them.
+     */
+    std::vector<fast_match::MatchConfig> getConfigs(int id) const;
     void propagate(const cv::Point2f& movement);
-    void updateConfigs();
+
+    /**
+     * Movement plus the propagation noise, drawn from `noise()` which returns
+     * Gaussian noise clamped to [-1, 1] (Utilities::gausian_noise(1)).
+     */
+    template<typename Noise>
+    static cv::Point2f noisyMovement(const cv::Point2f& movement, Noise&& noise) {
+        cv::Point2f m = movement;
+        const float alpha = 4.0f;
+        const float min_movement = 10.0f;
+        const float min_noise_level = 5.0f;
+        // This is the case when the odometry is lost
+        if (movement.x == 0.f && movement.y == 0.f) {
+            m.x = noise() * min_movement * alpha;
+            m.y = noise() * min_movement * alpha;
+        } else {
+            // Do not trust in noise level measurements
+            m.x += noise() * alpha * (movement.x < min_noise_level ? min_noise_level : m.x);
+            m.y += noise() * alpha * (movement.y < min_noise_level ? min_noise_level : m.y);
+        }
+        return m;
+    }
     cv::Point2i getLocationInMapCoords() const;
     cv::Point2i toPoint() const;
     cv::Mat staticTransformation() const;
@@ -68,8 +146,18 @@ public:
 
     float getScale() const;
 
+    /**
+     * Rotation in degrees applied by mapTransformation().
+     */
+    double mapRotationDegrees() const;
+
     cv::Mat mapTransformation() const;
 
+    /**
+     * mapTransformation() written into a row-major 2x3 array.
+     */
+    void mapTransformation(double m[6]) const;
+
     cv::Mat getMapImage(const cv::Mat& map, const cv::Size& imsize) const;
 
     std::vector<cv::Point> getCorners() const;
@@ -5,14 +5,21 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <opencv2/core/types.hpp>
 
 struct ParticleConfig {
+    static constexpr uint32_t kDefaultProbabilityWindow = 4;
+
     double direction = 0.0;
     cv::Point2i mapCenter;
     std::vector<float> r_initial;
     float r_step = 0.05f;
+    // Scale steps of the affine search, set by Particles::setScale
+    std::vector<float> scales;
+    // Number of recent probabilities averaged by Particle::setProbability
+    uint32_t probabilityWindow = kDefaultProbabilityWindow;
 
     ParticleConfig() {
         // -5deg ~ +5deg rotation range
@@ -4,19 +4,31 @@
 
 #include "ParticleFastMatch.hpp"
 #include "Utilities.hpp"
+#include "ConfigBounds.hpp"
+#include "ConfigEvaluator.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <utility>
 #include <fstream>
 
 #include <opencv2/features2d.hpp>
 
+#include <tbb/blocked_range.h>
 #include <tbb/task_scheduler_observer.h>
 #include <tbb/parallel_for_each.h>
 #include <tbb/parallel_for.h>
 
 #include "GeometryUtils.hpp"
 
+// Template center used by ImageSample when placing sampling points on the map
+static const cv::Point kSampleCenter(320, 240);
+
+// Margin around the configurations when the float map region is rebuilt
+static const int kFloatRegionMargin = 256;
 
 ParticleFastMatch::ParticleFastMatch(
         const cv::Point2i& startLocation,
@@ -27,8 +39,11 @@ ParticleFastMatch::ParticleFastMatch(
         float quantile_,
         float kld_error_,
         int bin_size_,
-        bool use_gaussian
+        bool use_gaussian,
+        uint64_t seed
 ) {
+    particles.seed(seed);
+    pointNoise.seed(seed, RandomStream::TemplateSampling);
     particles.init(startLocation, mapSize, radius, particleCount, use_gaussian);
     kld_error = kld_error_;
     binSize = bin_size_;
@@ -48,6 +63,7 @@ ParticleFastMatch::ParticleFastMatch(
             break;
         }
     }
+    kldBound = KldBoundTable(kld_error, zvalue);
     switch (matching) {
 
         case PearsonCorrelation:break;
@@ -66,33 +82,32 @@ void ParticleFastMatch::visualizeParticles(cv::Mat image, const cv::Point2i& off
 
 #ifdef USE_CV_GPU
 vector<Point> ParticleFastMatch::filterParticlesAffine(const cv::Point2f &movement, cv::Mat &bestTransform) {
-    int i = 0;
-    Particles newParticles = {};
+    if (original_image.empty()) {
+        throw std::runtime_error("Affine particle matching needs the map before the blur");
+    }
     int     support_particles = 0,
             samplingCount = minParticles;
-    std::vector < std::string > bins;
+    occupiedBins.clear();
     double bestProbability = +INFINITY;
-    std::sort(particles.begin(), particles.end(), std::less<>());
     initTemplatePixels();
+    particles.beginResampling();
     unsigned long particleIndex = 0;
     do {
         // Sample previous particle from previous belief
-        newParticles.addParticle(particles.sample());
+        Particles::View particle = particles.drawSample();
         // Predict next state
-        newParticles[particleIndex].propagate(movement);
+        particle.propagate(movement);
         // Calculate particle belief
 
-        std::string bin = newParticles[particleIndex].serialize(binSize);
+        cv::Point2i bin = particle.bin(binSize);
         particleIndex++;
-        if (std::find(bins.begin(), bins.end(), bin) == bins.end()) {
-            // Mark bin as taken
-            bins.push_back(bin);
+        // Mark bin as taken
+        if (occupiedBins.insert(KldBinSet::key(bin.x, bin.y))) {
             // Update number with support
             support_particles++;
             if (support_particles >= 2) {
                 // update desired number
-                int k = support_particles - 1;
-                k = static_cast<int>(ceil(k / (2 * kld_error) * pow(1 - 2 / (9.0 * k) + sqrt(2 / (9.0 * k)) * zvalue, 3)));
+                int k = kldBound(support_particles);
                 if (k > samplingCount) {
                     samplingCount = k;
                 }
@@ -101,27 +116,28 @@ vector<Point> ParticleFastMatch::filterParticlesAffine(const cv::Point2f &moveme
                 }
             }
         }
-    } while (newParticles.size() < samplingCount);
-    tbb::parallel_for(0, static_cast<int>(newParticles.size()), 1, [&] (int ip) {
+    } while (particleIndex < samplingCount);
+    particles.commitResampling();
+    tbb::parallel_for(0, static_cast<int>(particles.size()), 1, [&] (int ip) {
         double probability;
-        cv::Mat transform = evaluateParticle(newParticles[ip], ip, probability);
+        cv::Mat transform = evaluateParticle(particles[ip], ip, probability);
         if(probability < bestProbability) {
             bestTransform = transform;
             bestProbability = probability;
         }
         cv::Mat bestView = Utilities::extractWarpedMapPart(imageGray, templ.size(), transform);
         //cv::cuda::GpuMat bestView = Utilities::extractWarpedMapPart(imageGrayGpu, templ.size(), transform);
-        calculateSimilarity(bestView, newParticles[ip]);
+        calculateSimilarity(bestView, particles[ip]);
     });
 
-    particles.assign(newParticles.begin(), newParticles.end());
     particles.normalize();
-    return Utilities::calcCorners(image.size(), templ.size(), bestTransform);
+    return Utilities::calcCorners(imageSize, templ.size(), bestTransform);
 }
 #endif
 
 vector<Point> ParticleFastMatch::evaluateParticlesv2() {
-    return particles.evaluate(image, templ, no_of_points);
+    // Rarely used, so the float map is only built for the duration of the call
+    return particles.evaluate(Utilities::preprocessImage(original_image), templ, no_of_points);
 }
 
 void ParticleFastMatch::propagateParticles(const cv::Point2f& movement) {
@@ -129,115 +145,68 @@ void ParticleFastMatch::propagateParticles(const cv::Point2f& movement) {
 
 }
 
+void ParticleFastMatch::setResampling(ResamplingMethod method) {
+    particles.setResampling(method);
+}
+
+void ParticleFastMatch::setResampling(ResamplingMethod method, uint32_t seed) {
+    particles.setResampling(method, seed);
+}
+
+uint64_t ParticleFastMatch::getSeed() const {
+    return particles.getSeed();
+}
+
 void ParticleFastMatch::setDirection(const double &_d) {
     particles.getConfig()->direction = _d;
 }
 
 vector<double>
 ParticleFastMatch::evaluateConfigs(Mat &templ, vector<AffineTransformation> &affine_matrices, Mat &xs, Mat &ys,
-                                   bool photometric_invariance) {
-    int r1x = static_cast<int>(0.5 * (templ.cols - 1)),
-            r1y = static_cast<int>(0.5 * (templ.rows - 1)),
-            r2x = static_cast<int>(0.5 * (image.cols - 1)),
-            r2y = static_cast<int>(0.5 * (image.rows - 1));
-
+                                   bool photometric_invariance, double margin) {
     int no_of_configs = static_cast<int>(affine_matrices.size());
-    int no_of_points = xs.cols;
-
-    /* Create a lookup array for our template values based on the given random x and y points */
-    int *xs_ptr = xs.ptr<int>(0),
-            *ys_ptr = ys.ptr<int>(0);
-
-    vector<float> vals_i1(static_cast<unsigned long>(no_of_points));
-    for (int i = 0; i < no_of_points; i++)
-        vals_i1[i] = templ.at<float>(ys_ptr[i] - 1, xs_ptr[i] - 1);
-
-    /* Recenter our indices */
-    Mat xs_centered = xs.clone() - (r1x + 1),
-            ys_centered = ys.clone() - (r1y + 1);
-
-    int *xs_ptr_cent = xs_centered.ptr<int>(0),
-            *ys_ptr_cent = ys_centered.ptr<int>(0);
-
-    vector<double> distances(static_cast<unsigned long>(no_of_configs), 0.0);
-
-    /* Calculate the score for each configurations on each of our randomly sampled points */
-    tbb::parallel_for(0, no_of_configs, 1, [&](int i) {
-
-        float a11 = affine_matrices[i].T.at<float>(0, 0),
-                a12 = affine_matrices[i].T.at<float>(0, 1),
-                a13 = affine_matrices[i].T.at<float>(0, 2),
-                a21 = affine_matrices[i].T.at<float>(1, 0),
-                a22 = affine_matrices[i].T.at<float>(1, 1),
-                a23 = affine_matrices[i].T.at<float>(1, 2);
-
-        int particleId = affine_matrices[i].id;
-
-        double tmp_1 = (r2x + 1) + a13 + 0.5;
-        double tmp_2 = (r2y + 1) + a23 + 0.5 + 1 * image.rows;
-        double score = 0.0;
-
-        if (!photometric_invariance) {
-            for (int j = 0; j < no_of_points; j++) {
-                int target_x = int(a11 * xs_ptr_cent[j] + a12 * ys_ptr_cent[j] + tmp_1),
-                        target_y = int(a21 * xs_ptr_cent[j] + a22 * ys_ptr_cent[j] + tmp_2);
-
-                //score += abs(vals_i1[j] - paddedCurrentImage.at<float>(target_y - 1, target_x - 1) );
-                if (target_x - 1 >= 0 && target_x - 1 < paddedCurrentImage.size().width)
-                    score += abs(vals_i1[j] - paddedCurrentImage.at<float>(target_y - 1, target_x - 1));
-
-            }
-        } else {
-            vector<double> xs_target(static_cast<unsigned long>(no_of_points)),
-                    ys_target(static_cast<unsigned long>(no_of_points));
-
-            double sum_x = 0.0,
-                    sum_y = 0.0,
-                    sum_x_squared = 0.0,
-                    sum_y_squared = 0.0;
-
-            for (int j = 0; j < no_of_points; j++) {
-                int target_x = int(a11 * xs_ptr_cent[j] + a12 * ys_ptr_cent[j] + tmp_1),
-                        target_y = int(a21 * xs_ptr_cent[j] + a22 * ys_ptr_cent[j] + tmp_2);
-
-                float xi = vals_i1[j],
-                        yi = paddedCurrentImage.at<float>(target_y - 1, target_x - 1);
-
-                xs_target[j] = xi;
-                ys_target[j] = yi;
-
-                sum_x += xi;
-                sum_y += yi;
-
-                sum_x_squared += (xi * xi);
-                sum_y_squared += (yi * yi);
-            }
-
-            double epsilon = 1e-7;
-            double mean_x = sum_x / no_of_points,
-                    mean_y = sum_y / no_of_points,
-                    sigma_x = sqrt((sum_x_squared - (sum_x * sum_x) / no_of_points) / no_of_points) + epsilon,
-                    sigma_y = sqrt((sum_y_squared - (sum_y * sum_y) / no_of_points) / no_of_points) + epsilon;
-
-            double sigma_div = sigma_x / sigma_y;
-            double temp = -mean_x + sigma_div * mean_y;
-
-
-            for (int j = 0; j < no_of_points; j++)
-                score += fabs(xs_target[j] - sigma_div * ys_target[j] + temp);
+    auto affineAt = [&](size_t i, float a[6]) {
+        for (int k = 0; k < 6; k++)
+            a[k] = affine_matrices[i].T.at<float>(k / 3, k % 3);
+    };
+
+    /* Only the part of the map these configurations reach is converted to float;
+     * the corner extremes come from the coefficients, per block in parallel */
+    const ConfigBounds corners(imageSize, templ.size());
+    const size_t block = 256;
+    std::vector<cv::Rect> blockBounds((affine_matrices.size() + block - 1) / block);
+    tbb::parallel_for(size_t(0), blockBounds.size(), [&](size_t b) {
+        cv::Point2f low(std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+        cv::Point2f high(-low.x, -low.y);
+        for (size_t i = b * block, end = std::min(i + block, affine_matrices.size()); i < end; i++) {
+            float a[6];
+            cv::Point2f configLow, configHigh;
+            affineAt(i, a);
+            corners.extent(a, configLow, configHigh);
+            low = cv::Point2f(std::min(low.x, configLow.x), std::min(low.y, configLow.y));
+            high = cv::Point2f(std::max(high.x, configHigh.x), std::max(high.y, configHigh.y));
         }
-
-        distances[i] = score / no_of_points;
+        // Two pixels of slack for the rounding of the sampled positions
+        cv::Point topLeft(static_cast<int>(std::floor(low.x)) - 2, static_cast<int>(std::floor(low.y)) - 2);
+        cv::Point bottomRight(static_cast<int>(std::floor(high.x)) + 2, static_cast<int>(std::floor(high.y)) + 2);
+        blockBounds[b] = cv::Rect(topLeft, bottomRight);
     });
+    cv::Rect bounds;
+    for (const auto& rect : blockBounds) {
+        bounds |= rect;
+    }
+    std::shared_ptr<const FloatMapRegion> region = floatRegionCovering(bounds);
 
-
-    return distances;
-
+    /* Calculate the score for each configurations on each of our randomly sampled points */
+    ConfigEvaluator evaluator(templ, xs, ys, imageSize, photometric_invariance);
+    return evaluator.evaluate(region->view(), region->rect().tl(), no_of_configs, [&](int i, float a[6]) {
+        affineAt(static_cast<size_t>(i), a);
+    }, margin);
 }
 
 vector<AffineTransformation> ParticleFastMatch::configsToAffine(vector<fast_match::MatchConfig> &configs, vector<bool> &insiders) {
-    // Delegate core affine computation to Utilities
-    Utilities::configsToAffine(configs, insiders, image.size(), templ.size());
+    // Only the flags: the matrices are built here, along with the particle ids
+    Utilities::configsInside(configs, insiders, imageSize, templ.size());
 
     // Wrap insider configs into AffineTransformation objects with particle ids
     vector<AffineTransformation> result;
@@ -258,25 +227,40 @@ void ParticleFastMatch::initTemplatePixels() {
     rng.fill(ys, RNG::UNIFORM, 1, templ.rows);
 }
 
-void ParticleFastMatch::initPaddedImage() {
-    /* Use a paddedCurrentImage image, to avoid boundary checking */
-    paddedCurrentImage = cv::Mat(image.rows * 3, image.cols, image.type(), cv::Scalar(0.0));
-    image.copyTo(Mat(paddedCurrentImage, cv::Rect(0, image.rows, image.cols, image.rows)));
+std::shared_ptr<const FloatMapRegion> ParticleFastMatch::floatRegionCovering(const cv::Rect& bounds) {
+    std::lock_guard<std::mutex> lock(floatRegionMutex);
+    cv::Rect needed = bounds & cv::Rect(cv::Point(0, 0), imageSize);
+    if (floatRegion && floatRegion->covers(needed)) {
+        return floatRegion;
+    }
+    // Room for the particles to move before the region is rebuilt
+    cv::Rect grown(needed.x - kFloatRegionMargin, needed.y - kFloatRegionMargin,
+                   needed.width + 2 * kFloatRegionMargin, needed.height + 2 * kFloatRegionMargin);
+    if (floatRegion) {
+        // Other particles of the same frame most likely still read the old region
+        cv::Rect merged = grown | floatRegion->rect();
+        if (static_cast<int64_t>(merged.width) * merged.height <= 4ll * grown.width * grown.height) {
+            grown = merged;
+        }
+    }
+    floatRegion = std::make_shared<const FloatMapRegion>(original_image, grown & cv::Rect(cv::Point(0, 0), imageSize));
+    return floatRegion;
 }
 
-Mat ParticleFastMatch::evaluateParticle(Particle& particle, int id, double &bestProbability) {
+Mat ParticleFastMatch::evaluateParticle(const Particle& particle, int id, double &bestProbability) {
     std::vector<fast_match::MatchConfig> pConfigs = particle.getConfigs(id);
-    vector<AffineTransformation> affines = configsToAffine(pConfigs, particle.insiders);
+    std::vector<bool> insiders;
+    vector<AffineTransformation> affines = configsToAffine(pConfigs, insiders);
     /* Filter out configurations that fall outside of the boundaries */
     /* the internal logic of configsToAffine has more information */
     std::vector<fast_match::MatchConfig> temp_configs;
-    for (size_t i = 0; i < particle.insiders.size(); i++)
-        if (particle.insiders[i])
+    for (size_t i = 0; i < insiders.size(); i++)
+        if (insiders[i])
             temp_configs.push_back(pConfigs[i]);
     pConfigs = temp_configs;
 
-    /* For the configs, calculate the scores / distances */
-    vector<double> pDistances = evaluateConfigs(templ, affines, xs, ys, true);
+    /* For the configs, calculate the scores / distances; only the smallest one has to be exact */
+    vector<double> pDistances = evaluateConfigs(templ, affines, xs, ys, true, 0.0);
 
     auto min_itr = min_element(pDistances.begin(), pDistances.end());
     int min_index = static_cast<int>(min_itr - pDistances.begin());
@@ -304,8 +288,60 @@ void ParticleFastMatch::buildZTable() {
 }
 
 void ParticleFastMatch::setImage(const Mat &image) {
-    fast_match::FAsTMatch::setImage(image);
-    initPaddedImage();
+    // Same gray map as FAsTMatch::setImage, without its full float copy: the
+    // affine search converts only the region it reads (floatRegionCovering)
+    original_image = image;
+    if (image.type() == CV_8UC3) {
+        cv::cvtColor(image, imageGray, cv::COLOR_BGR2GRAY);
+    } else {
+        imageGray = image.clone();
+    }
+    imageGrayAvg = static_cast<float>(cv::mean(imageGray).val[0]);
+    GaussianBlur( imageGray, imageGray, Size( 9, 9 ), 0, 0 );
+#ifdef USE_CV_GPU
+    imageGrayGpu.upload(imageGray);
+#endif
+    mapChanged(Mat());
+}
+
+void ParticleFastMatch::setPreparedImage(const Mat &gray, const Mat &coarse, const Mat &original) {
+    CV_Assert(gray.type() == CV_8UC1);
+    CV_Assert(original.empty() || original.size() == gray.size());
+    original_image = original;
+    imageGray = gray;
+    mapChanged(coarse);
+}
+
+void ParticleFastMatch::mapChanged(const Mat &coarse) {
+    image.release();
+    imageSize = cv::Size(imageGray.cols % 2 == 0 ? imageGray.cols - 1 : imageGray.cols,
+                         imageGray.rows % 2 == 0 ? imageGray.rows - 1 : imageGray.rows);
+    {
+        std::lock_guard<std::mutex> lock(floatRegionMutex);
+        floatRegion.reset();
+    }
+    if (tiledMap) {
+        tiledImage.assign(imageGray);
+    }
+    if (coarseLevel > 0 && !coarse.empty()) {
+        coarseImage = coarse;
+    } else {
+        buildCoarseImage();
+    }
+}
+
+ParticleFastMatch::MapMemoryUsage ParticleFastMatch::mapMemoryUsage() const {
+    MapMemoryUsage usage;
+    usage.gray = imageGray.total() * imageGray.elemSize();
+    usage.tiled = tiledImage.bytes();
+    usage.coarse = coarseImage.total() * coarseImage.elemSize();
+    {
+        std::lock_guard<std::mutex> lock(floatRegionMutex);
+        usage.floatRegion = floatRegion ? floatRegion->bytes() : 0;
+    }
+    // preprocessImage result plus the padded copy with twice its rows of zeros
+    usage.avoided = static_cast<size_t>(imageSize.width) * imageSize.height * sizeof(float) * 4;
+    return usage;
 }
 
 void ParticleFastMatch::setTemplate(const Mat &templ_) {
@@ -322,10 +358,10 @@ void ParticleFastMatch::setTemplate(const Mat &templ_) {
 #endif
         case PearsonCorrelation: {
             if (samplingPoints.empty()) {
-                for (int y_ = 0; y_ < static_cast<int>(templ_.rows * templ_.cols * 0.1f); y_++) {
+                for (int y_ = 0; y_ < static_cast<int>(templ_.rows * templ_.cols * sampleDensity); y_++) {
                     samplingPoints.emplace_back(
-                            static_cast<int>(Utilities::uniform_dist() * templ_.cols),
-                            static_cast<int>(Utilities::uniform_dist() * templ_.rows)
+                            static_cast<int>(pointNoise.unit() * templ_.cols),
+                            static_cast<int>(pointNoise.unit() * templ_.rows)
                     );
                 }
 
@@ -335,6 +371,8 @@ void ParticleFastMatch::setTemplate(const Mat &templ_) {
                 });
             }
             templateSample = ImageSample(FAsTMatch::templGray, samplingPoints, templGrayAvg);
+            patternCache.setPoints(samplingPoints, kSampleCenter);
+            buildCoarseTemplate();
         }
         default: break;
     }
@@ -352,52 +390,200 @@ void ParticleFastMatch::setScale(float min, float max, uint32_t searchSteps) {
     particles.setScale(min, max, searchSteps);
 }
 
-std::vector<cv::Point> ParticleFastMatch::filterParticles(const cv::Point2f &movement, cv::Mat &bestTransform) {
-    Particles newParticles = {};
-    int     support_particles = 0,
-            samplingCount = minParticles;
-    std::vector <std::string> bins;
-    std::sort(particles.begin(), particles.end(), std::less<>());
-    unsigned long particleIndex = 0;
-    do {
-        // Sample previous particle from previous belief
-        newParticles.addParticle(particles.sample());
-        // Predict next state
-        newParticles[particleIndex].propagate(movement);
-        std::string bin = newParticles[particleIndex].serialize(binSize);
-        particleIndex++;
-        if (std::find(bins.begin(), bins.end(), bin) == bins.end()) {
-            // Mark bin as taken
-            bins.push_back(bin);
-            // Update number with support
-            support_particles++;
-            if (support_particles >= 2) {
-                // update desired number
-                int k = support_particles - 1;
-                k = static_cast<int>(ceil(k / (2 * kld_error) * pow(1 - 2 / (9.0 * k) + sqrt(2 / (9.0 * k)) * zvalue, 3)));
-                if (k > samplingCount) {
-                    samplingCount = k;
-                }
-                if (samplingCount < minParticles) {
-                    samplingCount = minParticles;
+void ParticleFastMatch::predictParticles(const cv::Point2f &movement) {
+    using Clock = std::chrono::steady_clock;
+    size_t support = 0,
+            samplingCount = static_cast<size_t>(minParticles);
+    occupiedBins.clear();
+    particles.beginResampling();
+    // KLD-sampling stops at the first draw whose count reaches the bound.
+    // The bound only grows, so a round drawing up to the current bound never
+    // overshoots: the stopping draw is the same as when drawing one by one.
+    size_t drawn = 0;
+    while (drawn < samplingCount) {
+        auto start = Clock::now();
+        size_t first = particles.drawSamples(samplingCount - drawn);
+        size_t last = particles.samples().size();
+        auto drawEnd = Clock::now();
+
+        particles.propagateSamples(first, last - first, movement);
+        drawnBins.resize(last);
+        firstInBlock.resize(last);
+        const ParticleColumns &samples = particles.samples();
+        tbb::parallel_for(tbb::blocked_range<size_t>(first, last, 256), [&](const tbb::blocked_range<size_t>& r) {
+            KldBinSet &local = blockBins.local();
+            local.clear();
+            for (size_t i = r.begin(); i < r.end(); i++) {
+                drawnBins[i] = KldBinSet::key(samples.x[i] / binSize, samples.y[i] / binSize);
+                firstInBlock[i] = local.insert(drawnBins[i]);
+            }
+        });
+        auto propagateEnd = Clock::now();
+
+        // A bin's first draw overall is also the first of its block, so only
+        // those are looked up, in draw order
+        for (size_t i = first; i < last; i++) {
+            if (firstInBlock[i] && occupiedBins.insert(drawnBins[i])) {
+                support++;
+                if (support >= 2) {
+                    samplingCount = std::max(samplingCount, static_cast<size_t>(kldBound(support)));
                 }
             }
         }
-    } while (particleIndex < samplingCount);
+        drawn = last;
+        auto mergeEnd = Clock::now();
+        stageTimings.drawMs += std::chrono::duration<double, std::milli>(drawEnd - start).count();
+        stageTimings.propagateMs += std::chrono::duration<double, std::milli>(propagateEnd - drawEnd).count();
+        stageTimings.kldMergeMs += std::chrono::duration<double, std::milli>(mergeEnd - propagateEnd).count();
+    }
+    particles.commitResampling();
+}
 
-    tbb::parallel_for_each(newParticles.begin(), newParticles.end(), [&] (Particle& particle) {
-        cv::Mat rot_mat = particle.mapTransformation();
-        ImageSample mapSample(imageGray, samplingPoints, rot_mat, particle.toPoint());
-        auto ccoef = static_cast<float>(templateSample.calcSimilarity(mapSample));
-        particle.setCorrelation(ccoef);
-        particle.setProbability(convertProbability(ccoef));
+std::vector<cv::Point> ParticleFastMatch::filterParticles(const cv::Point2f &movement, cv::Mat &bestTransform) {
+    using Clock = std::chrono::steady_clock;
+    predictParticles(movement);
+    auto start = Clock::now();
+    // Direction and scale are normally shared by the whole set, then only the position differs
+    Particles::View first = particles.front();
+    bool sharedPattern = std::all_of(particles.begin(), particles.end(), [&](const Particles::View& p) {
+        return p.mapRotationDegrees() == first.mapRotationDegrees() && p.getScale() == first.getScale();
     });
-    std::sort(particles.begin(), particles.end(), std::less<>());
-    particles.assign(newParticles.begin(), newParticles.end());
+    bool coarseToFine = coarseLevel > 0 && !coarseImage.empty() && particles.size() > coarseSurvivors;
+    if (coarseToFine) {
+        selectCoarseSurvivors(sharedPattern);
+    } else {
+        evaluated.resize(particles.size());
+        std::iota(evaluated.begin(), evaluated.end(), size_t(0));
+    }
+    gatherParticleSamples(0, sharedPattern, evaluated);
+    tbb::parallel_for(size_t(0), evaluated.size(), [&] (size_t i) {
+        auto ccoef = static_cast<float>(mapSamples.similarity(templateSample, i));
+        particles[evaluated[i]].setCorrelation(ccoef);
+        particles[evaluated[i]].setProbability(convertProbability(ccoef));
+    });
+    if (coarseToFine) {
+        // Coarse scores are not comparable with full resolution ones, so a
+        // discarded particle never ranks above a re-scored survivor
+        float lowestSurvivor = 1.0f;
+        for (size_t index : evaluated) {
+            lowestSurvivor = std::min(lowestSurvivor, particles[index].getCorrelation());
+        }
+        for (size_t i = 0; i < particles.size(); i++) {
+            if (!std::isnan(coarseCorrelations[i])) {
+                float ccoef = std::min(coarseCorrelations[i], lowestSurvivor);
+                particles[i].setCorrelation(ccoef);
+                particles[i].setProbability(convertProbability(ccoef));
+            }
+        }
+    }
+    auto evaluateEnd = Clock::now();
     particles.normalize();
+    stageTimings.evaluateMs += std::chrono::duration<double, std::milli>(evaluateEnd - start).count();
+    stageTimings.normalizeMs += std::chrono::duration<double, std::milli>(Clock::now() - evaluateEnd).count();
+    stageTimings.frames++;
+    stageTimings.particles += particles.size();
     return particles.front().getCorners();
 }
 
+double ParticleFastMatch::StageTimings::predictSerialFraction() const {
+    double predict = drawMs + propagateMs + kldMergeMs;
+    return predict > 0.0 ? (drawMs + kldMergeMs) / predict : 0.0;
+}
+
+const ParticleFastMatch::StageTimings &ParticleFastMatch::getStageTimings() const {
+    return stageTimings;
+}
+
+void ParticleFastMatch::gatherParticleSamples(int level, bool sharedPattern, const std::vector<size_t>& indices) {
+    const cv::Mat& map = level == 0 ? imageGray : coarseImage;
+    const TiledImage* tiled = level == 0 && tiledMap ? &tiledImage : nullptr;
+    const std::vector<cv::Point>& points = level == 0 ? samplingPoints : coarsePoints;
+    ImageSampleBatch& samples = level == 0 ? mapSamples : coarseSamples;
+    cv::Point center(kSampleCenter.x >> level, kSampleCenter.y >> level);
+    if (sharedPattern) {
+        Particles::View first = particles[indices.front()];
+        mapPositions.clear();
+        for (size_t index : indices) {
+            mapPositions.emplace_back(particles[index].x >> level, particles[index].y >> level);
+        }
+        SamplingPatternCache& cache = level == 0 ? patternCache : coarsePatternCache;
+        const SamplingPattern& pattern = cache.get(first.mapRotationDegrees(), first.getScale(), map.step);
+        if (tiled) {
+            samples.gather(*tiled, pattern, mapPositions);
+        } else {
+            samples.gather(map, pattern, mapPositions);
+        }
+    } else {
+        mapTransforms.clear();
+        for (size_t index : indices) {
+            Particles::View particle = particles[index];
+            cv::Point position(particle.x >> level, particle.y >> level);
+            double rotation[6];
+            geometry::rotationMatrix2D(position, particle.mapRotationDegrees(), particle.getScale(), rotation);
+            mapTransforms.push_back(Affine2f::fromSampling(rotation, position, center));
+        }
+        if (tiled) {
+            samples.gather(*tiled, points, mapTransforms);
+        } else {
+            samples.gather(map, points, mapTransforms);
+        }
+    }
+}
+
+void ParticleFastMatch::selectCoarseSurvivors(bool sharedPattern) {
+    evaluated.resize(particles.size());
+    std::iota(evaluated.begin(), evaluated.end(), size_t(0));
+    gatherParticleSamples(coarseLevel, sharedPattern, evaluated);
+    coarseCorrelations.resize(particles.size());
+    tbb::parallel_for(size_t(0), particles.size(), [&] (size_t i) {
+        coarseCorrelations[i] = static_cast<float>(coarseSamples.similarity(coarseTemplateSample, i));
+    });
+    std::nth_element(evaluated.begin(), evaluated.begin() + coarseSurvivors, evaluated.end(),
+                     [this](size_t a, size_t b) { return coarseCorrelations[a] > coarseCorrelations[b]; });
+    evaluated.resize(coarseSurvivors);
+    // Survivors get their full resolution score, NaN marks them
+    for (size_t index : evaluated) {
+        coarseCorrelations[index] = std::numeric_limits<float>::quiet_NaN();
+    }
+}
+
+void ParticleFastMatch::buildCoarseImage() {
+    coarseImage.release();
+    if (coarseLevel == 0 || imageGray.empty()) {
+        return;
+    }
+    cv::pyrDown(imageGray, coarseImage);
+    for (int level = 1; level < coarseLevel; level++) {
+        cv::pyrDown(coarseImage, coarseImage);
+    }
+}
+
+void ParticleFastMatch::buildCoarseTemplate() {
+    if (coarseLevel == 0 || templGray.empty()) {
+        return;
+    }
+    cv::pyrDown(templGray, coarseTemplate);
+    for (int level = 1; level < coarseLevel; level++) {
+        cv::pyrDown(coarseTemplate, coarseTemplate);
+    }
+    if (coarsePoints.empty()) {
+        // Same density as on the full resolution template
+        auto count = static_cast<int>(coarseTemplate.rows * coarseTemplate.cols * sampleDensity);
+        for (int i = 0; i < count; i++) {
+            coarsePoints.emplace_back(
+                    static_cast<int>(pointNoise.unit() * coarseTemplate.cols),
+                    static_cast<int>(pointNoise.unit() * coarseTemplate.rows)
+            );
+        }
+        std::sort(coarsePoints.begin(), coarsePoints.end(), [] (const cv::Point& a, const cv::Point& b) {
+            return a.y == b.y ? a.x < b.x : a.y < b.y;
+        });
+        coarsePatternCache.setPoints(coarsePoints, cv::Point(kSampleCenter.x >> coarseLevel,
+                                                             kSampleCenter.y >> coarseLevel));
+    }
+    coarseTemplateSample = ImageSample(coarseTemplate, coarsePoints);
+}
+
 cv::Mat ParticleFastMatch::getBestParticleView(cv::Mat map) {
     return particles.front().getMapImage(imageGray, cv::Size(640, 480));
 }
@@ -494,7 +680,7 @@ float ParticleFastMatch::convertProbability(float in) const {
     }
 }
 #ifdef USE_CV_GPU
-void ParticleFastMatch::calculateSimilarity(cv::cuda::GpuMat im, Particle& particle) const {
+void ParticleFastMatch::calculateSimilarity(cv::cuda::GpuMat im, Particles::View particle) const {
     switch (matching) {
         case PearsonCorrelation: {
             float ccoef = Utilities::calculateCorrCoeff(im, templGrayGpu);
@@ -546,10 +732,80 @@ void ParticleFastMatch::setLowBound(float lowBound) {
     ParticleFastMatch::lowBound = lowBound;
 }
 
+bool ParticleFastMatch::isTiledMap() const {
+    return tiledMap;
+}
+
+void ParticleFastMatch::setTiledMap(bool tiled) {
+    tiledMap = tiled;
+    if (!tiledMap) {
+        tiledImage.clear();
+    } else if (!imageGray.empty()) {
+        tiledImage.assign(imageGray);
+    }
+}
+
+int ParticleFastMatch::getCoarseLevel() const {
+    return coarseLevel;
+}
+
+size_t ParticleFastMatch::getCoarseSurvivors() const {
+    return coarseSurvivors;
+}
+
+void ParticleFastMatch::setCoarseToFine(int level, size_t survivors) {
+    if (level < 0 || level > kMaxCoarseLevel) {
+        throw std::invalid_argument("Coarse level must be in [0, " + std::to_string(kMaxCoarseLevel) + "]");
+    }
+    if (survivors == 0) {
+        throw std::invalid_argument("At least one particle has to survive the coarse level");
+    }
+    coarseSurvivors = survivors;
+    if (level != coarseLevel) {
+        coarseLevel = level;
+        coarsePoints.clear();
+        coarseTemplateSample = ImageSample();
+        buildCoarseImage();
+        buildCoarseTemplate();
+    }
+}
+
+uint32_t ParticleFastMatch::getProbabilityWindow() const {
+    return particles.getConfig()->probabilityWindow;
+}
+
+void ParticleFastMatch::setProbabilityWindow(uint32_t window) {
+    if (window == 0 || window > Particle::kMaxProbabilityWindow) {
+        throw std::invalid_argument("Probability window must be in [1, " +
+                                    std::to_string(Particle::kMaxProbabilityWindow) + "]");
+    }
+    particles.setProbabilityWindow(window);
+}
+
+float ParticleFastMatch::getSampleDensity() const {
+    return sampleDensity;
+}
+
+void ParticleFastMatch::setSampleDensity(float density) {
+    if (density != sampleDensity) {
+        sampleDensity = density;
+        samplingPoints.clear();
+        coarsePoints.clear();
+    }
+}
+
 const Particles &ParticleFastMatch::getParticles() const {
     return particles;
 }
 
+const SamplingPatternCache &ParticleFastMatch::getPatternCache() const {
+    return patternCache;
+}
+
+SamplingPatternCache &ParticleFastMatch::getPatternCache() {
+    return patternCache;
+}
+
 std::string ParticleFastMatch::conversionModeString() const {
     switch (conversionMode) {
         case HPRELU: return "HPRELU";
@@ -9,6 +9,15 @@
 #include "AffineTransformation.hpp"
 #include "Utilities.hpp"
 #include "ImageSample.hpp"
+#include "ImageSampleBatch.hpp"
+#include "KldSampling.hpp"
+#include "SamplingPatternCache.hpp"
+#include "FloatMapRegion.hpp"
+
+#include <memory>
+#include <mutex>
+
+#include <tbb/enumerable_thread_specific.h>
 
 class ParticleFastMatch : public fast_match::FAsTMatch {
 public:
@@ -35,7 +44,7 @@ public:
 
     cv::Ptr<cv::cuda::DescriptorMatcher> matcher;
 
-    void calculateSimilarity(cv::cuda::GpuMat im, Particle& particle) const;
+    void calculateSimilarity(cv::cuda::GpuMat im, Particles::View particle) const;
 #endif
 
     std::vector<cv::Point> samplingPoints;
@@ -51,39 +60,174 @@ public:
             float quantile_ = 0.7,
             float kld_error_ = 0.8,
             int bin_size_ = 5,
-            bool use_gaussian = false);
+            bool use_gaussian = false,
+            uint64_t seed = entropySeed());
     void visualizeParticles(cv::Mat image, const cv::Point2i& offset);
 
     vector<Point> filterParticlesAffine(const cv::Point2f &movement, cv::Mat &bestTransform);
 
     vector<Point> filterParticles(const cv::Point2f &movement, cv::Mat &bestTransform);
 
-    cv::Mat evaluateParticle(Particle& particle, int id, double &bestProbability);
+    cv::Mat evaluateParticle(const Particle& particle, int id, double &bestProbability);
 
     void propagateParticles(const cv::Point2f& movement);
 
+    /**
+     * Wall time of the stages of filterParticles, summed over frames. The
+     * resampler picks inside `draw` and the KLD merge run serially, the rest
+     * in parallel.
+     */
+    struct StageTimings {
+        size_t frames = 0;
+        size_t particles = 0;
+        double drawMs = 0.0;
+        double propagateMs = 0.0;
+        double kldMergeMs = 0.0;
+        double evaluateMs = 0.0;
+        double normalizeMs = 0.0;
+
+        double totalMs() const { return drawMs + propagateMs + kldMergeMs + evaluateMs + normalizeMs; }
+
+        /**
+         * Share of the predict stage (draw, propagate, KLD merge) spent in
+         * its serial parts.
+         */
+        double predictSerialFraction() const;
+    };
+
+    const StageTimings& getStageTimings() const;
+
     void setDirection(const double& _d);
 
+    /**
+     * Resampling method; without a seed the resampler keeps the stream
+     * derived from the filter seed.
+     */
+    void setResampling(ResamplingMethod method);
+
+    void setResampling(ResamplingMethod method, uint32_t seed);
+
+    /**
+     * Seed the particle set and the template sampling points were drawn
+     * from, see Particles::seed.
+     */
+    uint64_t getSeed() const;
+
+    /**
+     * Distances of the affine configurations, see FAsTMatch::evaluateConfigs for `margin`.
+     */
     virtual vector<double> evaluateConfigs( Mat& templ, vector<AffineTransformation>& affine_matrices,
-                                           Mat& xs, Mat& ys, bool photometric_invariance );
+                                           Mat& xs, Mat& ys, bool photometric_invariance,
+                                           double margin = std::numeric_limits<double>::infinity() );
 
 
     void setImage(const Mat &image) override;
 
+    /**
+     * Uses a map that is already converted to gray and blurred as imageGray,
+     * without copying it. Meant for maps paged in on demand or read from a
+     * cache. `coarse` may hold the precomputed coarse-to-fine level,
+     * otherwise it is built here. `original` is the gray map before the blur,
+     * which the affine search samples; without it only the particle sampling
+     * path works on this map.
+     */
+    void setPreparedImage(const Mat &gray, const Mat &coarse = Mat(), const Mat &original = Mat());
+
     float calculateSimilarity(cv::Mat im) const;
 
 protected:
+    /**
+     * Gathers the map samples of the given particles, at full resolution
+     * into mapSamples for level 0, from coarseImage into coarseSamples
+     * otherwise.
+     */
+    void gatherParticleSamples(int level, bool sharedPattern, const std::vector<size_t>& indices);
+
+    /**
+     * Scores all particles at the coarse level and keeps the best
+     * coarseSurvivors of them in `evaluated`.
+     */
+    void selectCoarseSurvivors(bool sharedPattern);
+
+    void buildCoarseImage();
+
+    /**
+     * Float map region containing `bounds`. Safe to call from parallel
+     * evaluateConfigs calls: a region that has to grow is rebuilt as a new
+     * object, callers keep reading the one they got.
+     */
+    std::shared_ptr<const FloatMapRegion> floatRegionCovering(const cv::Rect& bounds);
+
+    /**
+     * Resets everything derived from imageGray after the map changed.
+     */
+    void mapChanged(const Mat& coarse);
+
+    void buildCoarseTemplate();
+
     vector<AffineTransformation> configsToAffine(vector<fast_match::MatchConfig> &configs, vector<bool> &insiders);
 
     Particles particles;
 public:
     const Particles &getParticles() const;
 
+    const SamplingPatternCache &getPatternCache() const;
+
+    SamplingPatternCache &getPatternCache();
+
 protected:
     float kld_error = 0.5f;
     int binSize = 5;
 
-    cv::Mat xs, ys, paddedCurrentImage;
+    cv::Mat xs, ys;
+    // Map size trimmed to odd dimensions like Utilities::makeOdd, the affine
+    // search geometry is relative to its center
+    cv::Size imageSize;
+    // Float map around the particles for the affine search, replaced when
+    // the configurations leave it
+    std::shared_ptr<const FloatMapRegion> floatRegion;
+    mutable std::mutex floatRegionMutex;
+
+    // Map samples of all particles, reused between frames
+    ImageSampleBatch mapSamples;
+    std::vector<Affine2f> mapTransforms;
+    // Rotated sampling points shared by all particles of a frame
+    SamplingPatternCache patternCache;
+    std::vector<cv::Point> mapPositions;
+    // Tiled copy of imageGray, only kept when tiledMap is set
+    bool tiledMap = false;
+    TiledImage tiledImage;
+    // Coarse-to-fine evaluation, disabled while coarseLevel is 0
+    int coarseLevel = 0;
+    size_t coarseSurvivors = 32;
+    // imageGray and templGray reduced coarseLevel times with pyrDown
+    cv::Mat coarseImage, coarseTemplate;
+    std::vector<cv::Point> coarsePoints;
+    // Positions of samplingPoints and coarsePoints
+    ParticleNoise pointNoise;
+    ImageSample coarseTemplateSample;
+    // Coarse samples of all particles; kept apart from mapSamples so neither
+    // batch changes its sample length between frames
+    ImageSampleBatch coarseSamples;
+    SamplingPatternCache coarsePatternCache;
+    // Particles scored at full resolution in the current frame
+    std::vector<size_t> evaluated;
+    std::vector<float> coarseCorrelations;
+    // KLD bins occupied during the current resampling step
+    KldBinSet occupiedBins;
+    KldBoundTable kldBound;
+    // Bins of the particles drawn in a frame, and whether each was the first
+    // of its bin within the block of a thread-local set
+    std::vector<uint64_t> drawnBins;
+    std::vector<uint8_t> firstInBlock;
+    tbb::enumerable_thread_specific<KldBinSet> blockBins;
+    StageTimings stageTimings;
+
+    /**
+     * Resampling and propagation of filterParticles: draws particles in
+     * rounds until the KLD bound is met, see the implementation.
+     */
+    void predictParticles(const cv::Point2f& movement);
 
     int minParticles = 50;
 
@@ -91,11 +235,60 @@ protected:
     std::vector<float> ztable;
 
     float lowBound = 0.00f;
+    float sampleDensity = 0.1f;
 public:
     float getLowBound() const;
 
     void setLowBound(float lowBound);
 
+    bool isTiledMap() const;
+
+    /**
+     * Samples particles from a copy of the map stored in Morton ordered tiles
+     * (see TiledImage) instead of the row-major image.
+     */
+    void setTiledMap(bool tiled);
+
+    int getCoarseLevel() const;
+
+    size_t getCoarseSurvivors() const;
+
+    /**
+     * Scores every particle on level `level` of a Gaussian pyramid of the map
+     * and the template first and re-scores only the `survivors` best ones at
+     * full resolution. Level 0 evaluates every particle at full resolution.
+     */
+    void setCoarseToFine(int level, size_t survivors);
+
+    static constexpr int kMaxCoarseLevel = 4;
+
+    uint32_t getProbabilityWindow() const;
+
+    /**
+     * Number of recent correlations a particle's probability averages, at
+     * most Particle::kMaxProbabilityWindow.
+     */
+    void setProbabilityWindow(uint32_t window);
+
+    struct MapMemoryUsage {
+        size_t gray = 0;
+        size_t tiled = 0;
+        size_t coarse = 0;
+        size_t floatRegion = 0;
+        // Full float map and its padded copy, which are no longer built
+        size_t avoided = 0;
+    };
+
+    MapMemoryUsage mapMemoryUsage() const;
+
+    float getSampleDensity() const;
+
+    /**
+     * Fraction of template pixels used for the correlation. Takes effect on
+     * the next setTemplate call.
+     */
+    void setSampleDensity(float density);
+
 private:
     using fast_match::FAsTMatch::init;
 
@@ -109,8 +302,6 @@ public:
 
     void initTemplatePixels();
 
-    void initPaddedImage();
-
     uint32_t particleCount() const;
 
     cv::Point2i getPredictedLocation() const;
@@ -0,0 +1,183 @@
+//
+// Vectorized kernels over the particle columns of Particles.
+//
+
+#include "ParticleKernels.hpp"
+#include "SampleKernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PARTICLE_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+    namespace {
+        float sumScalar(const float* a, std::size_t n) {
+            float acc[4] = {0.f, 0.f, 0.f, 0.f};
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                acc[0] += a[i];
+                acc[1] += a[i + 1];
+                acc[2] += a[i + 2];
+                acc[3] += a[i + 3];
+            }
+            for (; i < n; i++) {
+                acc[0] += a[i];
+            }
+            return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+        }
+
+        void scaleScalar(const float* a, float factor, std::size_t n, float* out) {
+            for (std::size_t i = 0; i < n; i++) {
+                out[i] = a[i] * factor;
+            }
+        }
+
+        // Sums of w, w * x and w * y
+        void weightedSumsScalar(const int32_t* xs, const int32_t* ys, const float* ws, std::size_t n,
+                                double& w, double& wx, double& wy) {
+            for (std::size_t i = 0; i < n; i++) {
+                w += ws[i];
+                wx += static_cast<double>(ws[i]) * xs[i];
+                wy += static_cast<double>(ws[i]) * ys[i];
+            }
+        }
+
+        // Sums of w * dx^2, w * dx * dy and w * dy^2 around (meanX, meanY)
+        void centeredSumsScalar(const int32_t* xs, const int32_t* ys, const float* ws, std::size_t n,
+                                double meanX, double meanY, double& xx, double& xy, double& yy) {
+            for (std::size_t i = 0; i < n; i++) {
+                double dx = xs[i] - meanX, dy = ys[i] - meanY;
+                xx += ws[i] * dx * dx;
+                xy += ws[i] * dx * dy;
+                yy += ws[i] * dy * dy;
+            }
+        }
+
+#ifdef PARTICLE_KERNELS_X86
+        __attribute__((target("avx2")))
+        double horizontalSum(__m256d v) {
+            alignas(32) double lanes[4];
+            _mm256_store_pd(lanes, v);
+            return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        }
+
+        __attribute__((target("avx2")))
+        float sumAVX2(const float* a, std::size_t n) {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                acc0 = _mm256_add_ps(acc0, _mm256_loadu_ps(a + i));
+                acc1 = _mm256_add_ps(acc1, _mm256_loadu_ps(a + i + 8));
+            }
+            alignas(32) float lanes[8];
+            _mm256_store_ps(lanes, _mm256_add_ps(acc0, acc1));
+            float result = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) +
+                           ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+            return result + sumScalar(a + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void scaleAVX2(const float* a, float factor, std::size_t n, float* out) {
+            __m256 f = _mm256_set1_ps(factor);
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), f));
+            }
+            scaleScalar(a + i, factor, n - i, out + i);
+        }
+
+        __attribute__((target("avx2,fma")))
+        void weightedSumsAVX2(const int32_t* xs, const int32_t* ys, const float* ws, std::size_t n,
+                              double& w, double& wx, double& wy) {
+            __m256d accW = _mm256_setzero_pd(), accX = _mm256_setzero_pd(), accY = _mm256_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m256d wv = _mm256_cvtps_pd(_mm_loadu_ps(ws + i));
+                __m256d xv = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(xs + i)));
+                __m256d yv = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ys + i)));
+                accW = _mm256_add_pd(accW, wv);
+                accX = _mm256_fmadd_pd(wv, xv, accX);
+                accY = _mm256_fmadd_pd(wv, yv, accY);
+            }
+            w += horizontalSum(accW);
+            wx += horizontalSum(accX);
+            wy += horizontalSum(accY);
+            weightedSumsScalar(xs + i, ys + i, ws + i, n - i, w, wx, wy);
+        }
+
+        __attribute__((target("avx2,fma")))
+        void centeredSumsAVX2(const int32_t* xs, const int32_t* ys, const float* ws, std::size_t n,
+                              double meanX, double meanY, double& xx, double& xy, double& yy) {
+            __m256d mx = _mm256_set1_pd(meanX), my = _mm256_set1_pd(meanY);
+            __m256d accXX = _mm256_setzero_pd(), accXY = _mm256_setzero_pd(), accYY = _mm256_setzero_pd();
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m256d wv = _mm256_cvtps_pd(_mm_loadu_ps(ws + i));
+                __m256d dx = _mm256_sub_pd(
+                        _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(xs + i))), mx);
+                __m256d dy = _mm256_sub_pd(
+                        _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ys + i))), my);
+                __m256d wdx = _mm256_mul_pd(wv, dx);
+                accXX = _mm256_fmadd_pd(wdx, dx, accXX);
+                accXY = _mm256_fmadd_pd(wdx, dy, accXY);
+                accYY = _mm256_fmadd_pd(_mm256_mul_pd(wv, dy), dy, accYY);
+            }
+            xx += horizontalSum(accXX);
+            xy += horizontalSum(accXY);
+            yy += horizontalSum(accYY);
+            centeredSumsScalar(xs + i, ys + i, ws + i, n - i, meanX, meanY, xx, xy, yy);
+        }
+#endif
+
+        bool useAVX2() {
+#ifdef PARTICLE_KERNELS_X86
+            return activeLevel() >= Level::AVX2;
+#else
+            return false;
+#endif
+        }
+    }
+
+    float sum(const float* a, std::size_t n) {
+#ifdef PARTICLE_KERNELS_X86
+        if (useAVX2()) return sumAVX2(a, n);
+#endif
+        return sumScalar(a, n);
+    }
+
+    void scale(const float* a, float factor, std::size_t n, float* out) {
+#ifdef PARTICLE_KERNELS_X86
+        if (useAVX2()) return scaleAVX2(a, factor, n, out);
+#endif
+        scaleScalar(a, factor, n, out);
+    }
+
+    WeightedMoments weightedMoments(const int32_t* xs, const int32_t* ys, const float* ws, std::size_t n) {
+        WeightedMoments m;
+        double wx = 0.0, wy = 0.0;
+        // Two passes: the centered sums stay exact for map coordinates far from the origin
+#ifdef PARTICLE_KERNELS_X86
+        if (useAVX2()) {
+            weightedSumsAVX2(xs, ys, ws, n, m.weight, wx, wy);
+        } else
+#endif
+        weightedSumsScalar(xs, ys, ws, n, m.weight, wx, wy);
+        if (m.weight <= 0.0) {
+            return m;
+        }
+        m.meanX = wx / m.weight;
+        m.meanY = wy / m.weight;
+#ifdef PARTICLE_KERNELS_X86
+        if (useAVX2()) {
+            centeredSumsAVX2(xs, ys, ws, n, m.meanX, m.meanY, m.xx, m.xy, m.yy);
+        } else
+#endif
+        centeredSumsScalar(xs, ys, ws, n, m.meanX, m.meanY, m.xx, m.xy, m.yy);
+        m.xx /= m.weight;
+        m.xy /= m.weight;
+        m.yy /= m.weight;
+        return m;
+    }
+}
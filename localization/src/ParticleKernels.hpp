@@ -0,0 +1,38 @@
+//
+// Vectorized kernels over the particle columns of Particles.
+// Dispatch follows simd::activeLevel() (see SampleKernels.hpp).
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simd {
+
+    /**
+     * Sum of a float array, accumulated in several float lanes.
+     */
+    float sum(const float* a, std::size_t n);
+
+    /**
+     * out[i] = a[i] * factor. `out` may alias `a`.
+     */
+    void scale(const float* a, float factor, std::size_t n, float* out);
+
+    /**
+     * Total weight, weighted mean and weighted covariance (centered second
+     * moments divided by the total weight) of the points (xs[i], ys[i]) with
+     * weights ws[i]. The weights need not be normalized.
+     */
+    struct WeightedMoments {
+        double weight = 0.0;
+        double meanX = 0.0;
+        double meanY = 0.0;
+        double xx = 0.0;
+        double xy = 0.0;
+        double yy = 0.0;
+    };
+
+    WeightedMoments weightedMoments(const int32_t* xs, const int32_t* ys, const float* ws, std::size_t n);
+}
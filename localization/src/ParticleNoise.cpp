@@ -0,0 +1,100 @@
+//
+// Batched random numbers for particle propagation.
+//
+
+#include "ParticleNoise.hpp"
+
+#include <cmath>
+
+namespace {
+    constexpr float kTwoPi = 6.28318530717958647692f;
+    // Standard deviation of Utilities::normal_dist, three sigma reach the clamp
+    constexpr float kSigma = 0.33333f;
+
+    // Upper 24 bits give every float in [0, 1) with a 2^-24 step
+    inline float toUnit(uint32_t bits) {
+        return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+    }
+}
+
+ParticleNoise::ParticleNoise(uint64_t seed, uint64_t stream) {
+    ParticleNoise::seed(seed, stream);
+}
+
+void ParticleNoise::seed(uint64_t seed, uint64_t stream) {
+    key[0] = static_cast<uint32_t>(seed);
+    key[1] = static_cast<uint32_t>(seed >> 32);
+    this->stream = stream;
+    counter = 0;
+    normalNext = kBlock;
+    unitNext = kBlock;
+}
+
+void ParticleNoise::nextBits(uint32_t out[4][kLanes]) {
+    // Philox4x32::generate on kLanes counters at once, lane by lane
+    uint32_t *c0 = out[0], *c1 = out[1], *c2 = out[2], *c3 = out[3];
+    for (std::size_t lane = 0; lane < kLanes; lane++) {
+        uint64_t n = counter + lane;
+        c0[lane] = static_cast<uint32_t>(n);
+        c1[lane] = static_cast<uint32_t>(n >> 32);
+        c2[lane] = static_cast<uint32_t>(stream);
+        c3[lane] = static_cast<uint32_t>(stream >> 32);
+    }
+    counter += kLanes;
+    uint32_t k0 = key[0], k1 = key[1];
+    for (int round = 0; round < Philox4x32::kRounds; round++) {
+        for (std::size_t lane = 0; lane < kLanes; lane++) {
+            uint64_t p0 = static_cast<uint64_t>(Philox4x32::kMultiplier0) * c0[lane];
+            uint64_t p1 = static_cast<uint64_t>(Philox4x32::kMultiplier1) * c2[lane];
+            uint32_t x1 = c1[lane], x3 = c3[lane];
+            c0[lane] = static_cast<uint32_t>(p1 >> 32) ^ x1 ^ k0;
+            c1[lane] = static_cast<uint32_t>(p1);
+            c2[lane] = static_cast<uint32_t>(p0 >> 32) ^ x3 ^ k1;
+            c3[lane] = static_cast<uint32_t>(p0);
+        }
+        k0 += Philox4x32::kWeyl0;
+        k1 += Philox4x32::kWeyl1;
+    }
+}
+
+void ParticleNoise::refillNormal() {
+    uint32_t bits[4][kLanes];
+    // Box-Muller, each pair of uniforms gives two normal numbers
+    for (std::size_t i = 0; i < kBlock; i += 4 * kLanes) {
+        nextBits(bits);
+        for (std::size_t pair = 0; pair < 2; pair++) {
+            float *out = normalBlock + i + 2 * pair * kLanes;
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                float u1 = toUnit(bits[2 * pair][lane]), u2 = toUnit(bits[2 * pair + 1][lane]);
+                float r = kSigma * std::sqrt(-2.0f * std::log(1.0f - u1));
+                float a = kTwoPi * u2;
+                out[lane] = r * std::cos(a);
+                out[kLanes + lane] = r * std::sin(a);
+            }
+        }
+    }
+    normalNext = 0;
+}
+
+void IndexedNoise::gaussianPair(uint64_t index, float out[2]) const {
+    uint32_t bits[4] = {static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32),
+                        static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32)};
+    Philox4x32::generate(bits, key);
+    float r = kSigma * std::sqrt(-2.0f * std::log(1.0f - toUnit(bits[0])));
+    float a = kTwoPi * toUnit(bits[1]);
+    out[0] = std::min(1.0f, std::max(-1.0f, r * std::cos(a)));
+    out[1] = std::min(1.0f, std::max(-1.0f, r * std::sin(a)));
+}
+
+void ParticleNoise::refillUnit() {
+    uint32_t bits[4][kLanes];
+    for (std::size_t i = 0; i < kBlock; i += 4 * kLanes) {
+        nextBits(bits);
+        for (std::size_t word = 0; word < 4; word++) {
+            for (std::size_t lane = 0; lane < kLanes; lane++) {
+                unitBlock[i + word * kLanes + lane] = toUnit(bits[word][lane]);
+            }
+        }
+    }
+    unitNext = 0;
+}
@@ -0,0 +1,108 @@
+//
+// Batched random numbers for particle propagation.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "Random.hpp"
+
+/**
+ * Source of the random numbers of a particle set. Numbers are produced a
+ * block at a time from one stream of a Philox4x32 generator: kLanes
+ * consecutive counters are encrypted side by side, so every step of the
+ * refill loop is the same operation on kLanes values and compiles to
+ * vector instructions. The sequence depends only on the seed and the
+ * stream, and everything is stored inline: drawing never touches the heap.
+ */
+class ParticleNoise {
+public:
+    static constexpr std::size_t kLanes = 8;
+    static constexpr std::size_t kBlock = 256;
+    static constexpr uint64_t kDefaultSeed = 0x5eed;
+
+    explicit ParticleNoise(uint64_t seed = kDefaultSeed, uint64_t stream = 0);
+
+    ParticleNoise(uint64_t seed, RandomStream stream) : ParticleNoise(seed, static_cast<uint64_t>(stream)) {}
+
+    /**
+     * Restarts the sequence at the beginning of `stream` of `seed`.
+     */
+    void seed(uint64_t seed, uint64_t stream = 0);
+
+    void seed(uint64_t seed, RandomStream stream) { ParticleNoise::seed(seed, static_cast<uint64_t>(stream)); }
+
+    /**
+     * Normal noise with a standard deviation of 1/3 clamped to [-1, 1], the
+     * distribution of Utilities::gausian_noise(1).
+     */
+    float gaussian() { return std::min(1.0f, std::max(-1.0f, normal())); }
+
+    /**
+     * Normal noise with a standard deviation of 1/3, not clamped.
+     */
+    float normal() {
+        if (normalNext == kBlock) {
+            refillNormal();
+        }
+        return normalBlock[normalNext++];
+    }
+
+    /**
+     * Uniform noise in [-1, 1).
+     */
+    float uniform() { return 2.0f * unit() - 1.0f; }
+
+    /**
+     * Uniform noise in [0, 1).
+     */
+    float unit() {
+        if (unitNext == kBlock) {
+            refillUnit();
+        }
+        return unitBlock[unitNext++];
+    }
+
+private:
+    uint32_t key[2];
+    uint64_t stream;
+    // Next Philox counter of the stream
+    uint64_t counter;
+    float normalBlock[kBlock];
+    float unitBlock[kBlock];
+    std::size_t normalNext = kBlock;
+    std::size_t unitNext = kBlock;
+
+    /**
+     * Random words of the next kLanes counters, out[word][lane].
+     */
+    void nextBits(uint32_t out[4][kLanes]);
+
+    void refillNormal();
+
+    void refillUnit();
+};
+
+/**
+ * Noise addressed by position instead of drawn in sequence: the numbers for
+ * `index` depend only on the seed, the stream and the index, whichever
+ * thread asks and in whatever order. One Philox block per index, meant for
+ * loops that propagate particles in parallel.
+ */
+class IndexedNoise {
+public:
+    IndexedNoise(uint64_t seed, uint64_t stream)
+            : key{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)}, stream(stream) {}
+
+    /**
+     * Two numbers with the distribution of ParticleNoise::gaussian().
+     */
+    void gaussianPair(uint64_t index, float out[2]) const;
+
+private:
+    uint32_t key[2];
+    uint64_t stream;
+};
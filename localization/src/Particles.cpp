@@ -5,19 +5,120 @@
 #include <src/Utilities.hpp>
 #include "Particles.hpp"
 
+#include <numeric>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace {
+    // Particles copied or propagated by one task
+    constexpr size_t kSampleGrain = 256;
+}
+
+void ParticleColumns::clear() {
+    x.clear();
+    y.clear();
+    probability.clear();
+    weight.clear();
+    samplingFactor.clear();
+    correlation.clear();
+    history.clear();
+}
+
+void ParticleColumns::reserve(size_t count) {
+    x.reserve(count);
+    y.reserve(count);
+    probability.reserve(count);
+    weight.reserve(count);
+    samplingFactor.reserve(count);
+    correlation.reserve(count);
+    history.reserve(count);
+}
+
+void ParticleColumns::push(const Particle &particle) {
+    x.push_back(particle.x);
+    y.push_back(particle.y);
+    probability.push_back(particle.probability);
+    weight.push_back(particle.weight);
+    samplingFactor.push_back(particle.samplingFactor);
+    correlation.push_back(particle.correlation);
+    history.push_back(particle.history);
+}
+
+void ParticleColumns::resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    probability.resize(count);
+    weight.resize(count);
+    samplingFactor.resize(count);
+    correlation.resize(count);
+    history.resize(count);
+}
+
+void ParticleColumns::copyFrom(const ParticleColumns &other, size_t from, size_t to) {
+    x[to] = other.x[from];
+    y[to] = other.y[from];
+    probability[to] = other.probability[from];
+    weight[to] = other.weight[from];
+    samplingFactor[to] = other.samplingFactor[from];
+    correlation[to] = other.correlation[from];
+    history[to] = other.history[from];
+}
+
+void ParticleColumns::pushFrom(const ParticleColumns &other, size_t index) {
+    x.push_back(other.x[index]);
+    y.push_back(other.y[index]);
+    probability.push_back(other.probability[index]);
+    weight.push_back(other.weight[index]);
+    samplingFactor.push_back(other.samplingFactor[index]);
+    correlation.push_back(other.correlation[index]);
+    history.push_back(other.history[index]);
+}
+
+void ParticleColumns::swap(ParticleColumns &other) {
+    x.swap(other.x);
+    y.swap(other.y);
+    probability.swap(other.probability);
+    weight.swap(other.weight);
+    samplingFactor.swap(other.samplingFactor);
+    correlation.swap(other.correlation);
+    history.swap(other.history);
+}
+
+Particle ParticleColumns::get(size_t index, const ParticleConfig *config) const {
+    Particle particle(x[index], y[index], config);
+    particle.probability = probability[index];
+    particle.weight = weight[index];
+    particle.samplingFactor = samplingFactor[index];
+    particle.correlation = correlation[index];
+    particle.history = history[index];
+    return particle;
+}
+
+void ParticleColumns::set(size_t index, const Particle &particle) {
+    x[index] = particle.x;
+    y[index] = particle.y;
+    probability[index] = particle.probability;
+    weight[index] = particle.weight;
+    samplingFactor[index] = particle.samplingFactor;
+    correlation[index] = particle.correlation;
+    history[index] = particle.history;
+}
+
 void Particles::init(cv::Point2i startLocation, const cv::Size mapSize,  double radius, int particleCount, bool use_gaussian) {
     double r, a;
     int size = 0;
+    ParticleNoise noise(seed_, RandomStream::Initialization);
     particleConfig->setMapDimensions(mapSize);
     while (size < particleCount) {
         if(use_gaussian) {
-            a = ((Utilities::gausian_noise(1.0f) - 0.5) * 2) * 2 * M_PI;
-            double u = Utilities::gausian_noise(radius) + Utilities::gausian_noise(radius);
+            a = ((noise.gaussian() - 0.5) * 2) * 2 * M_PI;
+            double u = noise.gaussian() * radius + noise.gaussian() * radius;
             r = u > radius ? (2 * radius) - u : u;
         } else {
-            a = ((Utilities::uniform_dist() - 0.5) * 2) * 2 * M_PI;
-            double r1 = Utilities::uniform_dist() * radius,
-                    r2 = Utilities::uniform_dist() * radius;
+            a = ((noise.unit() - 0.5) * 2) * 2 * M_PI;
+            double r1 = noise.unit() * radius,
+                    r2 = noise.unit() * radius;
             double u = r1 + r2;
             r = u > radius ? (2 * radius) - u : u;
         }
@@ -26,7 +127,7 @@ void Particles::init(cv::Point2i startLocation, const cv::Size mapSize,  double
         // Skip duplicate particles
         if(!isLocationOccupied(x, y)) {
             addParticle(x, y);
-            data_.back().setProbability(.5f);
+            back().setProbability(.5f);
             size++;
         }
     }
@@ -34,26 +135,25 @@ void Particles::init(cv::Point2i startLocation, const cv::Size mapSize,  double
 }
 
 void Particles::addParticle(int x, int y) {
-    data_.emplace_back(x, y, particleConfig);
+    data_.push(Particle(x, y, particleConfig.get()));
 }
 
-void Particles::addParticle(Particle p) {
-    data_.emplace_back(std::move(p));
+void Particles::addParticle(const Particle& p) {
+    data_.push(p);
 }
 
 std::vector<fast_match::MatchConfig> Particles::getConfigs() {
     std::vector<fast_match::MatchConfig> configs;
-    int i = 0;
-    for (auto &it : data_) {
-        auto& curConfigs = it.getConfigs(i++);
+    for (size_t i = 0; i < size(); i++) {
+        auto curConfigs = (*this)[i].getConfigs(static_cast<int>(i));
         configs.insert(configs.end(), curConfigs.begin(), curConfigs.end());
     }
     return configs;
 }
 
 bool Particles::isLocationOccupied(int x, int y) {
-    for (const auto& it : data_) {
-        if(it.x == x && it.y == y) {
+    for (size_t i = 0; i < size(); i++) {
+        if(data_.x[i] == x && data_.y[i] == y) {
             return true;
         }
     }
@@ -61,19 +161,15 @@ bool Particles::isLocationOccupied(int x, int y) {
 }
 
 void Particles::propagate(const cv::Point2f &movement, float alpha) {
-    std::uniform_real_distribution<float> dist(-1.f, 1.f);
-    for (auto &it : data_) {
-        it.propagate(cv::Point2f(
-                movement.x * alpha * dist(rng_),
-                movement.y * alpha * dist(rng_)
-        ));
+    for (size_t i = 0; i < size(); i++) {
+        float dx = noise_.uniform(), dy = noise_.uniform();
+        (*this)[i].propagate(cv::Point2f(movement.x * alpha * dx, movement.y * alpha * dy));
     }
 }
 
 void Particles::printProbabilities() {
-    int i = 1;
-    for (const auto& it : data_) {
-        std::cout << "Particle no " << i++ << " probability is: " << it.getProbability() << "\n";
+    for (size_t i = 0; i < size(); i++) {
+        std::cout << "Particle no " << i + 1 << " probability is: " << data_.probability[i] << "\n";
     }
 }
 
@@ -90,70 +186,126 @@ std::vector<cv::Point> Particles::evaluate(cv::Mat image, cv::Mat templ, int no_
 
     double lowestDistance = +INFINITY;
     cv::Mat bestTrasform;
-    for (auto &it : data_) {
-        double distance = it.evaluate(image, templ, xs, ys);
+    for (size_t i = 0; i < size(); i++) {
+        Particle particle = (*this)[i];
+        double distance = particle.evaluate(image, templ, xs, ys);
+        data_.set(i, particle);
         if(distance < lowestDistance) {
             lowestDistance = distance;
-            bestTrasform = it.getBestTransform();
+            bestTrasform = particle.getBestTransform();
         }
     }
     return Utilities::calcCorners(image.size(), templ.size(), bestTrasform);
 }
 
-Particle Particles::sample() {
-    double sampleThreshold = Utilities::uniform_dist();
-    if(sampleThreshold < .5f) {
-        for (const auto &it : data_) {
-            if (it.getSamplingFactor() > sampleThreshold) {
-                return Particle(it);
-            }
+void Particles::beginResampling(size_t expectedCount) {
+    next_.clear();
+    resamplingPass_++;
+    // The weight column is the resampler's input as it is
+    resampler_.reset(data_.weight.data(), data_.size(), expectedCount > 0 ? expectedCount : data_.size());
+}
+
+Particles::View Particles::drawSample() {
+    next_.pushFrom(data_, resampler_.next());
+    return View(next_, next_.size() - 1, particleConfig.get(), &noise_);
+}
+
+size_t Particles::drawSamples(size_t count) {
+    size_t first = next_.size();
+    picks_.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        picks_[i] = resampler_.next();
+    }
+    next_.resize(first + count);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, count, kSampleGrain), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); i++) {
+            next_.copyFrom(data_, picks_[i], first + i);
         }
-    } else {
-        for (auto i = data_.rbegin(); i != data_.rend(); ++i ) {
-            if (i->getSamplingFactor() < sampleThreshold) {
-                return Particle(*i);
-            }
+    });
+    return first;
+}
+
+void Particles::propagateSamples(size_t first, size_t count, const cv::Point2f &movement) {
+    IndexedNoise noise(seed_, subStream(RandomStream::Propagation, resamplingPass_));
+    tbb::parallel_for(tbb::blocked_range<size_t>(first, first + count, kSampleGrain),
+                      [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i < r.end(); i++) {
+            float pair[2];
+            noise.gaussianPair(i, pair);
+            int used = 0;
+            cv::Point2f m = Particle::noisyMovement(movement, [&] { return pair[used++]; });
+            next_.x[i] += m.x;
+            next_.y[i] += m.y;
         }
-    }
-    // Fallback: return last particle if no threshold matched
-    return Particle(data_.back());
+    });
+}
+
+void Particles::commitResampling() {
+    data_.swap(next_);
+}
+
+void Particles::setResampling(ResamplingMethod method, uint32_t seed) {
+    resampler_.setMethod(method);
+    resampler_.seed(seed);
+}
+
+void Particles::seed(uint64_t seed) {
+    seed_ = seed;
+    rng_.seed(static_cast<std::mt19937::result_type>(deriveSeed(seed, RandomStream::Evaluation)));
+    noise_.seed(seed, RandomStream::Propagation);
+    resampler_.seed(static_cast<uint32_t>(deriveSeed(seed, RandomStream::Resampling)));
 }
 
 void Particles::sortAscending() {
-    std::sort(data_.begin(), data_.end(), std::greater<>());
+    // Highest sampling factor first, as Particle::operator>
+    std::vector<size_t> order(size());
+    std::iota(order.begin(), order.end(), size_t(0));
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return data_.samplingFactor[a] > data_.samplingFactor[b];
+    });
+    next_.clear();
+    for (size_t index : order) {
+        next_.pushFrom(data_, index);
+    }
+    data_.swap(next_);
 }
 
 
 void Particles::normalize() {
-    float normalizationFactor = 0.f,
-            total = 0.f;
-    for (const auto &it : data_) {
-        normalizationFactor += it.getProbability();
-    }
-    for (auto &it : data_) {
-        float weight = it.getProbability() / normalizationFactor;
-        it.setWeight(weight);
-        total += weight;
-        it.setSamplingFactor(1 - total);
+    size_t n = size();
+    float normalizationFactor = simd::sum(data_.probability.data(), n);
+    simd::scale(data_.probability.data(), 1.f / normalizationFactor, n, data_.weight.data());
+    // The running total is a sequential dependency, it stays scalar
+    float total = 0.f;
+    const float* weight = data_.weight.data();
+    float* samplingFactor = data_.samplingFactor.data();
+    for (size_t i = 0; i < n; i++) {
+        total += weight[i];
+        samplingFactor[i] = 1 - total;
     }
 }
 
 cv::Point2i Particles::getWeightedSum() const {
-    double s_x = .0, s_y = .0;
-    for(const auto& it : data_) {
-        s_x += it.x * it.getWeight();
-        s_y += it.y * it.getWeight();
-    }
-    return cv::Point2i(static_cast<int>(s_x), static_cast<int>(s_y));
+    simd::WeightedMoments m = getWeightedMoments();
+    // The weights sum to one after normalize(), so the mean is the weighted sum
+    return cv::Point2i(static_cast<int>(m.meanX * m.weight), static_cast<int>(m.meanY * m.weight));
+}
+
+simd::WeightedMoments Particles::getWeightedMoments() const {
+    return simd::weightedMoments(data_.x.data(), data_.y.data(), data_.weight.data(), size());
 }
 
 void Particles::setScale(float min, float max, uint32_t steps) {
     float delta = (std::abs(min - max)) / static_cast<float>(steps - 1);
-    s_initial = std::make_shared<std::vector<float>>();
+    particleConfig->scales.clear();
     for(uint32_t i = 0; i < steps; i++) {
-        s_initial->push_back(min + (i * delta));
+        particleConfig->scales.push_back(min + (i * delta));
     }
-    for(auto& p : data_) {
-        p.setS_initial(s_initial);
+}
+
+void Particles::setProbabilityWindow(uint32_t window) {
+    particleConfig->probabilityWindow = window;
+    for(size_t i = 0; i < size(); i++) {
+        data_.history[i].restart(window, data_.probability[i]);
     }
 }
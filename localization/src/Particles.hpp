@@ -7,49 +7,277 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <iterator>
+#include <optional>
 #include <random>
+#include <type_traits>
 #include <opencv2/core/types.hpp>
 #include <opencv2/core/mat.hpp>
 #include <FAsT-Match/MatchConfig.h>
 #include "Particle.hpp"
 #include "ParticleConfig.hpp"
+#include "ParticleKernels.hpp"
+#include "ParticleNoise.hpp"
+#include "Resampler.hpp"
+
+/**
+ * State of a particle set stored column by column, so the per-frame passes
+ * (normalization, weighted mean, propagation) stream through contiguous
+ * arrays instead of whole particles. The probability histories are only
+ * touched when a probability is set and keep their own column.
+ */
+struct ParticleColumns {
+    std::vector<int> x;
+    std::vector<int> y;
+    std::vector<float> probability;
+    std::vector<float> weight;
+    std::vector<float> samplingFactor;
+    std::vector<float> correlation;
+    std::vector<ProbabilityHistory> history;
+
+    size_t size() const { return x.size(); }
+
+    /**
+     * Empties every column, keeping the capacity.
+     */
+    void clear();
+
+    void reserve(size_t count);
+
+    void resize(size_t count);
+
+    void push(const Particle& particle);
+
+    /**
+     * Appends a copy of particle `index` of `other`.
+     */
+    void pushFrom(const ParticleColumns& other, size_t index);
+
+    /**
+     * Overwrites particle `to` with a copy of particle `from` of `other`.
+     */
+    void copyFrom(const ParticleColumns& other, size_t from, size_t to);
+
+    void swap(ParticleColumns& other);
+
+    /**
+     * Particle `index` as a standalone value using `config`.
+     */
+    Particle get(size_t index, const ParticleConfig* config) const;
+
+    /**
+     * Stores the state of `particle` as particle `index`.
+     */
+    void set(size_t index, const Particle& particle);
+};
+
+/**
+ * Reference to one particle of a Particles container, with the accessors
+ * of Particle. `x` and `y` refer into the columns; geometric queries build
+ * a Particle value and forward to it. Const views only allow the getters.
+ */
+template<bool Const>
+class BasicParticleView {
+public:
+    using Columns = std::conditional_t<Const, const ParticleColumns, ParticleColumns>;
+    using Coordinate = std::conditional_t<Const, const int, int>;
+
+    BasicParticleView(Columns& columns, size_t index, const ParticleConfig* config, ParticleNoise* noise)
+            : x(columns.x[index]), y(columns.y[index]), columns(&columns), index(index), config(config),
+              noise(noise) {}
+
+    Coordinate& x;
+    Coordinate& y;
+
+    operator Particle() const { return columns->get(index, config); }
+
+    Particle toParticle() const { return columns->get(index, config); }
+
+    size_t getIndex() const { return index; }
+
+    float getProbability() const { return columns->probability[index]; }
+
+    void setProbability(float probability) {
+        columns->probability[index] = columns->history[index].push(probability);
+    }
+
+    void setMinimalProbability(float probability) {
+        columns->probability[index] = std::min(columns->probability[index], probability);
+    }
+
+    void setMaximalProbability(float probability) {
+        columns->probability[index] = std::max(columns->probability[index], probability);
+    }
+
+    uint32_t getProbabilityWindow() const { return columns->history[index].window; }
+
+    float getWeight() const { return columns->weight[index]; }
+
+    void setWeight(float weight) { columns->weight[index] = weight; }
+
+    float getSamplingFactor() const { return columns->samplingFactor[index]; }
+
+    void setSamplingFactor(float samplingFactor) { columns->samplingFactor[index] = samplingFactor; }
+
+    float getCorrelation() const { return columns->correlation[index]; }
+
+    void setCorrelation(float correlation) { columns->correlation[index] = correlation; }
+
+    /**
+     * Particle::propagate with the noise of the container.
+     */
+    void propagate(const cv::Point2f& movement) {
+        cv::Point2f m = Particle::noisyMovement(movement, [this] { return noise->gaussian(); });
+        x += m.x;
+        y += m.y;
+    }
+
+    cv::Point2i bin(int binSize) const { return {x / binSize, y / binSize}; }
+
+    std::string serialize(int binSize) const { return toParticle().serialize(binSize); }
+
+    cv::Point2i toPoint() const { return {x, y}; }
+
+    cv::Point2i getLocationInMapCoords() const { return toParticle().getLocationInMapCoords(); }
+
+    double getDirection() const { return config->direction; }
+
+    double getDirectionDegrees() const { return toParticle().getDirectionDegrees(); }
+
+    float getScale() const { return config->scales[2]; }
+
+    double mapRotationDegrees() const { return toParticle().mapRotationDegrees(); }
+
+    cv::Mat mapTransformation() const { return toParticle().mapTransformation(); }
+
+    void mapTransformation(double m[6]) const { toParticle().mapTransformation(m); }
+
+    cv::Mat staticTransformation() const { return toParticle().staticTransformation(); }
+
+    std::vector<fast_match::MatchConfig> getConfigs(int id) const { return toParticle().getConfigs(id); }
+
+    cv::Mat getMapImage(const cv::Mat& map, const cv::Size& imsize) const {
+        return toParticle().getMapImage(map, imsize);
+    }
+
+    std::vector<cv::Point> getCorners() const { return toParticle().getCorners(); }
+
+private:
+    Columns* columns;
+    size_t index;
+    const ParticleConfig* config;
+    ParticleNoise* noise;
+};
+
+class Particles;
+
+/**
+ * Iterator over Particles handing out views. The view is kept inside the
+ * iterator, so `for (auto& particle : particles)` binds to it; it stays
+ * valid until the iterator moves.
+ */
+template<bool Const>
+class BasicParticleIterator {
+public:
+    using Container = std::conditional_t<Const, const Particles, Particles>;
+    using View = BasicParticleView<Const>;
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Particle;
+    using difference_type = std::ptrdiff_t;
+    using pointer = View*;
+    using reference = View&;
+
+    BasicParticleIterator(Container* particles, std::ptrdiff_t index, std::ptrdiff_t step)
+            : particles(particles), index(index), step(step) {}
+
+    BasicParticleIterator(const BasicParticleIterator& other)
+            : particles(other.particles), index(other.index), step(other.step) {}
+
+    BasicParticleIterator& operator=(const BasicParticleIterator& other) {
+        particles = other.particles;
+        index = other.index;
+        step = other.step;
+        view.reset();
+        return *this;
+    }
+
+    View& operator*() const {
+        view.emplace((*particles)[static_cast<size_t>(index)]);
+        return *view;
+    }
+
+    View* operator->() const { return &**this; }
+
+    BasicParticleIterator& operator++() {
+        index += step;
+        return *this;
+    }
+
+    BasicParticleIterator operator++(int) {
+        BasicParticleIterator previous(*this);
+        index += step;
+        return previous;
+    }
+
+    bool operator==(const BasicParticleIterator& other) const { return index == other.index; }
+
+    bool operator!=(const BasicParticleIterator& other) const { return index != other.index; }
+
+private:
+    Container* particles;
+    std::ptrdiff_t index;
+    // +1 forward, -1 for the reverse iterators
+    std::ptrdiff_t step;
+    mutable std::optional<View> view;
+};
 
 class Particles {
 public:
-    // Vector interface forwarding
-    using iterator = std::vector<Particle>::iterator;
-    using const_iterator = std::vector<Particle>::const_iterator;
-    using reverse_iterator = std::vector<Particle>::reverse_iterator;
-    using const_reverse_iterator = std::vector<Particle>::const_reverse_iterator;
-
-    iterator begin() { return data_.begin(); }
-    iterator end() { return data_.end(); }
-    const_iterator begin() const { return data_.begin(); }
-    const_iterator end() const { return data_.end(); }
-    reverse_iterator rbegin() { return data_.rbegin(); }
-    reverse_iterator rend() { return data_.rend(); }
-    const_reverse_iterator rbegin() const { return data_.rbegin(); }
-    const_reverse_iterator rend() const { return data_.rend(); }
-
-    Particle& operator[](size_t i) { return data_[i]; }
-    const Particle& operator[](size_t i) const { return data_[i]; }
-    Particle& front() { return data_.front(); }
-    const Particle& front() const { return data_.front(); }
-    Particle& back() { return data_.back(); }
-    const Particle& back() const { return data_.back(); }
+    Particles() { seed(entropySeed()); }
+
+    using View = BasicParticleView<false>;
+    using ConstView = BasicParticleView<true>;
+
+    // Vector-like interface over the columns
+    using iterator = BasicParticleIterator<false>;
+    using const_iterator = BasicParticleIterator<true>;
+    using reverse_iterator = BasicParticleIterator<false>;
+    using const_reverse_iterator = BasicParticleIterator<true>;
+
+    iterator begin() { return {this, 0, 1}; }
+    iterator end() { return {this, static_cast<std::ptrdiff_t>(size()), 1}; }
+    const_iterator begin() const { return {this, 0, 1}; }
+    const_iterator end() const { return {this, static_cast<std::ptrdiff_t>(size()), 1}; }
+    reverse_iterator rbegin() { return {this, static_cast<std::ptrdiff_t>(size()) - 1, -1}; }
+    reverse_iterator rend() { return {this, -1, -1}; }
+    const_reverse_iterator rbegin() const { return {this, static_cast<std::ptrdiff_t>(size()) - 1, -1}; }
+    const_reverse_iterator rend() const { return {this, -1, -1}; }
+
+    View operator[](size_t i) { return View(data_, i, particleConfig.get(), &noise_); }
+    ConstView operator[](size_t i) const { return ConstView(data_, i, particleConfig.get(), nullptr); }
+    View front() { return (*this)[0]; }
+    ConstView front() const { return (*this)[0]; }
+    View back() { return (*this)[size() - 1]; }
+    ConstView back() const { return (*this)[size() - 1]; }
 
     size_t size() const { return data_.size(); }
-    bool empty() const { return data_.empty(); }
+    bool empty() const { return data_.size() == 0; }
 
-    template<typename InputIt>
-    void assign(InputIt first, InputIt last) { data_.assign(first, last); }
+    /**
+     * Raw columns, e.g. for vectorized passes over all particles.
+     */
+    const ParticleColumns& columns() const { return data_; }
 
     // Domain-specific methods
     void init(cv::Point2i startLocation, const cv::Size mapSize, double radius, int particleCount, bool use_gaussian);
     std::vector<fast_match::MatchConfig> getConfigs();
     void propagate(const cv::Point2f& movement, float alpha = 2.f);
 
-    void addParticle(Particle p);
+    /**
+     * Appends the state of `p`. The particle uses the configuration of the
+     * container from then on.
+     */
+    void addParticle(const Particle& p);
 
     const std::shared_ptr<ParticleConfig>& getConfig() const { return particleConfig; }
 
@@ -57,22 +285,105 @@ public:
 
     void printProbabilities();
 
-    Particle sample();
+    /**
+     * Double-buffered resampling: beginResampling() empties the back buffer
+     * while keeping its capacity and prepares the resampler from the current
+     * weights, drawSample() copies a particle drawn from the current belief
+     * into it and commitResampling() makes it the current set. Once both
+     * buffers have grown to the particle count, a resampling step does not
+     * touch the heap.
+     *
+     * expectedCount is the number of draws one resampling pass is planned for;
+     * zero means the current particle count.
+     */
+    void beginResampling(size_t expectedCount = 0);
+
+    /**
+     * View of the drawn particle in the back buffer, valid until the next draw.
+     */
+    View drawSample();
+
+    /**
+     * Draws `count` particles into the back buffer at once: the resampler
+     * picks them serially, the copies are made in parallel. Returns the
+     * index of the first one in samples().
+     */
+    size_t drawSamples(size_t count);
+
+    /**
+     * Moves back buffer particles [first, first + count) by `movement` plus
+     * Particle::propagate noise, in parallel. The noise of a particle depends
+     * only on the seed, the resampling pass and its index in the back buffer,
+     * so the result does not depend on the number of threads or on how the
+     * draws were split into drawSamples calls.
+     */
+    void propagateSamples(size_t first, size_t count, const cv::Point2f& movement);
 
+    /**
+     * Back buffer of the running resampling step.
+     */
+    const ParticleColumns& samples() const { return next_; }
+
+    void commitResampling();
+
+    /**
+     * Resampling method, keeping the resampler seed taken from seed().
+     */
+    void setResampling(ResamplingMethod method) { resampler_.setMethod(method); }
+
+    void setResampling(ResamplingMethod method, uint32_t seed);
+
+    ResamplingMethod getResampling() const { return resampler_.method(); }
+
+    /**
+     * Weights proportional to the probabilities, summing to one, and the
+     * sampling factors 1 - cumulative weight.
+     */
     void normalize();
 
     void sortAscending();
 
     cv::Point2i getWeightedSum() const;
 
+    /**
+     * Weighted mean and covariance of the particle positions.
+     */
+    simd::WeightedMoments getWeightedMoments() const;
+
     void setScale(float min, float max, uint32_t steps = 5);
 
+    /**
+     * Sets ParticleConfig::probabilityWindow and restarts the probability
+     * history of the current particles from their current probability.
+     */
+    void setProbabilityWindow(uint32_t window);
+
+    /**
+     * Seeds every random stream of the set from `seed`: the initial spread,
+     * the propagation noise, the resampler and the point sampling of
+     * evaluate(). Called before init(), a run is reproducible from the seed
+     * alone. Without a call the seed comes from std::random_device.
+     */
+    void seed(uint64_t seed);
+
+    uint64_t getSeed() const { return seed_; }
+
 protected:
-    std::vector<Particle> data_;
+    ParticleColumns data_;
+    // Back buffer filled during resampling, swapped with data_ on commit
+    ParticleColumns next_;
+    Resampler resampler_;
+    // Particles point into it, so it is shared rather than owned by value
     std::shared_ptr<ParticleConfig> particleConfig = std::make_shared<ParticleConfig>();
-    std::shared_ptr<std::vector<float>> s_initial = std::make_shared<std::vector<float>>();
 
-    std::mt19937 rng_{std::random_device{}()};
+    uint64_t seed_ = 0;
+    // Point sampling of evaluate()
+    std::mt19937 rng_;
+    ParticleNoise noise_;
+    // Counts beginResampling calls, numbers the noise stream of a pass
+    uint64_t resamplingPass_ = 0;
+    // Resampler picks of drawSamples, reused between calls
+    std::vector<size_t> picks_;
 
     void addParticle(int x, int y);
 
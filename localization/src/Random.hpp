@@ -0,0 +1,81 @@
+//
+// Counter-based random numbers and seed handling of the particle filter.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+/**
+ * Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2,
+ * 3"). The output is a pure function of a 64 bit key and a 128 bit counter,
+ * so any number of independent streams can be taken from one seed and any
+ * position of a stream computed without generating the ones before it.
+ */
+struct Philox4x32 {
+    static constexpr int kRounds = 10;
+    static constexpr uint32_t kMultiplier0 = 0xD2511F53u;
+    static constexpr uint32_t kMultiplier1 = 0xCD9E8D57u;
+    static constexpr uint32_t kWeyl0 = 0x9E3779B9u;
+    static constexpr uint32_t kWeyl1 = 0xBB67AE85u;
+
+    /**
+     * Encrypts `counter` in place with `key`.
+     */
+    static void generate(uint32_t counter[4], const uint32_t key[2]) {
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < kRounds; round++) {
+            uint64_t p0 = static_cast<uint64_t>(kMultiplier0) * counter[0];
+            uint64_t p1 = static_cast<uint64_t>(kMultiplier1) * counter[2];
+            uint32_t c1 = counter[1], c3 = counter[3];
+            counter[0] = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+            counter[1] = static_cast<uint32_t>(p1);
+            counter[2] = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+            counter[3] = static_cast<uint32_t>(p0);
+            k0 += kWeyl0;
+            k1 += kWeyl1;
+        }
+    }
+};
+
+/**
+ * Streams taken from the seed of one filter. Each part of the filter that
+ * draws random numbers has its own, so adding draws in one part does not
+ * shift the numbers another part sees.
+ */
+enum class RandomStream : uint64_t {
+    Initialization = 1,
+    Propagation = 2,
+    Resampling = 3,
+    TemplateSampling = 4,
+    Evaluation = 5,
+};
+
+/**
+ * Stream number of part `index` of `stream`, e.g. one per resampling pass.
+ * Index 0 is `stream` itself.
+ */
+inline uint64_t subStream(RandomStream stream, uint64_t index) {
+    return (index << 8) | static_cast<uint64_t>(stream);
+}
+
+/**
+ * Well mixed 64 bit value for stream `stream` of `seed`, e.g. to seed a
+ * conventional generator from a filter seed.
+ */
+inline uint64_t deriveSeed(uint64_t seed, RandomStream stream) {
+    uint32_t counter[4] = {0, 0, static_cast<uint32_t>(stream), static_cast<uint32_t>(static_cast<uint64_t>(stream) >> 32)};
+    const uint32_t key[2] = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    Philox4x32::generate(counter, key);
+    return (static_cast<uint64_t>(counter[1]) << 32) | counter[0];
+}
+
+/**
+ * Fresh seed from std::random_device for runs that do not ask for one.
+ */
+inline uint64_t entropySeed() {
+    std::random_device device;
+    return (static_cast<uint64_t>(device()) << 32) | device();
+}
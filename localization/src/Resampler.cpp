@@ -0,0 +1,159 @@
+//
+// Resampling engines used by Particles to draw the next particle set.
+//
+
+#include "Resampler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+Resampler::Resampler(ResamplingMethod method, uint32_t seed) : method_(method), rng_(seed) {
+}
+
+void Resampler::reset(const float* weights, size_t n, size_t expectedDraws) {
+    if (n == 0) {
+        throw std::invalid_argument("cannot resample an empty particle set");
+    }
+    count_ = n;
+    passSize_ = std::max<size_t>(expectedDraws, 1);
+    pass_.clear();
+    passPosition_ = 0;
+
+    cumulative_.resize(n);
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        // Negative and NaN weights can not be drawn
+        if (weights[i] > 0.f) {
+            total += weights[i];
+        }
+        cumulative_[i] = total;
+    }
+    if (total > 0.0 && std::isfinite(total)) {
+        for (auto& c : cumulative_) {
+            c /= total;
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            cumulative_[i] = static_cast<double>(i + 1) / static_cast<double>(n);
+        }
+    }
+    // Guard the last bucket against rounding, u < 1 always lands in the table
+    cumulative_[n - 1] = 1.0;
+
+    if (method_ == ResamplingMethod::Alias) {
+        buildAliasTable();
+    }
+}
+
+size_t Resampler::next() {
+    if (count_ == 0) {
+        throw std::logic_error("Resampler::next called before reset");
+    }
+    switch (method_) {
+        case ResamplingMethod::Multinomial: {
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            return searchCumulative(cumulative_, uniform(rng_));
+        }
+        case ResamplingMethod::Alias: {
+            std::uniform_int_distribution<size_t> column(0, count_ - 1);
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            size_t i = column(rng_);
+            return uniform(rng_) < aliasProbability_[i] ? i : alias_[i];
+        }
+        default:
+            if (passPosition_ == pass_.size()) {
+                fillPass();
+            }
+            return pass_[passPosition_++];
+    }
+}
+
+size_t Resampler::searchCumulative(const std::vector<double>& cumulative, double u) const {
+    auto it = std::upper_bound(cumulative.begin(), cumulative.end(), u);
+    return std::min(static_cast<size_t>(it - cumulative.begin()), count_ - 1);
+}
+
+void Resampler::buildAliasTable() {
+    // Vose's alias method
+    aliasProbability_.resize(count_);
+    alias_.resize(count_);
+    small_.clear();
+    large_.clear();
+    double previous = 0.0;
+    for (size_t i = 0; i < count_; i++) {
+        aliasProbability_[i] = (cumulative_[i] - previous) * static_cast<double>(count_);
+        previous = cumulative_[i];
+        alias_[i] = static_cast<uint32_t>(i);
+        (aliasProbability_[i] < 1.0 ? small_ : large_).push_back(static_cast<uint32_t>(i));
+    }
+    while (!small_.empty() && !large_.empty()) {
+        uint32_t s = small_.back();
+        small_.pop_back();
+        uint32_t l = large_.back();
+        alias_[s] = l;
+        aliasProbability_[l] = (aliasProbability_[l] + aliasProbability_[s]) - 1.0;
+        if (aliasProbability_[l] < 1.0) {
+            large_.pop_back();
+            small_.push_back(l);
+        }
+    }
+    // Whatever is left is full up to rounding
+    for (uint32_t i : large_) {
+        aliasProbability_[i] = 1.0;
+    }
+    for (uint32_t i : small_) {
+        aliasProbability_[i] = 1.0;
+    }
+}
+
+void Resampler::fillPass() {
+    pass_.clear();
+    passPosition_ = 0;
+    const auto n = static_cast<double>(passSize_);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    switch (method_) {
+        case ResamplingMethod::Systematic:
+        case ResamplingMethod::Stratified: {
+            // Both walk the prefix sums once with increasing thresholds
+            double offset = uniform(rng_);
+            size_t j = 0;
+            for (size_t i = 0; i < passSize_; i++) {
+                if (method_ == ResamplingMethod::Stratified) {
+                    offset = uniform(rng_);
+                }
+                double u = (static_cast<double>(i) + offset) / n;
+                while (j < count_ - 1 && cumulative_[j] <= u) {
+                    j++;
+                }
+                pass_.push_back(static_cast<uint32_t>(j));
+            }
+            break;
+        }
+        case ResamplingMethod::Residual: {
+            // Deterministic floor(n * w) copies, the remainder drawn from the residual weights
+            residualCumulative_.resize(count_);
+            double previous = 0.0, residualTotal = 0.0;
+            for (size_t j = 0; j < count_; j++) {
+                double expected = (cumulative_[j] - previous) * n;
+                previous = cumulative_[j];
+                double copies = std::floor(expected);
+                for (size_t c = 0; c < static_cast<size_t>(copies) && pass_.size() < passSize_; c++) {
+                    pass_.push_back(static_cast<uint32_t>(j));
+                }
+                residualTotal += expected - copies;
+                residualCumulative_[j] = residualTotal;
+            }
+            while (pass_.size() < passSize_) {
+                size_t j = residualTotal > 0.0
+                           ? searchCumulative(residualCumulative_, uniform(rng_) * residualTotal)
+                           : searchCumulative(cumulative_, uniform(rng_));
+                pass_.push_back(static_cast<uint32_t>(j));
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    std::shuffle(pass_.begin(), pass_.end(), rng_);
+}
@@ -0,0 +1,94 @@
+//
+// Resampling engines used by Particles to draw the next particle set.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+enum class ResamplingMethod {
+    Multinomial, Alias, Systematic, Stratified, Residual
+};
+
+inline ResamplingMethod resamplingMethodFromString(const std::string& name) {
+    if (name == "multinomial") return ResamplingMethod::Multinomial;
+    if (name == "alias") return ResamplingMethod::Alias;
+    if (name == "systematic") return ResamplingMethod::Systematic;
+    if (name == "stratified") return ResamplingMethod::Stratified;
+    if (name == "residual") return ResamplingMethod::Residual;
+    throw std::invalid_argument("unknown resampling method: " + name);
+}
+
+inline const char* resamplingMethodName(ResamplingMethod method) {
+    switch (method) {
+        case ResamplingMethod::Multinomial: return "multinomial";
+        case ResamplingMethod::Alias: return "alias";
+        case ResamplingMethod::Systematic: return "systematic";
+        case ResamplingMethod::Stratified: return "stratified";
+        case ResamplingMethod::Residual: return "residual";
+    }
+    return "unknown";
+}
+
+/**
+ * Draws particle indices proportionally to their weights.
+ *
+ * Multinomial draws independently with a binary search over the prefix sums,
+ * Alias does the same in O(1) per draw after an O(N) table build. Systematic,
+ * stratified and residual produce a whole pass of `expectedDraws` indices in
+ * O(N) and hand it out in shuffled order, so a KLD-sampling loop that stops
+ * early still gets an unbiased subset. When a pass runs out, the next one is
+ * generated from the same weights.
+ *
+ * All buffers are reused, so once they have grown to the particle count no
+ * further allocations happen.
+ */
+class Resampler {
+public:
+    static constexpr uint32_t kDefaultSeed = 5489u;
+
+    explicit Resampler(ResamplingMethod method = ResamplingMethod::Systematic, uint32_t seed = kDefaultSeed);
+
+    void setMethod(ResamplingMethod method) { method_ = method; }
+
+    ResamplingMethod method() const { return method_; }
+
+    void seed(uint32_t seed) { rng_.seed(seed); }
+
+    /**
+     * Prepares drawing from `n` weights. Weights need not be normalized; if they
+     * do not sum to a positive finite value every index is equally likely.
+     */
+    void reset(const float* weights, size_t n, size_t expectedDraws);
+
+    size_t next();
+
+private:
+    size_t searchCumulative(const std::vector<double>& cumulative, double u) const;
+
+    void buildAliasTable();
+
+    void fillPass();
+
+    ResamplingMethod method_;
+    std::mt19937 rng_;
+    size_t count_ = 0;
+    size_t passSize_ = 0;
+
+    // Normalized inclusive prefix sums of the weights
+    std::vector<double> cumulative_;
+    // Prefix sums of the residual weights (Residual only)
+    std::vector<double> residualCumulative_;
+
+    std::vector<double> aliasProbability_;
+    std::vector<uint32_t> alias_;
+    std::vector<uint32_t> small_, large_;
+
+    std::vector<uint32_t> pass_;
+    size_t passPosition_ = 0;
+};
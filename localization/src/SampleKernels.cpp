@@ -0,0 +1,701 @@
+//
+// Vectorized kernels used when comparing image samples.
+//
+
+#include "SampleKernels.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+    namespace {
+        double dotProductScalar(const float* a, const float* b, std::size_t n) {
+            // Four independent accumulators let the compiler pipeline the multiplies
+            float acc[4] = {0.f, 0.f, 0.f, 0.f};
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                acc[0] += a[i] * b[i];
+                acc[1] += a[i + 1] * b[i + 1];
+                acc[2] += a[i + 2] * b[i + 2];
+                acc[3] += a[i + 3] * b[i + 3];
+            }
+            for (; i < n; i++) {
+                acc[0] += a[i] * b[i];
+            }
+            return static_cast<double>(acc[0]) + acc[1] + acc[2] + acc[3];
+        }
+
+#ifdef SIMD_KERNELS_X86
+        __attribute__((target("sse2")))
+        double dotProductSSE2(const float* a, const float* b, std::size_t n) {
+            __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+                acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+            }
+            alignas(16) float lanes[4];
+            _mm_store_ps(lanes, _mm_add_ps(acc0, acc1));
+            double result = static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+            return result + dotProductScalar(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx2,fma")))
+        double dotProductAVX2(const float* a, const float* b, std::size_t n) {
+            __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps(),
+                    acc2 = _mm256_setzero_ps(), acc3 = _mm256_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+                acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+                acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+                acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+            }
+            for (; i + 8 <= n; i += 8) {
+                acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+            }
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3));
+            alignas(32) float lanes[8];
+            _mm256_store_ps(lanes, sum);
+            double result = 0.0;
+            for (float lane : lanes) {
+                result += lane;
+            }
+            return result + dotProductScalar(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx512f")))
+        double dotProductAVX512(const float* a, const float* b, std::size_t n) {
+            __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps(),
+                    acc2 = _mm512_setzero_ps(), acc3 = _mm512_setzero_ps();
+            std::size_t i = 0;
+            for (; i + 64 <= n; i += 64) {
+                acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+                acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+                acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), acc2);
+                acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), acc3);
+            }
+            for (; i + 16 <= n; i += 16) {
+                acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+            }
+            __m512 sum = _mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3));
+            alignas(64) float lanes[16];
+            _mm512_store_ps(lanes, sum);
+            double result = 0.0;
+            for (float lane : lanes) {
+                result += lane;
+            }
+            return result + dotProductScalar(a + i, b + i, n - i);
+        }
+#endif
+
+        uint64_t dotProductU8Scalar(const uint8_t* a, const uint8_t* b, std::size_t n) {
+            uint64_t sum = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                sum += static_cast<uint32_t>(a[i]) * b[i];
+            }
+            return sum;
+        }
+
+#ifdef SIMD_KERNELS_X86
+        // Integer lanes are flushed to 64 bits before they can overflow: one step of
+        // the madd kernels adds at most 2 * 2 * 255^2 per lane, the VNNI kernels at
+        // most 4 * 255 * 128 in magnitude, so 4096 steps stay below 2^31.
+        constexpr std::size_t kFlushSteps = 4096;
+
+        __attribute__((target("avx2")))
+        int64_t horizontalSum32(__m256i lanes) {
+            alignas(32) int32_t values[8];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(values), lanes);
+            int64_t sum = 0;
+            for (int32_t v : values) {
+                sum += v;
+            }
+            return sum;
+        }
+
+        __attribute__((target("avx512f")))
+        int64_t horizontalSum32(__m512i lanes) {
+            alignas(64) int32_t values[16];
+            _mm512_store_si512(values, lanes);
+            int64_t sum = 0;
+            for (int32_t v : values) {
+                sum += v;
+            }
+            return sum;
+        }
+
+        __attribute__((target("avx2")))
+        uint64_t dotProductU8AVX2(const uint8_t* a, const uint8_t* b, std::size_t n) {
+            uint64_t sum = 0;
+            std::size_t i = 0;
+            while (i + 32 <= n) {
+                __m256i acc = _mm256_setzero_si256();
+                std::size_t blockEnd = std::min(n - (n - i) % 32, i + 32 * kFlushSteps);
+                for (; i < blockEnd; i += 32) {
+                    __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                            a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)),
+                            b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)),
+                            b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i + 16));
+                    // Widened to int16 both operands are non-negative, so pmaddwd can not saturate
+                    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_cvtepu8_epi16(a0), _mm256_cvtepu8_epi16(b0)));
+                    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_cvtepu8_epi16(a1), _mm256_cvtepu8_epi16(b1)));
+                }
+                sum += static_cast<uint64_t>(horizontalSum32(acc));
+            }
+            return sum + dotProductU8Scalar(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx2,avxvnni")))
+        uint64_t dotProductU8AVXVNNI(const uint8_t* a, const uint8_t* b, std::size_t n) {
+            // vpdpbusd multiplies unsigned by signed bytes, so b is biased to b - 128 and
+            // the bias is added back through the byte sum of a: a * b = a * (b - 128) + 128 * a
+            const __m256i bias = _mm256_set1_epi8(static_cast<char>(0x80)), zero = _mm256_setzero_si256();
+            int64_t sum = 0;
+            uint64_t sumA = 0;
+            std::size_t i = 0;
+            while (i + 32 <= n) {
+                __m256i acc = zero, accA = zero;
+                std::size_t blockEnd = std::min(n - (n - i) % 32, i + 32 * kFlushSteps);
+                for (; i < blockEnd; i += 32) {
+                    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                    __m256i vb = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)), bias);
+                    acc = _mm256_dpbusd_avx_epi32(acc, va, vb);
+                    accA = _mm256_add_epi64(accA, _mm256_sad_epu8(va, zero));
+                }
+                sum += horizontalSum32(acc);
+                alignas(32) uint64_t partial[4];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(partial), accA);
+                sumA += partial[0] + partial[1] + partial[2] + partial[3];
+            }
+            return static_cast<uint64_t>(sum + 128 * static_cast<int64_t>(sumA)) + dotProductU8Scalar(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx512f,avx512bw")))
+        uint64_t dotProductU8AVX512(const uint8_t* a, const uint8_t* b, std::size_t n) {
+            uint64_t sum = 0;
+            std::size_t i = 0;
+            while (i + 64 <= n) {
+                __m512i acc = _mm512_setzero_si512();
+                std::size_t blockEnd = std::min(n - (n - i) % 64, i + 64 * kFlushSteps);
+                for (; i < blockEnd; i += 64) {
+                    __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                            a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i + 32)),
+                            b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)),
+                            b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i + 32));
+                    acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_cvtepu8_epi16(a0), _mm512_cvtepu8_epi16(b0)));
+                    acc = _mm512_add_epi32(acc, _mm512_madd_epi16(_mm512_cvtepu8_epi16(a1), _mm512_cvtepu8_epi16(b1)));
+                }
+                sum += static_cast<uint64_t>(horizontalSum32(acc));
+            }
+            return sum + dotProductU8Scalar(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx512f,avx512bw,avx512vnni")))
+        uint64_t dotProductU8AVX512VNNI(const uint8_t* a, const uint8_t* b, std::size_t n) {
+            // Same bias trick as dotProductU8AVXVNNI
+            const __m512i bias = _mm512_set1_epi8(static_cast<char>(0x80)), zero = _mm512_setzero_si512();
+            int64_t sum = 0;
+            std::size_t i = 0;
+            __m512i accA = zero;
+            while (i + 64 <= n) {
+                __m512i acc = zero;
+                std::size_t blockEnd = std::min(n - (n - i) % 64, i + 64 * kFlushSteps);
+                for (; i < blockEnd; i += 64) {
+                    __m512i va = _mm512_loadu_si512(a + i);
+                    __m512i vb = _mm512_xor_si512(_mm512_loadu_si512(b + i), bias);
+                    acc = _mm512_dpbusd_epi32(acc, va, vb);
+                    accA = _mm512_add_epi64(accA, _mm512_sad_epu8(va, zero));
+                }
+                sum += horizontalSum32(acc);
+            }
+            alignas(64) int64_t partial[8];
+            _mm512_store_si512(partial, accA);
+            for (int64_t p : partial) {
+                sum += 128 * p;
+            }
+            return static_cast<uint64_t>(sum) + dotProductU8Scalar(a + i, b + i, n - i);
+        }
+#endif
+
+        constexpr int kFixedShift = 16;
+        constexpr double kFixedOne = 1 << kFixedShift;
+
+        void gatherAffineScalar(const ImageView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                                const FixedAffine& a, uint8_t* out, SampleStats& stats) {
+            uint64_t sum = 0, squaredSum = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                int32_t x = a.baseX + ((a.fracX + a.a11 * xs[i] + a.a12 * ys[i]) >> kFixedShift);
+                int32_t y = a.baseY + ((a.fracY + a.a21 * xs[i] + a.a22 * ys[i]) >> kFixedShift);
+                x = std::clamp(x, 0, image.cols - 1);
+                y = std::clamp(y, 0, image.rows - 1);
+                uint8_t val = image.data[static_cast<std::size_t>(y) * image.step + x];
+                sum += val;
+                squaredSum += static_cast<uint32_t>(val) * val;
+                out[i] = val;
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+        }
+
+#ifdef SIMD_KERNELS_X86
+        __attribute__((target("avx2")))
+        void storeLowBytes(uint8_t* out, __m256i values) {
+            // Low byte of every 32 bit lane, packed into 8 consecutive bytes
+            const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                  0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+            __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(values, pick),
+                                                         _mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(packed));
+        }
+
+        __attribute__((target("avx2")))
+        void gatherAffineAVX2(const ImageView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                              const FixedAffine& a, uint8_t* out, SampleStats& stats) {
+            // Gathers read whole 32 bit words, so the loads are aligned down to a word
+            // boundary and the wanted byte is shifted out. An aligned word never crosses
+            // a page, so reading it cannot fault even at the end of the image buffer.
+            auto base = reinterpret_cast<const int*>(reinterpret_cast<uintptr_t>(image.data) & ~uintptr_t(3));
+            auto delta = static_cast<int32_t>(image.data - reinterpret_cast<const uint8_t*>(base));
+
+            const __m256i a11 = _mm256_set1_epi32(a.a11), a12 = _mm256_set1_epi32(a.a12),
+                    a21 = _mm256_set1_epi32(a.a21), a22 = _mm256_set1_epi32(a.a22),
+                    baseX = _mm256_set1_epi32(a.baseX), baseY = _mm256_set1_epi32(a.baseY),
+                    fracX = _mm256_set1_epi32(a.fracX), fracY = _mm256_set1_epi32(a.fracY),
+                    zero = _mm256_setzero_si256(),
+                    maxX = _mm256_set1_epi32(image.cols - 1), maxY = _mm256_set1_epi32(image.rows - 1),
+                    step = _mm256_set1_epi32(static_cast<int32_t>(image.step)),
+                    offset = _mm256_set1_epi32(delta),
+                    wordMask = _mm256_set1_epi32(~3), byteMask = _mm256_set1_epi32(3),
+                    valueMask = _mm256_set1_epi32(0xFF);
+
+            uint64_t sum = 0, squaredSum = 0;
+            std::size_t i = 0;
+            while (i + 8 <= n) {
+                // Lanes hold at most 4096 * 255^2 before being flushed to 64 bits
+                __m256i laneSum = zero, laneSquaredSum = zero;
+                std::size_t blockEnd = std::min(n - (n - i) % 8, i + 8 * 4096);
+                for (; i < blockEnd; i += 8) {
+                    __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i));
+                    __m256i py = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i));
+                    __m256i tx = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a11, px),
+                                                                   _mm256_mullo_epi32(a12, py)), fracX);
+                    __m256i ty = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a21, px),
+                                                                   _mm256_mullo_epi32(a22, py)), fracY);
+                    tx = _mm256_add_epi32(_mm256_srai_epi32(tx, kFixedShift), baseX);
+                    ty = _mm256_add_epi32(_mm256_srai_epi32(ty, kFixedShift), baseY);
+                    tx = _mm256_min_epi32(_mm256_max_epi32(tx, zero), maxX);
+                    ty = _mm256_min_epi32(_mm256_max_epi32(ty, zero), maxY);
+                    __m256i byteOffset = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(ty, step), tx), offset);
+                    __m256i words = _mm256_i32gather_epi32(base, _mm256_and_si256(byteOffset, wordMask), 1);
+                    __m256i shift = _mm256_slli_epi32(_mm256_and_si256(byteOffset, byteMask), 3);
+                    __m256i values = _mm256_and_si256(_mm256_srlv_epi32(words, shift), valueMask);
+                    laneSum = _mm256_add_epi32(laneSum, values);
+                    laneSquaredSum = _mm256_add_epi32(laneSquaredSum, _mm256_mullo_epi32(values, values));
+                    storeLowBytes(out + i, values);
+                }
+                alignas(32) uint32_t sums[8], squaredSums[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(sums), laneSum);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(squaredSums), laneSquaredSum);
+                for (int lane = 0; lane < 8; lane++) {
+                    sum += sums[lane];
+                    squaredSum += squaredSums[lane];
+                }
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+            gatherAffineScalar(image, xs + i, ys + i, n - i, a, out + i, stats);
+        }
+#endif
+
+        void gatherOffsetsScalar(const ImageView8u& image, std::ptrdiff_t origin, const int32_t* offsets,
+                                 std::size_t n, uint8_t* out, SampleStats& stats) {
+            const uint8_t* base = image.data + origin;
+            uint64_t sum = 0, squaredSum = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                uint8_t val = base[offsets[i]];
+                sum += val;
+                squaredSum += static_cast<uint32_t>(val) * val;
+                out[i] = val;
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+        }
+
+#ifdef SIMD_KERNELS_X86
+        __attribute__((target("avx2")))
+        void gatherOffsetsAVX2(const ImageView8u& image, std::ptrdiff_t origin, const int32_t* offsets,
+                               std::size_t n, uint8_t* out, SampleStats& stats) {
+            // Same aligned word trick as gatherAffineAVX2
+            auto base = reinterpret_cast<const int*>(reinterpret_cast<uintptr_t>(image.data) & ~uintptr_t(3));
+            auto delta = static_cast<int32_t>(image.data - reinterpret_cast<const uint8_t*>(base));
+
+            const __m256i zero = _mm256_setzero_si256(),
+                    start = _mm256_set1_epi32(static_cast<int32_t>(origin) + delta),
+                    wordMask = _mm256_set1_epi32(~3), byteMask = _mm256_set1_epi32(3),
+                    valueMask = _mm256_set1_epi32(0xFF);
+
+            uint64_t sum = 0, squaredSum = 0;
+            std::size_t i = 0;
+            while (i + 8 <= n) {
+                __m256i laneSum = zero, laneSquaredSum = zero;
+                std::size_t blockEnd = std::min(n - (n - i) % 8, i + 8 * 4096);
+                for (; i < blockEnd; i += 8) {
+                    __m256i byteOffset = _mm256_add_epi32(
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(offsets + i)), start);
+                    __m256i words = _mm256_i32gather_epi32(base, _mm256_and_si256(byteOffset, wordMask), 1);
+                    __m256i shift = _mm256_slli_epi32(_mm256_and_si256(byteOffset, byteMask), 3);
+                    __m256i values = _mm256_and_si256(_mm256_srlv_epi32(words, shift), valueMask);
+                    laneSum = _mm256_add_epi32(laneSum, values);
+                    laneSquaredSum = _mm256_add_epi32(laneSquaredSum, _mm256_mullo_epi32(values, values));
+                    storeLowBytes(out + i, values);
+                }
+                alignas(32) uint32_t sums[8], squaredSums[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(sums), laneSum);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(squaredSums), laneSquaredSum);
+                for (int lane = 0; lane < 8; lane++) {
+                    sum += sums[lane];
+                    squaredSum += squaredSums[lane];
+                }
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+            gatherOffsetsScalar(image, origin, offsets + i, n - i, out + i, stats);
+        }
+#endif
+
+        constexpr int kTileShift = 6;
+        constexpr int kTileMask = (1 << kTileShift) - 1;
+
+        inline uint8_t tiledPixel(const TiledView8u& image, int32_t x, int32_t y) {
+            std::size_t tile = image.tileIndex[(y >> kTileShift) * image.tilesX + (x >> kTileShift)];
+            return image.data[(tile << (2 * kTileShift)) + ((y & kTileMask) << kTileShift) + (x & kTileMask)];
+        }
+
+        void gatherAffineTiledScalar(const TiledView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                                     const FixedAffine& a, uint8_t* out, SampleStats& stats) {
+            uint64_t sum = 0, squaredSum = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                int32_t x = a.baseX + ((a.fracX + a.a11 * xs[i] + a.a12 * ys[i]) >> kFixedShift);
+                int32_t y = a.baseY + ((a.fracY + a.a21 * xs[i] + a.a22 * ys[i]) >> kFixedShift);
+                uint8_t val = tiledPixel(image, std::clamp(x, 0, image.cols - 1), std::clamp(y, 0, image.rows - 1));
+                sum += val;
+                squaredSum += static_cast<uint32_t>(val) * val;
+                out[i] = val;
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+        }
+
+        void gatherTranslatedTiledScalar(const TiledView8u& image, int32_t x, int32_t y, const int32_t* dx,
+                                         const int32_t* dy, std::size_t n, uint8_t* out, SampleStats& stats) {
+            uint64_t sum = 0, squaredSum = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                uint8_t val = tiledPixel(image, std::clamp(x + dx[i], 0, image.cols - 1),
+                                         std::clamp(y + dy[i], 0, image.rows - 1));
+                sum += val;
+                squaredSum += static_cast<uint32_t>(val) * val;
+                out[i] = val;
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+        }
+
+#ifdef SIMD_KERNELS_X86
+        /**
+         * Gathers the pixels at clamped coordinates (x, y) of a tiled image: one
+         * gather for the tile slots, one for the aligned words holding the bytes.
+         */
+        struct TiledGatherAVX2 {
+            const int* base;
+            const int* tileIndex;
+            __m256i offset, tilesX, maxX, maxY, mask, zero, wordMask, byteMask, valueMask;
+
+            __attribute__((target("avx2")))
+            explicit TiledGatherAVX2(const TiledView8u& image) {
+                base = reinterpret_cast<const int*>(reinterpret_cast<uintptr_t>(image.data) & ~uintptr_t(3));
+                tileIndex = reinterpret_cast<const int*>(image.tileIndex);
+                offset = _mm256_set1_epi32(static_cast<int32_t>(image.data - reinterpret_cast<const uint8_t*>(base)));
+                tilesX = _mm256_set1_epi32(image.tilesX);
+                maxX = _mm256_set1_epi32(image.cols - 1);
+                maxY = _mm256_set1_epi32(image.rows - 1);
+                mask = _mm256_set1_epi32(kTileMask);
+                zero = _mm256_setzero_si256();
+                wordMask = _mm256_set1_epi32(~3);
+                byteMask = _mm256_set1_epi32(3);
+                valueMask = _mm256_set1_epi32(0xFF);
+            }
+
+            __attribute__((target("avx2")))
+            __m256i operator()(__m256i x, __m256i y) const {
+                x = _mm256_min_epi32(_mm256_max_epi32(x, zero), maxX);
+                y = _mm256_min_epi32(_mm256_max_epi32(y, zero), maxY);
+                __m256i tile = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(y, kTileShift), tilesX),
+                                                _mm256_srli_epi32(x, kTileShift));
+                __m256i slot = _mm256_i32gather_epi32(tileIndex, tile, 4);
+                __m256i inTile = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(y, mask), kTileShift),
+                                                  _mm256_and_si256(x, mask));
+                __m256i byteOffset = _mm256_add_epi32(
+                        _mm256_add_epi32(_mm256_slli_epi32(slot, 2 * kTileShift), inTile), offset);
+                __m256i words = _mm256_i32gather_epi32(base, _mm256_and_si256(byteOffset, wordMask), 1);
+                __m256i shift = _mm256_slli_epi32(_mm256_and_si256(byteOffset, byteMask), 3);
+                return _mm256_and_si256(_mm256_srlv_epi32(words, shift), valueMask);
+            }
+        };
+
+        __attribute__((target("avx2")))
+        void gatherAffineTiledAVX2(const TiledView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                                   const FixedAffine& a, uint8_t* out, SampleStats& stats) {
+            const TiledGatherAVX2 gather(image);
+            const __m256i a11 = _mm256_set1_epi32(a.a11), a12 = _mm256_set1_epi32(a.a12),
+                    a21 = _mm256_set1_epi32(a.a21), a22 = _mm256_set1_epi32(a.a22),
+                    baseX = _mm256_set1_epi32(a.baseX), baseY = _mm256_set1_epi32(a.baseY),
+                    fracX = _mm256_set1_epi32(a.fracX), fracY = _mm256_set1_epi32(a.fracY),
+                    zero = _mm256_setzero_si256();
+
+            uint64_t sum = 0, squaredSum = 0;
+            std::size_t i = 0;
+            while (i + 8 <= n) {
+                __m256i laneSum = zero, laneSquaredSum = zero;
+                std::size_t blockEnd = std::min(n - (n - i) % 8, i + 8 * 4096);
+                for (; i < blockEnd; i += 8) {
+                    __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xs + i));
+                    __m256i py = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ys + i));
+                    __m256i tx = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a11, px),
+                                                                   _mm256_mullo_epi32(a12, py)), fracX);
+                    __m256i ty = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(a21, px),
+                                                                   _mm256_mullo_epi32(a22, py)), fracY);
+                    __m256i values = gather(_mm256_add_epi32(_mm256_srai_epi32(tx, kFixedShift), baseX),
+                                            _mm256_add_epi32(_mm256_srai_epi32(ty, kFixedShift), baseY));
+                    laneSum = _mm256_add_epi32(laneSum, values);
+                    laneSquaredSum = _mm256_add_epi32(laneSquaredSum, _mm256_mullo_epi32(values, values));
+                    storeLowBytes(out + i, values);
+                }
+                alignas(32) uint32_t sums[8], squaredSums[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(sums), laneSum);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(squaredSums), laneSquaredSum);
+                for (int lane = 0; lane < 8; lane++) {
+                    sum += sums[lane];
+                    squaredSum += squaredSums[lane];
+                }
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+            gatherAffineTiledScalar(image, xs + i, ys + i, n - i, a, out + i, stats);
+        }
+
+        __attribute__((target("avx2")))
+        void gatherTranslatedTiledAVX2(const TiledView8u& image, int32_t x, int32_t y, const int32_t* dx,
+                                       const int32_t* dy, std::size_t n, uint8_t* out, SampleStats& stats) {
+            const TiledGatherAVX2 gather(image);
+            const __m256i originX = _mm256_set1_epi32(x), originY = _mm256_set1_epi32(y),
+                    zero = _mm256_setzero_si256();
+
+            uint64_t sum = 0, squaredSum = 0;
+            std::size_t i = 0;
+            while (i + 8 <= n) {
+                __m256i laneSum = zero, laneSquaredSum = zero;
+                std::size_t blockEnd = std::min(n - (n - i) % 8, i + 8 * 4096);
+                for (; i < blockEnd; i += 8) {
+                    __m256i px = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dx + i));
+                    __m256i py = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dy + i));
+                    __m256i values = gather(_mm256_add_epi32(px, originX), _mm256_add_epi32(py, originY));
+                    laneSum = _mm256_add_epi32(laneSum, values);
+                    laneSquaredSum = _mm256_add_epi32(laneSquaredSum, _mm256_mullo_epi32(values, values));
+                    storeLowBytes(out + i, values);
+                }
+                alignas(32) uint32_t sums[8], squaredSums[8];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(sums), laneSum);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(squaredSums), laneSquaredSum);
+                for (int lane = 0; lane < 8; lane++) {
+                    sum += sums[lane];
+                    squaredSum += squaredSums[lane];
+                }
+            }
+            stats.sum += sum;
+            stats.squaredSum += squaredSum;
+            gatherTranslatedTiledScalar(image, x, y, dx + i, dy + i, n - i, out + i, stats);
+        }
+#endif
+
+        Level detectLevelImpl() {
+#ifdef SIMD_KERNELS_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f")) {
+                return Level::AVX512;
+            }
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return Level::AVX2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return Level::SSE2;
+            }
+#endif
+            return Level::Scalar;
+        }
+
+        // Extensions that only select between kernels of the same Level
+        struct CpuFeatures {
+            bool avx512bw = false;
+            bool avx512vnni = false;
+            bool avxvnni = false;
+        };
+
+        const CpuFeatures& cpuFeatures() {
+            static const CpuFeatures features = [] {
+                CpuFeatures f;
+#ifdef SIMD_KERNELS_X86
+                __builtin_cpu_init();
+                f.avx512bw = __builtin_cpu_supports("avx512bw");
+                f.avx512vnni = f.avx512bw && __builtin_cpu_supports("avx512vnni");
+                f.avxvnni = __builtin_cpu_supports("avxvnni");
+#endif
+                return f;
+            }();
+            return features;
+        }
+
+        std::atomic<Level>& currentLevel() {
+            static std::atomic<Level> level(detectLevel());
+            return level;
+        }
+    }
+
+    Level detectLevel() {
+        static const Level detected = detectLevelImpl();
+        return detected;
+    }
+
+    Level activeLevel() {
+        return currentLevel().load(std::memory_order_relaxed);
+    }
+
+    void setLevel(Level level) {
+        currentLevel().store(std::min(level, detectLevel()), std::memory_order_relaxed);
+    }
+
+    const char* levelName(Level level) {
+        switch (level) {
+            case Level::Scalar: return "scalar";
+            case Level::SSE2: return "sse2";
+            case Level::AVX2: return "avx2";
+            case Level::AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    bool hasVnni() {
+        return cpuFeatures().avx512vnni || cpuFeatures().avxvnni;
+    }
+
+    uint64_t dotProductU8(const uint8_t* a, const uint8_t* b, std::size_t n) {
+#ifdef SIMD_KERNELS_X86
+        const CpuFeatures& cpu = cpuFeatures();
+        Level level = activeLevel();
+        if (level == Level::AVX512 && cpu.avx512vnni) return dotProductU8AVX512VNNI(a, b, n);
+        if (level == Level::AVX512 && cpu.avx512bw) return dotProductU8AVX512(a, b, n);
+        if (level >= Level::AVX2 && cpu.avxvnni) return dotProductU8AVXVNNI(a, b, n);
+        if (level >= Level::AVX2) return dotProductU8AVX2(a, b, n);
+#endif
+        return dotProductU8Scalar(a, b, n);
+    }
+
+    double dotProduct(const float* a, const float* b, std::size_t n) {
+        switch (activeLevel()) {
+#ifdef SIMD_KERNELS_X86
+            case Level::AVX512: return dotProductAVX512(a, b, n);
+            case Level::AVX2: return dotProductAVX2(a, b, n);
+            case Level::SSE2: return dotProductSSE2(a, b, n);
+#endif
+            default: return dotProductScalar(a, b, n);
+        }
+    }
+
+    FixedAffine FixedAffine::fromFloat(const float m[6]) {
+        FixedAffine a{};
+        a.a11 = static_cast<int32_t>(std::lround(m[0] * kFixedOne));
+        a.a12 = static_cast<int32_t>(std::lround(m[1] * kFixedOne));
+        a.a21 = static_cast<int32_t>(std::lround(m[3] * kFixedOne));
+        a.a22 = static_cast<int32_t>(std::lround(m[4] * kFixedOne));
+        double tx = std::floor(m[2]), ty = std::floor(m[5]);
+        a.baseX = static_cast<int32_t>(tx);
+        a.baseY = static_cast<int32_t>(ty);
+        // The fraction is kept below one so it cannot push the sum past the int32 budget
+        a.fracX = std::min(static_cast<int32_t>(std::lround((m[2] - tx) * kFixedOne)), (1 << kFixedShift) - 1);
+        a.fracY = std::min(static_cast<int32_t>(std::lround((m[5] - ty) * kFixedOne)), (1 << kFixedShift) - 1);
+        return a;
+    }
+
+    void gatherAffine(const ImageView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                      const FixedAffine& affine, uint8_t* out, SampleStats& stats) {
+#ifdef SIMD_KERNELS_X86
+        // 32 bit gather offsets limit the vector path to images below 2 GB
+        bool fitsGather = static_cast<double>(image.rows) * static_cast<double>(image.step) < 2147483647.0;
+        if (activeLevel() >= Level::AVX2 && fitsGather) {
+            gatherAffineAVX2(image, xs, ys, n, affine, out, stats);
+            return;
+        }
+#endif
+        gatherAffineScalar(image, xs, ys, n, affine, out, stats);
+    }
+
+    void gatherOffsets(const ImageView8u& image, std::ptrdiff_t origin, const int32_t* offsets, std::size_t n,
+                       uint8_t* out, SampleStats& stats) {
+#ifdef SIMD_KERNELS_X86
+        bool fitsGather = static_cast<double>(image.rows) * static_cast<double>(image.step) < 2147483647.0;
+        if (activeLevel() >= Level::AVX2 && fitsGather) {
+            gatherOffsetsAVX2(image, origin, offsets, n, out, stats);
+            return;
+        }
+#endif
+        gatherOffsetsScalar(image, origin, offsets, n, out, stats);
+    }
+
+    void gatherTranslated(const ImageView8u& image, int32_t x, int32_t y, const int32_t* dx, const int32_t* dy,
+                          std::size_t n, uint8_t* out, SampleStats& stats) {
+        uint64_t sum = 0, squaredSum = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            int32_t px = std::clamp(x + dx[i], 0, image.cols - 1);
+            int32_t py = std::clamp(y + dy[i], 0, image.rows - 1);
+            uint8_t val = image.data[static_cast<std::size_t>(py) * image.step + px];
+            sum += val;
+            squaredSum += static_cast<uint32_t>(val) * val;
+            out[i] = val;
+        }
+        stats.sum += sum;
+        stats.squaredSum += squaredSum;
+    }
+
+    void gatherAffine(const TiledView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                      const FixedAffine& affine, uint8_t* out, SampleStats& stats) {
+#ifdef SIMD_KERNELS_X86
+        // Tile slots are turned into 32 bit byte offsets as well
+        bool fitsGather = static_cast<double>(image.rows + 63) * static_cast<double>(image.cols + 63) < 2147483647.0;
+        if (activeLevel() >= Level::AVX2 && fitsGather) {
+            gatherAffineTiledAVX2(image, xs, ys, n, affine, out, stats);
+            return;
+        }
+#endif
+        gatherAffineTiledScalar(image, xs, ys, n, affine, out, stats);
+    }
+
+    void gatherTranslated(const TiledView8u& image, int32_t x, int32_t y, const int32_t* dx, const int32_t* dy,
+                          std::size_t n, uint8_t* out, SampleStats& stats) {
+#ifdef SIMD_KERNELS_X86
+        bool fitsGather = static_cast<double>(image.rows + 63) * static_cast<double>(image.cols + 63) < 2147483647.0;
+        if (activeLevel() >= Level::AVX2 && fitsGather) {
+            gatherTranslatedTiledAVX2(image, x, y, dx, dy, n, out, stats);
+            return;
+        }
+#endif
+        gatherTranslatedTiledScalar(image, x, y, dx, dy, n, out, stats);
+    }
+}
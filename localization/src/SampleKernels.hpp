@@ -0,0 +1,135 @@
+//
+// Vectorized kernels used when comparing image samples.
+// The best instruction set is picked at runtime, so the library can be
+// built without -march flags and still use AVX2 / AVX-512 where present.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace simd {
+
+    enum class Level {
+        Scalar, SSE2, AVX2, AVX512
+    };
+
+    /**
+     * Highest instruction set supported by the running CPU.
+     */
+    Level detectLevel();
+
+    /**
+     * Instruction set the kernels currently dispatch to.
+     */
+    Level activeLevel();
+
+    /**
+     * Forces the kernels to a specific instruction set. Levels above
+     * detectLevel() are clamped. Used by tests and benchmarks.
+     */
+    void setLevel(Level level);
+
+    const char* levelName(Level level);
+
+    /**
+     * Dot product of two float arrays with float accumulation.
+     * Both arrays should be 64 byte aligned and padded with zeros to
+     * paddedLength<float>(n) for the fastest path, but any n is accepted.
+     */
+    double dotProduct(const float* a, const float* b, std::size_t n);
+
+    /**
+     * Exact dot product of two byte arrays. Uses pmaddwd on widened bytes, or
+     * vpdpbusd where VNNI is available. Padding both arrays with zeros to
+     * paddedLength<uint8_t>(n) avoids the scalar tail.
+     */
+    uint64_t dotProductU8(const uint8_t* a, const uint8_t* b, std::size_t n);
+
+    /**
+     * True if dotProductU8 can use VNNI instructions on this CPU.
+     */
+    bool hasVnni();
+
+    /**
+     * 16.16 fixed-point form of a 2x3 affine transformation. The translation is
+     * split into an integer base and a fraction so the per-point arithmetic stays
+     * within int32 even for maps that are tens of thousands of pixels wide:
+     *   x' = baseX + ((fracX + a11 * x + a12 * y) >> 16)
+     * Points must stay small enough that |a11 * x| + |a12 * y| < 2^30, which holds
+     * for template sized point sets at any scale below 8.
+     */
+    struct FixedAffine {
+        int32_t a11, a12, a21, a22;
+        int32_t baseX, baseY;
+        int32_t fracX, fracY;
+
+        static FixedAffine fromFloat(const float m[6]);
+    };
+
+    /**
+     * Single channel 8 bit image described by its raw buffer.
+     */
+    struct ImageView8u {
+        const uint8_t* data;
+        int rows;
+        int cols;
+        std::size_t step;
+    };
+
+    /**
+     * Single channel 8 bit image stored as 64x64 tiles, see TiledImage.
+     */
+    struct TiledView8u {
+        const uint8_t* data;
+        int rows;
+        int cols;
+        int tilesX;
+        // Row-major tile number -> slot of the 4 KB tile in data
+        const uint32_t* tileIndex;
+    };
+
+    /**
+     * Running sums produced while gathering, used to derive the mean and the
+     * variance of a sample without a second pass.
+     */
+    struct SampleStats {
+        uint64_t sum = 0;
+        uint64_t squaredSum = 0;
+    };
+
+    /**
+     * Transforms each point (xs[i], ys[i]) with the affine, clamps it to the image
+     * and writes the pixel value to out[i]. Sum and squared sum of the gathered
+     * values are accumulated into stats.
+     */
+    void gatherAffine(const ImageView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                      const FixedAffine& affine, uint8_t* out, SampleStats& stats);
+
+    /**
+     * Writes image.data[origin + offsets[i]] to out[i]. The caller guarantees
+     * every index lies inside the image, so nothing is clamped.
+     */
+    void gatherOffsets(const ImageView8u& image, std::ptrdiff_t origin, const int32_t* offsets, std::size_t n,
+                       uint8_t* out, SampleStats& stats);
+
+    /**
+     * Writes the pixel at (x + dx[i], y + dy[i]), clamped to the image, to out[i].
+     * Slow path for patterns that reach past the image border.
+     */
+    void gatherTranslated(const ImageView8u& image, int32_t x, int32_t y, const int32_t* dx, const int32_t* dy,
+                          std::size_t n, uint8_t* out, SampleStats& stats);
+
+    /**
+     * gatherAffine for a tiled image.
+     */
+    void gatherAffine(const TiledView8u& image, const int32_t* xs, const int32_t* ys, std::size_t n,
+                      const FixedAffine& affine, uint8_t* out, SampleStats& stats);
+
+    /**
+     * gatherTranslated for a tiled image.
+     */
+    void gatherTranslated(const TiledView8u& image, int32_t x, int32_t y, const int32_t* dx, const int32_t* dy,
+                          std::size_t n, uint8_t* out, SampleStats& stats);
+}
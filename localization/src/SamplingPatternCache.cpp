@@ -0,0 +1,106 @@
+//
+// Cache of template sampling points rotated and scaled into map offsets.
+//
+
+#include "SamplingPatternCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "GeometryUtils.hpp"
+
+SamplingPatternCache::SamplingPatternCache(double angleStep, double scaleStep, size_t maxBytes)
+        : angleStep_(angleStep), scaleStep_(scaleStep), maxBytes_(maxBytes) {
+}
+
+void SamplingPatternCache::setPoints(const std::vector<cv::Point>& points, const cv::Point& center) {
+    if (points == points_ && center == center_) {
+        return;
+    }
+    points_ = points;
+    center_ = center;
+    clear();
+}
+
+const SamplingPattern& SamplingPatternCache::get(double angleDeg, double scale, size_t step) {
+    Key key{std::llround(angleDeg / angleStep_), std::llround(scale / scaleStep_)};
+    auto found = index_.find(key);
+    if (found != index_.end()) {
+        hits_++;
+        entries_.splice(entries_.begin(), entries_, found->second);
+    } else {
+        misses_++;
+        entries_.push_front(Entry{key, SamplingPattern()});
+        // Built from the quantized values, so a pattern does not depend on which request created it
+        build(entries_.front().pattern, static_cast<double>(key.angle) * angleStep_,
+              static_cast<double>(key.scale) * scaleStep_);
+        index_[key] = entries_.begin();
+        bytes_ += entries_.front().pattern.bytes();
+    }
+
+    SamplingPattern& pattern = entries_.front().pattern;
+    if (pattern.step != step || pattern.linear.size() != pattern.size()) {
+        bytes_ -= pattern.bytes();
+        pattern.step = step;
+        pattern.linear.resize(pattern.size());
+        for (size_t i = 0; i < pattern.size(); i++) {
+            pattern.linear[i] = pattern.dy[i] * static_cast<int32_t>(step) + pattern.dx[i];
+        }
+        bytes_ += pattern.bytes();
+    }
+    evict();
+    return pattern;
+}
+
+void SamplingPatternCache::setMemoryLimit(size_t maxBytes) {
+    maxBytes_ = maxBytes;
+    evict();
+}
+
+void SamplingPatternCache::clear() {
+    entries_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+void SamplingPatternCache::build(SamplingPattern& pattern, double angleDeg, double scale) const {
+    // Same matrix as Particle::mapTransformation, whose translation only moves
+    // the center onto the particle: P + R * (p - center)
+    double m[6];
+    geometry::rotationMatrix2D(cv::Point2d(0, 0), angleDeg, scale, m);
+
+    size_t n = points_.size();
+    pattern.dx.resize(n);
+    pattern.dy.resize(n);
+    pattern.linear.clear();
+    pattern.step = 0;
+    pattern.minX = pattern.minY = std::numeric_limits<int32_t>::max();
+    pattern.maxX = pattern.maxY = std::numeric_limits<int32_t>::min();
+    for (size_t i = 0; i < n; i++) {
+        double x = points_[i].x - center_.x,
+                y = points_[i].y - center_.y;
+        // floor(P + f) == P + floor(f) for integer P, so the offsets are exact for any position
+        auto dx = static_cast<int32_t>(std::floor(m[0] * x + m[1] * y));
+        auto dy = static_cast<int32_t>(std::floor(m[3] * x + m[4] * y));
+        pattern.dx[i] = dx;
+        pattern.dy[i] = dy;
+        pattern.minX = std::min(pattern.minX, dx);
+        pattern.maxX = std::max(pattern.maxX, dx);
+        pattern.minY = std::min(pattern.minY, dy);
+        pattern.maxY = std::max(pattern.maxY, dy);
+    }
+    if (n == 0) {
+        pattern.minX = pattern.maxX = pattern.minY = pattern.maxY = 0;
+    }
+}
+
+void SamplingPatternCache::evict() {
+    // The most recently used pattern is the one just handed out, never drop it
+    while (bytes_ > maxBytes_ && entries_.size() > 1) {
+        bytes_ -= entries_.back().pattern.bytes();
+        index_.erase(entries_.back().key);
+        entries_.pop_back();
+        evictions_++;
+    }
+}
@@ -0,0 +1,117 @@
+//
+// Cache of template sampling points rotated and scaled into map offsets.
+// Within a frame all particles share direction and scale, so the rotated
+// pattern is computed once and every particle only adds its own position.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/types.hpp>
+
+/**
+ * Sampling points after rotation and scaling, relative to the particle
+ * position: the i-th point of a particle at P is read from P + (dx[i], dy[i]).
+ */
+struct SamplingPattern {
+    std::vector<int32_t> dx, dy;
+    // dy * step + dx for the row step in `step`
+    std::vector<int32_t> linear;
+    size_t step = 0;
+    // Inclusive extent of the offsets
+    int32_t minX = 0, maxX = 0, minY = 0, maxY = 0;
+
+    size_t size() const { return dx.size(); }
+
+    size_t bytes() const { return (dx.capacity() + dy.capacity() + linear.capacity()) * sizeof(int32_t); }
+
+    /**
+     * True if every point of a particle at (x, y) falls inside a cols x rows image.
+     */
+    bool fits(int x, int y, int cols, int rows) const {
+        return x + minX >= 0 && y + minY >= 0 && x + maxX < cols && y + maxY < rows;
+    }
+};
+
+class SamplingPatternCache {
+public:
+    /**
+     * @param angleStep quantization of the rotation in degrees
+     * @param scaleStep quantization of the scale
+     * @param maxBytes memory bound for all cached patterns; least recently used
+     *                 patterns are dropped first, the pattern in use is always kept
+     */
+    explicit SamplingPatternCache(double angleStep = 0.01, double scaleStep = 0.0001, size_t maxBytes = 64u << 20);
+
+    /**
+     * Sets the template sampling points and the template center they are
+     * rotated around. Drops all cached patterns if the points changed.
+     */
+    void setPoints(const std::vector<cv::Point>& points, const cv::Point& center);
+
+    /**
+     * Pattern for the given rotation (degrees) and scale, with linear offsets
+     * prepared for an image with row step `step`. The reference stays valid
+     * until the next call.
+     */
+    const SamplingPattern& get(double angleDeg, double scale, size_t step);
+
+    void setMemoryLimit(size_t maxBytes);
+
+    void clear();
+
+    uint64_t hits() const { return hits_; }
+
+    uint64_t misses() const { return misses_; }
+
+    uint64_t evictions() const { return evictions_; }
+
+    size_t memoryUsage() const { return bytes_; }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Key {
+        int64_t angle;
+        int64_t scale;
+
+        bool operator==(const Key& other) const { return angle == other.angle && scale == other.scale; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<int64_t>()(key.angle * 1000003 ^ key.scale);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        SamplingPattern pattern;
+    };
+
+    void build(SamplingPattern& pattern, double angleDeg, double scale) const;
+
+    void evict();
+
+    double angleStep_;
+    double scaleStep_;
+    size_t maxBytes_;
+
+    std::vector<cv::Point> points_;
+    cv::Point center_;
+
+    // Most recently used entry first
+    std::list<Entry> entries_;
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    size_t bytes_ = 0;
+
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evictions_ = 0;
+};
@@ -0,0 +1,86 @@
+//
+// Single channel 8 bit image stored as 64x64 tiles in Morton (Z) order.
+//
+
+#include "TiledImage.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace {
+    uint64_t spreadBits(uint32_t v) {
+        uint64_t x = v;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return x;
+    }
+}
+
+TiledImage::TiledImage(const cv::Mat& image) {
+    assign(image);
+}
+
+uint64_t TiledImage::mortonCode(uint32_t tx, uint32_t ty) {
+    return spreadBits(tx) | (spreadBits(ty) << 1);
+}
+
+void TiledImage::assign(const cv::Mat& image) {
+    CV_Assert(image.type() == CV_8UC1);
+    rows_ = image.rows;
+    cols_ = image.cols;
+    tilesX_ = (cols_ + kTileSize - 1) / kTileSize;
+    tilesY_ = (rows_ + kTileSize - 1) / kTileSize;
+    size_t tileCount = static_cast<size_t>(tilesX_) * tilesY_;
+
+    // Rank the tiles by their Morton code. Ranking, rather than using the code
+    // as the address, keeps the storage compact for maps that are not square
+    // powers of two.
+    std::vector<uint32_t> order(tileCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return mortonCode(a % tilesX_, a / tilesX_) < mortonCode(b % tilesX_, b / tilesX_);
+    });
+    tileIndex_.resize(tileCount);
+    for (size_t slot = 0; slot < tileCount; slot++) {
+        tileIndex_[order[slot]] = static_cast<uint32_t>(slot);
+    }
+
+    tiles_.assign(tileCount * kTileBytes, 0);
+    for (int ty = 0; ty < tilesY_; ty++) {
+        for (int tx = 0; tx < tilesX_; tx++) {
+            uint8_t* tile = tiles_.data() + static_cast<size_t>(tileIndex_[ty * tilesX_ + tx]) * kTileBytes;
+            int x0 = tx * kTileSize, y0 = ty * kTileSize;
+            int width = std::min(kTileSize, cols_ - x0), height = std::min(kTileSize, rows_ - y0);
+            for (int y = 0; y < height; y++) {
+                std::memcpy(tile + y * kTileSize, image.ptr<uint8_t>(y0 + y) + x0, static_cast<size_t>(width));
+            }
+        }
+    }
+}
+
+void TiledImage::clear() {
+    rows_ = cols_ = tilesX_ = tilesY_ = 0;
+    tiles_.clear();
+    tiles_.shrink_to_fit();
+    tileIndex_.clear();
+    tileIndex_.shrink_to_fit();
+}
+
+simd::TiledView8u TiledImage::view() const {
+    return simd::TiledView8u{tiles_.data(), rows_, cols_, tilesX_, tileIndex_.data()};
+}
+
+cv::Mat TiledImage::toMat() const {
+    cv::Mat image(rows_, cols_, CV_8UC1);
+    for (int y = 0; y < rows_; y++) {
+        auto* row = image.ptr<uint8_t>(y);
+        for (int x = 0; x < cols_; x++) {
+            row[x] = at(x, y);
+        }
+    }
+    return image;
+}
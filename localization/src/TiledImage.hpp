@@ -0,0 +1,84 @@
+//
+// Single channel 8 bit image stored as 64x64 tiles in Morton (Z) order.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/mat.hpp>
+
+#include "AlignedBuffer.hpp"
+#include "SampleKernels.hpp"
+
+/**
+ * Rotated sampling walks a row-major map diagonally, so nearly every point
+ * lands on a different cache line and, on large maps, a different page.
+ * Here each 64x64 tile is one contiguous 4 KB block and neighbouring tiles
+ * are laid out along a Z-curve, so points that are close in 2D in any
+ * direction are close in memory too.
+ *
+ * Pixel (x, y) lives at
+ *   tileIndex[(y >> 6) * tilesX + (x >> 6)] * 4096 + (y & 63) * 64 + (x & 63)
+ * Tiles on the right and bottom border are padded with zeros.
+ */
+class TiledImage {
+public:
+    static constexpr int kTileShift = 6;
+    static constexpr int kTileSize = 1 << kTileShift;
+    static constexpr size_t kTileBytes = static_cast<size_t>(kTileSize) * kTileSize;
+
+    TiledImage() = default;
+
+    explicit TiledImage(const cv::Mat& image);
+
+    /**
+     * Copies a CV_8UC1 image into the tiled layout, reusing the storage if it
+     * is large enough.
+     */
+    void assign(const cv::Mat& image);
+
+    void clear();
+
+    bool empty() const { return tiles_.empty(); }
+
+    int rows() const { return rows_; }
+
+    int cols() const { return cols_; }
+
+    int tilesX() const { return tilesX_; }
+
+    int tilesY() const { return tilesY_; }
+
+    size_t bytes() const { return tiles_.size() + tileIndex_.size() * sizeof(uint32_t); }
+
+    uint8_t at(int x, int y) const {
+        return tiles_[offset(x, y)];
+    }
+
+    size_t offset(int x, int y) const {
+        return static_cast<size_t>(tileIndex_[(y >> kTileShift) * tilesX_ + (x >> kTileShift)]) * kTileBytes
+               + static_cast<size_t>((y & (kTileSize - 1)) << kTileShift) + (x & (kTileSize - 1));
+    }
+
+    simd::TiledView8u view() const;
+
+    /**
+     * Row-major copy of the image, mainly for tests and debugging.
+     */
+    cv::Mat toMat() const;
+
+    /**
+     * Position of tile (tx, ty) on the Z-curve: the bits of tx and ty interleaved.
+     */
+    static uint64_t mortonCode(uint32_t tx, uint32_t ty);
+
+private:
+    int rows_ = 0, cols_ = 0;
+    int tilesX_ = 0, tilesY_ = 0;
+    AlignedVector<uint8_t> tiles_;
+    // Row-major tile number -> slot of the tile in `tiles_`
+    std::vector<uint32_t> tileIndex_;
+};
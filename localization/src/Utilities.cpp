@@ -3,18 +3,20 @@
 //
 
 #include "Utilities.hpp"
+#include "ConfigBounds.hpp"
 
 #include <FAsT-Match/MatchConfig.h>
 
 #include <opencv2/imgproc.hpp>
 
-#include <chrono>
-#include <random>
+#include <algorithm>
 #include <cmath>
 
+#include <tbb/blocked_range.h>
 #include <tbb/parallel_for.h>
 
 #include "GeometryUtils.hpp"
+#include "ParticleNoise.hpp"
 
 
 double zeroIfNan(double x) {
@@ -203,10 +205,18 @@ float Utilities::getThresholdPerDelta(float delta) {
     return p[0] * delta + p[1] - safety;
 }
 
+namespace {
+// Every thread draws from its own stream, so callers running side by side
+// neither race on the state nor serialize on it. The filter itself draws
+// from the seeded streams of Particles and ParticleFastMatch.
+ParticleNoise& threadNoise() {
+    thread_local ParticleNoise noise(entropySeed());
+    return noise;
+}
+}
+
 double Utilities::normal_dist() {
-    static std::minstd_rand g(static_cast<unsigned long>(std::chrono::system_clock::now().time_since_epoch().count()));
-    static std::normal_distribution<double> normal(0.0, 0.33333);
-    return normal(g);
+    return threadNoise().normal();
 }
 
 double Utilities::gausian_noise(double u) {
@@ -218,9 +228,24 @@ double Utilities::gausian_noise(double u) {
 }
 
 double Utilities::uniform_dist() {
-    static std::uniform_real_distribution<double> uniform(0.0, 1.0);
-    static std::minstd_rand g(static_cast<unsigned long>(std::chrono::system_clock::now().time_since_epoch().count()));
-    return uniform(g);
+    return threadNoise().unit();
+}
+
+
+size_t Utilities::configsInside(const std::vector<fast_match::MatchConfig> &configs, std::vector<bool> &insiders,
+                                const cv::Size& imageSize, const cv::Size& templSize) {
+    const ConfigBounds bounds(imageSize, templSize);
+    // vector<bool> packs bits, so the parallel loop writes bytes
+    std::vector<uint8_t> inside(configs.size(), 0);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, configs.size(), 1024), [&](const tbb::blocked_range<size_t>& r) {
+        for (size_t i = r.begin(); i != r.end(); i++) {
+            inside[i] = bounds.contains(configs[i].getAffine());
+        }
+    });
+
+    insiders.assign(inside.begin(), inside.end());
+    return static_cast<size_t>(std::count(inside.begin(), inside.end(), 1));
 }
 
 /**
@@ -231,60 +256,32 @@ std::vector<cv::Mat> Utilities::configsToAffine(
         std::vector<fast_match::MatchConfig> &configs, std::vector<bool> &insiders,
         const cv::Size& imageSize, const cv::Size& templSize
 ) {
-    auto no_of_configs = static_cast<int>(configs.size());
-    std::vector<cv::Mat> affines(static_cast<size_t>(no_of_configs));
-
-    /* The boundary, between -10 to image size + 10 */
-    Point2d top_left(-geometry::kBoundaryPadding, -geometry::kBoundaryPadding);
-    Point2d bottom_right(imageSize.width + geometry::kBoundaryPadding, imageSize.height + geometry::kBoundaryPadding);
-
-
-    /* These are for the calculations of affine transformed corners */
-    int r1x = static_cast<int>(0.5 * (templSize.width - 1)),
-            r1y = static_cast<int>(0.5 * (templSize.height - 1)),
-            r2x = static_cast<int>(0.5 * (imageSize.width - 1)),
-            r2y = static_cast<int>(0.5 * (imageSize.height - 1));
-
-    Mat corners = (Mat_<float>(3, 4) << 1 - (r1x + 1), templSize.width - (r1x + 1), templSize.width - (r1x + 1), 1 - (r1x + 1),
-            1 - (r1y + 1), 1 - (r1y + 1), templSize.height - (r1y + 1), templSize.height - (r1y + 1),
-            1.0, 1.0, 1.0, 1.0);
-
-    Mat transl = (Mat_<float>(4, 2) << r2x + 1, r2y + 1,
-            r2x + 1, r2y + 1,
-            r2x + 1, r2y + 1,
-            r2x + 1, r2y + 1);
-
-    insiders.assign(static_cast<size_t>(no_of_configs), false);
-
-    /* Convert each configuration to corresponding affine transformation matrix */
-    tbb::parallel_for(0, no_of_configs, 1, [&](int i) {
-        Mat affine = configs[i].getAffineMatrix();
-
-        /* Check if our affine transformed rectangle still fits within our boundary */
-        Mat affine_corners = (affine * corners).t();
-        affine_corners = affine_corners + transl;
-
-        if (isWithinBounds(affine_corners.at<Point2f>(0, 0), top_left, bottom_right) &&
-            isWithinBounds(affine_corners.at<Point2f>(1, 0), top_left, bottom_right) &&
-            isWithinBounds(affine_corners.at<Point2f>(2, 0), top_left, bottom_right) &&
-            isWithinBounds(affine_corners.at<Point2f>(3, 0), top_left, bottom_right)) {
-
-            affines[i] = affine;
-            insiders[i] = true;
-        }
-    });
-
-    /* Filter out empty affine matrices (which initially don't fit within the preset boundary) */
-    /* It's done this way, so that I could parallelize the loop */
     std::vector<cv::Mat> result;
-    for (int i = 0; i < no_of_configs; i++) {
+    result.reserve(configsInside(configs, insiders, imageSize, templSize));
+    for (size_t i = 0; i < configs.size(); i++) {
         if (insiders[i])
-            result.push_back(affines[i]);
+            result.push_back(configs[i].getAffineMatrix());
     }
 
     return result;
 }
 
+size_t Utilities::configsToAffine(fast_match::MatchConfigBatch &configs, const cv::Size& imageSize,
+                                  const cv::Size& templSize) {
+    const ConfigBounds bounds(imageSize, templSize);
+    std::vector<uint8_t> inside(configs.size(), 0);
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, configs.size(), 4096), [&](const tbb::blocked_range<size_t>& r) {
+        size_t b = r.begin();
+        simd::AffineColumns columns{configs.a11.data() + b, configs.a12.data() + b, configs.translateX.data() + b,
+                                    configs.a21.data() + b, configs.a22.data() + b, configs.translateY.data() + b,
+                                    r.size()};
+        bounds.contains(columns, inside.data() + b);
+    });
+
+    return configs.compact(inside);
+}
+
 cv::Point Utilities::calculateLocationInMap(
         const cv::Size& image_size,
         const cv::Size& templ_size,
@@ -6,6 +6,7 @@
 
 #include <opencv2/opencv.hpp>
 #include "../FAsT-Match/MatchConfig.h"
+#include "MatchConfigBatch.hpp"
 
 class Utilities {
 public:
@@ -30,10 +31,26 @@ public:
 
     static double uniform_dist();
 
+    /**
+     * Flags in `insiders` the configurations within the boundaries of
+     * configsToAffine and returns how many there are, without building
+     * their matrices.
+     */
+    static size_t configsInside(const std::vector<fast_match::MatchConfig> &configs, std::vector<bool> &insiders,
+                                const cv::Size &imageSize, const cv::Size &templSize);
+
     static std::vector<cv::Mat> configsToAffine(
             std::vector<fast_match::MatchConfig> &configs, std::vector<bool> &insiders,
             const cv::Size &imageSize, const cv::Size &templSize);
 
+    /**
+     * configsToAffine for a batch, whose affine columns already are the
+     * matrices: drops the configurations outside the boundaries in place and
+     * returns how many are left.
+     */
+    static size_t configsToAffine(fast_match::MatchConfigBatch &configs, const cv::Size &imageSize,
+                                  const cv::Size &templSize);
+
     static cv::Mat getMapRoiMask(const cv::Size &image_size, const cv::Size &templ_size, cv::Mat &affine);
 
     static cv::Mat extractWarpedMapPart(cv::InputArray map, const cv::Size &templ_size, const cv::Mat &affine);
@@ -0,0 +1,87 @@
+#include "TestFramework.hpp"
+#include "io/BatchManifest.hpp"
+
+#include <sstream>
+#include <string>
+
+namespace {
+std::vector<BatchJob> readManifest(const std::string &text, const BatchJob &defaults = BatchJob()) {
+    std::istringstream in(text);
+    return BatchManifest::read(in, defaults, "/flights");
+}
+} // namespace
+
+void test_reads_jobs_with_defaults() {
+    BatchJob defaults;
+    defaults.skipRate = 3;
+    auto jobs = readManifest(
+            "# nightly regression\n"
+            "dataset,map,particle-count,resampler\n"
+            "\n"
+            "a,maps/a.tif,400,stratified\n"
+            "b,/maps/b.tif,,\n", defaults);
+    test::check(jobs.size() == 2, "comments and blank lines are skipped");
+    test::check(jobs[0].dataset == "/flights/a" && jobs[0].map == "/flights/maps/a.tif",
+                "relative paths are resolved against the manifest directory");
+    test::check(jobs[1].map == "/maps/b.tif", "absolute paths are kept");
+    test::check(jobs[0].config.particleCount == 400 && jobs[0].config.resampling == ResamplingMethod::Stratified,
+                "columns override the filter options");
+    test::check(jobs[1].config.particleCount == ParticleFilterConfig().particleCount &&
+                jobs[1].config.resampling == ParticleFilterConfig().resampling, "empty cells keep the defaults");
+    test::check(jobs[0].skipRate == 3 && jobs[1].skipRate == 3, "defaults come from the caller");
+    test::check(jobs[0].name == "a@a" && jobs[1].name == "b@b", "unnamed jobs are named after dataset and map");
+}
+
+void test_all_columns() {
+    auto jobs = readManifest(
+            "name,dataset,map,particle-radius,epsilon,quantile,kld-error,bin-size,no-gaussian,sample-density,"
+            "tiled-map,pattern-cache-mb,coarse-level,coarse-survivors,probability-window,seed,skip-rate,"
+            "correlation-bound,conversion-method\n"
+            "run1,d,m.tif,250,0.2,0.95,0.4,7,true,0.05,1,16,2,8,6,18446744073709551615,5,0.3,softmax\n");
+    test::check(jobs.size() == 1, "single job is read");
+    const auto &job = jobs[0];
+    test::check(job.name == "run1", "name column");
+    test::check_near(job.config.radius, 250.0, 1e-9, "particle-radius column");
+    test::check_near(job.config.epsilon, 0.2, 1e-6, "epsilon column");
+    test::check_near(job.config.quantile, 0.95, 1e-6, "quantile column");
+    test::check_near(job.config.kld_error, 0.4, 1e-6, "kld-error column");
+    test::check(job.config.binSize == 7, "bin-size column");
+    test::check(!job.config.use_gaussian, "no-gaussian column");
+    test::check_near(job.config.sampleDensity, 0.05, 1e-6, "sample-density column");
+    test::check(job.config.tiledMap && job.config.patternCacheMB == 16, "map sampling columns");
+    test::check(job.config.coarseLevel == 2 && job.config.coarseSurvivors == 8, "coarse-to-fine columns");
+    test::check(job.config.probabilityWindow == 6, "probability-window column");
+    test::check(job.config.seed && *job.config.seed == 18446744073709551615ULL, "seed column");
+    test::check(job.skipRate == 5, "skip-rate column");
+    test::check_near(job.correlationBound, 0.3, 1e-6, "correlation-bound column");
+    test::check(job.conversionMethod == "softmax", "conversion-method column");
+}
+
+void test_rejects_bad_manifests() {
+    test::check_throws([] { readManifest("dataset,map,particles\nd,m.tif,4\n"); }, "unknown column throws");
+    test::check_throws([] { readManifest("dataset,particle-count\nd,4\n"); }, "header without map throws");
+    test::check_throws([] { readManifest("dataset,map\nd,\n"); }, "job without map throws");
+    test::check_throws([] { readManifest("dataset,map,particle-count\nd,m.tif,many\n"); }, "non-numeric value throws");
+    test::check_throws([] { readManifest("dataset,map,particle-count\nd,m.tif,12x\n"); }, "trailing characters throw");
+    test::check_throws([] { readManifest("dataset,map,coarse-level\nd,m.tif,9\n"); }, "invalid config throws");
+    test::check_throws([] { readManifest("dataset,map,seed\nd,m.tif,-1\n"); }, "negative seed throws");
+    test::check_throws([] { readManifest("dataset,map,resampler\nd,m.tif,random\n"); }, "unknown resampler throws");
+    test::check_throws([] { readManifest("dataset,map,skip-rate\nd,m.tif,0\n"); }, "zero skip rate throws");
+    test::check_throws([] { readManifest("dataset,map\nd,m.tif,extra\n"); }, "extra cells throw");
+
+    bool namesLine = false;
+    try {
+        readManifest("dataset,map,epsilon\n\nd,m.tif,2\n");
+    } catch (const std::invalid_argument &e) {
+        namesLine = std::string(e.what()).find("line 3") != std::string::npos;
+    }
+    test::check(namesLine, "error names the manifest line");
+}
+
+int main() {
+    std::cout << "=== BatchManifest Tests ===\n";
+    test_reads_jobs_with_defaults();
+    test_all_columns();
+    test_rejects_bad_manifests();
+    return test::report();
+}
@@ -62,6 +62,48 @@ void test_bin_size_zero() {
     test::check_throws([&]{ config.validate(); }, "zero binSize throws");
 }
 
+void test_sample_density_out_of_range() {
+    ParticleFilterConfig config;
+    config.sampleDensity = 0.0f;
+    test::check_throws([&]{ config.validate(); }, "zero sampleDensity throws");
+    config.sampleDensity = 1.5f;
+    test::check_throws([&]{ config.validate(); }, "sampleDensity above 1 throws");
+    config.sampleDensity = 1.0f;
+    test::check_nothrow([&]{ config.validate(); }, "sampling every template pixel is valid");
+}
+
+void test_coarse_to_fine_bounds() {
+    ParticleFilterConfig config;
+    test::check(config.coarseLevel == 0, "coarse-to-fine evaluation is off by default");
+    config.coarseLevel = 5;
+    test::check_throws([&]{ config.validate(); }, "coarseLevel above 4 throws");
+    config.coarseLevel = -1;
+    test::check_throws([&]{ config.validate(); }, "negative coarseLevel throws");
+    config.coarseLevel = 2;
+    config.coarseSurvivors = 0;
+    test::check_throws([&]{ config.validate(); }, "zero coarseSurvivors throws");
+    config.coarseSurvivors = 16;
+    test::check_nothrow([&]{ config.validate(); }, "coarse level 2 with 16 survivors is valid");
+}
+
+void test_probability_window_bounds() {
+    ParticleFilterConfig config;
+    test::check(config.probabilityWindow == 4, "probabilities average 4 iterations by default");
+    config.probabilityWindow = 0;
+    test::check_throws([&]{ config.validate(); }, "zero probabilityWindow throws");
+    config.probabilityWindow = 17;
+    test::check_throws([&]{ config.validate(); }, "probabilityWindow above 16 throws");
+    config.probabilityWindow = 1;
+    test::check_nothrow([&]{ config.validate(); }, "window of one iteration is valid");
+}
+
+void test_seed_unset_by_default() {
+    ParticleFilterConfig config;
+    test::check(!config.seed, "no fixed seed by default");
+    config.seed = 0;
+    test::check_nothrow([&]{ config.validate(); }, "seed zero is valid");
+}
+
 void test_valid_custom_config() {
     ParticleFilterConfig config;
     config.radius = 100.0;
@@ -74,6 +116,19 @@ void test_valid_custom_config() {
     test::check_nothrow([&]{ config.validate(); }, "custom valid config passes");
 }
 
+void test_resampling_method_names() {
+    const ResamplingMethod methods[] = {
+            ResamplingMethod::Multinomial, ResamplingMethod::Alias, ResamplingMethod::Systematic,
+            ResamplingMethod::Stratified, ResamplingMethod::Residual
+    };
+    for (auto method : methods) {
+        std::string name = resamplingMethodName(method);
+        test::check(resamplingMethodFromString(name) == method, "resampling method round trips: " + name);
+    }
+    test::check_throws([]{ resamplingMethodFromString("roulette"); }, "unknown resampling method throws");
+    test::check(ParticleFilterConfig().resampling == ResamplingMethod::Systematic, "systematic resampling by default");
+}
+
 int main() {
     std::cout << "=== ParticleFilterConfig Tests ===\n";
     test_default_config_valid();
@@ -84,6 +139,11 @@ int main() {
     test_quantile_out_of_range();
     test_kld_error_zero();
     test_bin_size_zero();
+    test_sample_density_out_of_range();
+    test_coarse_to_fine_bounds();
+    test_probability_window_bounds();
+    test_seed_unset_by_default();
     test_valid_custom_config();
+    test_resampling_method_names();
     return test::report();
 }
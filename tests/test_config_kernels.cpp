@@ -0,0 +1,277 @@
+#include "TestFramework.hpp"
+#include "src/ConfigKernels.hpp"
+#include "src/SampleKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct Fixture {
+    std::vector<float> pixels;
+    simd::FloatImageView image{};
+    std::vector<float> xs, ys, values;
+
+    Fixture(int rows, int cols, size_t n, uint32_t seed) {
+        std::mt19937 gen(seed);
+        std::uniform_real_distribution<float> value(0.f, 1.f);
+        // A row stride wider than the image checks that `step` is honoured
+        size_t step = static_cast<size_t>(cols) + 5;
+        pixels.resize(step * rows);
+        for (auto& p : pixels) p = value(gen);
+        image = {pixels.data(), rows, cols, step};
+
+        std::uniform_real_distribution<float> coord(-20.f, 20.f);
+        for (size_t i = 0; i < n; i++) {
+            xs.push_back(std::round(coord(gen)));
+            ys.push_back(std::round(coord(gen)));
+            values.push_back(value(gen));
+        }
+    }
+
+    simd::ConfigSamples samples() const {
+        return {xs.data(), ys.data(), values.data(), values.size()};
+    }
+
+    float at(int column, int row) const {
+        if (column < 0 || column >= image.cols || row < 0 || row >= image.rows) return 0.f;
+        return pixels[static_cast<size_t>(row) * image.step + column];
+    }
+
+    void position(const simd::SampleAffine& a, size_t i, int& column, int& row) const {
+        float fx = a.a11 * xs[i] + a.a12 * ys[i] + a.cx;
+        float fy = a.a21 * xs[i] + a.a22 * ys[i] + a.cy;
+        column = static_cast<int>(fx) + a.ox;
+        row = static_cast<int>(fy) + a.oy;
+    }
+
+    double referenceSad(const simd::SampleAffine& a) const {
+        double sum = 0.0;
+        for (size_t i = 0; i < values.size(); i++) {
+            int column, row;
+            position(a, i, column, row);
+            if (column >= a.columnBegin && column < a.columnEnd) {
+                sum += std::fabs(static_cast<double>(values[i]) - at(column, row));
+            }
+        }
+        return sum;
+    }
+
+    double referencePhotometric(const simd::SampleAffine& a) const {
+        size_t n = values.size();
+        std::vector<double> gathered(n);
+        double sumX = 0, sumY = 0, sumXX = 0, sumYY = 0;
+        for (size_t i = 0; i < n; i++) {
+            int column, row;
+            position(a, i, column, row);
+            gathered[i] = at(column, row);
+            sumX += values[i];
+            sumY += gathered[i];
+            sumXX += static_cast<double>(values[i]) * values[i];
+            sumYY += gathered[i] * gathered[i];
+        }
+        double sigmaX = std::sqrt((sumXX - sumX * sumX / n) / n) + 1e-7;
+        double sigmaY = std::sqrt((sumYY - sumY * sumY / n) / n) + 1e-7;
+        double factor = sigmaX / sigmaY, offset = -sumX / n + factor * sumY / n;
+        double sum = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            sum += std::fabs(values[i] - factor * gathered[i] + offset);
+        }
+        return sum;
+    }
+
+    double valuesSum() const {
+        double sum = 0;
+        for (float v : values) sum += v;
+        return sum;
+    }
+
+    double valuesSquaredSum() const {
+        double sum = 0;
+        for (float v : values) sum += static_cast<double>(v) * v;
+        return sum;
+    }
+};
+
+// Rotated and scaled placement around the image center, partly leaving the image
+simd::SampleAffine placement(int rows, int cols, float angle, float scale) {
+    simd::SampleAffine a{};
+    a.a11 = scale * std::cos(angle);
+    a.a12 = -scale * std::sin(angle);
+    a.a21 = scale * std::sin(angle);
+    a.a22 = scale * std::cos(angle);
+    // Positive bias keeps the truncation a floor, as ConfigEvaluator does
+    a.cx = cols / 2.f + 0.5f + cols;
+    a.cy = rows / 2.f + 0.5f + rows;
+    a.ox = -cols;
+    a.oy = -rows;
+    a.columnBegin = 0;
+    a.columnEnd = cols;
+    return a;
+}
+
+const simd::Level kLevels[] = {simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2, simd::Level::AVX512};
+} // namespace
+
+void test_sad_matches_reference() {
+    // 1003 points: the vector loop of 16 leaves a scalar tail
+    Fixture f(48, 40, 1003, 1);
+    for (float scale : {0.5f, 1.f, 2.f}) {
+        auto a = placement(48, 40, 0.7f, scale);
+        double expected = f.referenceSad(a);
+        for (auto level : kLevels) {
+            if (level > simd::detectLevel()) continue;
+            simd::setLevel(level);
+            double got = simd::affineSad(f.image, f.samples(), a);
+            test::check_near(got, expected, 1e-4 * expected,
+                             std::string("affineSad matches reference at ") + simd::levelName(level));
+        }
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_sad_skips_columns_outside() {
+    Fixture f(30, 30, 500, 2);
+    auto a = placement(30, 30, 0.f, 2.f);
+    // Narrow the counted columns to the middle of the image
+    a.columnBegin = 10;
+    a.columnEnd = 20;
+    double expected = f.referenceSad(a);
+    auto all = placement(30, 30, 0.f, 2.f);
+    test::check(expected < f.referenceSad(all), "reference leaves out samples outside the columns");
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double got = simd::affineSad(f.image, f.samples(), a);
+        test::check_near(got, expected, 1e-4 * expected,
+                         std::string("affineSad skips columns outside at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_photometric_matches_reference() {
+    Fixture f(48, 40, 1009, 3);
+    std::vector<float> scratch(f.values.size());
+    auto a = placement(48, 40, -1.2f, 1.5f);
+    double expected = f.referencePhotometric(a);
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double got = simd::affineSadPhotometric(f.image, f.samples(), a, f.valuesSum(), f.valuesSquaredSum(),
+                                                scratch.data());
+        test::check_near(got, expected, 1e-4 * expected,
+                         std::string("affineSadPhotometric matches reference at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_photometric_passes_sum_in_chunks() {
+    // The two passes on their own, the second one over chunks, add up to affineSadPhotometric
+    Fixture f(48, 40, 1000, 5);
+    std::vector<float> scratch(f.values.size());
+    auto a = placement(48, 40, 0.4f, 1.2f);
+    double whole = simd::affineSadPhotometric(f.image, f.samples(), a, f.valuesSum(), f.valuesSquaredSum(),
+                                              scratch.data());
+    auto scale = simd::gatherPhotometric(f.image, f.samples(), a, f.valuesSum(), f.valuesSquaredSum(),
+                                         scratch.data());
+    double chunked = 0.0, prefix = 0.0;
+    bool growing = true;
+    for (size_t begin = 0; begin < f.values.size(); begin += 64) {
+        size_t length = std::min<size_t>(64, f.values.size() - begin);
+        chunked += simd::scaledSad(f.values.data() + begin, scratch.data() + begin, scale, length);
+        growing = growing && chunked >= prefix;
+        prefix = chunked;
+    }
+    test::check_near(chunked, whole, 1e-5 * whole, "chunks of scaledSad add up to affineSadPhotometric");
+    test::check(growing, "partial sums of scaledSad never decrease");
+}
+
+void test_photometric_ignores_gain_and_bias() {
+    // The image equal to the template values up to gain and bias scores ~0
+    Fixture f(41, 41, 301, 4);
+    // Half scale keeps every sample inside the image
+    auto a = placement(41, 41, 0.f, 0.5f);
+    for (size_t i = 0; i < f.values.size(); i++) {
+        int column, row;
+        f.position(a, i, column, row);
+        f.pixels[static_cast<size_t>(row) * f.image.step + column] = 0.5f * f.values[i] + 0.25f;
+    }
+    // Points landing on the same pixel must agree on its value
+    for (size_t i = 0; i < f.values.size(); i++) {
+        int column, row;
+        f.position(a, i, column, row);
+        f.values[i] = (f.pixels[static_cast<size_t>(row) * f.image.step + column] - 0.25f) / 0.5f;
+    }
+    std::vector<float> scratch(f.values.size());
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double got = simd::affineSadPhotometric(f.image, f.samples(), a, f.valuesSum(), f.valuesSquaredSum(),
+                                                scratch.data());
+        test::check_near(got / f.values.size(), 0.0, 1e-4,
+                         std::string("affineSadPhotometric ignores gain and bias at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_corners_inside_matches_corners() {
+    // Template 21x21 in a 101x101 image padded by 10, as ConfigBounds sets it up
+    simd::CornerBox box{-10.f, 11.f, -10.f, 11.f, 51.f, 51.f, -10.f, -10.f, 111.f, 111.f};
+    // 1003 configs: the vector loop of 8 leaves a scalar tail
+    const size_t n = 1003;
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<float> trans(-80.f, 80.f), angle(-3.2f, 3.2f), scale(0.5f, 2.f);
+    std::vector<float> a11(n), a12(n), tx(n), a21(n), a22(n), ty(n);
+    for (size_t i = 0; i < n; i++) {
+        float r = angle(gen), sx = scale(gen), sy = scale(gen);
+        a11[i] = sx * std::cos(r);
+        a12[i] = -sy * std::sin(r);
+        a21[i] = sx * std::sin(r);
+        a22[i] = sy * std::cos(r);
+        tx[i] = trans(gen);
+        ty[i] = trans(gen);
+    }
+    // A config whose right edge lands exactly on the bound is outside
+    a11[0] = 1.f, a12[0] = 0.f, a21[0] = 0.f, a22[0] = 1.f, tx[0] = 49.f, ty[0] = 0.f;
+
+    // Every corner transformed on its own
+    std::vector<uint8_t> expected(n);
+    size_t expectedCount = 0;
+    const float cornersX[4] = {box.left, box.right, box.right, box.left};
+    const float cornersY[4] = {box.top, box.top, box.bottom, box.bottom};
+    for (size_t i = 0; i < n; i++) {
+        bool in = true;
+        for (int k = 0; k < 4; k++) {
+            float x = a11[i] * cornersX[k] + a12[i] * cornersY[k] + tx[i] + box.centerX;
+            float y = a21[i] * cornersX[k] + a22[i] * cornersY[k] + ty[i] + box.centerY;
+            in = in && x > box.minX && x < box.maxX && y > box.minY && y < box.maxY;
+        }
+        expected[i] = in;
+        expectedCount += in;
+    }
+    test::check(expected[0] == 0 && expectedCount > 0 && expectedCount < n, "some configs fall outside, some inside");
+
+    simd::AffineColumns columns{a11.data(), a12.data(), tx.data(), a21.data(), a22.data(), ty.data(), n};
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        std::vector<uint8_t> inside(n, 7);
+        size_t count = simd::cornersInside(columns, box, inside.data());
+        test::check(count == expectedCount && inside == expected,
+                    std::string("cornersInside agrees with the corners at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+int main() {
+    std::cout << "=== ConfigKernels Tests ===" << std::endl;
+    test_sad_matches_reference();
+    test_sad_skips_columns_outside();
+    test_photometric_matches_reference();
+    test_photometric_passes_sum_in_chunks();
+    test_photometric_ignores_gain_and_bias();
+    test_corners_inside_matches_corners();
+    return test::report();
+}
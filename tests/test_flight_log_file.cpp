@@ -0,0 +1,217 @@
+#include "TestFramework.hpp"
+#include "fastmatch-dataset/FlightLogFile.hpp"
+#include "fastmatch-dataset/MetadataEntryReader.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include <opencv2/imgcodecs.hpp>
+
+namespace fs = std::filesystem;
+
+namespace {
+const int kFrames = 5;
+
+fs::path testDir(const std::string &name) {
+    fs::path dir = fs::temp_directory_path() / ("test_flight_log_file_" + name);
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    return dir;
+}
+
+MetadataEntry makeEntry(int i) {
+    MetadataEntry entry;
+    entry.imageFileName = "frame_" + std::to_string(i) + ".png";
+    entry.latitude = 54.9 + i * 0.001;
+    entry.longitude = 23.9 - i * 0.001;
+    entry.altitude = 100.0 + i;
+    entry.imuOrientation = Quaternion(0.1 * i, 0.2, 0.3, 0.9);
+    entry.groundTruthPose = Vector3d(i, 2.0 * i, 3.0);
+    entry.groundTruthOrientation = Quaternion(0.5, 0.5, 0.5, 0.5);
+    entry.mapLocation = cv::Point(100 + i, 200 - i);
+    entry.svoPose = Vector3d(-1.0 * i, 0.5, 7.25);
+    return entry;
+}
+
+// Gray frame whose pixels encode the frame index
+cv::Mat makeFrame(int i, cv::Size size) {
+    cv::Mat frame(size, CV_8UC1);
+    for (int y = 0; y < frame.rows; y++) {
+        for (int x = 0; x < frame.cols; x++) {
+            frame.ptr<uint8_t>(y)[x] = static_cast<uint8_t>(i * 40 + x + y);
+        }
+    }
+    return frame;
+}
+
+bool sameFrame(const cv::Mat &a, const cv::Mat &b) {
+    if (a.empty() || a.size() != b.size()) {
+        return false;
+    }
+    for (int y = 0; y < a.rows; y++) {
+        for (int x = 0; x < a.cols; x++) {
+            if (a.ptr<uint8_t>(y)[x] != b.ptr<uint8_t>(y)[x]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool sameMetadata(const MetadataEntry &a, const MetadataEntry &b) {
+    return a.imageFileName == b.imageFileName && a.latitude == b.latitude && a.longitude == b.longitude &&
+           a.altitude == b.altitude && a.imuOrientation.getX() == b.imuOrientation.getX() &&
+           a.imuOrientation.getW() == b.imuOrientation.getW() &&
+           a.groundTruthPose.getY() == b.groundTruthPose.getY() &&
+           a.groundTruthOrientation.getZ() == b.groundTruthOrientation.getZ() &&
+           a.mapLocation == b.mapLocation && a.svoPose.getX() == b.svoPose.getX() &&
+           a.svoPose.getZ() == b.svoPose.getZ();
+}
+
+std::string writeLog(const fs::path &path, cv::Size frameSize, const MapCacheFile::SourceStamp &source) {
+    FlightLogWriter writer;
+    writer.open(path.string(), frameSize, source);
+    for (int i = 0; i < kFrames; i++) {
+        writer.append(makeEntry(i), frameSize.empty() ? cv::Mat() : makeFrame(i, frameSize));
+    }
+    writer.finish();
+    return path.string();
+}
+} // namespace
+
+void test_metadata_roundtrip() {
+    fs::path dir = testDir("metadata");
+    std::string path = writeLog(dir / "metadata.pflog", cv::Size(), MapCacheFile::SourceStamp());
+    FlightLogFile log;
+    test::check(log.open(path), "log without frames opens");
+    test::check(log.recordCount() == kFrames, "every record is stored");
+    test::check(!log.hasFrames() && log.frame(0).empty(), "log without frames has no frame store");
+    bool same = true;
+    for (int i = 0; i < kFrames; i++) {
+        MetadataEntry entry;
+        log.fillEntry(i, entry);
+        same &= sameMetadata(entry, makeEntry(i)) && entry.imageGray.empty();
+    }
+    test::check(same, "records read back unchanged");
+    test::check(log.fileName(3) == "frame_3.png", "file names are stored");
+}
+
+void test_frames_roundtrip() {
+    fs::path dir = testDir("frames");
+    // 30x20 pixels is not a multiple of the frame alignment
+    cv::Size size(30, 20);
+    std::string path = writeLog(dir / "metadata.pflog", size, MapCacheFile::SourceStamp());
+    FlightLogFile log;
+    test::check(log.open(path), "log with frames opens");
+    test::check(log.hasFrames() && log.getFrameSize() == size, "frame size is stored");
+    bool same = true;
+    bool aligned = true;
+    for (int i = 0; i < kFrames; i++) {
+        cv::Mat frame = log.frame(i);
+        same &= sameFrame(frame, makeFrame(i, size));
+        aligned &= reinterpret_cast<uintptr_t>(frame.data) % FlightLogFile::kFrameAlignment == 0;
+    }
+    test::check(same, "frames read back unchanged");
+    test::check(aligned, "frames are aligned");
+    MetadataEntry entry;
+    log.fillEntry(2, entry);
+    test::check(entry.imageGray.data == log.frame(2).data, "entries view the mapped frame without a copy");
+}
+
+void test_rejected_logs() {
+    fs::path dir = testDir("rejected");
+    MapCacheFile::SourceStamp source;
+    source.size = 1234;
+    source.modified = 42;
+    std::string path = writeLog(dir / "metadata.pflog", cv::Size(), source);
+    FlightLogFile log;
+    test::check(log.open(path, source), "log of the same source opens");
+    MapCacheFile::SourceStamp other = source;
+    other.modified = 43;
+    test::check(!log.open(path, other), "log of another source version is rejected");
+    test::check(log.open(path), "source check is skipped without a stamp");
+
+    fs::path garbage = dir / "garbage.pflog";
+    std::ofstream(garbage.string()) << "not a flight log";
+    test::check(!log.open(garbage.string()), "file without the header is rejected");
+    test::check(!log.open((dir / "missing.pflog").string()), "missing file is rejected");
+
+    fs::path truncated = dir / "truncated.pflog";
+    fs::copy_file(path, truncated);
+    fs::resize_file(truncated, fs::file_size(truncated) - 1);
+    test::check(!log.open(truncated.string()), "truncated log is rejected");
+
+    {
+        FlightLogWriter writer;
+        writer.open((dir / "unfinished.pflog").string(), cv::Size(), source);
+        writer.append(makeEntry(0));
+    }
+    size_t files = 0;
+    for (const auto &file : fs::directory_iterator(dir)) {
+        files += file.path().filename().string().find("unfinished") != std::string::npos ? 1 : 0;
+    }
+    test::check(files == 0, "unfinished log leaves no file behind");
+}
+
+void test_reader_backend() {
+    fs::path dir = testDir("reader");
+    cv::Size size(32, 24);
+    {
+        std::ofstream csv((dir / "metadata.csv").string());
+        csv << "Filename,Latitude,Longitude,RelativeAltitude,MapX,MapY\n";
+        for (int i = 0; i < kFrames; i++) {
+            cv::imwrite((dir / ("frame_" + std::to_string(i) + ".png")).string(), makeFrame(i, size));
+            csv << "frame_" << i << ".png,54.9,23.9,100," << i << ",0\n";
+        }
+    }
+    std::string csvPath = (dir / "metadata.csv").string();
+    {
+        MetadataEntryReader csvReader;
+        csvReader.setDecodeImages(false);
+        csvReader.openDirectory(dir.string());
+        FlightLogWriter writer;
+        writer.open(FlightLogFile::defaultPath(dir.string()), size, MapCacheFile::SourceStamp::of(csvPath));
+        MetadataEntry entry;
+        while (csvReader.readNextEntry(entry)) {
+            writer.append(entry, makeFrame(entry.mapLocation.x, size));
+        }
+        writer.finish();
+    }
+
+    MetadataEntryReader reader;
+    reader.setSkipRate(2);
+    test::check(reader.openDirectory(dir.string()) && reader.usesFlightLog(), "reader prefers an up to date log");
+    test::check(reader.rowCount() == kFrames, "log rows are counted");
+    int frames = 0;
+    bool same = true;
+    MetadataEntry entry;
+    while (reader.readNextEntry(entry)) {
+        same &= entry.mapLocation.x == 2 * frames && sameFrame(entry.getImage(), makeFrame(2 * frames, size)) &&
+                entry.imageFullPath == (dir / entry.imageFileName).string();
+        frames++;
+    }
+    test::check(frames == 3, "skip rate applies to the log");
+    test::check(same, "log entries carry their metadata and frame");
+
+    reader.setUseFlightLog(false);
+    test::check(reader.openDirectory(dir.string()) && !reader.usesFlightLog(), "log can be disabled");
+
+    std::ofstream((dir / "metadata.csv").string(), std::ios::app) << "frame_0.png,54.9,23.9,100,9,0\n";
+    reader.setUseFlightLog(true);
+    test::check(reader.openDirectory(dir.string()) && !reader.usesFlightLog(), "stale log falls back to the CSV");
+    test::check(reader.rowCount() == kFrames + 1, "CSV rows are read after the fallback");
+
+    fs::remove(csvPath);
+    test::check(reader.openDirectory(dir.string()) && reader.usesFlightLog(), "log is read when the CSV is gone");
+}
+
+int main() {
+    std::cout << "=== FlightLogFile Tests ===" << std::endl;
+
+    test_metadata_roundtrip();
+    test_frames_roundtrip();
+    test_rejected_logs();
+    test_reader_backend();
+
+    return test::report();
+}
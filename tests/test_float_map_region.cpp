@@ -0,0 +1,58 @@
+#include "TestFramework.hpp"
+#include "src/FloatMapRegion.hpp"
+
+#include <cmath>
+
+namespace {
+cv::Mat gradientMap(int rows, int cols) {
+    cv::Mat map(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            map.at<uint8_t>(y, x) = static_cast<uint8_t>((x + 3 * y) & 0xFF);
+        }
+    }
+    return map;
+}
+} // namespace
+
+void test_region_matches_preprocessed_map() {
+    cv::Mat map = gradientMap(120, 200);
+    FloatMapRegion region(map, cv::Rect(30, 40, 50, 20));
+    test::check(region.rect() == cv::Rect(30, 40, 50, 20), "region inside the map is kept");
+    bool equal = true;
+    for (int y = 40; y < 60; y++) {
+        for (int x = 30; x < 80; x++) {
+            equal &= std::fabs(region.at(x, y) - map.at<uint8_t>(y, x) / 255.0f) < 1e-6f;
+        }
+    }
+    test::check(equal, "pixels are scaled to [0, 1]");
+    test::check(region.bytes() == 50 * 20 * sizeof(float), "only the region is converted");
+}
+
+void test_reads_outside_are_zero() {
+    cv::Mat map = gradientMap(120, 200);
+    FloatMapRegion region(map, cv::Rect(30, 40, 50, 20));
+    test::check(region.at(29, 45) == 0.f && region.at(80, 45) == 0.f, "columns beside the region read as zero");
+    test::check(region.at(35, 39) == 0.f && region.at(35, 60) == 0.f, "rows beside the region read as zero");
+    test::check(region.at(-1000, -1000) == 0.f, "far negative coordinates read as zero");
+}
+
+void test_region_is_clipped_to_map() {
+    cv::Mat map = gradientMap(120, 200);
+    FloatMapRegion region(map, cv::Rect(-10, 100, 50, 50));
+    test::check(region.rect() == cv::Rect(0, 100, 40, 20), "region is clipped to the map");
+    test::check(region.covers(cv::Rect(5, 105, 10, 10)), "covers a rectangle inside it");
+    test::check(!region.covers(cv::Rect(5, 90, 10, 20)), "does not cover a rectangle crossing its edge");
+    test::check(region.covers(cv::Rect()), "empty rectangle is always covered");
+
+    FloatMapRegion outside(map, cv::Rect(500, 500, 10, 10));
+    test::check(outside.rect().empty() && outside.at(500, 500) == 0.f, "region outside the map is empty");
+}
+
+int main() {
+    std::cout << "=== Float Map Region Tests ===\n";
+    test_region_matches_preprocessed_map();
+    test_reads_outside_are_zero();
+    test_region_is_clipped_to_map();
+    return test::report();
+}
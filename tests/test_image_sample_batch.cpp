@@ -0,0 +1,85 @@
+#include "TestFramework.hpp"
+#include "src/GeometryUtils.hpp"
+#include "src/ImageSampleBatch.hpp"
+
+#include <random>
+
+namespace {
+const cv::Point kCenter(320, 240);
+
+cv::Mat randomImage(int rows, int cols, uint32_t seed) {
+    std::mt19937 gen(seed);
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            // Smooth component so neighbouring placements correlate
+            image.at<uint8_t>(y, x) = static_cast<uint8_t>((x / 3 + y / 5) % 200 + gen() % 56);
+        }
+    }
+    return image;
+}
+
+std::vector<cv::Point> randomPoints(size_t n) {
+    std::mt19937 gen(8);
+    std::uniform_int_distribution<int> xDist(0, 639), yDist(0, 479);
+    std::vector<cv::Point> points(n);
+    for (auto& p : points) {
+        p = cv::Point(xDist(gen), yDist(gen));
+    }
+    return points;
+}
+
+cv::Mat rotationMat(const cv::Point& position, double angle, double scale) {
+    double m[6];
+    geometry::rotationMatrix2D(position, angle, scale, m);
+    cv::Mat rotation(2, 3, CV_64F);
+    for (int i = 0; i < 6; i++) {
+        rotation.at<double>(i / 3, i % 3) = m[i];
+    }
+    return rotation;
+}
+} // namespace
+
+void test_batch_similarity_matches_image_sample() {
+    cv::Mat map = randomImage(1500, 1700, 1);
+    cv::Mat templ = randomImage(480, 640, 2);
+    auto points = randomPoints(4001);
+    ImageSample templSample(templ, points, 117.3f);
+
+    const double angle = 23.0, scale = 0.9;
+    // Inside the map, and partly over the border so the clamped path runs too
+    std::vector<cv::Point> positions = {{700, 700}, {850, 640}, {1000, 900}, {60, 1450}};
+    SamplingPatternCache cache;
+    cache.setPoints(points, kCenter);
+    ImageSampleBatch batch;
+    batch.gather(map, cache.get(angle, scale, map.step), positions);
+
+    bool close = true;
+    for (size_t i = 0; i < positions.size(); i++) {
+        ImageSample reference(map, points, rotationMat(positions[i], angle, scale), positions[i]);
+        close &= std::abs(batch.similarity(templSample, i) - templSample.calcSimilarity(reference)) < 1e-3;
+    }
+    test::check(close, "integer batch correlation matches the float ImageSample correlation");
+    test::check(batch.size() == positions.size(), "one sample per position");
+}
+
+void test_batch_self_similarity() {
+    cv::Mat map = randomImage(1200, 1200, 3);
+    auto points = randomPoints(3000);
+    std::vector<cv::Point> positions = {{600, 600}};
+    SamplingPatternCache cache;
+    cache.setPoints(points, kCenter);
+    ImageSampleBatch batch;
+    batch.gather(map, cache.get(0.0, 1.0, map.step), positions);
+
+    // A template cut from the map at the same placement correlates perfectly
+    ImageSample templSample(map, points, rotationMat(positions[0], 0.0, 1.0), positions[0]);
+    test::check_near(batch.similarity(templSample, 0), 1.0, 1e-6, "sample correlates perfectly with itself");
+}
+
+int main() {
+    std::cout << "=== Image Sample Batch Tests ===\n";
+    test_batch_similarity_matches_image_sample();
+    test_batch_self_similarity();
+    return test::report();
+}
@@ -0,0 +1,74 @@
+#include "TestFramework.hpp"
+#include "src/KldSampling.hpp"
+
+#include <cmath>
+#include <random>
+#include <set>
+
+void test_bin_set_insert_and_duplicates() {
+    KldBinSet bins;
+    test::check(bins.insert(KldBinSet::key(3, 4)), "first insert reports a new bin");
+    test::check(!bins.insert(KldBinSet::key(3, 4)), "second insert of the same bin is rejected");
+    test::check(bins.insert(KldBinSet::key(4, 3)), "swapped coordinates are a different bin");
+    test::check(bins.size() == 2, "size counts distinct bins");
+}
+
+void test_bin_set_negative_bins() {
+    KldBinSet bins;
+    test::check(bins.insert(KldBinSet::key(-1, 0)), "negative x bin inserted");
+    test::check(bins.insert(KldBinSet::key(0, -1)), "negative y bin inserted");
+    test::check(bins.insert(KldBinSet::key(-1, -1)), "negative x and y bin inserted");
+    test::check(!bins.insert(KldBinSet::key(-1, 0)), "negative bin found again");
+}
+
+void test_bin_set_clear() {
+    KldBinSet bins;
+    for (int i = 0; i < 100; i++) {
+        bins.insert(KldBinSet::key(i, i));
+    }
+    bins.clear();
+    test::check(bins.size() == 0, "clear resets size");
+    test::check(bins.insert(KldBinSet::key(5, 5)), "bins from before clear are free again");
+}
+
+void test_bin_set_matches_reference() {
+    KldBinSet bins(4);
+    std::set<uint64_t> reference;
+    std::mt19937 rng(7);
+    std::normal_distribution<double> dist(0.0, 40.0);
+    bool agree = true;
+    for (int frame = 0; frame < 5; frame++) {
+        bins.clear();
+        reference.clear();
+        for (int i = 0; i < 5000; i++) {
+            uint64_t key = KldBinSet::key(static_cast<int32_t>(dist(rng)), static_cast<int32_t>(dist(rng)));
+            agree &= bins.insert(key) == reference.insert(key).second;
+        }
+        agree &= bins.size() == reference.size();
+    }
+    test::check(agree, "set agrees with std::set across growth and clears");
+}
+
+void test_bound_table_matches_formula() {
+    const float kldError = 0.5f, zvalue = 2.33f;
+    KldBoundTable table(kldError, zvalue, 8);
+    bool equal = true;
+    // Indices past the initial size force the table to extend
+    for (int support = 2; support < 5000; support++) {
+        int k = support - 1;
+        int expected = static_cast<int>(ceil(k / (2 * kldError) * pow(1 - 2 / (9.0 * k) + sqrt(2 / (9.0 * k)) * zvalue, 3)));
+        equal &= table(static_cast<size_t>(support)) == expected;
+    }
+    test::check(equal, "bound table equals the KLD formula");
+    test::check(table(1) == 0, "single bin imposes no bound");
+}
+
+int main() {
+    std::cout << "=== KLD Sampling Tests ===\n";
+    test_bin_set_insert_and_duplicates();
+    test_bin_set_negative_bins();
+    test_bin_set_clear();
+    test_bin_set_matches_reference();
+    test_bound_table_matches_formula();
+    return test::report();
+}
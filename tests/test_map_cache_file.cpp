@@ -0,0 +1,129 @@
+#include "TestFramework.hpp"
+#include "fastmatch-dataset/MapCacheFile.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace {
+cv::Mat randomImage(int rows, int cols, uint32_t seed) {
+    std::mt19937 gen(seed);
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            image.at<uint8_t>(y, x) = static_cast<uint8_t>(gen());
+        }
+    }
+    return image;
+}
+
+bool sameImage(const cv::Mat& a, const cv::Mat& b) {
+    if (a.rows != b.rows || a.cols != b.cols) {
+        return false;
+    }
+    for (int y = 0; y < a.rows; y++) {
+        for (int x = 0; x < a.cols; x++) {
+            if (a.at<uint8_t>(y, x) != b.at<uint8_t>(y, x)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::string cachePath(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / ("test_map_cache_" + name + ".pfcache")).string();
+}
+
+MapCacheFile::Georeference sampleGeoreference() {
+    MapCacheFile::Georeference geo;
+    const double transform[6] = {500000.0, 0.5, 0.0, 6100000.0, 0.0, -0.5};
+    std::copy(transform, transform + 6, geo.geoTransform);
+    geo.zoneNumber = 35;
+    geo.northp = 1;
+    return geo;
+}
+
+const MapCacheFile::SourceStamp kStamp{123456, 789};
+} // namespace
+
+void test_round_trip() {
+    std::string path = cachePath("round_trip");
+    // Odd sizes, so no level is a multiple of the page alignment
+    std::vector<cv::Mat> levels = {randomImage(301, 517, 1), randomImage(151, 259, 2), randomImage(76, 130, 3)};
+    test::check(MapCacheFile::write(path, kStamp, sampleGeoreference(), levels), "cache is written");
+
+    MapCacheFile cache;
+    test::check(cache.open(path, kStamp), "cache opens for the same source");
+    test::check(cache.levelCount() == levels.size(), "all levels are stored");
+    bool equal = cache.levelCount() == levels.size();
+    for (size_t i = 0; equal && i < levels.size(); i++) {
+        equal = sameImage(cache.level(i), levels[i]);
+    }
+    test::check(equal, "levels are read back unchanged");
+    test::check(reinterpret_cast<uintptr_t>(cache.level(1).data) % MapCacheFile::kAlignment == 0,
+                "levels are page aligned");
+    const auto& geo = cache.georeference();
+    test::check(geo.zoneNumber == 35 && geo.northp == 1 && geo.geoTransform[0] == 500000.0 &&
+                geo.geoTransform[5] == -0.5, "georeference is read back");
+    cache.close();
+    std::remove(path.c_str());
+}
+
+void test_stale_cache_is_rejected() {
+    std::string path = cachePath("stale");
+    MapCacheFile::write(path, kStamp, sampleGeoreference(), {randomImage(10, 10, 4)});
+    MapCacheFile cache;
+    test::check(!cache.open(path, MapCacheFile::SourceStamp{kStamp.size + 1, kStamp.modified}),
+                "changed source size invalidates the cache");
+    test::check(!cache.open(path, MapCacheFile::SourceStamp{kStamp.size, kStamp.modified + 1}),
+                "changed source time invalidates the cache");
+    test::check(!cache.isOpen(), "rejected cache is not mapped");
+    std::remove(path.c_str());
+}
+
+void test_foreign_files_are_rejected() {
+    MapCacheFile cache;
+    test::check(!cache.open(cachePath("missing"), kStamp), "missing cache is not opened");
+
+    std::string path = cachePath("foreign");
+    MapCacheFile::write(path, kStamp, sampleGeoreference(), {randomImage(10, 10, 5)});
+    {
+        // Bump the version field right after the magic
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(8);
+        uint32_t version = MapCacheFile::kVersion + 1;
+        file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+    test::check(!cache.open(path, kStamp), "cache of another version is rejected");
+
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a cache";
+    }
+    test::check(!cache.open(path, kStamp), "truncated file is rejected");
+    std::remove(path.c_str());
+}
+
+void test_source_stamp() {
+    std::string path = cachePath("stamp_source");
+    {
+        std::ofstream file(path);
+        file << "map";
+    }
+    auto stamp = MapCacheFile::SourceStamp::of(path);
+    test::check(stamp.size == 3, "stamp holds the file size");
+    test::check(stamp == MapCacheFile::SourceStamp::of(path), "stamp of an unchanged file is stable");
+    std::remove(path.c_str());
+    test::check(MapCacheFile::SourceStamp::of(path) == MapCacheFile::SourceStamp(), "missing file has an empty stamp");
+}
+
+int main() {
+    std::cout << "=== Map Cache File Tests ===\n";
+    test_round_trip();
+    test_stale_cache_is_rejected();
+    test_foreign_files_are_rejected();
+    test_source_stamp();
+    return test::report();
+}
@@ -0,0 +1,74 @@
+#include "TestFramework.hpp"
+#include "fastmatch-dataset/MapPageTable.hpp"
+
+#include <algorithm>
+
+void test_grid_covers_map() {
+    MapPageTable table(cv::Size(1000, 600), cv::Size(256, 256));
+    test::check(table.pagesX() == 4 && table.pagesY() == 3, "partial pages are counted");
+    test::check(table.pageCount() == 12, "page count is the grid size");
+    test::check(table.pageRect(0) == cv::Rect(0, 0, 256, 256), "first page is a full page");
+    test::check(table.pageRect(11) == cv::Rect(768, 512, 232, 88), "last page is clipped to the map");
+    test::check(table.residentCount() == 0, "nothing is resident after construction");
+}
+
+void test_request_reports_missing_pages_once() {
+    MapPageTable table(cv::Size(1000, 600), cv::Size(256, 256));
+    std::vector<size_t> missing;
+    table.request(cv::Rect(200, 200, 100, 100), missing);
+    std::sort(missing.begin(), missing.end());
+    test::check(missing == std::vector<size_t>({0, 1, 4, 5}), "region on a page corner needs four pages");
+    test::check(table.residentCount() == 4, "requested pages become resident");
+
+    missing.clear();
+    table.request(cv::Rect(250, 10, 20, 20), missing);
+    test::check(missing.empty(), "resident pages are not reported again");
+
+    table.request(cv::Rect(-50, -50, 10, 10), missing);
+    test::check(missing.empty(), "region outside the map needs no pages");
+
+    table.request(cv::Rect(900, 520, 500, 500), missing);
+    test::check(missing == std::vector<size_t>({11}), "region is clipped to the map");
+}
+
+void test_evict_drops_least_recently_used() {
+    MapPageTable table(cv::Size(1024, 256), cv::Size(256, 256));
+    std::vector<size_t> missing, evicted;
+    for (int page = 0; page < 4; page++) {
+        table.request(cv::Rect(page * 256, 0, 1, 1), missing);
+    }
+    // Page 0 becomes the most recently used one
+    table.request(cv::Rect(0, 0, 1, 1), missing);
+
+    table.evict(4, cv::Rect(), evicted);
+    test::check(evicted.empty(), "nothing is evicted within the limit");
+
+    table.evict(2, cv::Rect(), evicted);
+    std::sort(evicted.begin(), evicted.end());
+    test::check(evicted == std::vector<size_t>({1, 2}), "oldest pages go first");
+    test::check(!table.isResident(1) && !table.isResident(2), "evicted pages are no longer resident");
+    test::check(table.residentCount() == 2, "resident count follows evictions");
+
+    missing.clear();
+    table.request(cv::Rect(256, 0, 1, 1), missing);
+    test::check(missing == std::vector<size_t>({1}), "evicted page is reported missing again");
+}
+
+void test_evict_keeps_protected_region() {
+    MapPageTable table(cv::Size(1024, 256), cv::Size(256, 256));
+    std::vector<size_t> missing, evicted;
+    table.request(cv::Rect(0, 0, 1024, 256), missing);
+    table.evict(1, cv::Rect(0, 0, 300, 10), evicted);
+    std::sort(evicted.begin(), evicted.end());
+    test::check(evicted == std::vector<size_t>({2, 3}), "pages under the kept region survive");
+    test::check(table.residentCount() == 2, "limit is exceeded rather than dropping kept pages");
+}
+
+int main() {
+    std::cout << "=== Map Page Table Tests ===\n";
+    test_grid_covers_map();
+    test_request_reports_missing_pages_once();
+    test_evict_drops_least_recently_used();
+    test_evict_keeps_protected_region();
+    return test::report();
+}
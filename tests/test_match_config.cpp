@@ -0,0 +1,425 @@
+#include "TestFramework.hpp"
+#include "FAsT-Match/MatchConfig.h"
+#include "FAsT-Match/MatchNet.h"
+#include "src/ConfigBounds.hpp"
+#include "src/FastMatch.hpp"
+#include "src/GridConfigExpander.hpp"
+#include "src/MatchConfigBatch.hpp"
+#include "src/Utilities.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+using fast_match::MatchConfig;
+using fast_match::MatchConfigBatch;
+
+namespace {
+fast_match::MatchNet smallNet() {
+    // Search of a 21x21 template in a 101x101 image, as FAsTMatch::apply sets it up
+    return fast_match::MatchNet(21, 21, 0.5f, -40.f, 40.f, -40.f, 40.f, static_cast<float>(-M_PI),
+                                static_cast<float>(M_PI), 0.5f, 2.0f);
+}
+
+bool sameAffine(const float* a, const float* b) {
+    return std::memcmp(a, b, 6 * sizeof(float)) == 0;
+}
+} // namespace
+
+void test_config_is_plain_value() {
+    test::check(std::is_trivially_copyable<MatchConfig>::value, "MatchConfig is trivially copyable");
+    test::check(sizeof(MatchConfig) <= 64, "MatchConfig fits a cache line");
+
+    MatchConfig a(3.f, -4.f, 0.3f, 1.1f, 0.9f, -0.7f);
+    a.setId(12);
+    MatchConfig b;
+    std::memcpy(static_cast<void*>(&b), &a, sizeof(MatchConfig));
+    test::check(b.getId() == 12 && sameAffine(a.getAffine(), b.getAffine()), "memcpy copies the config");
+}
+
+void test_affine_matches_formula() {
+    float tx = 3.f, ty = -4.f, r2 = 0.3f, sx = 1.1f, sy = 0.9f, r1 = -0.7f;
+    MatchConfig config(tx, ty, r2, sx, sy, r1);
+    const float* m = config.getAffine();
+    float c1 = cosf(r1), s1 = sinf(r1), c2 = cosf(r2), s2 = sinf(r2);
+    test::check_near(m[0], sx * c1 * c2 - sy * s1 * s2, 1e-6, "a11 follows the FAsT-Match formula");
+    test::check_near(m[1], -sx * c1 * s2 - sy * c2 * s1, 1e-6, "a12 follows the FAsT-Match formula");
+    test::check_near(m[3], sx * c2 * s1 + sy * c1 * s2, 1e-6, "a21 follows the FAsT-Match formula");
+    test::check_near(m[4], sy * c1 * c2 - sx * s1 * s2, 1e-6, "a22 follows the FAsT-Match formula");
+    test::check(m[2] == tx && m[5] == ty, "translation is the last column");
+
+    cv::Mat affine = config.getAffineMatrix();
+    test::check(affine.rows == 2 && affine.cols == 3 && affine.type() == CV_32F, "getAffineMatrix is 2x3 float");
+    test::check(affine.at<float>(0, 0) == m[0] && affine.at<float>(1, 2) == m[5], "getAffineMatrix holds the inline matrix");
+}
+
+void test_batch_round_trip() {
+    std::vector<MatchConfig> configs = {
+            MatchConfig(1.f, 2.f, 0.1f, 1.f, 1.f, 0.2f),
+            MatchConfig(-5.f, 7.f, -0.4f, 0.8f, 1.3f, 1.2f),
+            MatchConfig(0.f, 0.f, 0.f, 1.f, 1.f, 0.f),
+    };
+    MatchConfigBatch batch = MatchConfigBatch::fromConfigs(configs);
+    test::check(batch.size() == 3, "batch holds every config");
+
+    bool same = true;
+    for (size_t i = 0; i < configs.size(); i++) {
+        float m[6];
+        batch.affine(i, m);
+        same = same && sameAffine(m, configs[i].getAffine());
+    }
+    test::check(same, "batch affine columns equal the config matrices");
+
+    auto back = batch.toConfigs();
+    same = back.size() == configs.size();
+    for (size_t i = 0; same && i < back.size(); i++) {
+        same = sameAffine(back[i].getAffine(), configs[i].getAffine()) &&
+               back[i].getRotate1() == configs[i].getRotate1() && back[i].getScaleY() == configs[i].getScaleY();
+    }
+    test::check(same, "toConfigs restores the configs");
+
+    MatchConfigBatch other;
+    other.resize(1);
+    other.set(0, 1.f, 2.f, 0.1f, 1.f, 1.f, 0.2f);
+    float m[6];
+    other.affine(0, m);
+    test::check(sameAffine(m, configs[0].getAffine()), "set computes the matrix like MatchConfig::init");
+}
+
+void test_batch_compact_keeps_order() {
+    MatchConfigBatch batch;
+    batch.resize(6);
+    for (size_t i = 0; i < 6; i++) {
+        batch.set(i, static_cast<float>(i), 0.f, 0.f, 1.f, 1.f, 0.f);
+    }
+    size_t kept = batch.compact({1, 0, 0, 1, 1, 0});
+    test::check(kept == 3 && batch.size() == 3, "compact drops the unflagged configs");
+    test::check(batch.translateX[0] == 0.f && batch.translateX[1] == 3.f && batch.translateX[2] == 4.f,
+                "compact keeps the order");
+    test::check(batch.a11.size() == 3 && batch.rotate1.size() == 3, "compact shrinks every column");
+
+    MatchConfigBatch extra;
+    extra.pushFrom(batch, 2);
+    batch.append(extra);
+    test::check(batch.size() == 4 && batch.translateX[3] == 4.f, "append and pushFrom copy configs");
+}
+
+void test_grid_matches_net() {
+    GridConfigExpander grid;
+    ConfigExpanderBase& expander = grid;
+    expander.setNet(smallNet());
+    fast_match::MatchNet net = expander.getNet();
+    size_t tx = net.getXTranslationSteps().size(), ty = net.getYTranslationSteps().size();
+    size_t r = net.getRotationSteps().size(), s = net.getScaleSteps().size();
+
+    MatchConfigBatch configs;
+    expander.createListOfConfigs(cv::Size(21, 21), cv::Size(101, 101), configs);
+    test::check(configs.size() > 0 && configs.size() <= tx * ty * r * r * s * s, "grid size follows the net");
+
+    bool consistent = true;
+    for (size_t i = 0; i < configs.size(); i += 97) {
+        MatchConfig single(configs.translateX[i], configs.translateY[i], configs.rotate2[i], configs.scaleX[i],
+                           configs.scaleY[i], configs.rotate1[i]);
+        float m[6];
+        configs.affine(i, m);
+        consistent = consistent && sameAffine(m, single.getAffine());
+    }
+    test::check(consistent, "grid affine columns match their parameters");
+    test::check(configs.translateX.front() == net.getXTranslationSteps().front() &&
+                configs.translateX.back() == net.getXTranslationSteps().back(), "x translation is the outermost grid axis");
+
+    // Refilling reuses the batch
+    expander.createListOfConfigs(cv::Size(21, 21), cv::Size(101, 101), configs);
+    test::check(configs.size() == configs.a22.size(), "refilled grid keeps the columns aligned");
+}
+
+void test_random_expand_steps_around_sources() {
+    GridConfigExpander grid;
+    ConfigExpanderBase& expander = grid;
+    expander.setNet(smallNet());
+    fast_match::MatchNet net = expander.getNet();
+
+    MatchConfigBatch sources;
+    sources.push(MatchConfig(1.f, 2.f, 0.1f, 1.f, 1.f, 0.2f));
+    sources.push(MatchConfig(-5.f, 7.f, -0.4f, 0.8f, 1.3f, 1.2f));
+    MatchConfigBatch expanded;
+    const int points = 40, level = 2;
+    const float delta = 1.511f;
+    expander.randomExpandConfigs(sources, level, points, delta, expanded);
+    test::check(expanded.size() == sources.size() * points, "every config gets no_of_points neighbours");
+
+    // Each neighbour is its source moved by whole half steps
+    float factor = static_cast<float>(std::pow(delta, level));
+    auto wholeSteps = [](float d, float step) {
+        float k = d / step;
+        return std::fabs(k - std::round(k)) < 1e-3f && std::fabs(k) <= 4.f;
+    };
+    bool onSteps = true;
+    for (size_t row = 0; row < expanded.size(); row++) {
+        size_t i = row % sources.size();
+        onSteps = onSteps &&
+                  wholeSteps(expanded.translateX[row] - sources.translateX[i], net.stepsTransX / factor) &&
+                  wholeSteps(expanded.translateY[row] - sources.translateY[i], net.stepsTransY / factor) &&
+                  wholeSteps(expanded.rotate1[row] - sources.rotate1[i], net.stepsRotate / factor) &&
+                  wholeSteps(expanded.scaleY[row] - sources.scaleY[i], net.stepsScale / factor);
+    }
+    test::check(onSteps, "neighbour p of config i sits at p * count + i, whole half steps away");
+}
+
+void test_bounds_filter_matches_vector_version() {
+    std::vector<MatchConfig> configs;
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> trans(-80.f, 80.f), angle(-3.f, 3.f), scale(0.5f, 2.f);
+    for (int i = 0; i < 500; i++) {
+        configs.emplace_back(trans(gen), trans(gen), angle(gen), scale(gen), scale(gen), angle(gen));
+    }
+    std::vector<bool> insiders;
+    std::vector<cv::Mat> affines = Utilities::configsToAffine(configs, insiders, cv::Size(101, 101), cv::Size(21, 21));
+
+    MatchConfigBatch batch = MatchConfigBatch::fromConfigs(configs);
+    size_t kept = Utilities::configsToAffine(batch, cv::Size(101, 101), cv::Size(21, 21));
+    test::check(kept == affines.size() && kept == batch.size(), "batch keeps as many configs as the vector version");
+    test::check(kept > 0 && kept < configs.size(), "some configs fall outside, some inside");
+
+    bool same = true;
+    size_t k = 0;
+    for (size_t i = 0; i < configs.size(); i++) {
+        if (insiders[i]) {
+            same = same && k < batch.size() && batch.translateX[k] == configs[i].getTranslateX();
+            k++;
+        }
+    }
+    test::check(same, "batch keeps the same configs in order");
+
+    std::vector<bool> flags;
+    size_t inside = Utilities::configsInside(configs, flags, cv::Size(101, 101), cv::Size(21, 21));
+    test::check(inside == kept && flags == insiders, "configsInside flags the configs configsToAffine keeps");
+
+    MatchConfigBatch centered;
+    centered.push(MatchConfig(0.f, 0.f, 0.f, 1.f, 1.f, 0.f));
+    centered.push(MatchConfig(500.f, 0.f, 0.f, 1.f, 1.f, 0.f));
+    Utilities::configsToAffine(centered, cv::Size(101, 101), cv::Size(21, 21));
+    test::check(centered.size() == 1 && centered.translateX[0] == 0.f, "centered config stays, far one goes");
+}
+
+void test_bounds_extent_covers_corners() {
+    // Odd template, so calcCorners and ConfigBounds share the template center
+    const cv::Size imageSize(101, 101), templSize(21, 21);
+    const ConfigBounds bounds(imageSize, templSize);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> trans(-80.f, 80.f), angle(-3.f, 3.f), scale(0.5f, 2.f);
+    bool covered = true;
+    for (int i = 0; i < 200; i++) {
+        MatchConfig config(trans(gen), trans(gen), angle(gen), scale(gen), scale(gen), angle(gen));
+        cv::Point2f low, high;
+        bounds.extent(config.getAffine(), low, high);
+        cv::Mat affine = config.getAffineMatrix();
+        float minX = std::numeric_limits<float>::infinity(), maxX = -minX, minY = minX, maxY = -minX;
+        for (const auto& corner : Utilities::calcCorners(imageSize, templSize, affine)) {
+            minX = std::min(minX, static_cast<float>(corner.x));
+            maxX = std::max(maxX, static_cast<float>(corner.x));
+            minY = std::min(minY, static_cast<float>(corner.y));
+            maxY = std::max(maxY, static_cast<float>(corner.y));
+        }
+        // calcCorners truncates to whole pixels
+        covered = covered && std::fabs(low.x - minX) < 1.01f && std::fabs(high.x - maxX) < 1.01f &&
+                  std::fabs(low.y - minY) < 1.01f && std::fabs(high.y - maxY) < 1.01f;
+    }
+    test::check(covered, "corner extent matches the corners of calcCorners");
+}
+
+void test_evaluate_batch_matches_matrices() {
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> value(0.f, 1.f);
+    cv::Mat image(101, 101, CV_32F), templ(21, 21, CV_32F);
+    for (int y = 0; y < image.rows; y++)
+        for (int x = 0; x < image.cols; x++)
+            image.at<float>(y, x) = value(gen);
+    for (int y = 0; y < templ.rows; y++)
+        for (int x = 0; x < templ.cols; x++)
+            templ.at<float>(y, x) = value(gen);
+    cv::Mat xs(1, 50, CV_32SC1), ys(1, 50, CV_32SC1);
+    std::uniform_int_distribution<int> coord(1, 21);
+    for (int i = 0; i < 50; i++) {
+        xs.at<int>(0, i) = coord(gen);
+        ys.at<int>(0, i) = coord(gen);
+    }
+
+    std::vector<MatchConfig> configs = {
+            MatchConfig(0.f, 0.f, 0.f, 1.f, 1.f, 0.f),
+            MatchConfig(10.f, -12.f, 0.5f, 1.2f, 0.8f, -0.3f),
+            MatchConfig(-20.f, 5.f, -1.f, 0.7f, 0.7f, 2.f),
+    };
+    std::vector<cv::Mat> matrices;
+    for (const auto& config : configs) {
+        matrices.push_back(config.getAffineMatrix());
+    }
+    MatchConfigBatch batch = MatchConfigBatch::fromConfigs(configs);
+    for (bool photometric : {false, true}) {
+        auto fromMatrices = fast_match::FAsTMatch::evaluateConfigs(image, templ, matrices, xs, ys, photometric);
+        auto fromBatch = fast_match::FAsTMatch::evaluateConfigs(image, templ, batch, xs, ys, photometric);
+        test::check(fromMatrices == fromBatch, std::string("batch and matrices score alike, photometric ") +
+                                               (photometric ? "on" : "off"));
+    }
+}
+
+void test_early_termination_keeps_good_configs() {
+    std::mt19937 gen(6);
+    std::uniform_real_distribution<float> value(0.f, 1.f);
+    cv::Mat image(101, 101, CV_32F);
+    for (int y = 0; y < image.rows; y++)
+        for (int x = 0; x < image.cols; x++)
+            image.at<float>(y, x) = value(gen);
+    // The template is part of the image, so one config lands close to 0
+    cv::Mat templ(21, 21, CV_32F);
+    for (int y = 0; y < templ.rows; y++)
+        for (int x = 0; x < templ.cols; x++)
+            templ.at<float>(y, x) = image.at<float>(y + 40, x + 40);
+    // Several chunks of samples per config
+    const int points = 300;
+    cv::Mat xs(1, points, CV_32SC1), ys(1, points, CV_32SC1);
+    std::uniform_int_distribution<int> coord(1, 21);
+    for (int i = 0; i < points; i++) {
+        xs.at<int>(0, i) = coord(gen);
+        ys.at<int>(0, i) = coord(gen);
+    }
+
+    GridConfigExpander grid;
+    ConfigExpanderBase& expander = grid;
+    expander.setNet(smallNet());
+    MatchConfigBatch configs;
+    expander.createListOfConfigs(templ.size(), image.size(), configs);
+    Utilities::configsToAffine(configs, image.size(), templ.size());
+
+    for (bool photometric : {false, true}) {
+        std::string mode = std::string(", photometric ") + (photometric ? "on" : "off");
+        auto full = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, photometric);
+        double best = *std::min_element(full.begin(), full.end());
+        const double margin = 0.05;
+        auto pruned = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, photometric, margin);
+
+        bool sameGood = true, boundsAbove = true;
+        size_t abandoned = 0;
+        for (size_t i = 0; i < full.size(); i++) {
+            if (full[i] <= best + margin) {
+                sameGood = sameGood && pruned[i] == full[i];
+            } else if (pruned[i] != full[i]) {
+                abandoned++;
+                boundsAbove = boundsAbove && pruned[i] > best + margin && pruned[i] <= full[i];
+            }
+        }
+        test::check(sameGood, "configs within the margin keep their exact distance" + mode);
+        test::check(boundsAbove, "abandoned configs get a lower bound beyond the margin" + mode);
+        test::check(abandoned > 0, "configs far from the best are abandoned" + mode);
+
+        auto minimum = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, photometric, 0.0);
+        test::check(std::min_element(minimum.begin(), minimum.end()) - minimum.begin() ==
+                    std::min_element(full.begin(), full.end()) - full.begin(),
+                    "a margin of 0 keeps the best config" + mode);
+    }
+}
+
+void test_grid_decodes_the_listed_configs() {
+    GridConfigExpander grid;
+    ConfigExpanderBase& expander = grid;
+    expander.setNet(smallNet());
+    MatchConfigBatch listed;
+    expander.createListOfConfigs(cv::Size(21, 21), cv::Size(101, 101), listed);
+    fast_match::ConfigGrid decoded = expander.createConfigGrid(cv::Size(21, 21), cv::Size(101, 101));
+    test::check(decoded.size() == listed.size(), "grid size equals the listed configs");
+
+    bool same = true;
+    MatchConfigBatch pushed;
+    for (size_t i = 0; i < decoded.size(); i += 7) {
+        float a[6], b[6];
+        decoded.affine(i, a);
+        listed.affine(i, b);
+        MatchConfig config = decoded.get(i);
+        decoded.pushTo(i, pushed);
+        size_t last = pushed.size() - 1;
+        same = same && sameAffine(a, b) && sameAffine(config.getAffine(), b) &&
+               config.getRotate1() == listed.rotate1[i] && config.getScaleX() == listed.scaleX[i] &&
+               pushed.translateY[last] == listed.translateY[i] && pushed.a21[last] == listed.a21[i];
+    }
+    test::check(same, "decoded configs are bit for bit the listed ones");
+}
+
+void test_streamed_grid_matches_batch() {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> value(0.f, 1.f);
+    cv::Mat image(101, 101, CV_32F);
+    for (int y = 0; y < image.rows; y++)
+        for (int x = 0; x < image.cols; x++)
+            image.at<float>(y, x) = value(gen);
+    cv::Mat templ(21, 21, CV_32F);
+    for (int y = 0; y < templ.rows; y++)
+        for (int x = 0; x < templ.cols; x++)
+            templ.at<float>(y, x) = image.at<float>(y + 30, x + 45);
+    const int points = 200;
+    cv::Mat xs(1, points, CV_32SC1), ys(1, points, CV_32SC1);
+    std::uniform_int_distribution<int> coord(1, 21);
+    for (int i = 0; i < points; i++) {
+        xs.at<int>(0, i) = coord(gen);
+        ys.at<int>(0, i) = coord(gen);
+    }
+
+    GridConfigExpander expander;
+    ConfigExpanderBase& base = expander;
+    base.setNet(smallNet());
+    fast_match::ConfigGrid grid = base.createConfigGrid(templ.size(), image.size());
+    MatchConfigBatch configs;
+    base.createListOfConfigs(templ.size(), image.size(), configs);
+    // Grid index of every config left after the bounds check
+    std::vector<size_t> listed;
+    {
+        MatchConfigBatch indexed = configs;
+        for (size_t i = 0; i < indexed.size(); i++) indexed.rotate2[i] = static_cast<float>(i);
+        Utilities::configsToAffine(indexed, image.size(), templ.size());
+        for (size_t i = 0; i < indexed.size(); i++) listed.push_back(static_cast<size_t>(indexed.rotate2[i]));
+    }
+    Utilities::configsToAffine(configs, image.size(), templ.size());
+    auto full = fast_match::FAsTMatch::evaluateConfigs(image, templ, configs, xs, ys, false);
+    double best = *std::min_element(full.begin(), full.end());
+
+    std::vector<size_t> indices;
+    std::vector<double> distances;
+    size_t inside = fast_match::FAsTMatch::evaluateGrid(image, templ, grid, xs, ys, false,
+                                                        std::numeric_limits<double>::infinity(), indices, distances);
+    test::check(inside == configs.size() && indices == listed, "streamed grid keeps the configs inside the image");
+    test::check(distances == full, "streamed distances equal the batch ones");
+
+    const double margin = 0.05;
+    inside = fast_match::FAsTMatch::evaluateGrid(image, templ, grid, xs, ys, false, margin, indices, distances);
+    test::check(inside == configs.size(), "bounded stream still counts every config inside");
+    test::check(std::is_sorted(indices.begin(), indices.end()) && indices.size() < listed.size(),
+                "bounded stream keeps fewer configs, in grid order");
+    size_t good = 0, kept = 0;
+    for (size_t i = 0; i < full.size(); i++) {
+        if (full[i] > best + margin) continue;
+        good++;
+        auto it = std::lower_bound(indices.begin(), indices.end(), listed[i]);
+        kept += it != indices.end() && *it == listed[i] && distances[it - indices.begin()] == full[i];
+    }
+    test::check(good > 0 && kept == good, "bounded stream keeps every config within the margin, exactly");
+}
+
+int main() {
+    std::cout << "=== Match Config Tests ===\n";
+    test_config_is_plain_value();
+    test_affine_matches_formula();
+    test_batch_round_trip();
+    test_batch_compact_keeps_order();
+    test_grid_matches_net();
+    test_random_expand_steps_around_sources();
+    test_bounds_filter_matches_vector_version();
+    test_bounds_extent_covers_corners();
+    test_evaluate_batch_matches_matrices();
+    test_early_termination_keeps_good_configs();
+    test_grid_decodes_the_listed_configs();
+    test_streamed_grid_matches_batch();
+    return test::report();
+}
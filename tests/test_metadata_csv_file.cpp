@@ -0,0 +1,116 @@
+#include "TestFramework.hpp"
+#include "fastmatch-dataset/MetadataEntryReader.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::string writeFile(const std::string &name, const std::string &content) {
+    fs::path dir = fs::temp_directory_path() / ("test_metadata_csv_" + name);
+    fs::create_directories(dir);
+    std::ofstream out((dir / "metadata.csv").string(), std::ios::binary);
+    out << content;
+    return dir.string();
+}
+
+// 25 rows with the columns in another order than MetadataCsvFile::Column
+std::string writeDataset() {
+    std::string csv = "MapY,Filename,Unused,Latitude,ImuW,MapX,SvoZ,RelativeAltitude\n";
+    for (int i = 0; i < 25; i++) {
+        csv += std::to_string(2 * i) + ",\"frame_" + std::to_string(i) + ".png\",x," +
+               std::to_string(54.5 + i * 0.25) + ",1," + std::to_string(i) + ",-" + std::to_string(i) + ".5,+100\n";
+    }
+    return writeFile("dataset", csv);
+}
+} // namespace
+
+void test_columns_resolved_from_header() {
+    std::string dir = writeFile("columns", "\"Filename\", Latitude ,MapX,Other\r\n"
+                                           "\"a.png\", 54.25 ,17,y\r\n"
+                                           "\r\n"
+                                           "b.png,1e-3,3.9,z\r\n"
+                                           "\n");
+    MetadataCsvFile csv;
+    test::check(csv.open(dir + "/metadata.csv"), "file opens");
+    test::check(csv.rowCount() == 2, "blank lines are not rows");
+    test::check(csv.hasColumn(MetadataCsvFile::Filename) && csv.hasColumn(MetadataCsvFile::MapX),
+                "quoted and padded header names are found");
+    test::check(!csv.hasColumn(MetadataCsvFile::SvoX), "missing columns are reported");
+
+    MetadataCsvFile::Row row;
+    csv.readRow(0, row);
+    test::check(row[MetadataCsvFile::Filename] == "a.png", "quotes are stripped");
+    test::check(MetadataCsvFile::toDouble(row[MetadataCsvFile::Latitude]) == 54.25, "padded number parses");
+    test::check(row[MetadataCsvFile::SvoX].empty(), "missing column reads empty");
+    csv.readRow(1, row);
+    test::check(row[MetadataCsvFile::Filename] == "b.png", "carriage return is stripped");
+    test::check(MetadataCsvFile::toDouble(row[MetadataCsvFile::Latitude]) == 1e-3, "exponent parses");
+    test::check(MetadataCsvFile::toInt(row[MetadataCsvFile::MapX]) == 3, "integer stops at the fraction like atoi");
+}
+
+void test_numbers_parse_like_atof() {
+    test::check(MetadataCsvFile::toDouble("") == 0.0, "empty field is zero");
+    test::check(MetadataCsvFile::toDouble("abc") == 0.0, "text is zero");
+    test::check(MetadataCsvFile::toDouble("+2.5") == 2.5, "leading plus is accepted");
+    test::check(MetadataCsvFile::toDouble("-0.125") == -0.125, "negative number");
+    test::check(MetadataCsvFile::toDouble("7.5m") == 7.5, "trailing text is ignored");
+    test::check(MetadataCsvFile::toInt("-42") == -42, "negative integer");
+}
+
+void test_reader_fills_entries() {
+    std::string dir = writeDataset();
+    MetadataEntryReader reader;
+    reader.setDecodeImages(false);
+    test::check(reader.openDirectory(dir), "dataset opens");
+    test::check(reader.rowCount() == 25, "row count");
+    MetadataEntry entry;
+    test::check(reader.readNextEntry(entry), "first entry is read");
+    test::check(entry.imageFileName == "frame_0.png" && entry.imageFullPath == dir + "/frame_0.png",
+                "file name and path");
+    test::check(entry.mapLocation == cv::Point(0, 0), "map location of the first row");
+    test::check_near(entry.latitude, 54.5, 1e-9, "latitude");
+    test::check_near(entry.altitude, 100.0, 1e-9, "altitude with a plus sign");
+    test::check_near(entry.svoPose.getZ(), -0.5, 1e-9, "negative svo coordinate");
+    test::check(reader.readNextEntry(entry) && entry.mapLocation == cv::Point(1, 2), "second row");
+}
+
+void test_skip_rate_and_seek() {
+    std::string dir = writeDataset();
+    MetadataEntryReader reader;
+    reader.setDecodeImages(false);
+    reader.openDirectory(dir);
+    reader.setSkipRate(10);
+    std::vector<int> rows;
+    MetadataEntry entry;
+    while (reader.readNextEntry(entry)) {
+        rows.push_back(entry.mapLocation.x);
+    }
+    test::check(rows == std::vector<int>({0, 10, 20}), "skip rate keeps every tenth row");
+    test::check(!reader.readNextEntry(entry), "reading past the end keeps failing");
+
+    test::check(reader.seek(11), "seek inside the file");
+    test::check(reader.readNextEntry(entry) && entry.mapLocation.x == 20, "seek rounds up to the skip rate");
+    reader.setSkipRate(1);
+    test::check(reader.seek(7) && reader.readNextEntry(entry) && entry.mapLocation.x == 7, "seek without skipping");
+    test::check(!reader.seek(25), "seek past the last row fails");
+    test::check(!reader.readNextEntry(entry), "nothing is read after seeking past the end");
+}
+
+void test_missing_file() {
+    MetadataEntryReader reader;
+    test::check(!reader.openDirectory("/nonexistent/dataset"), "missing metadata.csv does not open");
+    MetadataEntry entry;
+    test::check(!reader.readNextEntry(entry), "nothing is read without a file");
+}
+
+int main() {
+    std::cout << "=== MetadataCsvFile Tests ===\n";
+    test_columns_resolved_from_header();
+    test_numbers_parse_like_atof();
+    test_reader_fills_entries();
+    test_skip_rate_and_seek();
+    test_missing_file();
+    return test::report();
+}
@@ -0,0 +1,225 @@
+#include "TestFramework.hpp"
+#include "src/ParticleKernels.hpp"
+#include "src/ParticleNoise.hpp"
+#include "src/Random.hpp"
+#include "src/SampleKernels.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<float> randomWeights(size_t n, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(0.f, 1.f);
+    std::vector<float> v(n);
+    for (auto& w : v) {
+        w = dist(gen);
+    }
+    return v;
+}
+
+std::vector<int32_t> randomCoordinates(size_t n, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int32_t> dist(0, 20000);
+    std::vector<int32_t> v(n);
+    for (auto& c : v) {
+        c = dist(gen);
+    }
+    return v;
+}
+
+const simd::Level kLevels[] = {simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2, simd::Level::AVX512};
+} // namespace
+
+void test_sum_matches_reference() {
+    // Not a multiple of the vector width, so the tail is exercised too
+    const size_t n = 1003;
+    auto a = randomWeights(n, 1);
+    double expected = 0.0;
+    for (float v : a) expected += v;
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        test::check_near(simd::sum(a.data(), n) / expected, 1.0, 1e-5,
+                         std::string("sum matches double reference at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_scale_in_place() {
+    const size_t n = 37;
+    auto a = randomWeights(n, 2);
+    auto expected = a;
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        auto b = a;
+        simd::scale(b.data(), 0.5f, n, b.data());
+        bool same = true;
+        for (size_t i = 0; i < n; i++) {
+            same = same && b[i] == expected[i] * 0.5f;
+        }
+        test::check(same, std::string("scale works in place at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_weighted_moments_match_reference() {
+    const size_t n = 2001;
+    auto xs = randomCoordinates(n, 3);
+    auto ys = randomCoordinates(n, 4);
+    auto ws = randomWeights(n, 5);
+    double w = 0.0, mx = 0.0, my = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        w += ws[i];
+        mx += ws[i] * static_cast<double>(xs[i]);
+        my += ws[i] * static_cast<double>(ys[i]);
+    }
+    mx /= w;
+    my /= w;
+    double xx = 0.0, xy = 0.0, yy = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        xx += ws[i] * (xs[i] - mx) * (xs[i] - mx);
+        xy += ws[i] * (xs[i] - mx) * (ys[i] - my);
+        yy += ws[i] * (ys[i] - my) * (ys[i] - my);
+    }
+    xx /= w;
+    xy /= w;
+    yy /= w;
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        auto m = simd::weightedMoments(xs.data(), ys.data(), ws.data(), n);
+        std::string at = std::string(" at ") + simd::levelName(level);
+        test::check_near(m.weight / w, 1.0, 1e-5, "moment weight matches reference" + at);
+        test::check_near(m.meanX, mx, 0.05, "weighted mean x matches reference" + at);
+        test::check_near(m.meanY, my, 0.05, "weighted mean y matches reference" + at);
+        test::check_near(m.xx / xx, 1.0, 1e-4, "xx moment matches reference" + at);
+        test::check_near(m.yy / yy, 1.0, 1e-4, "yy moment matches reference" + at);
+        test::check_near(m.xy / std::sqrt(xx * yy), xy / std::sqrt(xx * yy), 1e-4,
+                         "xy moment matches reference" + at);
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_weighted_moments_empty() {
+    auto m = simd::weightedMoments(nullptr, nullptr, nullptr, 0);
+    test::check(m.weight == 0.0 && m.meanX == 0.0 && m.xx == 0.0, "weightedMoments of nothing is zero");
+}
+
+void test_noise_distribution() {
+    ParticleNoise noise(7);
+    const int n = 100000;
+    double sum = 0.0, squares = 0.0;
+    bool inRange = true;
+    for (int i = 0; i < n; i++) {
+        float v = noise.gaussian();
+        inRange = inRange && v >= -1.f && v <= 1.f;
+        sum += v;
+        squares += static_cast<double>(v) * v;
+    }
+    double mean = sum / n;
+    test::check(inRange, "gaussian noise is clamped to [-1, 1]");
+    test::check_near(mean, 0.0, 0.01, "gaussian noise has zero mean");
+    test::check_near(std::sqrt(squares / n - mean * mean), 1.0 / 3.0, 0.01, "gaussian noise has sigma 1/3");
+
+    sum = 0.0;
+    inRange = true;
+    for (int i = 0; i < n; i++) {
+        float v = noise.uniform();
+        inRange = inRange && v >= -1.f && v < 1.f;
+        sum += v;
+    }
+    test::check(inRange, "uniform noise is in [-1, 1)");
+    test::check_near(sum / n, 0.0, 0.01, "uniform noise has zero mean");
+}
+
+void test_noise_is_deterministic() {
+    ParticleNoise a(42), b(42), c(43);
+    bool same = true, differs = false;
+    for (size_t i = 0; i < 3 * ParticleNoise::kBlock; i++) {
+        float va = a.gaussian();
+        same = same && va == b.gaussian();
+        differs = differs || va != c.gaussian();
+    }
+    test::check(same, "equal seeds give equal noise");
+    test::check(differs, "different seeds give different noise");
+
+    a.seed(42);
+    ParticleNoise d(42);
+    test::check(a.uniform() == d.uniform(), "seed() restarts the sequence");
+}
+
+void test_philox_known_answers() {
+    // Known-answer vectors of the Random123 reference implementation
+    struct Vector {
+        uint32_t counter[4];
+        uint32_t key[2];
+        uint32_t expected[4];
+    };
+    const Vector vectors[] = {
+            {{0, 0, 0, 0}, {0, 0}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+            {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff},
+             {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+            {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0},
+             {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+    };
+    for (const auto& v : vectors) {
+        uint32_t counter[4] = {v.counter[0], v.counter[1], v.counter[2], v.counter[3]};
+        Philox4x32::generate(counter, v.key);
+        test::check(counter[0] == v.expected[0] && counter[1] == v.expected[1] &&
+                    counter[2] == v.expected[2] && counter[3] == v.expected[3],
+                    "Philox4x32-10 matches the reference vector");
+    }
+}
+
+void test_noise_follows_philox_counters() {
+    const uint64_t seed = 0x0123456789abcdefULL, stream = 7;
+    ParticleNoise noise(seed, stream);
+    const uint32_t key[2] = {static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+    bool same = true;
+    // Counter n fills word w of lane n % kLanes, words follow each other in
+    // steps of kLanes numbers
+    for (size_t i = 0; i < 2 * ParticleNoise::kBlock; i++) {
+        size_t batch = i / (4 * ParticleNoise::kLanes);
+        size_t word = i % (4 * ParticleNoise::kLanes) / ParticleNoise::kLanes;
+        size_t lane = i % ParticleNoise::kLanes;
+        uint64_t n = batch * ParticleNoise::kLanes + lane;
+        uint32_t counter[4] = {static_cast<uint32_t>(n), static_cast<uint32_t>(n >> 32),
+                               static_cast<uint32_t>(stream), 0};
+        Philox4x32::generate(counter, key);
+        float expected = static_cast<float>(counter[word] >> 8) * (1.0f / 16777216.0f);
+        same = same && noise.unit() == expected;
+    }
+    test::check(same, "unit noise is the Philox stream of the seed");
+}
+
+void test_noise_streams_are_independent() {
+    ParticleNoise a(42, RandomStream::Propagation), b(42, RandomStream::Initialization);
+    int equal = 0;
+    for (size_t i = 0; i < ParticleNoise::kBlock; i++) {
+        equal += a.unit() == b.unit();
+    }
+    test::check(equal < 4, "streams of one seed differ");
+    test::check(deriveSeed(42, RandomStream::Resampling) != deriveSeed(42, RandomStream::Evaluation),
+                "derived seeds of one seed differ");
+    test::check(deriveSeed(42, RandomStream::Resampling) == deriveSeed(42, RandomStream::Resampling),
+                "derived seeds are deterministic");
+}
+
+int main() {
+    std::cout << "=== Particle Kernel Tests ===\n";
+    std::cout << "Detected instruction set: " << simd::levelName(simd::detectLevel()) << "\n";
+    test_sum_matches_reference();
+    test_scale_in_place();
+    test_weighted_moments_match_reference();
+    test_weighted_moments_empty();
+    test_noise_distribution();
+    test_noise_is_deterministic();
+    test_philox_known_answers();
+    test_noise_follows_philox_counters();
+    test_noise_streams_are_independent();
+    return test::report();
+}
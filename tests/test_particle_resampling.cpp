@@ -0,0 +1,238 @@
+#include "TestFramework.hpp"
+#include "src/Particles.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <tbb/task_arena.h>
+
+// Every allocation in the test binary goes through here, so the resampling
+// loop can be checked for heap traffic.
+namespace {
+std::atomic<size_t> allocationCount{0};
+}
+
+void* operator new(std::size_t size) {
+    allocationCount++;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+Particles makeParticles(int count) {
+    Particles particles;
+    particles.init(cv::Point2i(2000, 1500), cv::Size(4000, 3000), 300.0, count, false);
+    particles.setScale(0.8f, 1.2f, 5);
+    return particles;
+}
+
+// Same steps as ParticleFastMatch::filterParticles, minus the map sampling
+void resamplingStep(Particles& particles, int count) {
+    particles.beginResampling();
+    for (int i = 0; i < count; i++) {
+        auto particle = particles.drawSample();
+        particle.propagate(cv::Point2f(4.f, -3.f));
+    }
+    particles.commitResampling();
+    for (auto& particle : particles) {
+        double rotation[6];
+        particle.mapTransformation(rotation);
+        particle.setCorrelation(static_cast<float>(rotation[0]));
+        particle.setProbability(0.5f + 0.001f * static_cast<float>(particle.x % 100));
+    }
+    particles.normalize();
+}
+} // namespace
+
+void test_steady_state_resampling_does_not_allocate() {
+    const int maxCount = 400;
+    Particles particles = makeParticles(maxCount);
+    // Warm up both buffers to the largest particle count
+    for (int frame = 0; frame < 3; frame++) {
+        resamplingStep(particles, maxCount);
+    }
+
+    size_t before = allocationCount.load();
+    for (int frame = 0; frame < 50; frame++) {
+        // KLD-sampling changes the particle count from frame to frame
+        resamplingStep(particles, maxCount - (frame * 37) % 250);
+    }
+    size_t allocations = allocationCount.load() - before;
+    test::check(allocations == 0, "steady state resampling performs no heap allocations",
+                std::to_string(allocations) + " allocations");
+}
+
+void test_resampling_draws_from_previous_set() {
+    Particles particles = makeParticles(200);
+    std::set<std::pair<int, int>> previous;
+    for (const auto& particle : particles) {
+        previous.emplace(particle.x, particle.y);
+    }
+
+    particles.beginResampling();
+    for (int i = 0; i < 300; i++) {
+        particles.drawSample();
+    }
+    particles.commitResampling();
+
+    test::check(particles.size() == 300, "commit exposes all drawn particles");
+    bool allKnown = std::all_of(particles.begin(), particles.end(), [&](const Particle& p) {
+        return previous.count({p.x, p.y}) == 1;
+    });
+    test::check(allKnown, "drawn particles are copies of the previous belief");
+}
+
+void test_resampling_favours_heavy_particles() {
+    Particles particles = makeParticles(100);
+    for (size_t i = 0; i < particles.size(); i++) {
+        particles[i].setMinimalProbability(i == 42 ? 1.f : 1e-6f);
+    }
+    int heavyX = particles[42].x, heavyY = particles[42].y;
+    particles.normalize();
+
+    particles.beginResampling(200);
+    for (int i = 0; i < 200; i++) {
+        particles.drawSample();
+    }
+    particles.commitResampling();
+
+    auto heavy = std::count_if(particles.begin(), particles.end(), [&](const Particle& p) {
+        return p.x == heavyX && p.y == heavyY;
+    });
+    test::check(heavy >= 199, "nearly all samples come from the dominant particle",
+                std::to_string(heavy) + " of 200");
+}
+
+void test_steady_state_allocation_free_for_every_method() {
+    const ResamplingMethod methods[] = {
+            ResamplingMethod::Multinomial, ResamplingMethod::Alias, ResamplingMethod::Systematic,
+            ResamplingMethod::Stratified, ResamplingMethod::Residual
+    };
+    for (auto method : methods) {
+        Particles particles = makeParticles(300);
+        particles.setResampling(method, 3);
+        for (int frame = 0; frame < 3; frame++) {
+            resamplingStep(particles, 300);
+        }
+        size_t before = allocationCount.load();
+        for (int frame = 0; frame < 20; frame++) {
+            resamplingStep(particles, 300 - frame * 7);
+        }
+        size_t allocations = allocationCount.load() - before;
+        test::check(allocations == 0, std::string(resamplingMethodName(method)) + " resampling does not allocate",
+                    std::to_string(allocations) + " allocations");
+    }
+}
+
+void test_seed_makes_runs_reproducible() {
+    auto run = [](uint64_t seed) {
+        Particles particles;
+        particles.seed(seed);
+        particles.init(cv::Point2i(2000, 1500), cv::Size(4000, 3000), 300.0, 200, true);
+        particles.setScale(0.8f, 1.2f, 5);
+        for (int step = 0; step < 5; step++) {
+            resamplingStep(particles, 200);
+            particles.propagate(cv::Point2f(2.f, 1.f));
+        }
+        std::vector<std::pair<int, int>> positions;
+        for (const auto& particle : particles) {
+            positions.emplace_back(particle.x, particle.y);
+        }
+        return positions;
+    };
+    auto first = run(17);
+    test::check(first == run(17), "equal seeds give identical particle sets");
+    test::check(first != run(18), "different seeds give different particle sets");
+
+    Particles particles;
+    particles.seed(17);
+    test::check(particles.getSeed() == 17, "getSeed returns the seed");
+}
+
+namespace {
+// One parallel predict step drawing `count` particles in the given splits
+std::vector<std::pair<int, int>> drawAndPropagate(uint64_t seed, const std::vector<size_t>& splits) {
+    Particles particles;
+    particles.seed(seed);
+    particles.init(cv::Point2i(2000, 1500), cv::Size(4000, 3000), 300.0, 500, true);
+    particles.beginResampling();
+    for (size_t count : splits) {
+        size_t first = particles.drawSamples(count);
+        particles.propagateSamples(first, count, cv::Point2f(6.f, -2.f));
+    }
+    std::vector<std::pair<int, int>> positions;
+    const ParticleColumns& samples = particles.samples();
+    for (size_t i = 0; i < samples.size(); i++) {
+        positions.emplace_back(samples.x[i], samples.y[i]);
+    }
+    return positions;
+}
+} // namespace
+
+void test_parallel_draws_do_not_depend_on_splitting() {
+    auto whole = drawAndPropagate(5, {1000});
+    test::check(whole.size() == 1000, "drawSamples appends the requested count");
+    test::check(whole == drawAndPropagate(5, {50, 350, 600}), "draws split into rounds give the same particles");
+    std::vector<std::pair<int, int>> serial;
+    tbb::task_arena(1).execute([&] { serial = drawAndPropagate(5, {1000}); });
+    test::check(whole == serial, "draws on one thread give the same particles");
+}
+
+void test_parallel_draws_come_from_previous_set() {
+    Particles particles;
+    particles.seed(9);
+    particles.init(cv::Point2i(2000, 1500), cv::Size(4000, 3000), 300.0, 200, false);
+    std::set<std::pair<int, int>> previous;
+    for (const auto& particle : particles) {
+        previous.emplace(particle.x, particle.y);
+    }
+    particles.beginResampling();
+    size_t first = particles.drawSamples(400);
+    const ParticleColumns& samples = particles.samples();
+    bool drawnFromPrevious = true;
+    for (size_t i = first; i < samples.size(); i++) {
+        drawnFromPrevious = drawnFromPrevious && previous.count({samples.x[i], samples.y[i]}) > 0;
+    }
+    test::check(drawnFromPrevious, "drawSamples copies particles of the current set");
+
+    // Lost odometry moves a particle by at most 40 px per axis
+    std::vector<std::pair<int, int>> before;
+    for (size_t i = first; i < samples.size(); i++) {
+        before.emplace_back(samples.x[i], samples.y[i]);
+    }
+    particles.propagateSamples(first, 400, cv::Point2f(0.f, 0.f));
+    bool bounded = true, moved = false;
+    for (size_t i = first; i < samples.size(); i++) {
+        int dx = samples.x[i] - before[i - first].first, dy = samples.y[i] - before[i - first].second;
+        bounded = bounded && std::abs(dx) <= 40 && std::abs(dy) <= 40;
+        moved = moved || dx != 0 || dy != 0;
+    }
+    test::check(bounded && moved, "propagateSamples adds bounded noise");
+}
+
+int main() {
+    std::cout << "=== Particle Resampling Tests ===\n";
+    test_steady_state_resampling_does_not_allocate();
+    test_resampling_draws_from_previous_set();
+    test_resampling_favours_heavy_particles();
+    test_steady_state_allocation_free_for_every_method();
+    test_seed_makes_runs_reproducible();
+    test_parallel_draws_do_not_depend_on_splitting();
+    test_parallel_draws_come_from_previous_set();
+    return test::report();
+}
@@ -2,8 +2,10 @@
 #include "src/Particle.hpp"
 #include "src/ParticleConfig.hpp"
 
+#include <algorithm>
 #include <memory>
 #include <cmath>
+#include <type_traits>
 
 namespace {
 std::shared_ptr<ParticleConfig> makeConfig() {
@@ -49,6 +51,70 @@ void test_particle_probability_moving_average() {
     test::check_near(p.getProbability(), 0.5, 0.01, "probability after 2 sets (moving avg)");
 }
 
+void test_particle_probability_window() {
+    auto cfg = makeConfig();
+    Particle p(100, 100, cfg);
+
+    const float values[] = {1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.4f};
+    for (float v : values) {
+        p.setProbability(v);
+    }
+    // Only the last probabilityWindow values count: (0 + 0 + 0 + 0.4) / 4
+    test::check_near(p.getProbability(), 0.1, 1e-5, "probability averages the most recent window");
+}
+
+void test_particle_configured_window() {
+    auto cfg = makeConfig();
+    cfg->probabilityWindow = 2;
+    Particle p(100, 100, cfg);
+    test::check(p.getProbabilityWindow() == 2, "window comes from the config");
+
+    const float values[] = {1.0f, 0.0f, 0.2f, 0.6f};
+    for (float v : values) {
+        p.setProbability(v);
+    }
+    test::check_near(p.getProbability(), 0.4, 1e-5, "window of 2 averages the last two values");
+
+    // Restarting keeps the current probability as the only history entry
+    p.setProbabilityWindow(3);
+    p.setProbability(0.1f);
+    p.setProbability(0.1f);
+    test::check_near(p.getProbability(), 0.2, 1e-5, "history restarts from the current probability");
+    p.setProbability(0.1f);
+    test::check_near(p.getProbability(), 0.1, 1e-5, "restarted value leaves the window");
+
+    p.setProbabilityWindow(100);
+    test::check(p.getProbabilityWindow() == Particle::kMaxProbabilityWindow, "window is clamped to the capacity");
+
+    Particle longWindow(0, 0, cfg);
+    longWindow.setProbabilityWindow(Particle::kMaxProbabilityWindow);
+    for (int i = 0; i < 1000; i++) {
+        longWindow.setProbability(i % 2 == 0 ? 1.0f : 0.0f);
+    }
+    test::check_near(longWindow.getProbability(), 0.5, 1e-4, "running sum does not drift over long runs");
+}
+
+void test_particle_trivially_copyable() {
+    test::check(std::is_trivially_copyable<Particle>::value, "particle is trivially copyable");
+    auto cfg = makeConfig();
+    Particle p(1, 2, cfg);
+    test::check(p.getBestTransform().empty(), "no best transform before evaluation");
+}
+
+void test_particle_configs_built_on_demand() {
+    auto cfg = makeConfig();
+    Particle p(100, 100, cfg);
+    cfg->scales = {0.9f, 1.0f, 1.1f};
+
+    auto configs = p.getConfigs(7);
+    // scales^2 * rotations * 3 secondary rotations
+    test::check(configs.size() == 3 * 3 * cfg->r_initial.size() * 3, "config count matches search grid");
+    bool idsSet = std::all_of(configs.begin(), configs.end(), [](const fast_match::MatchConfig& c) {
+        return c.getId() == 7;
+    });
+    test::check(idsSet, "configs carry the requested particle id");
+}
+
 void test_particle_weight_and_sampling() {
     auto cfg = makeConfig();
     Particle p(50, 50, cfg);
@@ -86,6 +152,10 @@ int main() {
     test_particle_serialize_bin_size_1();
     test_particle_serialize_bin_rounding();
     test_particle_probability_moving_average();
+    test_particle_probability_window();
+    test_particle_configured_window();
+    test_particle_trivially_copyable();
+    test_particle_configs_built_on_demand();
     test_particle_weight_and_sampling();
     test_particle_ordering();
     test_particle_copy();
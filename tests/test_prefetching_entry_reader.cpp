@@ -0,0 +1,118 @@
+#include "TestFramework.hpp"
+#include "fastmatch-dataset/PrefetchingEntryReader.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace fs = std::filesystem;
+
+namespace {
+const int kFrames = 12;
+
+// Dataset of kFrames color frames whose MapX column and pixels encode the frame index
+std::string writeDataset() {
+    fs::path dir = fs::temp_directory_path() / "test_prefetching_entry_reader";
+    fs::create_directories(dir);
+    std::ofstream csv((dir / "metadata.csv").string());
+    csv << "Filename,Latitude,Longitude,RelativeAltitude,MapX,MapY\n";
+    for (int i = 0; i < kFrames; i++) {
+        std::string name = "frame_" + std::to_string(i) + ".png";
+        cv::Mat image(24, 32, CV_8UC3);
+        for (int y = 0; y < image.rows; y++) {
+            for (int x = 0; x < image.cols; x++) {
+                uint8_t *pixel = image.ptr<uint8_t>(y) + 3 * x;
+                pixel[0] = static_cast<uint8_t>(10 * i);
+                pixel[1] = static_cast<uint8_t>(x + y);
+                pixel[2] = static_cast<uint8_t>(200 - i);
+            }
+        }
+        cv::imwrite((dir / name).string(), image);
+        csv << name << ",54.9,23.9,100," << i << ",0\n";
+    }
+    return dir.string();
+}
+
+bool grayMatchesColor(const MetadataEntry &entry) {
+    if (entry.imageBuffer.empty() || entry.imageGray.empty()) {
+        return false;
+    }
+    cv::Mat gray;
+    cv::cvtColor(entry.imageBuffer, gray, cv::COLOR_BGR2GRAY);
+    for (int y = 0; y < gray.rows; y++) {
+        for (int x = 0; x < gray.cols; x++) {
+            if (gray.at<uint8_t>(y, x) != entry.imageGray.at<uint8_t>(y, x)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+} // namespace
+
+void test_frames_arrive_in_order(size_t depth, size_t workers) {
+    std::string dataset = writeDataset();
+    MetadataEntryReader reader;
+    reader.openDirectory(dataset);
+    std::string label = " (depth " + std::to_string(depth) + ", " + std::to_string(workers) + " workers)";
+    int frames = 0;
+    bool ordered = true;
+    bool decoded = true;
+    {
+        PrefetchingEntryReader prefetcher(reader, depth, workers);
+        MetadataEntry entry;
+        while (prefetcher.readNextEntry(entry)) {
+            ordered &= entry.mapLocation.x == frames;
+            decoded &= grayMatchesColor(entry) && entry.imageBuffer.ptr<uint8_t>(0)[0] == 10 * frames;
+            frames++;
+        }
+        auto stats = prefetcher.stats();
+        test::check(stats.frames == kFrames && stats.decoded == kFrames, "stats count every frame" + label);
+        test::check(stats.stalls <= stats.frames, "stalls are bounded by the frames" + label);
+        test::check(stats.meanQueueDepth() <= static_cast<double>(depth) + 1.0, "queue depth is bounded" + label);
+    }
+    test::check(frames == kFrames, "every frame is returned" + label);
+    test::check(ordered, "frames keep the CSV order" + label);
+    test::check(decoded, "color and gray images belong to the frame" + label);
+}
+
+void test_skip_rate_is_kept() {
+    std::string dataset = writeDataset();
+    MetadataEntryReader reader;
+    reader.openDirectory(dataset);
+    reader.setSkipRate(5);
+    PrefetchingEntryReader prefetcher(reader, 3, 2);
+    std::vector<int> seen;
+    MetadataEntry entry;
+    while (prefetcher.readNextEntry(entry)) {
+        seen.push_back(entry.mapLocation.x);
+    }
+    test::check(seen == std::vector<int>({0, 5, 10}), "skip rate of the wrapped reader applies");
+}
+
+void test_stop_before_the_end() {
+    std::string dataset = writeDataset();
+    MetadataEntryReader reader;
+    reader.openDirectory(dataset);
+    test::check_nothrow([&] {
+        PrefetchingEntryReader prefetcher(reader, 4, 3);
+        MetadataEntry entry;
+        prefetcher.readNextEntry(entry);
+    }, "destroying with frames still queued");
+    MetadataEntry entry;
+    test::check(reader.readNextEntry(entry) && !entry.imageGray.empty(),
+                "wrapped reader decodes again once the prefetcher is gone");
+}
+
+int main() {
+    std::cout << "=== PrefetchingEntryReader Tests ===\n";
+    test_frames_arrive_in_order(0, 1);
+    test_frames_arrive_in_order(1, 1);
+    test_frames_arrive_in_order(4, 2);
+    test_frames_arrive_in_order(16, 4);
+    test_skip_rate_is_kept();
+    test_stop_before_the_end();
+    return test::report();
+}
@@ -0,0 +1,123 @@
+#include "TestFramework.hpp"
+#include "src/Resampler.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+const ResamplingMethod kMethods[] = {
+        ResamplingMethod::Multinomial, ResamplingMethod::Alias, ResamplingMethod::Systematic,
+        ResamplingMethod::Stratified, ResamplingMethod::Residual
+};
+
+std::vector<size_t> drawCounts(Resampler& resampler, const std::vector<float>& weights, size_t draws) {
+    resampler.reset(weights.data(), weights.size(), draws);
+    std::vector<size_t> counts(weights.size(), 0);
+    for (size_t i = 0; i < draws; i++) {
+        counts[resampler.next()]++;
+    }
+    return counts;
+}
+} // namespace
+
+void test_draws_follow_weights() {
+    const std::vector<float> weights = {0.5f, 0.0f, 0.25f, 0.125f, 0.125f};
+    const size_t draws = 40000;
+    for (auto method : kMethods) {
+        Resampler resampler(method);
+        auto counts = drawCounts(resampler, weights, draws);
+        bool close = true;
+        for (size_t i = 0; i < weights.size(); i++) {
+            close &= std::abs(static_cast<double>(counts[i]) / draws - weights[i]) < 0.01;
+        }
+        test::check(close, std::string(resamplingMethodName(method)) + " draws match weights");
+        test::check(counts[1] == 0, std::string(resamplingMethodName(method)) + " never draws zero weight");
+    }
+}
+
+void test_low_variance_methods_are_exact_per_pass() {
+    // With n draws per pass each index appears floor(n*w) or ceil(n*w) times
+    const std::vector<float> weights = {0.37f, 0.21f, 0.05f, 0.3f, 0.07f};
+    const size_t draws = 1000;
+    const ResamplingMethod methods[] = {ResamplingMethod::Systematic, ResamplingMethod::Residual};
+    for (auto method : methods) {
+        Resampler resampler(method);
+        auto counts = drawCounts(resampler, weights, draws);
+        bool exact = true;
+        for (size_t i = 0; i < weights.size(); i++) {
+            double expected = weights[i] * draws;
+            exact &= counts[i] + 1 > expected && counts[i] < expected + 1;
+        }
+        test::check(exact, std::string(resamplingMethodName(method)) + " keeps counts within one of n*w");
+    }
+}
+
+void test_truncated_pass_is_unbiased() {
+    // KLD-sampling may stop long before a pass is used up
+    std::vector<float> weights(100, 1.f);
+    weights[0] = 100.f;
+    for (auto method : kMethods) {
+        Resampler resampler(method);
+        size_t heavy = 0, draws = 0;
+        for (int frame = 0; frame < 200; frame++) {
+            resampler.reset(weights.data(), weights.size(), 1000);
+            for (int i = 0; i < 50; i++, draws++) {
+                heavy += resampler.next() == 0;
+            }
+        }
+        double share = static_cast<double>(heavy) / draws;
+        test::check(std::abs(share - 100.0 / 199.0) < 0.03,
+                    std::string(resamplingMethodName(method)) + " prefix of a pass keeps proportions");
+    }
+}
+
+void test_passes_continue_past_expected_draws() {
+    const std::vector<float> weights = {1.f, 3.f};
+    Resampler resampler(ResamplingMethod::Systematic);
+    auto counts = drawCounts(resampler, weights, 4);
+    resampler.reset(weights.data(), weights.size(), 4);
+    size_t second = 0;
+    for (int i = 0; i < 40; i++) {
+        second += resampler.next() == 1;
+    }
+    test::check(counts[1] == 3, "systematic pass of four draws gives three heavy samples");
+    test::check(second == 30, "further passes are generated on demand");
+}
+
+void test_deterministic_seed() {
+    const std::vector<float> weights = {0.1f, 0.2f, 0.3f, 0.4f};
+    for (auto method : kMethods) {
+        Resampler a(method, 17), b(method, 17);
+        a.reset(weights.data(), weights.size(), 64);
+        b.reset(weights.data(), weights.size(), 64);
+        bool same = true;
+        for (int i = 0; i < 500; i++) {
+            same &= a.next() == b.next();
+        }
+        test::check(same, std::string(resamplingMethodName(method)) + " is reproducible for a seed");
+    }
+}
+
+void test_degenerate_weights_fall_back_to_uniform() {
+    const std::vector<float> weights = {0.f, 0.f, 0.f, 0.f};
+    for (auto method : kMethods) {
+        Resampler resampler(method);
+        auto counts = drawCounts(resampler, weights, 4000);
+        bool uniform = std::all_of(counts.begin(), counts.end(), [](size_t c) { return c > 800 && c < 1200; });
+        test::check(uniform, std::string(resamplingMethodName(method)) + " treats zero weights as uniform");
+    }
+    Resampler resampler;
+    test::check_throws([&] { resampler.reset(weights.data(), 0, 1); }, "empty weight set throws");
+}
+
+int main() {
+    std::cout << "=== Resampler Tests ===\n";
+    test_draws_follow_weights();
+    test_low_variance_methods_are_exact_per_pass();
+    test_truncated_pass_is_unbiased();
+    test_passes_continue_past_expected_draws();
+    test_deterministic_seed();
+    test_degenerate_weights_fall_back_to_uniform();
+    return test::report();
+}
@@ -1,5 +1,6 @@
 #include "TestFramework.hpp"
 #include "io/ResultWriter.hpp"
+#include "io/BatchManifest.hpp"
 
 #include <sstream>
 #include <string>
@@ -41,10 +42,31 @@ void test_row_preserves_stream_state() {
     test::check(out.precision() == prec_before, "stream precision preserved after appendRow");
 }
 
+void test_job_row_format() {
+    std::ostringstream header;
+    ResultWriter::appendJobHeader(header);
+    test::check(header.str().find("Throughput") != std::string::npos, "job header contains Throughput");
+
+    BatchJobResult result;
+    result.name = "flight@map";
+    result.frames = 50;
+    result.seconds = 4.0;
+    result.meanError = 3.456;
+    std::ostringstream out;
+    ResultWriter::appendJobRow(out, result);
+    test::check(out.str() == "\"flight@map\",50,4.00,12.50,3.46,0.00,0.00,0.00,\"ok\"", "job row format", out.str());
+
+    result.error = "map is not valid";
+    std::ostringstream failed;
+    ResultWriter::appendJobRow(failed, result);
+    test::check(failed.str().find("\"map is not valid\"") != std::string::npos, "failed job row carries the error");
+}
+
 int main() {
     std::cout << "=== ResultWriter Tests ===\n";
     test_header_format();
     test_row_format();
     test_row_preserves_stream_state();
+    test_job_row_format();
     return test::report();
 }
@@ -0,0 +1,229 @@
+#include "TestFramework.hpp"
+#include "src/AlignedBuffer.hpp"
+#include "src/SampleKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+namespace {
+AlignedVector<float> randomSample(size_t n, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-128.f, 127.f);
+    AlignedVector<float> v(paddedLength<float>(n), 0.f);
+    for (size_t i = 0; i < n; i++) {
+        v[i] = dist(gen);
+    }
+    return v;
+}
+
+double referenceDot(const AlignedVector<float>& a, const AlignedVector<float>& b, size_t n) {
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) {
+        sum += static_cast<double>(a[i]) * b[i];
+    }
+    return sum;
+}
+
+const simd::Level kLevels[] = {simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2, simd::Level::AVX512};
+} // namespace
+
+void test_padded_length() {
+    test::check(paddedLength<float>(1) == 16, "paddedLength rounds 1 float up to 16");
+    test::check(paddedLength<float>(16) == 16, "paddedLength keeps full vectors");
+    test::check(paddedLength<float>(30721) == 30736, "paddedLength rounds up to a 64 byte multiple");
+}
+
+void test_aligned_allocation() {
+    AlignedVector<float> v(37);
+    test::check(reinterpret_cast<uintptr_t>(v.data()) % 64 == 0, "AlignedVector data is 64 byte aligned");
+}
+
+void test_dot_product_matches_reference() {
+    const size_t n = 30720;
+    auto a = randomSample(n, 1);
+    auto b = randomSample(n, 2);
+    double expected = referenceDot(a, b, n);
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double got = simd::dotProduct(a.data(), b.data(), a.size());
+        test::check_near(got / expected, 1.0, 1e-4,
+                         std::string("dotProduct matches double reference at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_dot_product_unpadded_tail() {
+    const size_t n = 1003;
+    auto a = randomSample(n, 3);
+    auto b = randomSample(n, 4);
+    double expected = referenceDot(a, b, n);
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        double got = simd::dotProduct(a.data(), b.data(), n);
+        test::check_near(got / expected, 1.0, 1e-4,
+                         std::string("dotProduct handles a scalar tail at ") + simd::levelName(level));
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_dot_product_u8_is_exact() {
+    // Long enough that the integer lanes have to be flushed several times
+    const size_t n = 300001;
+    std::mt19937 gen(11);
+    AlignedVector<uint8_t> a(paddedLength<uint8_t>(n), 0), b(paddedLength<uint8_t>(n), 0);
+    uint64_t expected = 0;
+    for (size_t i = 0; i < n; i++) {
+        // Mostly saturated values stress the overflow bounds
+        a[i] = static_cast<uint8_t>(i % 7 == 0 ? gen() : 255);
+        b[i] = static_cast<uint8_t>(i % 5 == 0 ? gen() : 255);
+        expected += static_cast<uint64_t>(a[i]) * b[i];
+    }
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        std::string name = simd::levelName(level);
+        test::check(simd::dotProductU8(a.data(), b.data(), a.size()) == expected,
+                    "dotProductU8 is exact at " + name);
+        test::check(simd::dotProductU8(a.data() + 1, b.data() + 3, 1003) ==
+                    simd::dotProductU8(a.data() + 1, b.data() + 3, 1000) +
+                    static_cast<uint64_t>(a[1001]) * b[1003] + static_cast<uint64_t>(a[1002]) * b[1004] +
+                    static_cast<uint64_t>(a[1003]) * b[1005],
+                    "dotProductU8 handles unaligned input and a scalar tail at " + name);
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_gather_affine_matches_double_transform() {
+    // Synthetic 8 bit "map" with a non-trivial pattern
+    const int rows = 777, cols = 1003;
+    std::vector<uint8_t> pixels(static_cast<size_t>(rows) * cols);
+    for (int y = 0; y < rows; y++)
+        for (int x = 0; x < cols; x++)
+            pixels[y * cols + x] = static_cast<uint8_t>((x * 7 + y * 13 + (x * y) % 31) & 0xFF);
+    simd::ImageView8u view{pixels.data(), rows, cols, static_cast<size_t>(cols)};
+
+    std::mt19937 gen(5);
+    std::uniform_int_distribution<int> xDist(0, 639), yDist(0, 479);
+    const size_t n = 3001;
+    std::vector<int32_t> xs(n), ys(n);
+    for (size_t i = 0; i < n; i++) {
+        xs[i] = xDist(gen);
+        ys[i] = yDist(gen);
+    }
+    // Rotated and scaled placement that partly falls outside of the image
+    const double angle = 0.4, scale = 0.8;
+    const float m[6] = {
+            static_cast<float>(scale * std::cos(angle)), static_cast<float>(scale * std::sin(angle)), 250.37f,
+            static_cast<float>(-scale * std::sin(angle)), static_cast<float>(scale * std::cos(angle)), 120.81f
+    };
+    auto affine = simd::FixedAffine::fromFloat(m);
+
+    size_t mismatches = 0;
+    uint64_t expectedSum = 0;
+    for (size_t i = 0; i < n; i++) {
+        double tx = m[0] * xs[i] + m[1] * ys[i] + m[2];
+        double ty = m[3] * xs[i] + m[4] * ys[i] + m[5];
+        int x = std::clamp(static_cast<int>(std::floor(tx)), 0, cols - 1);
+        int y = std::clamp(static_cast<int>(std::floor(ty)), 0, rows - 1);
+        expectedSum += pixels[y * cols + x];
+    }
+
+    std::vector<uint8_t> reference(n);
+    simd::SampleStats referenceStats;
+    simd::setLevel(simd::Level::Scalar);
+    simd::gatherAffine(view, xs.data(), ys.data(), n, affine, reference.data(), referenceStats);
+    test::check_near(static_cast<double>(referenceStats.sum) / expectedSum, 1.0, 1e-3,
+                     "fixed-point gather follows the floating point transform");
+
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        std::vector<uint8_t> out(n);
+        simd::SampleStats stats;
+        simd::gatherAffine(view, xs.data(), ys.data(), n, affine, out.data(), stats);
+        mismatches = 0;
+        double squaredSum = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            if (out[i] != reference[i]) mismatches++;
+            squaredSum += static_cast<double>(out[i]) * out[i];
+        }
+        std::string name = simd::levelName(level);
+        test::check(mismatches == 0, "gatherAffine is bit exact with the scalar path at " + name);
+        test::check(stats.sum == referenceStats.sum, "gatherAffine sum matches at " + name);
+        test::check_near(static_cast<double>(stats.squaredSum), squaredSum, 0.5,
+                         "gatherAffine squared sum matches the gathered values at " + name);
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+void test_gather_offsets_matches_translated() {
+    const int rows = 301, cols = 517;
+    std::vector<uint8_t> pixels(static_cast<size_t>(rows) * cols);
+    for (int y = 0; y < rows; y++)
+        for (int x = 0; x < cols; x++)
+            pixels[y * cols + x] = static_cast<uint8_t>((x * 5 + y * 11 + (x * y) % 17) & 0xFF);
+    simd::ImageView8u view{pixels.data(), rows, cols, static_cast<size_t>(cols)};
+
+    std::mt19937 gen(9);
+    std::uniform_int_distribution<int> offsetDist(-100, 100);
+    const size_t n = 2051;
+    std::vector<int32_t> dx(n), dy(n), linear(n);
+    for (size_t i = 0; i < n; i++) {
+        dx[i] = offsetDist(gen);
+        dy[i] = offsetDist(gen);
+        linear[i] = dy[i] * cols + dx[i];
+    }
+    const int32_t x = 200, y = 150;
+
+    std::vector<uint8_t> reference(n);
+    simd::SampleStats referenceStats;
+    simd::gatherTranslated(view, x, y, dx.data(), dy.data(), n, reference.data(), referenceStats);
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        std::vector<uint8_t> out(n);
+        simd::SampleStats stats;
+        simd::gatherOffsets(view, static_cast<std::ptrdiff_t>(y) * cols + x, linear.data(), n, out.data(), stats);
+        std::string name = simd::levelName(level);
+        test::check(out == reference, "gatherOffsets equals the translated gather at " + name);
+        test::check(stats.sum == referenceStats.sum && stats.squaredSum == referenceStats.squaredSum,
+                    "gatherOffsets sums match at " + name);
+    }
+    simd::setLevel(simd::detectLevel());
+
+    // Near the border the translated gather clamps like gatherAffine
+    std::vector<uint8_t> clamped(n);
+    simd::SampleStats clampedStats;
+    simd::gatherTranslated(view, 0, 0, dx.data(), dy.data(), n, clamped.data(), clampedStats);
+    bool inside = true;
+    for (size_t i = 0; i < n; i++) {
+        int px = std::clamp(dx[i], 0, cols - 1), py = std::clamp(dy[i], 0, rows - 1);
+        inside &= clamped[i] == pixels[py * cols + px];
+    }
+    test::check(inside, "gatherTranslated clamps points outside of the image");
+}
+
+void test_set_level_is_clamped() {
+    simd::setLevel(simd::Level::AVX512);
+    test::check(simd::activeLevel() <= simd::detectLevel(), "setLevel does not exceed the detected level");
+    simd::setLevel(simd::detectLevel());
+}
+
+int main() {
+    std::cout << "=== Sample Kernel Tests ===\n";
+    std::cout << "Detected instruction set: " << simd::levelName(simd::detectLevel())
+              << (simd::hasVnni() ? " with VNNI" : "") << "\n";
+    test_padded_length();
+    test_aligned_allocation();
+    test_dot_product_matches_reference();
+    test_dot_product_unpadded_tail();
+    test_dot_product_u8_is_exact();
+    test_gather_affine_matches_double_transform();
+    test_gather_offsets_matches_translated();
+    test_set_level_is_clamped();
+    return test::report();
+}
@@ -0,0 +1,98 @@
+#include "TestFramework.hpp"
+#include "src/GeometryUtils.hpp"
+#include "src/SamplingPatternCache.hpp"
+
+#include <cmath>
+#include <random>
+
+namespace {
+std::vector<cv::Point> randomPoints(size_t n) {
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> xDist(0, 639), yDist(0, 479);
+    std::vector<cv::Point> points(n);
+    for (auto& p : points) {
+        p = cv::Point(xDist(gen), yDist(gen));
+    }
+    return points;
+}
+
+const cv::Point kCenter(320, 240);
+} // namespace
+
+void test_pattern_matches_particle_transform() {
+    auto points = randomPoints(2000);
+    SamplingPatternCache cache(0.01, 0.0001);
+    cache.setPoints(points, kCenter);
+    const double angle = -37.5, scale = 0.75;
+    const size_t step = 4096;
+    const SamplingPattern& pattern = cache.get(angle, scale, step);
+
+    // Absolute coordinates the way the batch sampler derives them from the particle transform
+    bool equal = true, linearOk = true;
+    const cv::Point positions[] = {{1000, 800}, {2513, 1777}, {641, 3001}};
+    for (const auto& position : positions) {
+        double m[6];
+        geometry::rotationMatrix2D(position, angle, scale, m);
+        for (size_t i = 0; i < points.size(); i++) {
+            double x = points[i].x + position.x - kCenter.x,
+                    y = points[i].y + position.y - kCenter.y;
+            int ex = static_cast<int>(std::floor(m[0] * x + m[1] * y + m[2]));
+            int ey = static_cast<int>(std::floor(m[3] * x + m[4] * y + m[5]));
+            equal &= position.x + pattern.dx[i] == ex && position.y + pattern.dy[i] == ey;
+            linearOk &= pattern.linear[i] == pattern.dy[i] * static_cast<int32_t>(step) + pattern.dx[i];
+        }
+    }
+    test::check(equal, "pattern offsets equal the particle transform at any position");
+    test::check(linearOk, "linear offsets follow the row step");
+    test::check(pattern.fits(1000, 800, 4096, 4096), "pattern fits well inside a large map");
+    test::check(!pattern.fits(0, 0, 4096, 4096), "pattern at the map corner does not fit");
+}
+
+void test_hits_and_misses() {
+    SamplingPatternCache cache(0.01, 0.0001);
+    cache.setPoints(randomPoints(100), kCenter);
+    cache.get(10.0, 1.0, 1000);
+    cache.get(10.0, 1.0, 1000);
+    // Within the quantization step the same pattern is reused
+    cache.get(10.001, 1.00001, 1000);
+    cache.get(20.0, 1.0, 1000);
+    test::check(cache.misses() == 2, "two distinct rotations miss");
+    test::check(cache.hits() == 2, "repeated and nearby rotations hit");
+    test::check(cache.size() == 2, "one entry per distinct key");
+
+    cache.setPoints(randomPoints(100), kCenter);
+    test::check(cache.size() == 2, "same points keep the cache");
+    cache.setPoints(randomPoints(50), kCenter);
+    test::check(cache.size() == 0 && cache.memoryUsage() == 0, "new points drop all patterns");
+}
+
+void test_memory_bound() {
+    SamplingPatternCache cache(0.01, 0.0001);
+    cache.setPoints(randomPoints(1000), kCenter);
+    size_t patternBytes = cache.get(0.0, 1.0, 1000).bytes();
+    cache.setMemoryLimit(patternBytes * 3);
+    for (int i = 1; i < 10; i++) {
+        cache.get(i, 1.0, 1000);
+    }
+    test::check(cache.memoryUsage() <= patternBytes * 3, "memory stays within the limit");
+    test::check(cache.size() == 3, "least recently used patterns are evicted");
+    test::check(cache.evictions() == 7, "evictions are counted");
+
+    // The newest angle survived, the oldest did not
+    uint64_t misses = cache.misses();
+    cache.get(9.0, 1.0, 1000);
+    test::check(cache.misses() == misses, "most recent pattern is still cached");
+    cache.get(0.0, 1.0, 1000);
+    test::check(cache.misses() == misses + 1, "oldest pattern was evicted");
+
+    cache.setMemoryLimit(0);
+    test::check(cache.size() == 1, "the pattern in use is kept even above the limit");
+}
+
+int main() {
+    std::cout << "=== Sampling Pattern Cache Tests ===\n";
+    test_pattern_matches_particle_transform();
+    test_hits_and_misses();
+    test_memory_bound();
+    return test::report();
+}
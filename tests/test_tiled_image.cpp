@@ -0,0 +1,107 @@
+#include "TestFramework.hpp"
+#include "src/TiledImage.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+cv::Mat randomImage(int rows, int cols, uint32_t seed) {
+    std::mt19937 gen(seed);
+    cv::Mat image(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            image.at<uint8_t>(y, x) = static_cast<uint8_t>(gen());
+        }
+    }
+    return image;
+}
+
+const simd::Level kLevels[] = {simd::Level::Scalar, simd::Level::SSE2, simd::Level::AVX2, simd::Level::AVX512};
+} // namespace
+
+void test_morton_code() {
+    test::check(TiledImage::mortonCode(0, 0) == 0, "origin is first on the curve");
+    test::check(TiledImage::mortonCode(1, 0) == 1 && TiledImage::mortonCode(0, 1) == 2 &&
+                TiledImage::mortonCode(1, 1) == 3, "2x2 block follows a Z");
+    test::check(TiledImage::mortonCode(2, 0) == 4, "next 2x2 block starts after the first");
+    test::check(TiledImage::mortonCode(0xFFFF, 0xFFFF) == 0xFFFFFFFFull, "all bits interleave");
+}
+
+void test_layout_round_trip() {
+    // Neither side is a multiple of the tile size
+    cv::Mat image = randomImage(203, 331, 1);
+    TiledImage tiled(image);
+    test::check(tiled.tilesX() == 6 && tiled.tilesY() == 4, "border tiles are counted");
+    bool equal = true;
+    for (int y = 0; y < image.rows; y++) {
+        for (int x = 0; x < image.cols; x++) {
+            equal &= tiled.at(x, y) == image.at<uint8_t>(y, x);
+        }
+    }
+    test::check(equal, "every pixel is found at its tiled offset");
+    cv::Mat back = tiled.toMat();
+    test::check(std::equal(back.data, back.data + back.rows * back.step, image.data), "toMat restores the image");
+}
+
+void test_tiles_follow_z_order() {
+    cv::Mat image = randomImage(256, 256, 2);
+    TiledImage tiled(image);
+    // Tile (1, 0) directly follows tile (0, 0), tile (0, 1) comes after both
+    test::check(tiled.offset(64, 0) == TiledImage::kTileBytes, "second tile on the curve is to the right");
+    test::check(tiled.offset(0, 64) == 2 * TiledImage::kTileBytes, "third tile on the curve is below");
+    test::check(tiled.offset(128, 0) == 4 * TiledImage::kTileBytes, "next 2x2 block follows");
+}
+
+void test_gathers_match_row_major() {
+    cv::Mat image = randomImage(777, 1003, 3);
+    TiledImage tiled(image);
+    simd::ImageView8u rowMajor{image.data, image.rows, image.cols, image.step};
+
+    std::mt19937 gen(4);
+    std::uniform_int_distribution<int> xDist(0, 639), yDist(0, 479), offsetDist(-300, 300);
+    const size_t n = 3001;
+    std::vector<int32_t> xs(n), ys(n), dx(n), dy(n);
+    for (size_t i = 0; i < n; i++) {
+        xs[i] = xDist(gen);
+        ys[i] = yDist(gen);
+        dx[i] = offsetDist(gen);
+        dy[i] = offsetDist(gen);
+    }
+    // Partly outside of the image, so clamping is covered as well
+    const double angle = 0.7, scale = 0.9;
+    const float m[6] = {
+            static_cast<float>(scale * std::cos(angle)), static_cast<float>(scale * std::sin(angle)), 150.5f,
+            static_cast<float>(-scale * std::sin(angle)), static_cast<float>(scale * std::cos(angle)), 300.25f
+    };
+    auto affine = simd::FixedAffine::fromFloat(m);
+
+    for (auto level : kLevels) {
+        if (level > simd::detectLevel()) continue;
+        simd::setLevel(level);
+        std::string name = simd::levelName(level);
+
+        std::vector<uint8_t> expected(n), got(n);
+        simd::SampleStats expectedStats, stats;
+        simd::gatherAffine(rowMajor, xs.data(), ys.data(), n, affine, expected.data(), expectedStats);
+        simd::gatherAffine(tiled.view(), xs.data(), ys.data(), n, affine, got.data(), stats);
+        test::check(got == expected && stats.sum == expectedStats.sum && stats.squaredSum == expectedStats.squaredSum,
+                    "tiled gatherAffine equals the row-major one at " + name);
+
+        expectedStats = stats = simd::SampleStats();
+        simd::gatherTranslated(rowMajor, 200, 100, dx.data(), dy.data(), n, expected.data(), expectedStats);
+        simd::gatherTranslated(tiled.view(), 200, 100, dx.data(), dy.data(), n, got.data(), stats);
+        test::check(got == expected && stats.sum == expectedStats.sum && stats.squaredSum == expectedStats.squaredSum,
+                    "tiled gatherTranslated equals the row-major one at " + name);
+    }
+    simd::setLevel(simd::detectLevel());
+}
+
+int main() {
+    std::cout << "=== Tiled Image Tests ===\n";
+    test_morton_code();
+    test_layout_round_trip();
+    test_tiles_follow_z_order();
+    test_gathers_match_row_major();
+    return test::report();
+}